@@ -0,0 +1,22 @@
+#ifndef BENCH_ALLOC_H
+#define BENCH_ALLOC_H
+
+#include <stdint.h>
+
+#include "ember_alloc.h"
+
+/**
+ * @brief Allocation calls and bytes requested so far, summed over every
+ *        subsystem's ember_mem_stats() counters.
+ */
+static inline void bench_alloc_totals(uint64_t* calls, uint64_t* bytes) {
+    *calls = 0;
+    *bytes = 0;
+    for (int s = 0; s < EMBER_MEM_SUBSYSTEM_COUNT; s++) {
+        EmberMemStats stats = ember_mem_stats((EmberMemSubsystem)s);
+        *calls += stats.calls;
+        *bytes += stats.bytes;
+    }
+}
+
+#endif // BENCH_ALLOC_H
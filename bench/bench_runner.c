@@ -0,0 +1,301 @@
+// clock_gettime() and the dirent functions under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <dirent.h>
+
+#include "compiler.h"
+#include "virtual_machine.h"
+#include "parser.h"
+#include "lexer.h"
+#include "runtime.h"
+#include "builtins.h"
+#include "event_bus.h"
+#include "bench_alloc.h"
+
+#define DEFAULT_WARMUP 2
+#define DEFAULT_REPETITIONS 10
+#define MAX_SCRIPTS 256
+
+/* -------------------------------------------------------
+   Scripts
+   ------------------------------------------------------- */
+
+typedef enum {
+    ENGINE_TREE,  // runtime_execute_block over the AST
+    ENGINE_VM     // compile_ast + vm_run
+} Engine;
+
+static const char* engine_name(Engine engine) {
+    return engine == ENGINE_TREE ? "tree" : "vm";
+}
+
+typedef struct {
+    char* name;    // File name without ".ember"
+    char* source;
+    bool engines[2];
+} Script;
+
+static char* read_file(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open file '%s'\n", filename);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    rewind(file);
+    char* buffer = (char*)malloc((size_t)length + 1);
+    if (!buffer) {
+        fclose(file);
+        return NULL;
+    }
+    size_t read_count = fread(buffer, 1, (size_t)length, file);
+    buffer[read_count] = '\0';
+    fclose(file);
+    return buffer;
+}
+
+// The first line of every bench script is "// engines: tree vm" (or a subset)
+static void parse_engines(const char* source, bool engines[2]) {
+    engines[ENGINE_TREE] = true;
+    engines[ENGINE_VM] = true;
+    const char* tag = "// engines:";
+    if (strncmp(source, tag, strlen(tag)) != 0) {
+        return;
+    }
+    const char* end = strchr(source, '\n');
+    size_t length = end ? (size_t)(end - source) : strlen(source);
+    char line[128];
+    if (length >= sizeof(line)) {
+        length = sizeof(line) - 1;
+    }
+    memcpy(line, source, length);
+    line[length] = '\0';
+    engines[ENGINE_TREE] = strstr(line, " tree") != NULL;
+    engines[ENGINE_VM] = strstr(line, " vm") != NULL;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(((const Script*)a)->name, ((const Script*)b)->name);
+}
+
+static int load_scripts(const char* dir, const char* filter, Script* scripts) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "Error: Could not open bench directory '%s'\n", dir);
+        return -1;
+    }
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL && count < MAX_SCRIPTS) {
+        const char* name = entry->d_name;
+        size_t length = strlen(name);
+        if (length <= 6 || strcmp(name + length - 6, ".ember") != 0) {
+            continue;
+        }
+        if (filter && !strstr(name, filter)) {
+            continue;
+        }
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        char* source = read_file(path);
+        if (!source) {
+            continue;
+        }
+        scripts[count].name = strndup(name, length - 6);
+        scripts[count].source = source;
+        parse_engines(source, scripts[count].engines);
+        count++;
+    }
+    closedir(d);
+    qsort(scripts, (size_t)count, sizeof(Script), compare_names);
+    return count;
+}
+
+/* -------------------------------------------------------
+   Running
+   ------------------------------------------------------- */
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+// One timed execution. Parsing and compiling happen before the clock starts.
+static bool run_once(Engine engine, ASTNode* root, BytecodeChunk* chunk, double* elapsed_ms) {
+    if (engine == ENGINE_TREE) {
+        EventBus* bus = event_bus_create();
+        event_bus_bind(bus);
+        Environment* env = runtime_create_environment();
+        builtins_register(env);
+
+        double start = now_ms();
+        runtime_execute_block(env, root);
+        *elapsed_ms = now_ms() - start;
+
+        runtime_free_environment(env);
+        event_bus_free(bus);
+        return true;
+    }
+
+    VM* vm = vm_create(chunk);
+    if (!vm) {
+        return false;
+    }
+    double start = now_ms();
+    int status = vm_run(vm);
+    *elapsed_ms = now_ms() - start;
+    vm_free(vm);
+    return status == VM_RESULT_OK;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const double* sorted, int count, double p) {
+    int rank = (int)(p / 100.0 * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+static void bench_script(const Script* script, Engine engine, int warmup, int repetitions,
+                         FILE* out, bool* first_result) {
+    Lexer lexer;
+    lexer_init(&lexer, script->source);
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    free(parser);
+
+    BytecodeChunk* chunk = NULL;
+    bool ok = root != NULL;
+    if (ok && engine == ENGINE_VM) {
+        chunk = vm_create_chunk();
+        SymbolTable* symtab = symbol_table_create();
+        ok = compile_ast(root, chunk, symtab);
+        symbol_table_free(symtab);
+    }
+
+    double* times = (double*)malloc(sizeof(double) * (size_t)repetitions);
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; ok && i < warmup + repetitions; i++) {
+        double elapsed;
+        uint64_t count_before, bytes_before, count_after, bytes_after;
+        bench_alloc_totals(&count_before, &bytes_before);
+        ok = run_once(engine, root, chunk, &elapsed);
+        bench_alloc_totals(&count_after, &bytes_after);
+        if (i >= warmup) {
+            times[i - warmup] = elapsed;
+            // Every repetition does the same work; keep the last one's counts
+            allocs = count_after - count_before;
+            bytes = bytes_after - bytes_before;
+        }
+    }
+
+    fprintf(out, "%s\n    {\"script\": \"%s\", \"engine\": \"%s\", ", *first_result ? "" : ",",
+            script->name, engine_name(engine));
+    *first_result = false;
+    if (ok) {
+        qsort(times, (size_t)repetitions, sizeof(double), compare_doubles);
+        fprintf(out, "\"status\": \"ok\", \"median_ms\": %.3f, \"p99_ms\": %.3f, \"min_ms\": %.3f, ",
+                percentile(times, repetitions, 50), percentile(times, repetitions, 99), times[0]);
+        fprintf(out, "\"allocs\": %llu, \"alloc_bytes\": %llu}",
+                (unsigned long long)allocs, (unsigned long long)bytes);
+        fprintf(stderr, "%-20s %-5s median %9.3f ms  p99 %9.3f ms\n", script->name,
+                engine_name(engine), percentile(times, repetitions, 50),
+                percentile(times, repetitions, 99));
+    } else {
+        fprintf(out, "\"status\": \"error\"}");
+        fprintf(stderr, "%-20s %-5s FAILED\n", script->name, engine_name(engine));
+    }
+
+    free(times);
+    vm_free_chunk(chunk);
+    if (root) {
+        free_ast(root);
+    }
+}
+
+static void print_usage(void) {
+    printf(
+        "Usage: ember_bench [options]\n\n"
+        "Runs every bench script on the tree walker and the VM and writes JSON results.\n\n"
+        "Options:\n"
+        "  --dir <path>       Directory of .ember bench scripts (default: bench)\n"
+        "  --out <file>       Write JSON here instead of stdout\n"
+        "  --warmup <n>       Untimed runs before measuring (default %d)\n"
+        "  --reps <n>         Timed runs per script and engine (default %d)\n"
+        "  --filter <text>    Only scripts whose file name contains <text>\n\n",
+        DEFAULT_WARMUP, DEFAULT_REPETITIONS);
+}
+
+int main(int argc, char* argv[]) {
+    const char* dir = "bench";
+    const char* out_path = NULL;
+    const char* filter = NULL;
+    int warmup = DEFAULT_WARMUP;
+    int repetitions = DEFAULT_REPETITIONS;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--dir") == 0 && has_value) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && has_value) {
+            repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (warmup < 0) warmup = 0;
+    if (repetitions < 1) repetitions = 1;
+
+    static Script scripts[MAX_SCRIPTS];
+    int count = load_scripts(dir, filter, scripts);
+    if (count < 0) {
+        return 1;
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error: Could not open output file '%s'\n", out_path);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"warmup\": %d,\n  \"repetitions\": %d,\n  \"results\": [", warmup, repetitions);
+    bool first_result = true;
+    for (int i = 0; i < count; i++) {
+        for (int engine = ENGINE_TREE; engine <= ENGINE_VM; engine++) {
+            if (scripts[i].engines[engine]) {
+                bench_script(&scripts[i], (Engine)engine, warmup, repetitions, out, &first_result);
+            }
+        }
+        free(scripts[i].name);
+        free(scripts[i].source);
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout) {
+        fclose(out);
+        fprintf(stderr, "Results written to '%s'\n", out_path);
+    }
+    return 0;
+}
@@ -0,0 +1,358 @@
+// clock_gettime() under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "compiler.h"
+#include "parser.h"
+#include "lexer.h"
+#include "bench_alloc.h"
+
+#define DEFAULT_SIZES "10K,1M,50M"
+#define DEFAULT_MIN_TIME_MS 300.0
+#define MAX_SIZES 16
+
+// Nesting depth of one unit of the "nested" corpus; the parser recurses per level
+#define NESTING_DEPTH 32
+
+// Units reuse this many global names; the compiler addresses globals with one byte
+#define NAME_POOL 128
+
+/* -------------------------------------------------------
+   Generated corpora
+   ------------------------------------------------------- */
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+static void buffer_append(Buffer* buffer, const char* text) {
+    size_t length = strlen(text);
+    if (buffer->length + length + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (buffer->length + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        char* data = (char*)realloc(buffer->data, capacity);
+        if (!data) {
+            fprintf(stderr, "Error: Memory allocation failed for generated corpus\n");
+            exit(EXIT_FAILURE);
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->length, text, length + 1);
+    buffer->length += length;
+}
+
+static void buffer_appendf(Buffer* buffer, const char* format, int a, int b) {
+    char text[256];
+    snprintf(text, sizeof(text), format, a, b);
+    buffer_append(buffer, text);
+}
+
+static void indent(Buffer* buffer, int depth) {
+    for (int i = 0; i < depth; i++) {
+        buffer_append(buffer, "    ");
+    }
+}
+
+// Alternating if/while blocks NESTING_DEPTH deep inside a function
+static void emit_nested(Buffer* buffer, int unit) {
+    buffer_appendf(buffer, "function nest_%d(x) {\n", unit % NAME_POOL, 0);
+    for (int depth = 1; depth <= NESTING_DEPTH; depth++) {
+        indent(buffer, depth);
+        if (depth % 2) {
+            buffer_appendf(buffer, "if (x > %d) {\n", depth, 0);
+        } else {
+            buffer_appendf(buffer, "while (x < %d) {\n", depth * 10, 0);
+        }
+    }
+    indent(buffer, NESTING_DEPTH + 1);
+    buffer_append(buffer, "var y = x * 2 + 1;\n");
+    indent(buffer, NESTING_DEPTH + 1);
+    buffer_append(buffer, "x = x + y;\n");
+    for (int depth = NESTING_DEPTH; depth >= 1; depth--) {
+        indent(buffer, depth);
+        buffer_append(buffer, "}\n");
+    }
+    buffer_append(buffer, "    return x;\n}\n");
+}
+
+// One long numeric array literal per unit
+static void emit_arrays(Buffer* buffer, int unit) {
+    buffer_appendf(buffer, "var data_%d = [", unit % NAME_POOL, 0);
+    for (int i = 0; i < 512; i++) {
+        buffer_appendf(buffer, i ? ", %d.%d" : "%d.%d", i * 7 + unit % 13, i % 10);
+        if (i % 16 == 15) {
+            buffer_append(buffer, "\n    ");
+        }
+    }
+    buffer_append(buffer, "];\n");
+}
+
+// Many small functions and calls between them
+static void emit_functions(Buffer* buffer, int unit) {
+    buffer_appendf(buffer, "function fn_%d(a, b) {\n", unit % NAME_POOL, 0);
+    buffer_appendf(buffer, "    var t = a * b + %d;\n", unit % 100, 0);
+    buffer_append(buffer, "    if (t > b) {\n        t = t - a;\n    }\n");
+    buffer_append(buffer, "    return t;\n}\n");
+    buffer_appendf(buffer, "var r_%d = fn_%d(1, 2);\n", unit % NAME_POOL, unit % NAME_POOL);
+}
+
+// Mostly line and block comments around a few statements
+static void emit_comments(Buffer* buffer, int unit) {
+    buffer_append(buffer, "/*\n * Block comment describing the next few statements in some detail,\n");
+    buffer_append(buffer, " * long enough that skipping it dominates the lexer's time.\n */\n");
+    for (int i = 0; i < 6; i++) {
+        buffer_appendf(buffer, "// Line comment %d of unit %d: explains the code that follows it.\n", i, unit);
+    }
+    buffer_appendf(buffer, "var c_%d = %d / 2; // trailing comment\n", unit % NAME_POOL, unit);
+}
+
+typedef struct {
+    const char* name;
+    void (*emit_unit)(Buffer* buffer, int unit);
+} Corpus;
+
+static const Corpus corpora[] = {
+    { "nested", emit_nested },
+    { "arrays", emit_arrays },
+    { "functions", emit_functions },
+    { "comments", emit_comments },
+};
+
+static Buffer generate(const Corpus* corpus, size_t target_bytes) {
+    Buffer buffer = { NULL, 0, 0 };
+    for (int unit = 0; buffer.length < target_bytes; unit++) {
+        corpus->emit_unit(&buffer, unit);
+    }
+    return buffer;
+}
+
+/* -------------------------------------------------------
+   Phases
+   ------------------------------------------------------- */
+
+typedef enum {
+    PHASE_LEX,      // lexer_next_token until EOF
+    PHASE_PARSE,    // parse_script (lexing included)
+    PHASE_COMPILE   // compile_ast on an already parsed tree
+} Phase;
+
+static const char* phase_names[] = { "lex", "parse", "compile" };
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static ASTNode* parse_source(const char* source) {
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    free(parser);
+    return root;
+}
+
+// One timed pass of `phase`; whatever the pass builds is freed after the clock stops
+static bool run_phase(Phase phase, const char* source, ASTNode* tree, double* elapsed_ms) {
+    double start = now_ms();
+    switch (phase) {
+        case PHASE_LEX: {
+            Lexer lexer;
+            lexer_init(&lexer, source);
+            Token token;
+            do {
+                token = lexer_next_token(&lexer);
+                free_token(&token);
+            } while (token.type != TOKEN_EOF && token.type != TOKEN_ERROR);
+            *elapsed_ms = now_ms() - start;
+            return token.type == TOKEN_EOF;
+        }
+        case PHASE_PARSE: {
+            ASTNode* root = parse_source(source);
+            *elapsed_ms = now_ms() - start;
+            if (!root) {
+                return false;
+            }
+            free_ast(root);
+            return true;
+        }
+        case PHASE_COMPILE: {
+            BytecodeChunk* chunk = vm_create_chunk();
+            SymbolTable* symtab = symbol_table_create();
+            bool ok = compile_ast(tree, chunk, symtab);
+            *elapsed_ms = now_ms() - start;
+            symbol_table_free(symtab);
+            vm_free_chunk(chunk);
+            return ok;
+        }
+    }
+    return false;
+}
+
+static void format_size(size_t bytes, char* out, size_t out_size) {
+    if (bytes >= 1024 * 1024) {
+        snprintf(out, out_size, "%.1fM", (double)bytes / (1024.0 * 1024.0));
+    } else {
+        snprintf(out, out_size, "%.1fK", (double)bytes / 1024.0);
+    }
+}
+
+static void bench_phase(const Corpus* corpus, const Buffer* source, ASTNode* tree, Phase phase,
+                        double min_time_ms, FILE* out, bool* first_result) {
+    // Repeat until enough time has accumulated for a stable rate; big inputs run once
+    double total_ms = 0.0;
+    int runs = 0;
+    uint64_t allocs = 0;
+    bool ok = true;
+    while (ok && (runs == 0 || total_ms < min_time_ms)) {
+        uint64_t count_before, count_after, bytes;
+        bench_alloc_totals(&count_before, &bytes);
+        double elapsed;
+        ok = run_phase(phase, source->data, tree, &elapsed);
+        bench_alloc_totals(&count_after, &bytes);
+        if (runs == 0) {
+            allocs = count_after - count_before;
+        }
+        total_ms += elapsed;
+        runs++;
+    }
+
+    char size[32];
+    format_size(source->length, size, sizeof(size));
+    fprintf(out, "%s\n    {\"corpus\": \"%s\", \"bytes\": %zu, \"phase\": \"%s\", ",
+            *first_result ? "" : ",", corpus->name, source->length, phase_names[phase]);
+    *first_result = false;
+    if (!ok) {
+        fprintf(out, "\"status\": \"error\"}");
+        fprintf(stderr, "%-10s %8s %-8s FAILED\n", corpus->name, size, phase_names[phase]);
+        return;
+    }
+
+    double mb_per_s = (double)source->length / 1e6 / (total_ms / runs / 1000.0);
+    double allocs_per_kb = (double)allocs / ((double)source->length / 1024.0);
+    fprintf(out, "\"status\": \"ok\", \"runs\": %d, \"mb_per_s\": %.2f, ", runs, mb_per_s);
+    fprintf(out, "\"allocs_per_kb\": %.2f}", allocs_per_kb);
+    fprintf(stderr, "%-10s %8s %-8s %9.2f MB/s  %9.2f allocs/KB\n", corpus->name, size,
+            phase_names[phase], mb_per_s, allocs_per_kb);
+}
+
+/* -------------------------------------------------------
+   Driver
+   ------------------------------------------------------- */
+
+// "10K,1M,50M" -> byte counts; returns how many were parsed, or -1 on a bad entry
+static int parse_sizes(const char* text, size_t* sizes) {
+    int count = 0;
+    const char* p = text;
+    while (*p && count < MAX_SIZES) {
+        char* end;
+        double value = strtod(p, &end);
+        if (end == p || value <= 0) {
+            return -1;
+        }
+        if (*end == 'K' || *end == 'k') {
+            value *= 1024;
+            end++;
+        } else if (*end == 'M' || *end == 'm') {
+            value *= 1024 * 1024;
+            end++;
+        }
+        sizes[count++] = (size_t)value;
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
+        }
+        p = end;
+    }
+    return count;
+}
+
+static void print_usage(void) {
+    printf(
+        "Usage: ember_frontend_bench [options]\n\n"
+        "Measures lexer, parser and compiler throughput on generated scripts.\n\n"
+        "Options:\n"
+        "  --sizes <list>     Corpus sizes, e.g. 10K,1M,50M (default %s)\n"
+        "  --filter <text>    Only corpora whose name contains <text>\n"
+        "                     (nested, arrays, functions, comments)\n"
+        "  --min-time <ms>    Repeat each phase until this much time is measured (default %.0f)\n"
+        "  --out <file>       Write JSON here instead of stdout\n\n",
+        DEFAULT_SIZES, DEFAULT_MIN_TIME_MS);
+}
+
+int main(int argc, char* argv[]) {
+    const char* sizes_text = DEFAULT_SIZES;
+    const char* filter = NULL;
+    const char* out_path = NULL;
+    double min_time_ms = DEFAULT_MIN_TIME_MS;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--sizes") == 0 && has_value) {
+            sizes_text = argv[++i];
+        } else if (strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time") == 0 && has_value) {
+            min_time_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    size_t sizes[MAX_SIZES];
+    int size_count = parse_sizes(sizes_text, sizes);
+    if (size_count <= 0) {
+        fprintf(stderr, "Error: Invalid --sizes list '%s'\n", sizes_text);
+        return 1;
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error: Could not open output file '%s'\n", out_path);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"results\": [");
+    bool first_result = true;
+    for (size_t c = 0; c < sizeof(corpora) / sizeof(corpora[0]); c++) {
+        const Corpus* corpus = &corpora[c];
+        if (filter && !strstr(corpus->name, filter)) {
+            continue;
+        }
+        for (int s = 0; s < size_count; s++) {
+            Buffer source = generate(corpus, sizes[s]);
+            bench_phase(corpus, &source, NULL, PHASE_LEX, min_time_ms, out, &first_result);
+            bench_phase(corpus, &source, NULL, PHASE_PARSE, min_time_ms, out, &first_result);
+
+            ASTNode* tree = parse_source(source.data);
+            if (tree) {
+                bench_phase(corpus, &source, tree, PHASE_COMPILE, min_time_ms, out, &first_result);
+                free_ast(tree);
+            }
+            free(source.data);
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout) {
+        fclose(out);
+        fprintf(stderr, "Results written to '%s'\n", out_path);
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+// array.h
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include <stdbool.h>
+
+#include "runtime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How an array stores its elements.
+ *
+ * Every array starts out as ARRAY_KIND_DOUBLE, holding its numbers unboxed
+ * in a plain `double[]`. The first non-number written to it moves it to
+ * ARRAY_KIND_GENERIC for good.
+ */
+typedef enum {
+    ARRAY_KIND_DOUBLE,  ///< Every element is a number
+    ARRAY_KIND_GENERIC  ///< Elements are full RuntimeValues
+} ArrayKind;
+
+/**
+ * @brief A growable script array.
+ *
+ * Arrays are reference counted like objects: runtime_value_copy() retains
+ * and runtime_free_value() releases, so copies share the same elements.
+ */
+typedef struct ScriptArray ScriptArray;
+
+/**
+ * @brief Create an empty array with room for `capacity` elements.
+ *
+ * @return ScriptArray* The new array (reference count one), or NULL on
+ *         allocation failure.
+ */
+ScriptArray* array_create(int capacity);
+
+/**
+ * @brief Create an ARRAY_KIND_DOUBLE array of `count` elements and hand
+ *        back its storage in `*numbers` for the caller to fill.
+ *
+ * @return ScriptArray* The new array, or NULL on allocation failure.
+ */
+ScriptArray* array_create_numbers(int count, double** numbers);
+
+/**
+ * @brief Take another reference to `array`.
+ */
+void array_retain(ScriptArray* array);
+
+/**
+ * @brief Drop a reference; the last one frees the array and its elements.
+ */
+void array_release(ScriptArray* array);
+
+/**
+ * @brief Number of elements.
+ */
+int array_count(const ScriptArray* array);
+
+/**
+ * @brief The array's current storage kind.
+ */
+ArrayKind array_kind(const ScriptArray* array);
+
+/**
+ * @brief The unboxed elements of an ARRAY_KIND_DOUBLE array, else NULL.
+ *
+ * The pointer stays valid until the array grows or changes kind.
+ */
+const double* array_numbers(const ScriptArray* array);
+
+/**
+ * @brief Element `index`, which must be in range.
+ *
+ * Numbers come back by value; other values are the array's own, so copy
+ * them with runtime_value_copy() to keep them.
+ */
+RuntimeValue array_get(const ScriptArray* array, int index);
+
+/**
+ * @brief Replace element `index`, which must be in range.
+ *
+ * The array takes ownership of `value` and frees the value it replaces.
+ *
+ * @return bool False on allocation failure (`value` is then freed).
+ */
+bool array_set(ScriptArray* array, int index, RuntimeValue value);
+
+/**
+ * @brief Append `value`, taking ownership of it.
+ *
+ * @return bool False on allocation failure (`value` is then untouched).
+ */
+bool array_push(ScriptArray* array, RuntimeValue value);
+
+/**
+ * @brief New array holding copies of elements [start, end).
+ *
+ * Negative bounds count from the end; both are clamped to the array. The
+ * slice keeps the source's kind.
+ *
+ * @return ScriptArray* The new array, or NULL on allocation failure.
+ */
+ScriptArray* array_slice(const ScriptArray* array, int start, int end);
+
+/**
+ * @brief Converts a script slice bound to an int array_slice() accepts.
+ *
+ * `bound` must be finite. It is clamped to [-count, count] first, so the
+ * cast cannot overflow and the slice is the same as for the unclamped value.
+ */
+int array_slice_bound(double bound, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ARRAY_H
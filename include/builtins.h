@@ -3,6 +3,10 @@
 
 #include "runtime.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Register all built-in functions to the runtime environment.
  *
@@ -139,5 +143,124 @@ RuntimeValue builtin_debug(Environment* env, RuntimeValue* args, int arg_count);
 RuntimeValue builtin_rand_int(Environment* env, RuntimeValue* args, int arg_count);
 RuntimeValue builtin_rand_choice(Environment* env, RuntimeValue* args, int arg_count);
 
+/**
+ * Data-parallel array operations
+ *
+ * The array is split into contiguous chunks that run on the shared worker
+ * pool. The calling environment is snapshotted once per call and shared
+ * read-only; each chunk calls the callback in its own scope on top of it,
+ * so assignments made by the callback are not visible to the caller or to
+ * other chunks. Results are merged in index order.
+ */
+
+/**
+ * @brief `parallel_map(array, fn)`: new array of fn(element) for each element.
+ */
+RuntimeValue builtin_parallel_map(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `parallel_filter(array, fn)`: elements for which fn(element) returns true.
+ */
+RuntimeValue builtin_parallel_filter(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `parallel_reduce(array, fn, initial)`: fold with fn(accumulator, element).
+ *
+ * Chunks are folded independently and the partial results are then folded
+ * from `initial` in order, so `fn` must be associative.
+ */
+RuntimeValue builtin_parallel_reduce(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * Numeric arrays
+ *
+ * These run over arrays whose elements are all numbers, using the SSE2 or
+ * AVX2 kernels picked for this CPU (see numeric_kernels.h). Packed arrays
+ * are read in place; others are unboxed first. The array-returning ones
+ * build a new array and leave their arguments unchanged.
+ */
+
+/**
+ * @brief `sum(array)`: total of the elements (0 for an empty array).
+ */
+RuntimeValue builtin_sum(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `min(array)` / `max(array)`: smallest / largest element (null if empty).
+ */
+RuntimeValue builtin_min(Environment* env, RuntimeValue* args, int arg_count);
+RuntimeValue builtin_max(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `dot(a, b)`: sum of a[i] * b[i] over two arrays of the same length.
+ */
+RuntimeValue builtin_dot(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `scale(array, k)`: new array of array[i] * k.
+ */
+RuntimeValue builtin_scale(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `add_arrays(a, b)`: new array of a[i] + b[i].
+ */
+RuntimeValue builtin_add_arrays(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `clamp_all(array, lo, hi)`: new array with each element clamped to [lo, hi].
+ */
+RuntimeValue builtin_clamp_all(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief Index of the builtin `name` in the table the VM calls through
+ *        OP_CALL_NATIVE, or -1 if compiled code cannot call it directly.
+ */
+int builtins_native_index(const char* name);
+
+/**
+ * @brief The builtin at `index` in that table, or NULL if out of range.
+ */
+BuiltinFunction builtins_native(int index);
+
+/**
+ * @brief `on(name, fn)`: add `fn` as a handler for the event `name`.
+ *
+ * Registers into the EventBus bound to the calling thread (see
+ * event_bus_bind); several handlers per event are run in registration order.
+ */
+RuntimeValue builtin_on(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `emit(name[, data])`: run the handlers for `name` right away.
+ *
+ * Handlers receive `data` when it is given. Returns how many ran.
+ */
+RuntimeValue builtin_emit(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * Timers
+ *
+ * Callbacks run during timer_wheel_tick() on the wheel bound to the calling
+ * thread (see timer_wheel_bind).
+ */
+
+/**
+ * @brief `set_timeout(fn, ms)`: call fn once after ms milliseconds; returns a timer id.
+ */
+RuntimeValue builtin_set_timeout(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `set_interval(fn, ms)`: call fn every ms milliseconds; returns a timer id.
+ */
+RuntimeValue builtin_set_interval(Environment* env, RuntimeValue* args, int arg_count);
+
+/**
+ * @brief `cancel(id)`: stop a pending timer; returns whether it was pending.
+ */
+RuntimeValue builtin_cancel(Environment* env, RuntimeValue* args, int arg_count);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif // BUILTINS_H
@@ -5,6 +5,10 @@
 #include "parser.h"
 #include "virtual_machine.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Simple structure to hold symbol info (variable or function).
  *        For now, we only handle top-level variables. You could extend
@@ -25,8 +29,21 @@ typedef struct {
     Symbol* symbols;
     int capacity;
     int count;
+
+    struct LocalScope* scope; // Function body being compiled (NULL at top level)
 } SymbolTable;
 
+/**
+ * @brief Frame slots of the function currently being compiled: its
+ *        parameters followed by every `var` declared in its body.
+ *        Names not found here resolve to globals.
+ */
+typedef struct LocalScope {
+    char** names;
+    int count;
+    int capacity;
+} LocalScope;
+
 /**
  * @brief Create an empty symbol table.
  */
@@ -49,4 +66,24 @@ int symbol_table_get_or_add(SymbolTable* table, const char* name, bool isFunctio
  */
 bool compile_ast(ASTNode* ast, BytecodeChunk* chunk, SymbolTable* symtab);
 
+/**
+ * @brief Compute the deepest operand stack `chunk` can reach.
+ *        compile_ast stores the result in `chunk->max_stack_depth`; loaders
+ *        for pre-compiled bytecode can call this directly.
+ *        Returns -1 if the bytecode is malformed.
+ */
+int compile_max_stack_depth(const BytecodeChunk* chunk);
+
+/**
+ * @brief Number of inline caches the property sites in `chunk` refer to.
+ *        compile_ast keeps `chunk->property_cache_count` up to date; loaders
+ *        for pre-compiled bytecode call this to restore it.
+ *        Returns -1 if the bytecode is malformed.
+ */
+int compile_property_cache_count(const BytecodeChunk* chunk);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // COMPILER_H
@@ -0,0 +1,93 @@
+// ember_alloc.h
+#ifndef EMBER_ALLOC_H
+#define EMBER_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The part of Ember an allocation is made on behalf of.
+ */
+typedef enum {
+    EMBER_MEM_LEXER,
+    EMBER_MEM_PARSER,
+    EMBER_MEM_COMPILER,
+    EMBER_MEM_VM,        // VM, bytecode chunks, scheduler and profilers
+    EMBER_MEM_RUNTIME,   // Tree walker, environments, events, timers, worker pool
+    EMBER_MEM_BUILTINS,
+    EMBER_MEM_SUBSYSTEM_COUNT
+} EmberMemSubsystem;
+
+/**
+ * @brief Memory functions every Ember allocation and free goes through.
+ *
+ * `alloc` and `realloc` return NULL on failure; an allocator enforcing a
+ * budget does so by refusing requests. `realloc` with a NULL `ptr` behaves
+ * like `alloc`. `user` is passed back unchanged on every call.
+ */
+typedef struct {
+    void* (*alloc)(void* user, size_t size);
+    void* (*realloc)(void* user, void* ptr, size_t size);
+    void (*free)(void* user, void* ptr);
+    void* user;
+} EmberAllocator;
+
+/**
+ * @brief Per-subsystem counters since start-up or the last reset.
+ */
+typedef struct {
+    uint64_t calls;     // alloc + realloc requests
+    uint64_t bytes;     // Bytes requested by those calls
+    uint64_t failures;  // Requests the allocator refused
+} EmberMemStats;
+
+/**
+ * @brief Route all Ember memory through `allocator` (NULL restores malloc/free).
+ *
+ * Memory is freed by whichever subsystem ends up owning it, so there is a
+ * single allocator for the whole process. Install it before creating any
+ * lexer, parser, chunk, VM or environment: blocks obtained from the previous
+ * allocator must not be freed through the new one.
+ */
+void ember_set_allocator(const EmberAllocator* allocator);
+
+/**
+ * @brief The allocator currently in use.
+ */
+const EmberAllocator* ember_get_allocator(void);
+
+/**
+ * @brief Allocation wrappers used throughout Ember. They count against
+ *        `subsystem`; memory from any of them is released with ember_free().
+ */
+void* ember_malloc(EmberMemSubsystem subsystem, size_t size);
+void* ember_calloc(EmberMemSubsystem subsystem, size_t count, size_t size);
+void* ember_realloc(EmberMemSubsystem subsystem, void* ptr, size_t size);
+char* ember_strdup(EmberMemSubsystem subsystem, const char* s);
+char* ember_strndup(EmberMemSubsystem subsystem, const char* s, size_t n);
+void ember_free(void* ptr);
+
+/**
+ * @brief Read the counters for `subsystem`. Safe to call while scripts run.
+ */
+EmberMemStats ember_mem_stats(EmberMemSubsystem subsystem);
+
+/**
+ * @brief Zero every subsystem's counters.
+ */
+void ember_mem_stats_reset(void);
+
+/**
+ * @brief Lower-case name of `subsystem` ("lexer", "vm", ...) for reports.
+ */
+const char* ember_mem_subsystem_name(EmberMemSubsystem subsystem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMBER_ALLOC_H
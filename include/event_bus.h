@@ -0,0 +1,107 @@
+// event_bus.h
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "runtime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Events handled per event_bus_dispatch() call when no batch size is given.
+#define EVENT_BUS_DEFAULT_BATCH 256
+
+/**
+ * @brief Script event registry plus a queue that other threads post into.
+ *
+ * Handlers are registered with `on(name, fn)` and stored in a hash table
+ * keyed by the FNV-1a hash of the event name, so dispatch never walks the
+ * environment. Any thread may call event_bus_post(); posting is a single
+ * atomic exchange and never blocks. Only the script thread that owns the
+ * bus registers handlers and dispatches.
+ */
+typedef struct EventBus EventBus;
+
+/**
+ * @brief Create an empty event bus.
+ *
+ * @return EventBus* The new bus, or NULL on allocation failure.
+ */
+EventBus* event_bus_create(void);
+
+/**
+ * @brief Free a bus, its handlers and any events still queued.
+ *
+ * No thread may be posting while the bus is freed.
+ */
+void event_bus_free(EventBus* bus);
+
+/**
+ * @brief 32-bit FNV-1a hash of an event name.
+ */
+uint32_t event_bus_hash(const char* name);
+
+/**
+ * @brief Make `bus` the one the calling thread's scripts use for `on()` and
+ *        runtime_trigger_event(). Pass NULL to unbind.
+ */
+void event_bus_bind(EventBus* bus);
+
+/**
+ * @brief The bus bound to the calling thread, or NULL.
+ */
+EventBus* event_bus_current(void);
+
+/**
+ * @brief Add a handler for `name`. Handlers run in registration order.
+ *
+ * @param bus The event bus.
+ * @param name Event name.
+ * @param handler A function value; the bus keeps its own copy.
+ * @return bool false if `handler` is not a function or allocation failed.
+ */
+bool event_bus_on(EventBus* bus, const char* name, const RuntimeValue* handler);
+
+/**
+ * @brief Number of handlers registered for `name`.
+ */
+int event_bus_handler_count(const EventBus* bus, const char* name);
+
+/**
+ * @brief Queue an event from any thread.
+ *
+ * @param bus The event bus.
+ * @param name Event name (copied).
+ * @param data Argument passed to each handler (deep-copied), or NULL for none.
+ * @return bool false if the event could not be allocated.
+ */
+bool event_bus_post(EventBus* bus, const char* name, const RuntimeValue* data);
+
+/**
+ * @brief Run the handlers of up to `max_events` queued events, oldest first.
+ *
+ * Must be called from the script thread. Events posted while the batch is
+ * running wait for the next call.
+ *
+ * @param bus The event bus.
+ * @param env Environment the handlers run in (normally the global one).
+ * @param max_events Batch size; 0 or less means EVENT_BUS_DEFAULT_BATCH.
+ * @return int Number of events dispatched.
+ */
+int event_bus_dispatch(EventBus* bus, Environment* env, int max_events);
+
+/**
+ * @brief Run the handlers for `name` immediately on the calling thread.
+ *
+ * @return int Number of handlers called.
+ */
+int event_bus_emit(EventBus* bus, Environment* env, const char* name, const RuntimeValue* data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_BUS_H
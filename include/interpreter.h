@@ -7,6 +7,10 @@
 #include "virtual_machine.h"
 #include "runtime.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Execute a script from source code.
  * 
@@ -15,4 +19,8 @@
  */
 int interpreter_execute_script(const char* source);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // INTERPRETER_H
@@ -3,6 +3,10 @@
 
 #include <stdbool.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Token types for the scripting language
 typedef enum {
     TOKEN_IDENTIFIER,  // Names (e.g., variable or function names)
@@ -20,9 +24,10 @@ typedef enum {
 // Token structure
 typedef struct {
     ScriptTokenType type;  // Type of the token
-    char* value;     // Value of the token (e.g., "42", "+")
+    char* value;     // Value of the token (e.g., "+"); NULL for numbers
     int line;        // Line number of the token
     int column;      // Column number of the token
+    double number;   // TOKEN_NUMBER only: the literal's value
 } Token;
 
 // Lexer structure
@@ -64,6 +69,18 @@ void lexer_skip_whitespace(Lexer* lexer);
  */
 char* lexer_read_identifier(Lexer* lexer);
 
+/**
+ * @brief Reads a numeric literal and returns its value.
+ *
+ * Accepts digits with an optional fraction (`.` followed by a digit) and an
+ * optional exponent (`e` or `E`, an optional sign and digits). The result is
+ * the double nearest the decimal value, as strtod() would give.
+ *
+ * @param lexer The lexer instance, positioned on the first digit.
+ * @return double The literal's value.
+ */
+double lexer_read_number(Lexer* lexer);
+
 void lexer_skip_whitespace_and_comments(Lexer* lexer);
 
 char lexer_peek(Lexer* lexer);
@@ -100,4 +117,8 @@ void free_token(Token* token);
  */
 void print_token(const Token* token);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // LEXER_H
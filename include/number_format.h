@@ -0,0 +1,34 @@
+// number_format.h
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Bytes number_format() may write, terminator included.
+#define NUMBER_FORMAT_BUFFER_SIZE 32
+
+/**
+ * @brief Write `value` as the short decimal text scripts see when a number
+ *        is printed, concatenated or passed to to_string().
+ *
+ * Whole numbers print without a fraction ("42"). Other values print with
+ * digits that read back as exactly the same double, usually the fewest
+ * possible ("0.1", not "0.10000000000000001"); a small fraction of values
+ * get one digit more than the shortest round-trip text. Values of 1e21 and above, or below
+ * 1e-6, use an exponent ("1e+21", "2.5e-7"). Non-finite values print as
+ * "nan", "inf" and "-inf". Negative zero prints as "0".
+ *
+ * @param out At least NUMBER_FORMAT_BUFFER_SIZE bytes; NUL-terminated.
+ * @return size_t Length of the text, excluding the terminator.
+ */
+size_t number_format(double value, char* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NUMBER_FORMAT_H
@@ -0,0 +1,58 @@
+// numeric_kernels.h
+#ifndef NUMERIC_KERNELS_H
+#define NUMERIC_KERNELS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Instruction sets the numeric kernels are built for.
+ */
+typedef enum {
+    NUMERIC_ISA_SCALAR,
+    NUMERIC_ISA_SSE2,
+    NUMERIC_ISA_AVX2,
+    NUMERIC_ISA_COUNT
+} NumericIsa;
+
+/**
+ * @brief Loops over contiguous doubles used by the numeric array builtins.
+ *
+ * Every kernel accepts any length, including zero; `out` may alias an
+ * input. Vector kernels add in a different order than a plain loop, so
+ * sum() and dot() can differ from the scalar result in the last bits.
+ * min() and max() of an empty range are +inf and -inf. Every instruction
+ * set skips NaN elements in min() and max(), and clamp() maps them to `lo`.
+ */
+typedef struct {
+    NumericIsa isa;
+    const char* name;
+    double (*sum)(const double* values, size_t count);
+    double (*min)(const double* values, size_t count);
+    double (*max)(const double* values, size_t count);
+    double (*dot)(const double* a, const double* b, size_t count);
+    void (*scale)(double* out, const double* values, size_t count, double factor);
+    void (*add)(double* out, const double* a, const double* b, size_t count);
+    void (*clamp)(double* out, const double* values, size_t count, double lo, double hi);
+} NumericKernels;
+
+/**
+ * @brief The fastest kernels this CPU supports, picked with CPUID on
+ *        first use.
+ */
+const NumericKernels* numeric_kernels(void);
+
+/**
+ * @brief The kernels for one instruction set, or NULL if this build or
+ *        CPU lacks it. Meant for tests and benchmarks.
+ */
+const NumericKernels* numeric_kernels_for(NumericIsa isa);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NUMERIC_KERNELS_H
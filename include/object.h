@@ -0,0 +1,129 @@
+// object.h
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <stdbool.h>
+
+#include "runtime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Properties an object may have before it switches to dictionary mode.
+#define OBJECT_DICTIONARY_THRESHOLD 32
+
+/**
+ * @brief A hidden class: the ordered list of property names an object has.
+ *
+ * Objects built by adding the same properties in the same order share one
+ * shape, so "where does `health` live" is answered once per shape rather
+ * than once per object. Adding a property follows (or creates) a transition
+ * to a child shape. Shapes are shared by every thread and never freed.
+ */
+typedef struct Shape Shape;
+
+/**
+ * @brief A script object: a shape plus one value slot per property.
+ *
+ * An object that outgrows OBJECT_DICTIONARY_THRESHOLD properties, or is
+ * given a key that is not an identifier (say "item-42"), switches for good
+ * to dictionary mode: its properties move into a hash table and it stops
+ * taking part in shapes and inline caches.
+ *
+ * Objects are reference counted; runtime_value_copy() retains and
+ * runtime_free_value() releases, so copies share the same properties.
+ */
+typedef struct ScriptObject ScriptObject;
+
+/**
+ * @brief The shape of an object with no properties.
+ */
+const Shape* shape_root(void);
+
+/**
+ * @brief Slot holding `key` in objects of this shape, or -1 if absent.
+ */
+int shape_lookup(const Shape* shape, const char* key);
+
+/**
+ * @brief Shape reached by adding `key` to `shape`.
+ *
+ * The transition is created on first use and reused afterwards, from any
+ * thread. Returns NULL on allocation failure.
+ */
+const Shape* shape_transition(const Shape* shape, const char* key);
+
+/**
+ * @brief Number of properties objects of this shape have.
+ */
+int shape_property_count(const Shape* shape);
+
+/**
+ * @brief Name of the property stored in `slot`.
+ */
+const char* shape_key(const Shape* shape, int slot);
+
+/**
+ * @brief Create an empty object with a reference count of one.
+ *
+ * @return ScriptObject* The new object, or NULL on allocation failure.
+ */
+ScriptObject* object_create(void);
+
+/**
+ * @brief Take another reference to `object`.
+ */
+void object_retain(ScriptObject* object);
+
+/**
+ * @brief Drop a reference; the last one frees the object and its values.
+ */
+void object_release(ScriptObject* object);
+
+/**
+ * @brief The object's current shape.
+ */
+const Shape* object_shape(const ScriptObject* object);
+
+/**
+ * @brief Whether the object keeps its properties in a hash table.
+ */
+bool object_is_dictionary(const ScriptObject* object);
+
+/**
+ * @brief Number of properties the object has.
+ */
+int object_property_count(const ScriptObject* object);
+
+/**
+ * @brief Value of property `key`, or NULL if the object does not have it.
+ *
+ * The pointer stays valid until the object gains another property.
+ */
+RuntimeValue* object_get(ScriptObject* object, const char* key);
+
+/**
+ * @brief Set property `key`, adding it if needed.
+ *
+ * The object takes ownership of `value` and frees the value it replaces.
+ *
+ * @return bool False on allocation failure (`value` is then freed).
+ */
+bool object_set(ScriptObject* object, const char* key, RuntimeValue value);
+
+/**
+ * @brief Call `visit` once for every property of `object`.
+ *
+ * Shaped objects are visited in the order their properties were added.
+ * `visit` must not add properties to `object`.
+ */
+void object_for_each(ScriptObject* object,
+                     void (*visit)(const char* key, RuntimeValue* value, void* context),
+                     void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OBJECT_H
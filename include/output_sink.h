@@ -0,0 +1,145 @@
+// output_sink.h
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Buffer size of the default stdout sink and of sinks created with size 0.
+#define OUTPUT_SINK_DEFAULT_BUFFER (64 * 1024)
+
+/**
+ * @brief Where a sink's bytes end up.
+ */
+typedef enum {
+    OUTPUT_SINK_STDOUT,  ///< Buffered, written to the process's stdout
+    OUTPUT_SINK_FILE,    ///< Buffered, written to a file the sink opened
+    OUTPUT_SINK_MEMORY   ///< Kept in memory for the host to read
+} OutputSinkKind;
+
+/**
+ * @brief Destination for script output: print() and OP_PRINT.
+ *
+ * Stdout and file sinks collect output in a buffer and write it out in one
+ * call when the buffer fills up or the sink is flushed, instead of once per
+ * printed value. A memory sink keeps everything for the host to read.
+ * Every sink may be written from several threads; each write, and each
+ * line written with output_sink_write_line(), is atomic.
+ *
+ * Scripts print to the sink bound to their thread with output_sink_bind(),
+ * else to the process's sink (output_sink_install()), else to a built-in
+ * stdout sink. That one is flushed at exit, and writes straight through
+ * when stdout is a terminal so interactive output is not held back.
+ */
+typedef struct OutputSink OutputSink;
+
+/**
+ * @brief Create a sink that buffers up to `buffer_size` bytes before writing
+ *        them to stdout (0 means OUTPUT_SINK_DEFAULT_BUFFER).
+ *
+ * @return OutputSink* The new sink, or NULL on allocation failure.
+ */
+OutputSink* output_sink_create_stdout(size_t buffer_size);
+
+/**
+ * @brief Create a buffered sink writing to `path`, truncated or appended to.
+ *
+ * @return OutputSink* The new sink, or NULL if the file cannot be opened.
+ */
+OutputSink* output_sink_create_file(const char* path, bool append, size_t buffer_size);
+
+/**
+ * @brief Create a sink that captures output in memory.
+ *
+ * @return OutputSink* The new sink, or NULL on allocation failure.
+ */
+OutputSink* output_sink_create_memory(void);
+
+/**
+ * @brief Flush and free a sink, closing its file if it has one.
+ *
+ * The sink must no longer be bound or installed.
+ */
+void output_sink_free(OutputSink* sink);
+
+/**
+ * @brief The sink's kind.
+ */
+OutputSinkKind output_sink_kind(const OutputSink* sink);
+
+/**
+ * @brief Append `length` bytes. A buffered sink writes its buffer out first
+ *        if they would not fit; writes larger than the buffer go straight
+ *        through.
+ *
+ * @return bool false if writing or growing the capture failed.
+ */
+bool output_sink_write(OutputSink* sink, const char* data, size_t length);
+
+/**
+ * @brief Write out everything buffered so far. Does nothing for a memory sink.
+ *
+ * @return bool false if the write failed.
+ */
+bool output_sink_flush(OutputSink* sink);
+
+/**
+ * @brief The bytes a memory sink has captured, valid until the next write or
+ *        reset. NULL for other kinds.
+ *
+ * @param length Receives the number of bytes (may be NULL).
+ */
+const char* output_sink_contents(const OutputSink* sink, size_t* length);
+
+/**
+ * @brief Discard what a memory sink has captured.
+ */
+void output_sink_reset(OutputSink* sink);
+
+/**
+ * @brief Append `length` bytes and a newline as one write, so lines printed
+ *        from different threads never interleave.
+ *
+ * @return bool false if writing or growing the capture failed.
+ */
+bool output_sink_write_line(OutputSink* sink, const char* data, size_t length);
+
+/**
+ * @brief printf-style diagnostic on stderr, written after flushing the
+ *        calling thread's sink so it never overtakes output printed before it.
+ */
+void output_sink_error(const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 1, 2)))
+#endif
+    ;
+
+/**
+ * @brief Make `sink` the one scripts on the calling thread print to. Pass
+ *        NULL to unbind.
+ */
+void output_sink_bind(OutputSink* sink);
+
+/**
+ * @brief Make `sink` the process-wide destination for threads without a
+ *        bound sink; NULL restores the built-in stdout sink. The previous
+ *        sink is flushed. Install before scripts start running.
+ *
+ * @return OutputSink* The previously installed sink, or NULL for the built-in one.
+ */
+OutputSink* output_sink_install(OutputSink* sink);
+
+/**
+ * @brief The sink the calling thread's scripts print to.
+ */
+OutputSink* output_sink_current(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OUTPUT_SINK_H
@@ -3,6 +3,10 @@
 
 #include "lexer.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // AST Node Types
 typedef enum {
     AST_LITERAL,
@@ -22,6 +26,11 @@ typedef enum {
     AST_ARRAY_LITERAL,
     AST_INDEX_ACCESS,
     AST_IMPORT,
+    AST_RETURN,          // Return statement (value may be NULL)
+    AST_OBJECT_LITERAL,  // { key = value, ... }
+    AST_PROPERTY_ACCESS, // object.property
+    AST_PROPERTY_ASSIGNMENT, // object.property = value
+    AST_INDEX_ASSIGNMENT, // target[index] = value
 } ASTNodeType;
 
 // AST Node Structure
@@ -30,7 +39,7 @@ typedef struct ASTNode {
     int line;   // Line number where this node appears
     int column; // Column number where this node appears
     union {
-        struct { ScriptTokenType token_type; char* value; } literal; // Literal values (e.g., numbers, strings)
+        struct { ScriptTokenType token_type; char* value; double number; } literal; // Literal values; numbers keep only `number`
         struct { struct ASTNode* operand; char* op_symbol; } unary_op;  // Unary operation (e.g., -x, !x)
         struct { struct ASTNode* left; struct ASTNode* right; char* op_symbol; } binary_op; // Binary operation (e.g., x + y)
         struct { char* variable; struct ASTNode* value; } assignment; // Assignment (e.g., x = y)
@@ -48,6 +57,11 @@ typedef struct ASTNode {
         struct { struct ASTNode** elements; int element_count; } array_literal; // For AST_ARRAY_LITERAL
         struct { struct ASTNode* array_expr; struct ASTNode* index_expr; } index_access; // For AST_INDEX_ACCESS
         struct { char* import_path; } import_stmt; // For AST_IMPORT
+        struct { struct ASTNode* value; } return_stmt; // For AST_RETURN
+        struct { char** keys; struct ASTNode** values; int property_count; } object_literal; // For AST_OBJECT_LITERAL
+        struct { struct ASTNode* object_expr; char* property_name; } property_access; // For AST_PROPERTY_ACCESS
+        struct { struct ASTNode* object_expr; char* property_name; struct ASTNode* value; } property_assignment; // For AST_PROPERTY_ASSIGNMENT
+        struct { struct ASTNode* array_expr; struct ASTNode* index_expr; struct ASTNode* value; } index_assignment; // For AST_INDEX_ASSIGNMENT
     };
 } ASTNode;
 
@@ -150,6 +164,14 @@ ASTNode* parse_function_definition(Parser* parser);
  */
 static ASTNode* parse_import_statement(Parser* parser);
 
+/**
+ * @brief Parse a return statement: `return;` or `return <expression>;`
+ *
+ * @param parser The parser instance.
+ * @return ASTNode* The AST_RETURN node, or NULL on error.
+ */
+ASTNode* parse_return_statement(Parser* parser);
+
 /**
  * @brief Parse an if statement with its condition and body.
  * 
@@ -252,4 +274,8 @@ void print_ast(const ASTNode* node, int depth);
 void parser_set_error_callback(Parser* parser, ParserErrorCallback callback);
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // PARSER_H
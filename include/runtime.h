@@ -2,13 +2,23 @@
 #define RUNTIME_H
 
 #include "parser.h"
+#include "thread_pool.h"
 
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Forward declarations
 typedef struct Environment Environment;
 typedef struct UserDefinedFunction UserDefinedFunction;
 typedef struct RuntimeValue RuntimeValue;
+typedef struct BytecodeFunction BytecodeFunction; // Defined in virtual_machine.h
+typedef struct Coroutine Coroutine;               // Defined in virtual_machine.h
+typedef struct ScriptObject ScriptObject;         // Defined in object.h
+typedef struct ScriptArray ScriptArray;           // Defined in array.h
+typedef struct ScriptString ScriptString;         // Defined in script_string.h
 
 // Runtime Value Types
 typedef enum {
@@ -18,7 +28,8 @@ typedef enum {
     RUNTIME_VALUE_NULL,
     RUNTIME_VALUE_ARRAY,
     RUNTIME_VALUE_OBJECT,
-    RUNTIME_VALUE_FUNCTION  // Added to handle function types in runtime
+    RUNTIME_VALUE_FUNCTION, // Added to handle function types in runtime
+    RUNTIME_VALUE_COROUTINE // VM coroutine handle (owned by the VM that created it)
 } RuntimeValueType;
 
 // User-Defined Functions
@@ -26,12 +37,14 @@ struct UserDefinedFunction {
     char* name;
     char** parameters;
     int parameter_count;
+    int local_count;     // Number of `var` declarations in the body (frame sizing hint)
     ASTNode* body;
 };
 
 typedef enum {
     FUNCTION_TYPE_BUILTIN,
-    FUNCTION_TYPE_USER
+    FUNCTION_TYPE_USER,
+    FUNCTION_TYPE_BYTECODE  // Compiled function; lives in a BytecodeChunk's constants
 } FunctionType;
 
 // Forward declaration of RuntimeValue
@@ -45,6 +58,7 @@ typedef struct {
     union {
         BuiltinFunction builtin_function;
         UserDefinedFunction* user_function;
+        BytecodeFunction* bytecode_function;
     };
 } FunctionValue;
 
@@ -53,27 +67,28 @@ struct RuntimeValue {
     RuntimeValueType type;
     union {
         double number_value;
-        char* string_value;
+        ScriptString* string_value;   // Shared, reference counted (see script_string.h)
         bool boolean_value;
-        struct {
-            struct RuntimeValue* elements;
-            int count;
-        } array_value;
-        struct {
-            char** keys;
-            struct RuntimeValue* values;
-            int count;
-        } object_value;
+        ScriptArray* array_value;     // Shared, reference counted (see array.h)
+        ScriptObject* object_value;   // Shared, reference counted (see object.h)
         FunctionValue function_value; // For functions
+        Coroutine* coroutine_value;   // For coroutines
     };
 };
 
 // Environment (linked list for variables and scope management)
+//
+// Frame headers and variable cells share this node type. Both are handed out
+// by a per-thread free list, so a recycled cell keeps its name buffer around
+// (see `name_capacity`) and rebinding it to a new variable is usually a copy
+// into existing storage rather than a fresh strdup.
 struct Environment {
     char* variable_name;
+    size_t name_capacity; // Bytes allocated for variable_name (0 if none)
     RuntimeValue value;
     Environment* next;
     Environment* parent; // Parent environment for nested scopes
+    bool shared;         // Frame header of a read-only scope (see runtime_share_environment)
 };
 
 // Runtime Error
@@ -112,6 +127,27 @@ Environment* runtime_create_environment();
  */
 Environment* runtime_create_child_environment(Environment* parent);
 
+/**
+ * @brief Create a child environment for a function call frame.
+ *
+ * Behaves like runtime_create_child_environment(), but makes sure the calling
+ * thread's environment pool holds at least `slot_hint` spare variable cells so
+ * binding parameters and locals does not fall through to malloc.
+ *
+ * @param parent Pointer to the parent environment.
+ * @param slot_hint Expected number of variables (parameters + locals).
+ * @return Environment* Pointer to the frame environment.
+ */
+Environment* runtime_create_frame(Environment* parent, int slot_hint);
+
+/**
+ * @brief Release the calling thread's cached environment nodes.
+ *
+ * Environment frames and variable cells are recycled through a per-thread
+ * free list. Long-lived worker threads should call this before exiting.
+ */
+void runtime_env_pool_trim(void);
+
 /**
  * @brief Reads and executes a .ember file into the specified environment.
  *
@@ -226,6 +262,26 @@ void runtime_free_environment(Environment* env);
  */
 void runtime_free_value(RuntimeValue* value);
 
+/**
+ * @brief Copy a runtime value so the copy can be freed independently.
+ *
+ * @param value Pointer to the RuntimeValue to copy.
+ * @return RuntimeValue The copy.
+ */
+RuntimeValue runtime_value_copy(const RuntimeValue* value);
+
+/**
+ * @brief Copy a runtime value so that nothing mutable is shared with it.
+ *
+ * Arrays and objects, and everything reachable from them, are copied too;
+ * shared and cyclic references are preserved within the copy. Other values
+ * are copied with runtime_value_copy().
+ *
+ * @param value Pointer to the RuntimeValue to clone.
+ * @return RuntimeValue The clone (null if an allocation failed).
+ */
+RuntimeValue runtime_value_clone(const RuntimeValue* value);
+
 /**
  * @brief Print a runtime value for debugging purposes.
  * 
@@ -248,13 +304,79 @@ void runtime_print_environment(const Environment* env);
  */
 char* runtime_value_to_string(const RuntimeValue* value);
 
+/// Scratch space runtime_value_text() may need, terminator included.
+#define RUNTIME_VALUE_TEXT_SIZE 32
+
 /**
- * @brief Execute a block of code in a separate thread.
- * 
+ * @brief The text a value prints and concatenates as, without allocating.
+ *
+ * Strings hand back their own bytes, which are not NUL-terminated if the
+ * string is a slice. Numbers are formatted by number_format() into
+ * `scratch`; other values map to fixed text. This is the one conversion
+ * behind print, string concatenation and to_string().
+ *
+ * @param scratch At least RUNTIME_VALUE_TEXT_SIZE bytes.
+ * @param length Receives the text's length in bytes.
+ * @return const char* The text, valid while `value` and `scratch` are.
+ */
+const char* runtime_value_text(const RuntimeValue* value, char* scratch, size_t* length);
+
+/**
+ * @brief Call a function value with already-evaluated arguments.
+ *
+ * User-defined functions run in a new frame whose parent is `env`; the
+ * arguments are copied into it, so the caller keeps ownership of `args`.
+ *
+ * @param env Environment the call is made from.
+ * @param function The function value (built-in or user-defined).
+ * @param args Argument values.
+ * @param arg_count Number of arguments.
+ * @return RuntimeValue The function's return value (null if it has none).
+ */
+RuntimeValue runtime_call_function(Environment* env, const RuntimeValue* function,
+                                   RuntimeValue* args, int arg_count);
+
+/**
+ * @brief Execute a block of code on the shared worker pool.
+ *
+ * The block runs against a snapshot of `env` taken before this returns
+ * (see runtime_snapshot_environment). Arrays and objects are deep-copied
+ * into it and strings are immutable, so the block shares no mutable script
+ * value with the caller. Coroutine handles are the exception: they are
+ * copied by reference and must not be resumed from the block. Assignments
+ * made by the block stay in the snapshot. The AST must stay alive until the
+ * task is joined.
+ *
  * @param env Pointer to the environment.
  * @param block Pointer to the block AST node.
+ * @return ThreadPoolTask* Handle for thread_pool_join/thread_pool_detach, or NULL on failure.
  */
-void runtime_execute_in_thread(Environment* env, ASTNode* block);
+ThreadPoolTask* runtime_execute_in_thread(Environment* env, ASTNode* block);
+
+/**
+ * @brief Copy every binding visible from `env` into a new root environment.
+ *
+ * Shadowed outer bindings are dropped; values are copied with
+ * runtime_value_clone(), so the snapshot shares no array or object with
+ * `env`.
+ *
+ * @param env Pointer to the environment to capture.
+ * @return Environment* The snapshot, or NULL on failure.
+ */
+Environment* runtime_snapshot_environment(Environment* env);
+
+/**
+ * @brief Make the root scope `env` read-only so tasks on several threads can
+ *        run in child scopes of it at the same time.
+ *
+ * Lookups that reach `env` still see its bindings, but writes never change
+ * it: assigning to one of its variables binds the variable in the scope just
+ * below, and an array or object read from it is first cloned into that
+ * scope, so each child sees its own copy.
+ *
+ * @param env Root environment (typically a snapshot) to share.
+ */
+void runtime_share_environment(Environment* env);
 
 /**
  * @brief Initialize the garbage collector.
@@ -303,4 +425,8 @@ typedef struct RuntimeEvent {
  */
 void runtime_trigger_event(Environment* env, RuntimeEvent* event);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // RUNTIME_H
@@ -0,0 +1,99 @@
+// scheduler.h
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "virtual_machine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Fuel (loop iterations plus calls) a fiber burns before it goes to the
+/// back of the ready queue.
+#define SCHEDULER_DEFAULT_SLICE 1000
+
+/**
+ * @brief M:N scheduler running many VMs (green threads) on a few workers.
+ *
+ * Each worker owns a FIFO ready queue. A fiber runs for one slice of
+ * vm_run_slice() and is then re-queued on the worker that ran it; a worker
+ * whose queue is empty steals from the others. Scripts leave the ready
+ * queues with sleep(ms) or wait_event(name).
+ */
+typedef struct Scheduler Scheduler;
+
+/**
+ * @brief One VM scheduled by a Scheduler. Owned by the scheduler.
+ */
+typedef struct Fiber Fiber;
+
+/**
+ * @brief Lifecycle of a fiber.
+ */
+typedef enum {
+    FIBER_READY,     ///< Queued, waiting for a worker
+    FIBER_RUNNING,   ///< Inside vm_run_slice() on some worker
+    FIBER_SLEEPING,  ///< In sleep(ms); a worker re-queues it when the time is up
+    FIBER_WAITING,   ///< In wait_event(name) until scheduler_signal()
+    FIBER_DONE       ///< Finished; see scheduler_fiber_result()
+} FiberState;
+
+/**
+ * @brief Create a scheduler and start its workers.
+ *
+ * @param worker_count Number of worker threads; 0 or less means one per online core.
+ * @param slice_budget Fuel per time slice (see vm_run_slice); 0 or less means SCHEDULER_DEFAULT_SLICE.
+ * @return Scheduler* The new scheduler, or NULL on failure.
+ */
+Scheduler* scheduler_create(int worker_count, long slice_budget);
+
+/**
+ * @brief Stop the workers and free the scheduler and all of its fibers.
+ *
+ * Fibers that have not finished are abandoned where they stopped. The VMs
+ * themselves are never freed here.
+ */
+void scheduler_destroy(Scheduler* sched);
+
+/**
+ * @brief Start running `vm` on the scheduler.
+ *
+ * The VM must stay alive and must not be run by anyone else until its fiber
+ * is FIBER_DONE or the scheduler is destroyed.
+ *
+ * @return Fiber* The fiber handle, or NULL on failure.
+ */
+Fiber* scheduler_spawn(Scheduler* sched, VM* vm);
+
+/**
+ * @brief Wake every fiber currently blocked in wait_event(`event`).
+ *
+ * Signals are not remembered: a fiber that starts waiting afterwards keeps
+ * waiting for the next one.
+ *
+ * @return int Number of fibers woken.
+ */
+int scheduler_signal(Scheduler* sched, const char* event);
+
+/**
+ * @brief Block until no fiber is ready, running or sleeping.
+ *
+ * Returns once every fiber is either done or waiting on an event.
+ */
+void scheduler_wait_idle(Scheduler* sched);
+
+/**
+ * @brief Current state of a fiber.
+ */
+FiberState scheduler_fiber_state(const Fiber* fiber);
+
+/**
+ * @brief The VMResult the fiber finished with (only meaningful once FIBER_DONE).
+ */
+int scheduler_fiber_result(const Fiber* fiber);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCHEDULER_H
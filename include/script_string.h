@@ -0,0 +1,113 @@
+// script_string.h
+#ifndef SCRIPT_STRING_H
+#define SCRIPT_STRING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How a string holds its bytes.
+ */
+typedef enum {
+    STRING_KIND_FLAT,  ///< Owns a NUL-terminated buffer
+    STRING_KIND_SLICE  ///< A range of a flat parent string, which it keeps alive
+} StringKind;
+
+/**
+ * @brief An immutable script string.
+ *
+ * Strings are reference counted like arrays and objects: runtime_value_copy()
+ * retains and runtime_free_value() releases. The bytes of a slice are not
+ * NUL-terminated; use string_cstr() where C code needs a terminator.
+ */
+typedef struct ScriptString ScriptString;
+
+/**
+ * @brief Create a flat string holding a copy of `length` bytes of `chars`.
+ *
+ * @return ScriptString* The new string (reference count one), or NULL on
+ *         allocation failure.
+ */
+ScriptString* string_create(const char* chars, size_t length);
+
+/**
+ * @brief string_create() for a NUL-terminated C string.
+ */
+ScriptString* string_from_cstr(const char* chars);
+
+/**
+ * @brief Create a flat string of `length` bytes and hand back its buffer in
+ *        `*chars` for the caller to fill. The terminator is already written.
+ *
+ * @return ScriptString* The new string, or NULL on allocation failure.
+ */
+ScriptString* string_create_uninit(size_t length, char** chars);
+
+/**
+ * @brief Take another reference to `string`.
+ */
+void string_retain(ScriptString* string);
+
+/**
+ * @brief Drop a reference; the last one frees the string (and, for a slice,
+ *        its reference to the parent).
+ */
+void string_release(ScriptString* string);
+
+/**
+ * @brief The string's storage kind.
+ */
+StringKind string_kind(const ScriptString* string);
+
+/**
+ * @brief Length in bytes.
+ */
+size_t string_length(const ScriptString* string);
+
+/**
+ * @brief The string's bytes; only string_length() of them are meaningful.
+ */
+const char* string_data(const ScriptString* string);
+
+/**
+ * @brief The string as a NUL-terminated C string, valid while `string` is.
+ *
+ * A slice copies its bytes out the first time this is asked for and keeps
+ * the copy; concurrent callers agree on a single copy.
+ */
+const char* string_cstr(const ScriptString* string);
+
+/**
+ * @brief The `length` bytes of `string` starting at `start`, which must lie
+ *        within it.
+ *
+ * Long ranges become slices that share the root string's buffer. Short
+ * ranges, and ranges small enough that they would pin a much larger parent,
+ * are copied into a flat string instead.
+ *
+ * @return ScriptString* The substring, or NULL on allocation failure.
+ */
+ScriptString* string_substring(ScriptString* string, size_t start, size_t length);
+
+/**
+ * @brief Byte-wise equality.
+ */
+bool string_equals(const ScriptString* a, const ScriptString* b);
+
+/**
+ * @brief New flat string holding `a_length` bytes of `a` followed by
+ *        `b_length` bytes of `b`.
+ *
+ * @return ScriptString* The result, or NULL on allocation failure.
+ */
+ScriptString* string_concat(const char* a, size_t a_length, const char* b, size_t b_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRIPT_STRING_H
@@ -0,0 +1,53 @@
+// string_kernels.h
+#ifndef STRING_KERNELS_H
+#define STRING_KERNELS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// string_find() result when the needle does not occur.
+#define STRING_NOT_FOUND ((size_t)-1)
+
+/**
+ * @brief Byte offset of the first `needle` in `haystack`, or
+ *        STRING_NOT_FOUND. An empty needle is found at offset 0.
+ *
+ * Candidates are found sixteen positions at a time by matching the
+ * needle's first and last bytes together, so only likely matches are
+ * compared in full.
+ */
+size_t string_find(const char* haystack, size_t haystack_len,
+                   const char* needle, size_t needle_len);
+
+/**
+ * @brief Number of non-overlapping occurrences of a non-empty `needle`,
+ *        counted left to right.
+ */
+size_t string_count(const char* haystack, size_t haystack_len,
+                    const char* needle, size_t needle_len);
+
+/**
+ * @brief Upper-case `len` bytes of UTF-8 from `in` into `out`.
+ *
+ * ASCII is mapped sixteen bytes at a time. Two-byte letters are mapped in
+ * Latin-1 (U+00C0-U+00FF), Latin Extended-A (U+0100-U+017F), Greek
+ * (U+0391-U+03C9) and Cyrillic (U+0400-U+045F) whenever their other case
+ * has the same encoded length, so the output is always exactly `len` bytes.
+ * Anything else, including malformed UTF-8, is copied unchanged. `out` may
+ * be `in`.
+ */
+void string_to_upper(char* out, const char* in, size_t len);
+
+/**
+ * @brief Lower-case counterpart of string_to_upper().
+ */
+void string_to_lower(char* out, const char* in, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STRING_KERNELS_H
@@ -0,0 +1,84 @@
+// thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Work function run by a pool worker.
+ */
+typedef void (*ThreadPoolFn)(void* arg);
+
+/**
+ * @brief Fixed-size work-stealing thread pool.
+ *
+ * Each worker owns a Chase-Lev deque: it pushes and pops its own end, idle
+ * workers steal from the other end. Tasks submitted from outside the pool go
+ * through a shared injector queue; tasks submitted from a worker land on that
+ * worker's deque.
+ */
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Join handle for a submitted task.
+ *
+ * Every handle returned by thread_pool_submit must be passed to exactly one
+ * of thread_pool_join or thread_pool_detach.
+ */
+typedef struct ThreadPoolTask ThreadPoolTask;
+
+/**
+ * @brief Create a pool and start its workers.
+ *
+ * @param worker_count Number of workers; 0 or less means one per online core.
+ * @return ThreadPool* The new pool, or NULL on failure.
+ */
+ThreadPool* thread_pool_create(int worker_count);
+
+/**
+ * @brief Stop the workers and free the pool.
+ *
+ * Tasks already queued are run to completion first. Must not be called
+ * from one of the pool's own workers.
+ */
+void thread_pool_destroy(ThreadPool* pool);
+
+/**
+ * @brief Process-wide pool used by the runtime, created on first use.
+ *
+ * @return ThreadPool* The shared pool, or NULL if it could not be started.
+ */
+ThreadPool* thread_pool_default(void);
+
+/**
+ * @brief Number of workers in a pool.
+ */
+int thread_pool_worker_count(const ThreadPool* pool);
+
+/**
+ * @brief Queue `fn(arg)` to run on the pool.
+ *
+ * @return ThreadPoolTask* Join handle, or NULL if the task could not be queued.
+ */
+ThreadPoolTask* thread_pool_submit(ThreadPool* pool, ThreadPoolFn fn, void* arg);
+
+/**
+ * @brief Wait for a task to finish and release its handle.
+ *
+ * When called from a worker of the same pool, the caller runs other queued
+ * tasks while it waits instead of blocking, so nested joins cannot deadlock.
+ */
+void thread_pool_join(ThreadPoolTask* task);
+
+/**
+ * @brief Release a handle without waiting; the task still runs.
+ */
+void thread_pool_detach(ThreadPoolTask* task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,94 @@
+// timer_wheel.h
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "runtime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Levels in the wheel; each covers 256 times the range of the one below.
+#define TIMER_WHEEL_LEVELS 4
+
+/// Slots per level.
+#define TIMER_WHEEL_SLOTS 256
+
+/**
+ * @brief Hierarchical timing wheel for script callbacks (1 ms per tick).
+ *
+ * Level 0 holds timers due within 256 ms, one slot per millisecond; level
+ * n holds timers due within 256^(n+1) ms and is cascaded down a level
+ * each time the level below wraps. Timers sit on intrusive lists, so
+ * scheduling and cancelling are O(1) regardless of how many are pending.
+ * Callbacks only run inside timer_wheel_tick(), on the thread calling it.
+ */
+typedef struct TimerWheel TimerWheel;
+
+/**
+ * @brief Create an empty wheel whose clock starts at 0.
+ *
+ * @return TimerWheel* The new wheel, or NULL on allocation failure.
+ */
+TimerWheel* timer_wheel_create(void);
+
+/**
+ * @brief Free a wheel and every pending timer.
+ */
+void timer_wheel_free(TimerWheel* wheel);
+
+/**
+ * @brief Make `wheel` the one the calling thread's scripts use for
+ *        set_timeout / set_interval / cancel. Pass NULL to unbind.
+ */
+void timer_wheel_bind(TimerWheel* wheel);
+
+/**
+ * @brief The wheel bound to the calling thread, or NULL.
+ */
+TimerWheel* timer_wheel_current(void);
+
+/**
+ * @brief Schedule `callback` to run after `delay_ms`, then every
+ *        `interval_ms` if that is positive.
+ *
+ * A delay under 1 ms (or NaN) fires on the next tick. Delays and intervals
+ * are capped at 2^32 - 1 ms, about 49 days.
+ *
+ * @return double Timer id for timer_wheel_cancel(), or -1 on failure.
+ */
+double timer_wheel_schedule(TimerWheel* wheel, const RuntimeValue* callback,
+                            double delay_ms, double interval_ms);
+
+/**
+ * @brief Cancel a pending timer. Safe to call from inside a callback,
+ *        including the timer's own.
+ *
+ * @return bool true if the timer was still pending.
+ */
+bool timer_wheel_cancel(TimerWheel* wheel, double id);
+
+/**
+ * @brief Number of timers waiting to fire.
+ */
+int timer_wheel_pending(const TimerWheel* wheel);
+
+/**
+ * @brief Advance the clock by `elapsed_ms` and run every callback that
+ *        comes due, in expiry order.
+ *
+ * @param wheel The timer wheel.
+ * @param env Environment the callbacks run in (normally the global one).
+ * @param elapsed_ms Milliseconds since the previous tick.
+ * @return int Number of callbacks run.
+ */
+int timer_wheel_tick(TimerWheel* wheel, Environment* env, uint64_t elapsed_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMER_WHEEL_H
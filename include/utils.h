@@ -1,6 +1,10 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Read the entire contents of a file into a null-terminated string.
  *
@@ -10,4 +14,8 @@
  */
 char* read_file(const char* filename);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // UTILS_H
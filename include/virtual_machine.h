@@ -2,10 +2,17 @@
 #define VIRTUAL_MACHINE_H
 
 #include <stdint.h>
+#include <setjmp.h>
+#include <limits.h>
+#include <signal.h>
 
 #include "runtime.h"
 #include "parser.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief The bytecode instruction set for EmberScript.
  */
@@ -61,8 +68,8 @@ typedef enum {
     OP_GET_INDEX,        // a[b] (array or object index)
     OP_SET_INDEX,        // a[b] = c
     OP_NEW_OBJECT,       // Create a new object/map/dict
-    OP_SET_PROPERTY,     // object.prop = value
-    OP_GET_PROPERTY,     // push object.prop
+    OP_SET_PROPERTY,     // object.prop = value; operands: name constant (u8), cache slot (u16)
+    OP_GET_PROPERTY,     // push object.prop; operands: name constant (u8), cache slot (u16)
 
     // Type conversions, printing, etc. (examples)
     OP_PRINT,            // Debug print top of stack
@@ -74,9 +81,88 @@ typedef enum {
 
     // Additional placeholders
     OP_THROW,            // Throw an error
-    OP_TRY_CATCH         // Possibly a try-catch block in the future??
+    OP_TRY_CATCH,        // Possibly a try-catch block in the future??
+
+    // Appended so existing .embc opcode numbers stay valid
+    OP_LOAD_LOCAL,       // Push a slot of the current call frame
+    OP_STORE_LOCAL,      // Pop into a slot of the current call frame
+    OP_NEW_COROUTINE,    // Pop a function, push a coroutine that will run it
+    OP_SLEEP,            // Pop milliseconds, suspend the VM for that long
+    OP_WAIT_EVENT,       // Pop an event name, suspend the VM until it is signalled
+    OP_LEN,              // Pop an array or string, push its length
+    OP_SLICE,            // Pop end (or null), start and an array; push the copied range
+    OP_CALL_NATIVE       // Call a host builtin; operands: native index (u8), argCount (u8)
 } OpCode;
 
+typedef struct VMProfile VMProfile; // Defined in vm_profile.h
+typedef struct Shape Shape;         // Defined in object.h
+
+/**
+ * @brief A function compiled into a chunk.
+ *
+ * The body lives inline in the chunk's code (jumped over at definition
+ * time); a FUNCTION_TYPE_BYTECODE constant points at one of these.
+ */
+struct BytecodeFunction {
+    char* name;
+    int arity;        ///< Declared parameters
+    int local_count;  ///< Frame slots: parameters first, then `var` locals
+    int entry;        ///< Offset of the first instruction in `chunk->code`
+};
+
+/**
+ * @brief One active function call.
+ *
+ * Slots are addressed by index rather than pointer so the operand stack can
+ * be reallocated while frames are live.
+ */
+typedef struct {
+    uint8_t* return_ip;  ///< Where the caller resumes; NULL for a coroutine's body
+    int base;            ///< Stack index of local slot 0
+    const BytecodeFunction* function; ///< Callee, for profilers and diagnostics
+} CallFrame;
+
+typedef enum {
+    COROUTINE_SUSPENDED,  ///< Created or yielded; can be resumed
+    COROUTINE_RUNNING,    ///< Currently executing
+    COROUTINE_NORMAL,     ///< Resumed another coroutine and is waiting on it
+    COROUTINE_DEAD        ///< Body returned; resuming is an error
+} CoroutineStatus;
+
+/**
+ * @brief A stackful coroutine: its own operand stack and call frames.
+ *
+ * While a coroutine runs, its registers live in the VM; suspending or
+ * resuming copies a handful of fields, so switching is O(1) regardless of
+ * stack depth. Stacks start at VM_COROUTINE_STACK_SLOTS and grow on demand.
+ * Coroutines are owned by the VM that created them and freed with it.
+ */
+struct Coroutine {
+    RuntimeValue function;   ///< Body (FUNCTION_TYPE_BYTECODE)
+    CoroutineStatus status;
+    bool started;
+    Coroutine* caller;       ///< Context that resumed us, while running
+    Coroutine* next;         ///< Next coroutine owned by the same VM
+
+    // Saved registers (valid while not running)
+    uint8_t* ip;
+    RuntimeValue* stack;
+    RuntimeValue* stack_top;
+    int stack_capacity;
+    CallFrame* frames;
+    int frame_count;
+    int frame_capacity;
+};
+
+/**
+ * @brief One run of the line table: bytecode from `offset` up to the next
+ *        run's offset was compiled from source line `line`.
+ */
+typedef struct {
+    int offset;
+    int line;
+} LineRun;
+
 /**
  * @brief A structure representing a chunk of bytecode.
  *
@@ -92,8 +178,90 @@ typedef struct {
     RuntimeValue* constants; ///< A table/array of constants used by this chunk
     int constants_count;     ///< Number of constants
     int constants_capacity;  ///< Allocated capacity for constants
+
+    int max_stack_depth;     ///< Deepest operand stack the code can reach (0 = unknown)
+
+    LineRun* lines;          ///< Line table, sorted by offset (NULL if stripped)
+    int line_count;
+    int line_capacity;
+
+    int property_cache_count; ///< Property access sites; each VM keeps one cache per site
 } BytecodeChunk;
 
+/// Shapes a property cache remembers before the site goes megamorphic.
+#define VM_PROPERTY_CACHE_WAYS 4
+
+/// Cache slot operand meaning "do not cache this site".
+#define VM_PROPERTY_CACHE_NONE 0xFFFF
+
+/**
+ * @brief One receiver shape seen at a property access site.
+ *
+ * For a store that added the property, `transition` is the shape the
+ * object moves to and `slot` the new slot; otherwise `transition` is NULL.
+ */
+typedef struct {
+    const Shape* shape;
+    const Shape* transition;
+    int slot;
+} PropertyCacheEntry;
+
+/**
+ * @brief Inline cache of an OP_GET_PROPERTY / OP_SET_PROPERTY site.
+ *
+ * Monomorphic with one entry, polymorphic up to VM_PROPERTY_CACHE_WAYS;
+ * a site that sees more shapes than that stops caching and always does
+ * the full lookup. Caches live in the VM rather than the chunk because
+ * chunks are shared read-only between VMs on different threads.
+ */
+typedef struct {
+    PropertyCacheEntry entries[VM_PROPERTY_CACHE_WAYS];
+    int count;
+    bool megamorphic;
+} PropertyCache;
+
+/**
+ * @brief Status codes returned by vm_run().
+ */
+typedef enum {
+    VM_RESULT_OK = 0,             ///< Reached OP_EOF / OP_RETURN
+    VM_RESULT_ERROR = 1,          ///< Runtime error (message already printed)
+    VM_RESULT_STACK_OVERFLOW = 2, ///< Operand stack would exceed `stack_limit`
+    VM_RESULT_YIELDED = 3,        ///< Out of fuel; run again to continue
+    VM_RESULT_SUSPENDED = 4       ///< Script called sleep/wait_event; see `wait_kind`
+} VMResult;
+
+/**
+ * @brief Why a VM returned VM_RESULT_SUSPENDED.
+ */
+typedef enum {
+    VM_WAIT_NONE,
+    VM_WAIT_SLEEP,   ///< Resume after `wait_ms` milliseconds
+    VM_WAIT_EVENT    ///< Resume once `wait_event` is signalled
+} VMWaitKind;
+
+/// Number of global variable slots per VM (indices are one-byte operands).
+#define VM_MAX_GLOBALS 256
+
+/// Smallest operand stack a VM starts with, in slots.
+#define VM_MIN_STACK_CAPACITY 16
+
+/// Default hard limit on operand stack slots (about 32 MB of RuntimeValues).
+/// Also caps the call depth.
+#define VM_DEFAULT_STACK_LIMIT (1 << 20)
+
+/// Initial operand stack of a coroutine, in slots.
+#define VM_COROUTINE_STACK_SLOTS 8
+
+/// Initial call-frame capacity of a coroutine.
+#define VM_COROUTINE_FRAMES 2
+
+/// Initial call-frame capacity of the main context.
+#define VM_INITIAL_FRAMES 8
+
+/// Fuel of a VM without a limit; never runs out in practice.
+#define VM_UNLIMITED_FUEL LONG_MAX
+
 /**
  * @brief A structure representing the VM state.
  *
@@ -102,18 +270,48 @@ typedef struct {
  * - `stack_top` to track the current top
  * - The current instruction pointer (IP)
  * - Possibly a pointer to Environment for variables, or a specialized “CallFrame” array
+ *
+ * Every piece of mutable execution state lives here, so a VM is a
+ * self-contained isolate: several VMs may run the same (read-only)
+ * BytecodeChunk concurrently, one per thread. A single VM must not be
+ * entered from two threads at once.
+ *
+ * Every stack slot (coroutine stacks included) and every global slot owns
+ * one reference to its value; vm_free() releases them all.
  */
 typedef struct {
     BytecodeChunk* chunk; ///< The chunk of bytecode we're executing
     uint8_t* ip;          ///< Instruction pointer into `chunk->code`
     
-    RuntimeValue* stack;  ///< The VM's operand stack
+    RuntimeValue* stack;  ///< The VM's operand stack (grows on demand)
     RuntimeValue* stack_top; ///< Points to the next free slot
     int stack_capacity;   ///< Size of `stack`
-    
-    // Potentially a call stack for function calls, environments, etc.
-    // Environment* global_env; // Bridging to runtime environment
-    // ...
+    int stack_limit;      ///< Hard cap on `stack_capacity`, in slots
+
+    jmp_buf* error_jump;  ///< Set while vm_run is active; stack overflow unwinds here
+
+    RuntimeValue* globals; ///< VM_MAX_GLOBALS slots, indexed by the compiler's symbol table
+
+    CallFrame* frames;    ///< Call frames of the running context
+    int frame_count;
+    int frame_capacity;
+    volatile sig_atomic_t frames_changing; ///< Nonzero while `frames` is swapped or resized; samplers skip
+
+    Coroutine root;       ///< Saved registers of the main context while a coroutine runs
+    Coroutine* current;   ///< Running context (`&root` outside any coroutine)
+    Coroutine* coroutines; ///< Every coroutine created by this VM
+
+    long fuel;            ///< Burned by backward jumps and calls; yields at zero
+    long fuel_per_run;    ///< Tank each vm_run() starts with (0 = unlimited)
+    VMWaitKind wait_kind; ///< Set when vm_run_slice returns VM_RESULT_SUSPENDED
+    double wait_ms;       ///< Sleep length for VM_WAIT_SLEEP
+    const char* wait_event; ///< Event name for VM_WAIT_EVENT (valid until the next slice)
+    ScriptString* wait_event_name; ///< Reference that keeps `wait_event` alive
+
+    struct VMProfile* profile; ///< When set, runs use the instrumented dispatch loop
+
+    PropertyCache* property_caches; ///< One per site, `chunk->property_cache_count` of them
+    int property_cache_count;
 } VM;
 
 /**
@@ -138,6 +336,24 @@ void vm_free_chunk(BytecodeChunk* chunk);
  */
 void vm_chunk_write_byte(BytecodeChunk* chunk, uint8_t byte);
 
+/**
+ * @brief Attribute the bytes written from now on to source `line`.
+ *
+ * A new run is only started when the line changes, so the table stays a
+ * handful of entries per statement. Lines below 1 are ignored.
+ */
+void vm_chunk_mark_line(BytecodeChunk* chunk, int line);
+
+/**
+ * @brief Source line of the instruction covering `offset`.
+ *
+ * Binary search over the line table; the VM only calls this when it needs
+ * to report a position, never while dispatching.
+ *
+ * @return int The line, or 0 if the chunk has no line table.
+ */
+int vm_chunk_line_at(const BytecodeChunk* chunk, int offset);
+
 /**
  * @brief Add a constant (e.g., a number or string) to the chunk's constants table.
  *
@@ -155,6 +371,51 @@ int vm_chunk_add_constant(BytecodeChunk* chunk, RuntimeValue value);
  */
 VM* vm_create(BytecodeChunk* chunk);
 
+/**
+ * @brief Set the hard limit on the VM's operand stack.
+ *
+ * The stack starts small and grows on demand. Once a push would take it past
+ * `max_slots`, vm_run() stops and returns VM_RESULT_STACK_OVERFLOW.
+ *
+ * @param vm The VM instance.
+ * @param max_slots Maximum number of stack slots.
+ */
+void vm_set_stack_limit(VM* vm, int max_slots);
+
+/**
+ * @brief Attach counters for a profiled run, or NULL to detach.
+ *
+ * While a profile is attached the VM runs a separate, instrumented copy of
+ * its dispatch loop; unprofiled runs execute no profiling code at all.
+ *
+ * @param vm The VM instance.
+ * @param profile Counters to fill in (see vm_profile.h); not owned by the VM.
+ */
+void vm_set_profile(VM* vm, VMProfile* profile);
+
+/**
+ * @brief Mnemonic of an opcode without the OP_ prefix ("UNKNOWN" if invalid).
+ */
+const char* vm_opcode_name(int opcode);
+
+/**
+ * @brief Limit how much fuel each vm_run() call may burn.
+ *
+ * @param vm The VM instance.
+ * @param fuel Backward jumps plus calls per run; 0 or less removes the limit.
+ */
+void vm_set_fuel(VM* vm, long fuel);
+
+/**
+ * @brief Read a global variable slot of a VM.
+ *
+ * @param vm The VM instance.
+ * @param index Slot index assigned by the compiler's symbol table.
+ * @return RuntimeValue The slot's value (null if out of range or never stored),
+ *         borrowed from the VM: valid until the slot is next stored or the VM is freed.
+ */
+RuntimeValue vm_get_global(const VM* vm, int index);
+
 /**
  * @brief Free a VM and its resources.
  *
@@ -165,16 +426,44 @@ void vm_free(VM* vm);
 /**
  * @brief Run the bytecode in the given VM until completion or error.
  *
+ * If a fuel limit was set with vm_set_fuel(), the run also stops with
+ * VM_RESULT_YIELDED once that much fuel is burned; calling vm_run() again
+ * resumes it with a full tank.
+ *
+ * A sleep() in the script blocks the calling thread; wait_event() is an
+ * error because nothing outside a scheduler can signal it.
+ *
  * @param vm The VM instance.
- * @return int 0 on success, non-zero on error.
+ * @return int A VMResult: VM_RESULT_OK on success, non-zero on error.
  */
 int vm_run(VM* vm);
 
 /**
- * @brief Push a value onto the VM stack.
+ * @brief Run with `budget` units of fuel, then return so the host can
+ *        schedule something else.
+ *
+ * Only OP_LOOP and OP_CALL burn fuel (one unit each), so straight-line code
+ * runs unmetered while any unbounded loop or recursion still runs dry.
+ * All execution state stays in the VM, so calling vm_run_slice() again
+ * continues exactly where the previous slice stopped. Unlike vm_run(),
+ * sleep() and wait_event() are not handled here: they return
+ * VM_RESULT_SUSPENDED and leave the request in `wait_kind`.
  *
  * @param vm The VM instance.
- * @param value The value to push.
+ * @param budget Fuel for this slice; 0 or less means no limit.
+ * @return int VM_RESULT_YIELDED when the fuel ran out, VM_RESULT_SUSPENDED
+ *         on sleep/wait_event, otherwise as vm_run().
+ */
+int vm_run_slice(VM* vm, long budget);
+
+/**
+ * @brief Push a value onto the VM stack, growing it if needed.
+ *
+ * If the stack is already at its limit, the push raises a stack overflow that
+ * unwinds the running vm_run() call. Outside vm_run the value is dropped.
+ *
+ * @param vm The VM instance.
+ * @param value The value to push; the stack takes over the caller's reference.
  */
 void vm_push(VM* vm, RuntimeValue value);
 
@@ -182,8 +471,12 @@ void vm_push(VM* vm, RuntimeValue value);
  * @brief Pop a value from the VM stack.
  *
  * @param vm The VM instance.
- * @return RuntimeValue The popped value.
+ * @return RuntimeValue The popped value; the caller now owns its reference.
  */
 RuntimeValue vm_pop(VM* vm);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // VIRTUAL_MACHINE_H
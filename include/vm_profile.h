@@ -0,0 +1,81 @@
+// vm_profile.h
+#ifndef VM_PROFILE_H
+#define VM_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "virtual_machine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Per-opcode and per-offset counters filled in by a profiled run.
+ *
+ * Attach one to a VM with vm_set_profile(); while attached, the VM runs an
+ * instrumented copy of its dispatch loop. Time is in TSC cycles on x86 and
+ * in nanoseconds elsewhere (see vm_profile_time_unit()).
+ */
+struct VMProfile {
+    uint64_t op_counts[256];  ///< Times each opcode was executed
+    uint64_t op_time[256];    ///< Total time spent in each opcode
+    uint64_t* offset_hits;    ///< Executions per bytecode offset
+    int code_size;            ///< Length of `offset_hits`
+    const BytecodeChunk* chunk; ///< Profiled chunk, for offset-to-line lookups
+};
+
+/**
+ * @brief Read the profiler's clock.
+ */
+static inline uint64_t vm_profile_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Unit of VMProfile::op_time: "cycles" or "ns".
+ */
+const char* vm_profile_time_unit(void);
+
+/**
+ * @brief Create empty counters sized for `chunk`.
+ *
+ * @return VMProfile* The profile, or NULL on allocation failure.
+ */
+VMProfile* vm_profile_create(const BytecodeChunk* chunk);
+
+/**
+ * @brief Free a profile.
+ */
+void vm_profile_free(VMProfile* profile);
+
+/**
+ * @brief Print opcodes sorted by total time, then the `top_offsets` hottest
+ *        bytecode offsets.
+ */
+void vm_profile_print(const VMProfile* profile, FILE* out, int top_offsets);
+
+/**
+ * @brief Write the profile as JSON.
+ *
+ * @return bool false if the file could not be written.
+ */
+bool vm_profile_write_json(const VMProfile* profile, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VM_PROFILE_H
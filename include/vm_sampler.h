@@ -0,0 +1,91 @@
+// vm_sampler.h
+#ifndef VM_SAMPLER_H
+#define VM_SAMPLER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "virtual_machine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Samples per second of CPU time when none is given.
+#define VM_SAMPLER_DEFAULT_HZ 997
+
+/// Samples kept when no capacity is given; later ones are dropped.
+#define VM_SAMPLER_DEFAULT_CAPACITY 16384
+
+/// Innermost call frames recorded per sample; deeper stacks are cut at the root.
+#define VM_SAMPLER_MAX_DEPTH 32
+
+/**
+ * @brief Statistical profiler that records which script functions a VM is in.
+ *
+ * While started, ITIMER_PROF raises SIGPROF every 1/hz seconds of process
+ * CPU time. The handler copies the VM's call-frame stack into a
+ * preallocated buffer and returns; the VM itself runs the normal dispatch
+ * loop with no extra work per instruction. Signals that land on another
+ * thread, or while the VM is switching frame arrays, are counted as dropped.
+ *
+ * Only one sampler can be running per process.
+ */
+typedef struct VMSampler VMSampler;
+
+/**
+ * @brief Create a stopped sampler.
+ *
+ * @param hz Sampling rate; 0 or less means VM_SAMPLER_DEFAULT_HZ.
+ * @param capacity Samples to keep; 0 or less means VM_SAMPLER_DEFAULT_CAPACITY.
+ * @return VMSampler* The new sampler, or NULL on allocation failure.
+ */
+VMSampler* vm_sampler_create(int hz, int capacity);
+
+/**
+ * @brief Stop (if running) and free a sampler.
+ */
+void vm_sampler_free(VMSampler* sampler);
+
+/**
+ * @brief Start sampling `vm`.
+ *
+ * Must be called on the thread that will run the VM. The VM must outlive
+ * vm_sampler_stop().
+ *
+ * @return bool false if another sampler is running or the timer could not be set.
+ */
+bool vm_sampler_start(VMSampler* sampler, VM* vm);
+
+/**
+ * @brief Stop the timer and restore the previous SIGPROF handler.
+ */
+void vm_sampler_stop(VMSampler* sampler);
+
+/**
+ * @brief Number of samples recorded so far.
+ */
+int vm_sampler_sample_count(const VMSampler* sampler);
+
+/**
+ * @brief Number of timer ticks that could not be recorded.
+ */
+int vm_sampler_dropped_count(const VMSampler* sampler);
+
+/**
+ * @brief Write the samples as folded stacks ("main:9;outer:4;inner:2 42"),
+ *        the input format of flamegraph.pl and speedscope.
+ *
+ * Each frame carries the line it was executing; the suffix is left out
+ * when the chunk has no line table. The chunk of the last sampled VM must
+ * still be alive. Call only while stopped.
+ *
+ * @return bool false on a write error.
+ */
+bool vm_sampler_write_folded(const VMSampler* sampler, FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VM_SAMPLER_H
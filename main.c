@@ -6,10 +6,15 @@
 
 #include "compiler.h"
 #include "virtual_machine.h"
+#include "vm_profile.h"
+#include "vm_sampler.h"
 #include "parser.h"
 #include "lexer.h"
 #include "runtime.h"
+#include "script_string.h"
+#include "output_sink.h"
 #include "interpreter.h"
+#include "ember_alloc.h"
 
 // Forward declaration for usage printing:
 static void print_usage(void);
@@ -40,7 +45,7 @@ static char* read_file(const char* filename) {
     }
     rewind(file);
 
-    char* buffer = (char*)malloc((size_t)length + 1);
+    char* buffer = (char*)ember_malloc(EMBER_MEM_COMPILER, (size_t)length + 1);
     if (!buffer) {
         fprintf(stderr, "Error: Memory allocation failed\n");
         fclose(file);
@@ -54,9 +59,84 @@ static char* read_file(const char* filename) {
     return buffer;
 }
 
+// Tag of the optional line-table section that follows the constants
+static const char LINE_SECTION_TAG[4] = { 'L', 'I', 'N', 'E' };
+
+static void write_uvarint(FILE* file, uint32_t value) {
+    while (value >= 0x80) {
+        fputc((int)((value & 0x7F) | 0x80), file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static bool read_uvarint(FILE* file, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF) {
+            return false;
+        }
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Write the line table: [tag "LINE"], [int run_count], then per run
+ *        the offset delta and zigzag-encoded line delta as varints.
+ */
+static void write_line_section(FILE* file, const BytecodeChunk* chunk) {
+    fwrite(LINE_SECTION_TAG, 1, sizeof(LINE_SECTION_TAG), file);
+    fwrite(&chunk->line_count, sizeof(int), 1, file);
+    int offset = 0;
+    int line = 0;
+    for (int i = 0; i < chunk->line_count; i++) {
+        int32_t line_delta = chunk->lines[i].line - line;
+        write_uvarint(file, (uint32_t)(chunk->lines[i].offset - offset));
+        write_uvarint(file, ((uint32_t)line_delta << 1) ^ (uint32_t)(line_delta >> 31));
+        offset = chunk->lines[i].offset;
+        line = chunk->lines[i].line;
+    }
+}
+
+static bool read_line_section(FILE* file, BytecodeChunk* chunk) {
+    int count = 0;
+    if (fread(&count, sizeof(int), 1, file) != 1 || count < 0 || count > chunk->code_count + 1) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    chunk->lines = (LineRun*)ember_malloc(EMBER_MEM_VM, sizeof(LineRun) * count);
+    if (!chunk->lines) {
+        return false;
+    }
+    chunk->line_capacity = count;
+    int offset = 0;
+    int line = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t offset_delta, line_bits;
+        if (!read_uvarint(file, &offset_delta) || !read_uvarint(file, &line_bits)) {
+            return false;
+        }
+        offset += (int)offset_delta;
+        line += (int32_t)(line_bits >> 1) ^ -(int32_t)(line_bits & 1);
+        chunk->lines[i].offset = offset;
+        chunk->lines[i].line = line;
+        chunk->line_count = i + 1;
+    }
+    return true;
+}
+
 /**
  * @brief Read a serialized BytecodeChunk from a .embc file.
- *        Format: [int code_count], [int constants_count], code bytes, then constants.
+ *        Format: [int code_count], [int constants_count], code bytes, then constants,
+ *        then an optional line-table section (see write_line_section).
  */
 static BytecodeChunk* read_chunk(const char* filename) {
     FILE* file = fopen(filename, "rb");
@@ -88,7 +168,7 @@ static BytecodeChunk* read_chunk(const char* filename) {
 
     // Allocate code array
     chunk->code_capacity = chunk->code_count;
-    chunk->code = (uint8_t*)malloc(chunk->code_count);
+    chunk->code = (uint8_t*)ember_malloc(EMBER_MEM_VM, chunk->code_count);
     if (!chunk->code) {
         fprintf(stderr, "Error: Memory allocation for code failed.\n");
         vm_free_chunk(chunk);
@@ -105,7 +185,9 @@ static BytecodeChunk* read_chunk(const char* filename) {
 
     // Allocate constants array
     chunk->constants_capacity = chunk->constants_count;
-    chunk->constants = (RuntimeValue*)malloc(chunk->constants_count * sizeof(RuntimeValue));
+    // Zeroed so vm_free_chunk can walk a partially read table on error
+    chunk->constants = (RuntimeValue*)ember_calloc(EMBER_MEM_VM, chunk->constants_count > 0 ? chunk->constants_count : 1,
+                                             sizeof(RuntimeValue));
     if (!chunk->constants) {
         fprintf(stderr, "Error: Memory allocation for constants failed.\n");
         vm_free_chunk(chunk);
@@ -159,22 +241,53 @@ static BytecodeChunk* read_chunk(const char* filename) {
                     fclose(file);
                     return NULL;
                 }
-                char* sdata = (char*)malloc(slen + 1);
-                if (!sdata) {
+                char* sdata;
+                ScriptString* string = string_create_uninit((size_t)slen, &sdata);
+                if (!string) {
                     fprintf(stderr, "Error allocating memory for string constant.\n");
                     vm_free_chunk(chunk);
                     fclose(file);
                     return NULL;
                 }
+                chunk->constants[i].string_value = string;
                 if (fread(sdata, 1, slen, file) != (size_t)slen) {
                     fprintf(stderr, "Error reading string constant data.\n");
-                    free(sdata);
                     vm_free_chunk(chunk);
                     fclose(file);
                     return NULL;
                 }
-                sdata[slen] = '\0';
-                chunk->constants[i].string_value = sdata;
+            } break;
+
+            case RUNTIME_VALUE_FUNCTION: {
+                // Compiled function: arity, local_count, entry, then its name
+                int header[3];
+                int nlen = 0;
+                if (fread(header, sizeof(int), 3, file) != 3 ||
+                    fread(&nlen, sizeof(int), 1, file) != 1 || nlen < 0) {
+                    fprintf(stderr, "Error reading function constant.\n");
+                    chunk->constants[i].type = RUNTIME_VALUE_NULL;
+                    vm_free_chunk(chunk);
+                    fclose(file);
+                    return NULL;
+                }
+                BytecodeFunction* fn = (BytecodeFunction*)ember_malloc(EMBER_MEM_VM, sizeof(BytecodeFunction));
+                char* name = (char*)ember_malloc(EMBER_MEM_VM, nlen + 1);
+                if (!fn || !name || fread(name, 1, nlen, file) != (size_t)nlen) {
+                    fprintf(stderr, "Error reading function constant name.\n");
+                    ember_free(fn);
+                    ember_free(name);
+                    chunk->constants[i].type = RUNTIME_VALUE_NULL;
+                    vm_free_chunk(chunk);
+                    fclose(file);
+                    return NULL;
+                }
+                name[nlen] = '\0';
+                fn->name = name;
+                fn->arity = header[0];
+                fn->local_count = header[1];
+                fn->entry = header[2];
+                chunk->constants[i].function_value.function_type = FUNCTION_TYPE_BYTECODE;
+                chunk->constants[i].function_value.bytecode_function = fn;
             } break;
 
             default:
@@ -185,14 +298,42 @@ static BytecodeChunk* read_chunk(const char* filename) {
         }
     }
 
+    // Optional sections; files from older compilers, or stripped ones, end here
+    char tag[sizeof(LINE_SECTION_TAG)];
+    size_t tag_read = fread(tag, 1, sizeof(tag), file);
+    if (tag_read == sizeof(tag) && memcmp(tag, LINE_SECTION_TAG, sizeof(tag)) == 0) {
+        if (!read_line_section(file, chunk)) {
+            fprintf(stderr, "Warning: Ignoring malformed line table in '%s'\n", filename);
+            ember_free(chunk->lines);
+            chunk->lines = NULL;
+            chunk->line_count = 0;
+            chunk->line_capacity = 0;
+        }
+    } else if (tag_read != 0) {
+        fprintf(stderr, "Warning: Ignoring unknown trailing data in '%s'\n", filename);
+    }
+
     fclose(file);
+
+    // .embc files don't store the stack depth; recompute it so the VM can pre-size
+    int depth = compile_max_stack_depth(chunk);
+    if (depth < 0) {
+        fprintf(stderr, "Error: Bytecode in '%s' is malformed.\n", filename);
+        vm_free_chunk(chunk);
+        return NULL;
+    }
+    chunk->max_stack_depth = depth;
+
+    // Nor the number of property caches; without it every site runs uncached
+    int caches = compile_property_cache_count(chunk);
+    chunk->property_cache_count = caches > 0 ? caches : 0;
     return chunk;
 }
 
 /**
  * @brief Write a BytecodeChunk to a .embc file.
  */
-static int write_chunk(const char* filename, const BytecodeChunk* chunk) {
+static int write_chunk(const char* filename, const BytecodeChunk* chunk, bool strip_lines) {
     FILE* file = fopen(filename, "wb");
     if (!file) {
         fprintf(stderr, "Error: Could not open output file '%s'\n", filename);
@@ -227,18 +368,37 @@ static int write_chunk(const char* filename, const BytecodeChunk* chunk) {
             } break;
 
             case RUNTIME_VALUE_STRING: {
-                const char* s = chunk->constants[i].string_value ? chunk->constants[i].string_value : "";
-                int slen = (int)strlen(s);
+                const ScriptString* str = chunk->constants[i].string_value;
+                const char* s = str ? string_data(str) : "";
+                int slen = str ? (int)string_length(str) : 0;
                 fwrite(&slen, sizeof(int), 1, file);
                 fwrite(s, 1, slen, file);
             } break;
 
+            case RUNTIME_VALUE_FUNCTION: {
+                const BytecodeFunction* fn = chunk->constants[i].function_value.bytecode_function;
+                if (chunk->constants[i].function_value.function_type != FUNCTION_TYPE_BYTECODE || !fn) {
+                    fprintf(stderr, "Error: Only compiled functions can be written to bytecode.\n");
+                    fclose(file);
+                    return 1;
+                }
+                int header[3] = { fn->arity, fn->local_count, fn->entry };
+                int nlen = fn->name ? (int)strlen(fn->name) : 0;
+                fwrite(header, sizeof(int), 3, file);
+                fwrite(&nlen, sizeof(int), 1, file);
+                fwrite(fn->name ? fn->name : "", 1, nlen, file);
+            } break;
+
             default:
                 fprintf(stderr, "Warning: Unknown constant type %d\n", (int)t);
                 break;
         }
     }
 
+    if (!strip_lines && chunk->line_count > 0) {
+        write_line_section(file, chunk);
+    }
+
     fclose(file);
     return 0; // success
 }
@@ -256,7 +416,7 @@ static BytecodeChunk* compile_ember_source(const char* source) {
     ASTNode* root = parse_script(parser);
     if (!root) {
         fprintf(stderr, "Error: Parsing failed.\n");
-        free(parser);
+        ember_free(parser);
         return NULL;
     }
 
@@ -264,7 +424,7 @@ static BytecodeChunk* compile_ember_source(const char* source) {
     BytecodeChunk* chunk = vm_create_chunk();
     if (!chunk) {
         free_ast(root);
-        free(parser);
+        ember_free(parser);
         return NULL;
     }
 
@@ -273,7 +433,7 @@ static BytecodeChunk* compile_ember_source(const char* source) {
     if (!symtab) {
         vm_free_chunk(chunk);
         free_ast(root);
-        free(parser);
+        ember_free(parser);
         return NULL;
     }
 
@@ -284,13 +444,13 @@ static BytecodeChunk* compile_ember_source(const char* source) {
         symbol_table_free(symtab);
         vm_free_chunk(chunk);
         free_ast(root);
-        free(parser);
+        ember_free(parser);
         return NULL;
     }
 
     symbol_table_free(symtab);
     free_ast(root);
-    free(parser);
+    ember_free(parser);
 
     return chunk;
 }
@@ -299,7 +459,7 @@ static BytecodeChunk* compile_ember_source(const char* source) {
  * @brief Create a small C stub that includes the bytecode as an array, then
  *        compile that stub into a self-contained executable linked against libEmber.
  */
-static int embed_chunk_in_exe(const char* outFile, const BytecodeChunk* chunk) {
+static int embed_chunk_in_exe(const char* outFile, const BytecodeChunk* chunk, bool strip_lines) {
     // 1) Write a temporary C file that embeds the chunk data
     FILE* stub = fopen("temp_stub.c", "w");
     if (!stub) {
@@ -314,6 +474,7 @@ static int embed_chunk_in_exe(const char* outFile, const BytecodeChunk* chunk) {
     fprintf(stub, "#include <string.h>\n");
     fprintf(stub, "#include \"virtual_machine.h\"\n");
     fprintf(stub, "#include \"runtime.h\"\n");
+    fprintf(stub, "#include \"script_string.h\"\n");
     fprintf(stub, "extern int vm_run(VM* vm);\n");
     fprintf(stub, "extern VM* vm_create(BytecodeChunk* chunk);\n");
     fprintf(stub, "extern void vm_free(VM* vm);\n");
@@ -329,6 +490,17 @@ static int embed_chunk_in_exe(const char* outFile, const BytecodeChunk* chunk) {
     }
     fprintf(stub, "};\n");
 
+    // Embed the line table so runtime errors can still name lines
+    int line_count = strip_lines ? 0 : chunk->line_count;
+    if (line_count > 0) {
+        fprintf(stub, "static LineRun line_data[%d] = {", line_count);
+        for (int i = 0; i < line_count; i++) {
+            fprintf(stub, "{%d,%d}%s", chunk->lines[i].offset, chunk->lines[i].line,
+                    i < line_count - 1 ? "," : "");
+        }
+        fprintf(stub, "};\n");
+    }
+
     // Start main() and fill the BytecodeChunk structure
     fprintf(stub, "int main(void) {\n");
     fprintf(stub, "  BytecodeChunk chunk;\n");
@@ -337,6 +509,10 @@ static int embed_chunk_in_exe(const char* outFile, const BytecodeChunk* chunk) {
     fprintf(stub, "  chunk.code = code_data;\n");
     fprintf(stub, "  chunk.constants_count = %d;\n", chunk->constants_count);
     fprintf(stub, "  chunk.constants_capacity = %d;\n", chunk->constants_count);
+    fprintf(stub, "  chunk.max_stack_depth = %d;\n", chunk->max_stack_depth);
+    fprintf(stub, "  chunk.lines = %s;\n", line_count > 0 ? "line_data" : "NULL");
+    fprintf(stub, "  chunk.line_count = %d;\n", line_count);
+    fprintf(stub, "  chunk.line_capacity = %d;\n", line_count);
     fprintf(stub, "  chunk.constants = malloc(sizeof(RuntimeValue) * %d);\n", chunk->constants_count);
     fprintf(stub, "  if (!chunk.constants) {\n");
     fprintf(stub, "    fprintf(stderr, \"Failed to allocate constants.\\n\");\n");
@@ -360,18 +536,27 @@ static int embed_chunk_in_exe(const char* outFile, const BytecodeChunk* chunk) {
                 // No additional data needed
                 break;
             case RUNTIME_VALUE_STRING: {
-                int slen = (int)strlen(val.string_value);
+                const char* sdata = string_data(val.string_value);
+                int slen = (int)string_length(val.string_value);
                 fprintf(stub, "  {\n");
-                fprintf(stub, "    static char s_%d[%d + 1] = {", i, slen);
+                fprintf(stub, "    static const char s_%d[%d + 1] = {", i, slen);
                 for (int c = 0; c < slen; c++) {
-                    fprintf(stub, "%d", (unsigned char)val.string_value[c]);
+                    fprintf(stub, "%d", (unsigned char)sdata[c]);
                     if (c < slen - 1) {
                         fprintf(stub, ",");
                     }
                 }
                 fprintf(stub, "};\n");
-                fprintf(stub, "    s_%d[%d] = '\\0';\n", i, slen);
-                fprintf(stub, "    chunk.constants[%d].string_value = s_%d;\n", i, i);
+                fprintf(stub, "    chunk.constants[%d].string_value = string_create(s_%d, %d);\n", i, i, slen);
+                fprintf(stub, "  }\n");
+            } break;
+            case RUNTIME_VALUE_FUNCTION: {
+                const BytecodeFunction* fn = val.function_value.bytecode_function;
+                fprintf(stub, "  {\n");
+                fprintf(stub, "    static BytecodeFunction fn_%d = { \"%s\", %d, %d, %d };\n",
+                        i, fn->name ? fn->name : "", fn->arity, fn->local_count, fn->entry);
+                fprintf(stub, "    chunk.constants[%d].function_value.function_type = FUNCTION_TYPE_BYTECODE;\n", i);
+                fprintf(stub, "    chunk.constants[%d].function_value.bytecode_function = &fn_%d;\n", i, i);
                 fprintf(stub, "  }\n");
             } break;
             default:
@@ -427,12 +612,31 @@ int main(int argc, char* argv[]) {
     const char* subcommand = argv[1];
     const char* input_file = NULL;
     const char* output_file = NULL;
+    const char* profile_json = NULL;
+    bool profile = false;
+    const char* sample_file = NULL;
+    int sample_hz = 0;
+    bool strip_lines = false;
 
-    // Parse optional "-o" for output
+    // Parse optional "-o" for output, and the "run" profiling flags
     for (int i = 2; i < argc; i++) {
         if (strcmp(argv[i], "-o") == 0 && (i + 1 < argc)) {
             output_file = argv[i + 1];
             i++;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "--profile-json") == 0 && (i + 1 < argc)) {
+            profile = true;
+            profile_json = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "--strip-lines") == 0) {
+            strip_lines = true;
+        } else if (strcmp(argv[i], "--sample") == 0 && (i + 1 < argc)) {
+            sample_file = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "--sample-hz") == 0 && (i + 1 < argc)) {
+            sample_hz = atoi(argv[i + 1]);
+            i++;
         } else {
             input_file = argv[i];
         }
@@ -462,7 +666,46 @@ int main(int argc, char* argv[]) {
             vm_free_chunk(chunk);
             return 1;
         }
+        VMProfile* counters = NULL;
+        if (profile) {
+            counters = vm_profile_create(chunk);
+            vm_set_profile(vm, counters);
+        }
+        VMSampler* sampler = NULL;
+        if (sample_file) {
+            sampler = vm_sampler_create(sample_hz, 0);
+            if (sampler && !vm_sampler_start(sampler, vm)) {
+                vm_sampler_free(sampler);
+                sampler = NULL;
+            }
+        }
         int status = vm_run(vm);
+        // Script output goes out before any report below
+        output_sink_flush(output_sink_current());
+        if (sampler) {
+            vm_sampler_stop(sampler);
+            FILE* out = fopen(sample_file, "w");
+            if (!out) {
+                fprintf(stderr, "Error: Could not open sample output file '%s'\n", sample_file);
+                status = 1;
+            } else {
+                if (!vm_sampler_write_folded(sampler, out)) {
+                    status = 1;
+                }
+                fclose(out);
+                fprintf(stderr, "Wrote %d samples to '%s' (%d dropped)\n",
+                        vm_sampler_sample_count(sampler), sample_file,
+                        vm_sampler_dropped_count(sampler));
+            }
+            vm_sampler_free(sampler);
+        }
+        if (counters) {
+            vm_profile_print(counters, stderr, 10);
+            if (profile_json && !vm_profile_write_json(counters, profile_json)) {
+                status = 1;
+            }
+            vm_profile_free(counters);
+        }
         vm_free(vm);
         vm_free_chunk(chunk);
         return status;
@@ -480,7 +723,7 @@ int main(int argc, char* argv[]) {
 
         // Compile the source code into a BytecodeChunk
         BytecodeChunk* chunk = compile_ember_source(script_content);
-        free(script_content);
+        ember_free(script_content);
         if (!chunk) {
             return 1; // compile_ember_source already printed errors
         }
@@ -500,12 +743,12 @@ int main(int argc, char* argv[]) {
 
         if (isExe) {
             printf("Compiling '%s' => Executable '%s'\n", input_file, output_file);
-            int ecode = embed_chunk_in_exe(output_file, chunk);
+            int ecode = embed_chunk_in_exe(output_file, chunk, strip_lines);
             vm_free_chunk(chunk);
             return ecode;
         } else {
             printf("Compiling '%s' => Bytecode '%s'\n", input_file, output_file);
-            int ecode = write_chunk(output_file, chunk);
+            int ecode = write_chunk(output_file, chunk, strip_lines);
             vm_free_chunk(chunk);
             return ecode;
         }
@@ -521,12 +764,20 @@ static void print_usage(void) {
         "Subcommands:\n"
         "  compile (default)   - Compile a .ember file to either a native executable or .embc\n"
         "  run                  - Run a .embc bytecode file in the VM\n\n"
+        "Options for 'compile':\n"
+        "  --strip-lines         - Leave out the line table (smaller output, no line numbers in errors)\n\n"
+        "Options for 'run':\n"
+        "  --profile             - Print per-opcode counts and time, and the hottest offsets, to stderr\n"
+        "  --profile-json <file> - Also write the profile as JSON\n"
+        "  --sample <file>       - Sample the call stack and write folded stacks for flamegraph tools\n"
+        "  --sample-hz <n>       - Samples per second of CPU time (default 997)\n\n"
         "Logic for '-o':\n"
         "  - If you specify no extension, or use '.exe', emberc produces a native binary (linked against libEmber).\n"
         "  - Otherwise, emberc writes raw bytecode ('.embc').\n\n"
         "Examples:\n"
         "  emberc my_script.ember -o my_script       (produces native binary called 'my_script')\n"
         "  emberc my_script.ember -o my_script.exe   (produces native binary 'my_script.exe')\n"
-        "  emberc run my_script.embc                 (runs existing bytecode)\n\n"
+        "  emberc run my_script.embc                 (runs existing bytecode)\n"
+        "  emberc run my_script.embc --profile       (runs it and reports where time went)\n\n"
     );
 }
@@ -0,0 +1,32 @@
+// array_layout.h
+//
+// Field layout of arrays, shared by array.c and the VM's dispatch loop so
+// indexing a packed array compiles to a bounds check and a load. Everything
+// else goes through array.h.
+
+#ifndef ARRAY_LAYOUT_H
+#define ARRAY_LAYOUT_H
+
+#include <stdatomic.h>
+
+#include "array.h"
+
+struct ScriptArray {
+    atomic_int refcount;
+    ArrayKind kind;
+    int count;
+    int capacity;
+    union {
+        double* numbers;      // ARRAY_KIND_DOUBLE
+        RuntimeValue* values; // ARRAY_KIND_GENERIC
+    };
+};
+
+/**
+ * Store `value` at `index` (in range) as-is, without freeing what was there;
+ * a non-number moves the array to ARRAY_KIND_GENERIC. The VM uses this since
+ * its values are shallow. Returns false on allocation failure.
+ */
+bool array_store(ScriptArray* array, int index, RuntimeValue value);
+
+#endif // ARRAY_LAYOUT_H
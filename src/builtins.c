@@ -1,10 +1,17 @@
 #include "builtins.h"
 #include "runtime.h"
+#include "array.h"
+#include "numeric_kernels.h"
+#include "string_kernels.h"
+#include "script_string.h"
+#include "event_bus.h"
+#include "timer_wheel.h"
+#include "output_sink.h"
+#include "ember_alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
-#include <ctype.h>
 
 /**
  * Register all built-in functions to the runtime environment.
@@ -31,12 +38,163 @@ void builtins_register(Environment* env) {
     runtime_register_builtin(env, "to_lower", builtin_to_lower);
     runtime_register_builtin(env, "index_of", builtin_index_of);
     runtime_register_builtin(env, "replace", builtin_replace);
+    runtime_register_builtin(env, "to_string", builtin_to_string);
+
+    runtime_register_builtin(env, "len", builtin_len);
+    runtime_register_builtin(env, "push", builtin_push);
+    runtime_register_builtin(env, "slice", builtin_slice);
+
+    runtime_register_builtin(env, "sum", builtin_sum);
+    runtime_register_builtin(env, "min", builtin_min);
+    runtime_register_builtin(env, "max", builtin_max);
+    runtime_register_builtin(env, "dot", builtin_dot);
+    runtime_register_builtin(env, "scale", builtin_scale);
+    runtime_register_builtin(env, "add_arrays", builtin_add_arrays);
+    runtime_register_builtin(env, "clamp_all", builtin_clamp_all);
+
+    runtime_register_builtin(env, "parallel_map", builtin_parallel_map);
+    runtime_register_builtin(env, "parallel_filter", builtin_parallel_filter);
+    runtime_register_builtin(env, "parallel_reduce", builtin_parallel_reduce);
+
+    runtime_register_builtin(env, "on", builtin_on);
+    runtime_register_builtin(env, "emit", builtin_emit);
+
+    runtime_register_builtin(env, "set_timeout", builtin_set_timeout);
+    runtime_register_builtin(env, "set_interval", builtin_set_interval);
+    runtime_register_builtin(env, "cancel", builtin_cancel);
+}
+
+RuntimeValue builtin_on(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
+    if (arg_count != 2 || args[0].type != RUNTIME_VALUE_STRING || !args[0].string_value) {
+        output_sink_error("Error: on() expects an event name and a function.\n");
+        return result;
+    }
+    EventBus* bus = event_bus_current();
+    if (!bus) {
+        output_sink_error("Error: on('%s') called with no event bus bound to this thread.\n",
+                          string_cstr(args[0].string_value));
+        return result;
+    }
+    event_bus_on(bus, string_cstr(args[0].string_value), &args[1]);
+    return result;
+}
+
+RuntimeValue builtin_emit(Environment* env, RuntimeValue* args, int arg_count) {
+    RuntimeValue result = { .type = RUNTIME_VALUE_NUMBER, .number_value = 0 };
+    if (arg_count < 1 || arg_count > 2 || args[0].type != RUNTIME_VALUE_STRING || !args[0].string_value) {
+        output_sink_error("Error: emit() expects an event name and optional data.\n");
+        return result;
+    }
+    EventBus* bus = event_bus_current();
+    if (!bus) {
+        output_sink_error("Error: emit('%s') called with no event bus bound to this thread.\n",
+                          string_cstr(args[0].string_value));
+        return result;
+    }
+    int ran = event_bus_emit(bus, env, string_cstr(args[0].string_value), arg_count == 2 ? &args[1] : NULL);
+    result.number_value = ran;
+    return result;
+}
+
+// set_timeout / set_interval share everything but the repeat
+static RuntimeValue schedule_timer(const char* name, RuntimeValue* args, int arg_count, bool repeat) {
+    RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
+    if (arg_count != 2 || args[0].type != RUNTIME_VALUE_FUNCTION || args[1].type != RUNTIME_VALUE_NUMBER) {
+        output_sink_error("Error: %s() expects a function and a delay in milliseconds.\n", name);
+        return result;
+    }
+    TimerWheel* wheel = timer_wheel_current();
+    if (!wheel) {
+        output_sink_error("Error: %s() called with no timer wheel bound to this thread.\n", name);
+        return result;
+    }
+    double delay = args[1].number_value;
+    if (!isfinite(delay)) {
+        output_sink_error("Error: %s() needs a finite delay.\n", name);
+        return result;
+    }
+    double id = timer_wheel_schedule(wheel, &args[0], delay, repeat ? delay : 0);
+    if (id >= 0) {
+        result.type = RUNTIME_VALUE_NUMBER;
+        result.number_value = id;
+    }
+    return result;
+}
+
+RuntimeValue builtin_set_timeout(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    return schedule_timer("set_timeout", args, arg_count, false);
+}
+
+RuntimeValue builtin_set_interval(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    return schedule_timer("set_interval", args, arg_count, true);
+}
+
+RuntimeValue builtin_cancel(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    RuntimeValue result = { .type = RUNTIME_VALUE_BOOLEAN, .boolean_value = false };
+    if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER || !isfinite(args[0].number_value)) {
+        output_sink_error("Error: cancel() expects a timer id.\n");
+        return result;
+    }
+    result.boolean_value = timer_wheel_cancel(timer_wheel_current(), args[0].number_value);
+    return result;
+}
+
+RuntimeValue builtin_print(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    OutputSink* out = output_sink_current();
+    char scratch[RUNTIME_VALUE_TEXT_SIZE];
+    size_t length = 0;
+    if (arg_count == 1) {
+        const char* text = runtime_value_text(&args[0], scratch, &length);
+        output_sink_write_line(out, text, length);
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+
+    // Join the arguments first so the whole line is one sink write
+    char stack_line[256];
+    char* line = stack_line;
+    size_t capacity = sizeof(stack_line);
+    for (int i = 0; i < arg_count; i++) {
+        size_t text_length;
+        const char* text = runtime_value_text(&args[i], scratch, &text_length);
+        size_t needed = length + (i > 0) + text_length;
+        if (needed > capacity) {
+            while (capacity < needed) {
+                capacity *= 2;
+            }
+            char* grown = (char*)ember_malloc(EMBER_MEM_BUILTINS, capacity);
+            if (!grown) {
+                output_sink_error("Error: Memory allocation failed for print.\n");
+                break;
+            }
+            memcpy(grown, line, length);
+            if (line != stack_line) {
+                ember_free(line);
+            }
+            line = grown;
+        }
+        if (i > 0) {
+            line[length++] = ' ';
+        }
+        memcpy(line + length, text, text_length);
+        length += text_length;
+    }
+    output_sink_write_line(out, line, length);
+    if (line != stack_line) {
+        ember_free(line);
+    }
+    return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
 }
 
 RuntimeValue builtin_floor(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'floor' requires a single numeric argument.\n");
+        output_sink_error("Error: 'floor' requires a single numeric argument.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = floor(args[0].number_value) };
@@ -45,7 +203,7 @@ RuntimeValue builtin_floor(Environment* env, RuntimeValue* args, int arg_count)
 RuntimeValue builtin_ceil(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'ceil' requires a single numeric argument.\n");
+        output_sink_error("Error: 'ceil' requires a single numeric argument.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = ceil(args[0].number_value) };
@@ -54,7 +212,7 @@ RuntimeValue builtin_ceil(Environment* env, RuntimeValue* args, int arg_count) {
 RuntimeValue builtin_sqrt(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'sqrt' requires a single numeric argument.\n");
+        output_sink_error("Error: 'sqrt' requires a single numeric argument.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = sqrt(args[0].number_value) };
@@ -63,7 +221,7 @@ RuntimeValue builtin_sqrt(Environment* env, RuntimeValue* args, int arg_count) {
 RuntimeValue builtin_pow(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 2 || args[0].type != RUNTIME_VALUE_NUMBER || args[1].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'pow' requires two numeric arguments.\n");
+        output_sink_error("Error: 'pow' requires two numeric arguments.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = pow(args[0].number_value, args[1].number_value) };
@@ -72,7 +230,7 @@ RuntimeValue builtin_pow(Environment* env, RuntimeValue* args, int arg_count) {
 RuntimeValue builtin_sin(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'sin' requires a single numeric argument.\n");
+        output_sink_error("Error: 'sin' requires a single numeric argument.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = sin(args[0].number_value) };
@@ -81,7 +239,7 @@ RuntimeValue builtin_sin(Environment* env, RuntimeValue* args, int arg_count) {
 RuntimeValue builtin_cos(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'cos' requires a single numeric argument.\n");
+        output_sink_error("Error: 'cos' requires a single numeric argument.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = cos(args[0].number_value) };
@@ -90,7 +248,7 @@ RuntimeValue builtin_cos(Environment* env, RuntimeValue* args, int arg_count) {
 RuntimeValue builtin_tan(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'tan' requires a single numeric argument.\n");
+        output_sink_error("Error: 'tan' requires a single numeric argument.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = tan(args[0].number_value) };
@@ -99,7 +257,7 @@ RuntimeValue builtin_tan(Environment* env, RuntimeValue* args, int arg_count) {
 RuntimeValue builtin_log(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'log' requires a single numeric argument.\n");
+        output_sink_error("Error: 'log' requires a single numeric argument.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = log(args[0].number_value) };
@@ -108,162 +266,707 @@ RuntimeValue builtin_log(Environment* env, RuntimeValue* args, int arg_count) {
 RuntimeValue builtin_round(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env; // Unused
     if (arg_count != 1 || args[0].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'round' requires a single numeric argument.\n");
+        output_sink_error("Error: 'round' requires a single numeric argument.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
     return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = round(args[0].number_value) };
 }
 
+// Wrap a new string, or null when creating it failed
+static RuntimeValue string_result(ScriptString* string) {
+    if (!string) {
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    return (RuntimeValue){ .type = RUNTIME_VALUE_STRING, .string_value = string };
+}
+
 RuntimeValue builtin_concat(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env;
     if (arg_count != 2 || args[0].type != RUNTIME_VALUE_STRING || args[1].type != RUNTIME_VALUE_STRING) {
-        fprintf(stderr, "Error: 'concat' requires two string arguments.\n");
+        output_sink_error("Error: 'concat' requires two string arguments.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
 
-    const char* str1 = args[0].string_value;
-    const char* str2 = args[1].string_value;
-    size_t len1 = strlen(str1);
-    size_t len2 = strlen(str2);
+    const ScriptString* str1 = args[0].string_value;
+    const ScriptString* str2 = args[1].string_value;
+    ScriptString* result_str = string_concat(string_data(str1), string_length(str1),
+                                             string_data(str2), string_length(str2));
+    return string_result(result_str);
+}
 
-    char* result_str = malloc(len1 + len2 + 1);
-    if (!result_str) {
-        fprintf(stderr, "Error: Memory allocation failed.\n");
+RuntimeValue builtin_substring(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    if (arg_count != 3 || args[0].type != RUNTIME_VALUE_STRING || args[1].type != RUNTIME_VALUE_NUMBER || args[2].type != RUNTIME_VALUE_NUMBER) {
+        output_sink_error("Error: 'substring' requires a string and two numeric arguments.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
 
-    strcpy(result_str, str1);
-    strcat(result_str, str2);
+    ScriptString* str = args[0].string_value;
+    double start = args[1].number_value;
+    double length = args[2].number_value;
 
-    RuntimeValue result = { .type = RUNTIME_VALUE_STRING, .string_value = result_str };
-    return result;
+    // NaN fails every comparison, so it has to be rejected before the casts
+    if (!isfinite(start) || !isfinite(length) ||
+        start < 0 || length < 0 || start + length > (double)string_length(str)) {
+        output_sink_error("Error: Invalid range for 'substring'.\n");
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+
+    // Long ranges share the source's buffer instead of being copied
+    return string_result(string_substring(str, (size_t)start, (size_t)length));
 }
 
-RuntimeValue builtin_substring(Environment* env, RuntimeValue* args, int arg_count) {
+// Shared body of to_upper/to_lower; the mapped string is the same length
+static RuntimeValue map_case(RuntimeValue* args, int arg_count, const char* name,
+                             void (*kernel)(char*, const char*, size_t)) {
+    if (arg_count != 1 || args[0].type != RUNTIME_VALUE_STRING) {
+        output_sink_error("Error: '%s' requires a single string argument.\n", name);
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+
+    const ScriptString* str = args[0].string_value;
+    size_t length = string_length(str);
+    char* chars;
+    ScriptString* result_str = string_create_uninit(length, &chars);
+    if (result_str) {
+        kernel(chars, string_data(str), length);
+    }
+    return string_result(result_str);
+}
+
+RuntimeValue builtin_to_upper(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env;
-    if (arg_count != 3 || args[0].type != RUNTIME_VALUE_STRING || args[1].type != RUNTIME_VALUE_NUMBER || args[2].type != RUNTIME_VALUE_NUMBER) {
-        fprintf(stderr, "Error: 'substring' requires a string and two numeric arguments.\n");
+    return map_case(args, arg_count, "to_upper", string_to_upper);
+}
+
+RuntimeValue builtin_to_lower(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    return map_case(args, arg_count, "to_lower", string_to_lower);
+}
+
+RuntimeValue builtin_index_of(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    if (arg_count != 2 || args[0].type != RUNTIME_VALUE_STRING || args[1].type != RUNTIME_VALUE_STRING) {
+        output_sink_error("Error: 'index_of' requires two string arguments.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
 
-    const char* str = args[0].string_value;
-    int start = (int)args[1].number_value;
-    int length = (int)args[2].number_value;
+    const ScriptString* haystack = args[0].string_value;
+    const ScriptString* needle = args[1].string_value;
+    size_t found = string_find(string_data(haystack), string_length(haystack),
+                               string_data(needle), string_length(needle));
 
-    if (start < 0 || length < 0 || start + length > (int)strlen(str)) {
-        fprintf(stderr, "Error: Invalid range for 'substring'.\n");
+    if (found == STRING_NOT_FOUND) {
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = -1 };
+    }
+
+    return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = (double)found };
+}
+
+RuntimeValue builtin_replace(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    if (arg_count != 3 || args[0].type != RUNTIME_VALUE_STRING || args[1].type != RUNTIME_VALUE_STRING || args[2].type != RUNTIME_VALUE_STRING) {
+        output_sink_error("Error: 'replace' requires three string arguments.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
 
-    char* result_str = malloc(length + 1);
+    const char* str = string_data(args[0].string_value);
+    const char* search = string_data(args[1].string_value);
+    const char* replace = string_data(args[2].string_value);
+    size_t str_len = string_length(args[0].string_value);
+    size_t search_len = string_length(args[1].string_value);
+    size_t replace_len = string_length(args[2].string_value);
+
+    // Count first so the result is allocated exactly once
+    size_t matches = string_count(str, str_len, search, search_len);
+    if (matches == 0) {
+        string_retain(args[0].string_value);
+        return args[0];
+    }
+
+    size_t result_len = str_len - matches * search_len + matches * replace_len;
+    char* out;
+    ScriptString* result_str = string_create_uninit(result_len, &out);
     if (!result_str) {
-        fprintf(stderr, "Error: Memory allocation failed.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
 
-    strncpy(result_str, str + start, length);
-    result_str[length] = '\0';
+    size_t offset = 0;
+    for (size_t i = 0; i < matches; i++) {
+        size_t at = offset + string_find(str + offset, str_len - offset, search, search_len);
+        memcpy(out, str + offset, at - offset);
+        out += at - offset;
+        memcpy(out, replace, replace_len);
+        out += replace_len;
+        offset = at + search_len;
+    }
+    memcpy(out, str + offset, str_len - offset);
+    return string_result(result_str);
+}
 
-    RuntimeValue result = { .type = RUNTIME_VALUE_STRING, .string_value = result_str };
+RuntimeValue builtin_to_string(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    if (arg_count != 1) {
+        output_sink_error("Error: 'to_string' requires a single argument.\n");
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    if (args[0].type == RUNTIME_VALUE_STRING) {
+        string_retain(args[0].string_value);
+        return args[0];
+    }
+    char scratch[RUNTIME_VALUE_TEXT_SIZE];
+    size_t length;
+    const char* text = runtime_value_text(&args[0], scratch, &length);
+    return string_result(string_create(text, length));
+}
+
+/* -------------------------------------------------------
+   Arrays
+   ------------------------------------------------------- */
+
+RuntimeValue builtin_len(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    RuntimeValue result = { .type = RUNTIME_VALUE_NUMBER };
+    if (arg_count == 1 && args[0].type == RUNTIME_VALUE_ARRAY) {
+        result.number_value = array_count(args[0].array_value);
+    } else if (arg_count == 1 && args[0].type == RUNTIME_VALUE_STRING && args[0].string_value) {
+        result.number_value = (double)string_length(args[0].string_value);
+    } else {
+        output_sink_error("Error: 'len' requires a string or array argument.\n");
+        result.type = RUNTIME_VALUE_NULL;
+    }
     return result;
 }
 
-RuntimeValue builtin_to_upper(Environment* env, RuntimeValue* args, int arg_count) {
+// push(array, value): appends in place and returns the array
+RuntimeValue builtin_push(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env;
-    if (arg_count != 1 || args[0].type != RUNTIME_VALUE_STRING) {
-        fprintf(stderr, "Error: 'to_upper' requires a single string argument.\n");
+    if (arg_count != 2 || args[0].type != RUNTIME_VALUE_ARRAY) {
+        output_sink_error("Error: 'push' requires an array and a value.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
+    RuntimeValue value = runtime_value_copy(&args[1]);
+    if (!array_push(args[0].array_value, value)) {
+        runtime_free_value(&value);
+    }
+    return runtime_value_copy(&args[0]);
+}
 
-    const char* str = args[0].string_value;
-    char* result_str = malloc(strlen(str) + 1);
-    if (!result_str) {
-        fprintf(stderr, "Error: Memory allocation failed.\n");
+// slice(array, start[, end]): copies [start, end); negative bounds count from the end
+RuntimeValue builtin_slice(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    if (arg_count < 2 || arg_count > 3 || args[0].type != RUNTIME_VALUE_ARRAY ||
+        args[1].type != RUNTIME_VALUE_NUMBER ||
+        (arg_count == 3 && args[2].type != RUNTIME_VALUE_NUMBER)) {
+        output_sink_error("Error: 'slice' requires an array and numeric bounds.\n");
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
+    if (!isfinite(args[1].number_value) || (arg_count == 3 && !isfinite(args[2].number_value))) {
+        output_sink_error("Error: 'slice' requires finite bounds.\n");
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    int count = array_count(args[0].array_value);
+    int start = array_slice_bound(args[1].number_value, count);
+    int end = arg_count == 3 ? array_slice_bound(args[2].number_value, count) : count;
+    ScriptArray* slice = array_slice(args[0].array_value, start, end);
+    if (!slice) {
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    RuntimeValue result = { .type = RUNTIME_VALUE_ARRAY };
+    result.array_value = slice;
+    return result;
+}
 
-    for (size_t i = 0; str[i]; ++i) {
-        result_str[i] = toupper(str[i]);
+/* -------------------------------------------------------
+   Numeric arrays: contiguous doubles through the SIMD kernels
+   ------------------------------------------------------- */
+
+// Elements of an all-number array as contiguous doubles. Packed arrays are
+// read in place; boxed ones are unboxed into `*scratch`, which the caller
+// frees. Returns NULL (after reporting) if `value` is not such an array.
+static const double* numeric_elements(const RuntimeValue* value, const char* name,
+                                      double** scratch, int* count) {
+    static const double no_numbers[1] = { 0.0 };
+    *scratch = NULL;
+    if (value->type != RUNTIME_VALUE_ARRAY) {
+        output_sink_error("Error: '%s' requires an array of numbers.\n", name);
+        return NULL;
     }
-    result_str[strlen(str)] = '\0';
+    ScriptArray* array = value->array_value;
+    *count = array_count(array);
+    if (*count == 0) {
+        return no_numbers;
+    }
+    const double* numbers = array_numbers(array);
+    if (numbers) {
+        return numbers;
+    }
+    double* unboxed = (double*)ember_malloc(EMBER_MEM_BUILTINS, sizeof(double) * *count);
+    if (!unboxed) {
+        output_sink_error("Error: Memory allocation failed.\n");
+        return NULL;
+    }
+    for (int i = 0; i < *count; i++) {
+        RuntimeValue element = array_get(array, i);
+        if (element.type != RUNTIME_VALUE_NUMBER) {
+            output_sink_error("Error: '%s' requires an array of numbers.\n", name);
+            ember_free(unboxed);
+            return NULL;
+        }
+        unboxed[i] = element.number_value;
+    }
+    *scratch = unboxed;
+    return unboxed;
+}
 
-    RuntimeValue result = { .type = RUNTIME_VALUE_STRING, .string_value = result_str };
+static RuntimeValue number_result(double number) {
+    RuntimeValue result = { .type = RUNTIME_VALUE_NUMBER };
+    result.number_value = number;
     return result;
 }
 
-RuntimeValue builtin_to_lower(Environment* env, RuntimeValue* args, int arg_count) {
-    (void)env;
-    if (arg_count != 1 || args[0].type != RUNTIME_VALUE_STRING) {
-        fprintf(stderr, "Error: 'to_lower' requires a single string argument.\n");
+static RuntimeValue array_result(ScriptArray* array) {
+    if (!array) {
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
+    RuntimeValue result = { .type = RUNTIME_VALUE_ARRAY };
+    result.array_value = array;
+    return result;
+}
 
-    const char* str = args[0].string_value;
-    char* result_str = malloc(strlen(str) + 1);
-    if (!result_str) {
-        fprintf(stderr, "Error: Memory allocation failed.\n");
+typedef enum { REDUCE_SUM, REDUCE_MIN, REDUCE_MAX } NumericReduction;
+
+static RuntimeValue numeric_reduce(RuntimeValue* args, int arg_count, const char* name,
+                                   NumericReduction op) {
+    if (arg_count != 1) {
+        output_sink_error("Error: '%s' requires one array.\n", name);
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    double* scratch;
+    int count;
+    const double* values = numeric_elements(&args[0], name, &scratch, &count);
+    if (!values) {
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    // min/max of nothing is null rather than an infinity
+    if (count == 0 && op != REDUCE_SUM) {
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
+    const NumericKernels* kernels = numeric_kernels();
+    double result = op == REDUCE_SUM ? kernels->sum(values, (size_t)count)
+                  : op == REDUCE_MIN ? kernels->min(values, (size_t)count)
+                                     : kernels->max(values, (size_t)count);
+    ember_free(scratch);
+    return number_result(result);
+}
+
+RuntimeValue builtin_sum(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    return numeric_reduce(args, arg_count, "sum", REDUCE_SUM);
+}
+
+RuntimeValue builtin_min(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    return numeric_reduce(args, arg_count, "min", REDUCE_MIN);
+}
+
+RuntimeValue builtin_max(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    return numeric_reduce(args, arg_count, "max", REDUCE_MAX);
+}
 
-    for (size_t i = 0; str[i]; ++i) {
-        result_str[i] = tolower(str[i]);
+RuntimeValue builtin_dot(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
+    if (arg_count != 2) {
+        output_sink_error("Error: 'dot' requires two arrays.\n");
+        return result;
+    }
+    double *scratch_a, *scratch_b = NULL;
+    int count_a, count_b;
+    const double* a = numeric_elements(&args[0], "dot", &scratch_a, &count_a);
+    const double* b = a ? numeric_elements(&args[1], "dot", &scratch_b, &count_b) : NULL;
+    if (a && b) {
+        if (count_a != count_b) {
+            output_sink_error("Error: 'dot' requires arrays of the same length.\n");
+        } else {
+            result = number_result(numeric_kernels()->dot(a, b, (size_t)count_a));
+        }
     }
-    result_str[strlen(str)] = '\0';
+    ember_free(scratch_a);
+    ember_free(scratch_b);
+    return result;
+}
 
-    RuntimeValue result = { .type = RUNTIME_VALUE_STRING, .string_value = result_str };
+RuntimeValue builtin_scale(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    if (arg_count != 2 || args[1].type != RUNTIME_VALUE_NUMBER) {
+        output_sink_error("Error: 'scale' requires an array and a number.\n");
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    double* scratch;
+    int count;
+    const double* values = numeric_elements(&args[0], "scale", &scratch, &count);
+    if (!values) {
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    double* out;
+    ScriptArray* scaled = array_create_numbers(count, &out);
+    if (scaled) {
+        numeric_kernels()->scale(out, values, (size_t)count, args[1].number_value);
+    }
+    ember_free(scratch);
+    return array_result(scaled);
+}
+
+RuntimeValue builtin_add_arrays(Environment* env, RuntimeValue* args, int arg_count) {
+    (void)env;
+    RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
+    if (arg_count != 2) {
+        output_sink_error("Error: 'add_arrays' requires two arrays.\n");
+        return result;
+    }
+    double *scratch_a, *scratch_b = NULL;
+    int count_a, count_b;
+    const double* a = numeric_elements(&args[0], "add_arrays", &scratch_a, &count_a);
+    const double* b = a ? numeric_elements(&args[1], "add_arrays", &scratch_b, &count_b) : NULL;
+    if (a && b) {
+        if (count_a != count_b) {
+            output_sink_error("Error: 'add_arrays' requires arrays of the same length.\n");
+        } else {
+            double* out;
+            ScriptArray* sums = array_create_numbers(count_a, &out);
+            if (sums) {
+                numeric_kernels()->add(out, a, b, (size_t)count_a);
+            }
+            result = array_result(sums);
+        }
+    }
+    ember_free(scratch_a);
+    ember_free(scratch_b);
     return result;
 }
 
-RuntimeValue builtin_index_of(Environment* env, RuntimeValue* args, int arg_count) {
+RuntimeValue builtin_clamp_all(Environment* env, RuntimeValue* args, int arg_count) {
     (void)env;
-    if (arg_count != 2 || args[0].type != RUNTIME_VALUE_STRING || args[1].type != RUNTIME_VALUE_STRING) {
-        fprintf(stderr, "Error: 'index_of' requires two string arguments.\n");
+    if (arg_count != 3 || args[1].type != RUNTIME_VALUE_NUMBER || args[2].type != RUNTIME_VALUE_NUMBER) {
+        output_sink_error("Error: 'clamp_all' requires an array and two numeric bounds.\n");
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    double* scratch;
+    int count;
+    const double* values = numeric_elements(&args[0], "clamp_all", &scratch, &count);
+    if (!values) {
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
+    double* out;
+    ScriptArray* clamped = array_create_numbers(count, &out);
+    if (clamped) {
+        numeric_kernels()->clamp(out, values, (size_t)count,
+                                 args[1].number_value, args[2].number_value);
+    }
+    ember_free(scratch);
+    return array_result(clamped);
+}
 
-    const char* haystack = args[0].string_value;
-    const char* needle = args[1].string_value;
-    const char* found = strstr(haystack, needle);
+/* -------------------------------------------------------
+   Builtins callable from the VM
+   ------------------------------------------------------- */
+
+// These need no environment, so compiled code calls them directly through
+// OP_CALL_NATIVE. Compiled chunks refer to them by index: append only.
+static const struct {
+    const char* name;
+    BuiltinFunction function;
+} vm_natives[] = {
+    { "sum", builtin_sum },
+    { "min", builtin_min },
+    { "max", builtin_max },
+    { "dot", builtin_dot },
+    { "scale", builtin_scale },
+    { "add_arrays", builtin_add_arrays },
+    { "clamp_all", builtin_clamp_all },
+    { "to_upper", builtin_to_upper },
+    { "to_lower", builtin_to_lower },
+    { "index_of", builtin_index_of },
+    { "replace", builtin_replace },
+    { "substring", builtin_substring },
+    { "concat", builtin_concat },
+    { "to_string", builtin_to_string },
+};
+
+#define VM_NATIVE_COUNT ((int)(sizeof(vm_natives) / sizeof(vm_natives[0])))
+
+int builtins_native_index(const char* name) {
+    for (int i = 0; i < VM_NATIVE_COUNT; i++) {
+        if (strcmp(vm_natives[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-    if (!found) {
-        return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = -1 };
+BuiltinFunction builtins_native(int index) {
+    if (index < 0 || index >= VM_NATIVE_COUNT) {
+        return NULL;
+    }
+    return vm_natives[index].function;
+}
+
+/* -------------------------------------------------------
+   Data-parallel array operations
+   ------------------------------------------------------- */
+
+// Smallest number of elements worth handing to a worker on its own
+#define PARALLEL_MIN_CHUNK 64
+// Chunks per worker, so uneven callbacks can be balanced by stealing
+#define PARALLEL_CHUNKS_PER_WORKER 4
+
+typedef enum {
+    PARALLEL_MAP,
+    PARALLEL_FILTER,
+    PARALLEL_REDUCE
+} ParallelOp;
+
+typedef struct {
+    ParallelOp op;
+    Environment* env;             // Task scope over the shared snapshot of the caller's environment
+    const RuntimeValue* function;
+    const ScriptArray* array;     // Shared input, read-only
+    int start;
+    int end;
+    RuntimeValue* results;        // MAP: one slot per element (shared, disjoint ranges)
+    bool* keep;                   // FILTER: one flag per element (shared, disjoint ranges)
+    RuntimeValue partial;         // REDUCE: this chunk's fold
+} ParallelChunk;
+
+static void parallel_run_chunk(void* arg) {
+    ParallelChunk* chunk = (ParallelChunk*)arg;
+
+    for (int i = chunk->start; i < chunk->end; i++) {
+        RuntimeValue borrowed = array_get(chunk->array, i);
+        RuntimeValue element = runtime_value_copy(&borrowed);
+
+        switch (chunk->op) {
+            case PARALLEL_MAP:
+                chunk->results[i] = runtime_call_function(chunk->env, chunk->function, &element, 1);
+                break;
+            case PARALLEL_FILTER: {
+                RuntimeValue verdict = runtime_call_function(chunk->env, chunk->function, &element, 1);
+                chunk->keep[i] = verdict.type == RUNTIME_VALUE_BOOLEAN && verdict.boolean_value;
+                runtime_free_value(&verdict);
+                break;
+            }
+            case PARALLEL_REDUCE:
+                if (i == chunk->start) {
+                    // Seed the fold with the chunk's first element
+                    chunk->partial = element;
+                    continue;
+                } else {
+                    RuntimeValue pair[2] = { chunk->partial, element };
+                    chunk->partial = runtime_call_function(chunk->env, chunk->function, pair, 2);
+                    runtime_free_value(&pair[0]);
+                }
+                break;
+        }
+        runtime_free_value(&element);
     }
+}
 
-    return (RuntimeValue){ .type = RUNTIME_VALUE_NUMBER, .number_value = (int)(found - haystack) };
+// Split `array` into chunks, run them on the pool and wait for all of them.
+// Returns the chunk array (free it with parallel_free_chunks), or NULL.
+static ParallelChunk* parallel_dispatch(Environment* env, ParallelOp op, const RuntimeValue* array,
+                                        const RuntimeValue* function, RuntimeValue* results,
+                                        bool* keep, int* chunk_count_out) {
+    int count = array_count(array->array_value);
+    ThreadPool* pool = thread_pool_default();
+    int workers = thread_pool_worker_count(pool);
+    if (workers < 1) {
+        workers = 1;
+    }
+
+    int chunk_size = (count + workers * PARALLEL_CHUNKS_PER_WORKER - 1) / (workers * PARALLEL_CHUNKS_PER_WORKER);
+    if (chunk_size < PARALLEL_MIN_CHUNK) {
+        chunk_size = PARALLEL_MIN_CHUNK;
+    }
+    int chunk_count = (count + chunk_size - 1) / chunk_size;
+
+    ParallelChunk* chunks = (ParallelChunk*)ember_calloc(EMBER_MEM_BUILTINS, (size_t)chunk_count, sizeof(ParallelChunk));
+    ThreadPoolTask** tasks = (ThreadPoolTask**)ember_calloc(EMBER_MEM_BUILTINS, (size_t)chunk_count, sizeof(ThreadPoolTask*));
+    // One snapshot for the whole dispatch, taken before any chunk starts.
+    // Chunks only read it; their writes land in their own task scope.
+    Environment* snapshot = chunks && tasks ? runtime_snapshot_environment(env) : NULL;
+    if (!chunks || !tasks || !snapshot) {
+        output_sink_error("Error: Memory allocation failed for parallel chunks.\n");
+        ember_free(chunks);
+        ember_free(tasks);
+        return NULL;
+    }
+    runtime_share_environment(snapshot);
+
+    for (int c = 0; c < chunk_count; c++) {
+        ParallelChunk* chunk = &chunks[c];
+        chunk->op = op;
+        chunk->env = runtime_create_child_environment(snapshot);
+        chunk->function = function;
+        chunk->array = array->array_value;
+        chunk->start = c * chunk_size;
+        chunk->end = chunk->start + chunk_size < count ? chunk->start + chunk_size : count;
+        chunk->results = results;
+        chunk->keep = keep;
+        chunk->partial.type = RUNTIME_VALUE_NULL;
+    }
+
+    for (int c = 0; c < chunk_count; c++) {
+        tasks[c] = pool ? thread_pool_submit(pool, parallel_run_chunk, &chunks[c]) : NULL;
+        if (!tasks[c]) {
+            // No pool (or submit failed): run this chunk here
+            parallel_run_chunk(&chunks[c]);
+        }
+    }
+    for (int c = 0; c < chunk_count; c++) {
+        thread_pool_join(tasks[c]);
+    }
+    ember_free(tasks);
+
+    *chunk_count_out = chunk_count;
+    return chunks;
 }
 
-RuntimeValue builtin_replace(Environment* env, RuntimeValue* args, int arg_count) {
-    (void)env;
-    if (arg_count != 3 || args[0].type != RUNTIME_VALUE_STRING || args[1].type != RUNTIME_VALUE_STRING || args[2].type != RUNTIME_VALUE_STRING) {
-        fprintf(stderr, "Error: 'replace' requires three string arguments.\n");
+static void parallel_free_chunks(ParallelChunk* chunks, int chunk_count) {
+    // Every task scope hangs off the same snapshot
+    Environment* snapshot = chunks[0].env->parent;
+    for (int c = 0; c < chunk_count; c++) {
+        runtime_free_environment(chunks[c].env);
+    }
+    runtime_free_environment(snapshot);
+    ember_free(chunks);
+}
+
+static bool parallel_check_args(const char* name, RuntimeValue* args, int arg_count, int expected) {
+    if (arg_count != expected || args[0].type != RUNTIME_VALUE_ARRAY ||
+        args[1].type != RUNTIME_VALUE_FUNCTION) {
+        output_sink_error("Error: '%s' requires an array and a function%s.\n",
+                          name, expected == 3 ? " and an initial value" : "");
+        return false;
+    }
+    return true;
+}
+
+// Array value owning `values` (which is freed); numbers end up unboxed
+static RuntimeValue array_from_values(RuntimeValue* values, int count) {
+    ScriptArray* array = array_create(count);
+    if (!array) {
+        for (int i = 0; i < count; i++) {
+            runtime_free_value(&values[i]);
+        }
+        ember_free(values);
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
+    for (int i = 0; i < count; i++) {
+        if (!array_push(array, values[i])) {
+            runtime_free_value(&values[i]);
+        }
+    }
+    ember_free(values);
+    RuntimeValue result = { .type = RUNTIME_VALUE_ARRAY };
+    result.array_value = array;
+    return result;
+}
 
-    const char* str = args[0].string_value;
-    const char* search = args[1].string_value;
-    const char* replace = args[2].string_value;
+RuntimeValue builtin_parallel_map(Environment* env, RuntimeValue* args, int arg_count) {
+    if (!parallel_check_args("parallel_map", args, arg_count, 2)) {
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
 
-    const char* pos = strstr(str, search);
-    if (!pos) {
-        char* result_str = strdup(str);
-        return (RuntimeValue){ .type = RUNTIME_VALUE_STRING, .string_value = result_str };
+    int count = array_count(args[0].array_value);
+    RuntimeValue* results = (RuntimeValue*)ember_malloc(EMBER_MEM_BUILTINS, sizeof(RuntimeValue) * (count > 0 ? count : 1));
+    if (!results) {
+        output_sink_error("Error: Memory allocation failed.\n");
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
 
-    size_t before_len = pos - str;
-    size_t search_len = strlen(search);
-    size_t replace_len = strlen(replace);
-    size_t after_len = strlen(pos + search_len);
+    if (count > 0) {
+        int chunk_count = 0;
+        ParallelChunk* chunks = parallel_dispatch(env, PARALLEL_MAP, &args[0], &args[1], results, NULL, &chunk_count);
+        if (!chunks) {
+            ember_free(results);
+            return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+        }
+        parallel_free_chunks(chunks, chunk_count);
+    }
 
-    char* result_str = malloc(before_len + replace_len + after_len + 1);
-    if (!result_str) {
-        fprintf(stderr, "Error: Memory allocation failed.\n");
+    return array_from_values(results, count);
+}
+
+RuntimeValue builtin_parallel_filter(Environment* env, RuntimeValue* args, int arg_count) {
+    if (!parallel_check_args("parallel_filter", args, arg_count, 2)) {
         return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
     }
 
-    strncpy(result_str, str, before_len);
-    strcpy(result_str + before_len, replace);
-    strcpy(result_str + before_len + replace_len, pos + search_len);
+    int count = array_count(args[0].array_value);
+    bool* keep = (bool*)ember_calloc(EMBER_MEM_BUILTINS, (size_t)(count > 0 ? count : 1), sizeof(bool));
+    if (!keep) {
+        output_sink_error("Error: Memory allocation failed.\n");
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
 
-    RuntimeValue result = { .type = RUNTIME_VALUE_STRING, .string_value = result_str };
+    if (count > 0) {
+        int chunk_count = 0;
+        ParallelChunk* chunks = parallel_dispatch(env, PARALLEL_FILTER, &args[0], &args[1], NULL, keep, &chunk_count);
+        if (!chunks) {
+            ember_free(keep);
+            return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+        }
+        parallel_free_chunks(chunks, chunk_count);
+    }
+
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        kept += keep[i];
+    }
+    ScriptArray* kept_array = array_create(kept);
+    if (!kept_array) {
+        ember_free(keep);
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    for (int i = 0; i < count; i++) {
+        if (keep[i]) {
+            RuntimeValue element = array_get(args[0].array_value, i);
+            array_push(kept_array, runtime_value_copy(&element));
+        }
+    }
+    ember_free(keep);
+
+    RuntimeValue result = { .type = RUNTIME_VALUE_ARRAY };
+    result.array_value = kept_array;
     return result;
 }
+
+RuntimeValue builtin_parallel_reduce(Environment* env, RuntimeValue* args, int arg_count) {
+    if (!parallel_check_args("parallel_reduce", args, arg_count, 3)) {
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+
+    RuntimeValue accumulator = runtime_value_copy(&args[2]);
+    if (array_count(args[0].array_value) == 0) {
+        return accumulator;
+    }
+
+    int chunk_count = 0;
+    ParallelChunk* chunks = parallel_dispatch(env, PARALLEL_REDUCE, &args[0], &args[1], NULL, NULL, &chunk_count);
+    if (!chunks) {
+        runtime_free_value(&accumulator);
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+
+    // Fold the partials in chunk order on the calling thread
+    for (int c = 0; c < chunk_count; c++) {
+        RuntimeValue pair[2] = { accumulator, chunks[c].partial };
+        accumulator = runtime_call_function(env, &args[1], pair, 2);
+        runtime_free_value(&pair[0]);
+        runtime_free_value(&pair[1]);
+    }
+    parallel_free_chunks(chunks, chunk_count);
+    return accumulator;
+}
@@ -8,6 +8,9 @@
 #include "virtual_machine.h"
 #include "parser.h"  // For ASTNodeType, ASTNode, etc.
 #include "utils.h"
+#include "builtins.h"
+#include "script_string.h"
+#include "ember_alloc.h"
 
 static void compile_node(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symtab);
 
@@ -15,27 +18,28 @@ static void compile_node(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symta
    Symbol Table Implementation
    ------------------------------------------------------- */
 SymbolTable* symbol_table_create() {
-    SymbolTable* table = (SymbolTable*)malloc(sizeof(SymbolTable));
+    SymbolTable* table = (SymbolTable*)ember_malloc(EMBER_MEM_COMPILER, sizeof(SymbolTable));
     if (!table) return NULL;
     table->symbols = NULL;
     table->capacity = 0;
     table->count = 0;
+    table->scope = NULL;
     return table;
 }
 
 void symbol_table_free(SymbolTable* table) {
     if (!table) return;
     for (int i = 0; i < table->count; i++) {
-        free(table->symbols[i].name);
+        ember_free(table->symbols[i].name);
     }
-    free(table->symbols);
-    free(table);
+    ember_free(table->symbols);
+    ember_free(table);
 }
 
 static void ensure_symtab_capacity(SymbolTable* table) {
     if (table->count >= table->capacity) {
         int new_capacity = (table->capacity < 8) ? 8 : table->capacity * 2;
-        Symbol* new_symbols = realloc(table->symbols, new_capacity * sizeof(Symbol));
+        Symbol* new_symbols = ember_realloc(EMBER_MEM_COMPILER, table->symbols, new_capacity * sizeof(Symbol));
         if (!new_symbols) {
             fprintf(stderr, "Error: SymbolTable reallocation failed.\n");
             exit(EXIT_FAILURE);
@@ -56,13 +60,95 @@ int symbol_table_get_or_add(SymbolTable* table, const char* name, bool isFunctio
     // Otherwise, create a new symbol
     ensure_symtab_capacity(table);
     int index = table->count;
-    table->symbols[index].name = strdup(name);
+    table->symbols[index].name = ember_strdup(EMBER_MEM_COMPILER, name);
     table->symbols[index].index = index;      // For simplicity
     table->symbols[index].isFunction = isFunction;
     table->count++;
     return index;
 }
 
+static bool symbol_table_has(const SymbolTable* table, const char* name) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->symbols[i].name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Give every function the script defines its global up front, so a call
+// that comes before the definition (or recursion) still resolves to it
+// rather than to a host builtin of the same name
+static void declare_functions(const ASTNode* node, SymbolTable* symtab) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statement_count; i++) {
+                declare_functions(node->block.statements[i], symtab);
+            }
+            break;
+        case AST_FUNCTION_DEF:
+            symbol_table_get_or_add(symtab, node->function_def.function_name, true);
+            declare_functions(node->function_def.body, symtab);
+            break;
+        case AST_IF_STATEMENT:
+            declare_functions(node->if_statement.body, symtab);
+            declare_functions(node->if_statement.else_body, symtab);
+            break;
+        case AST_WHILE_LOOP:
+            declare_functions(node->while_loop.body, symtab);
+            break;
+        case AST_FOR_LOOP:
+            declare_functions(node->for_loop.body, symtab);
+            break;
+        default:
+            break;
+    }
+}
+
+/* -------------------------------------------------------
+   Function-local slots
+   ------------------------------------------------------- */
+
+// Maximum slots per frame (locals are addressed by a one-byte operand)
+#define MAX_LOCALS 256
+
+static int scope_resolve(const LocalScope* scope, const char* name) {
+    if (!scope) return -1;
+    for (int i = 0; i < scope->count; i++) {
+        if (strcmp(scope->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static int scope_declare(LocalScope* scope, const char* name) {
+    int slot = scope_resolve(scope, name);
+    if (slot >= 0) return slot;
+    if (scope->count >= MAX_LOCALS) {
+        fprintf(stderr, "Compiler error: Too many locals in one function (max %d).\n", MAX_LOCALS);
+        return -1;
+    }
+    if (scope->count == scope->capacity) {
+        int new_capacity = (scope->capacity < 8) ? 8 : scope->capacity * 2;
+        char** names = ember_realloc(EMBER_MEM_COMPILER, scope->names, new_capacity * sizeof(char*));
+        if (!names) {
+            fprintf(stderr, "Error: LocalScope reallocation failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        scope->names = names;
+        scope->capacity = new_capacity;
+    }
+    scope->names[scope->count] = ember_strdup(EMBER_MEM_COMPILER, name);
+    return scope->count++;
+}
+
+static void scope_free(LocalScope* scope) {
+    for (int i = 0; i < scope->count; i++) {
+        ember_free(scope->names[i]);
+    }
+    ember_free(scope->names);
+}
+
 /* -------------------------------------------------------
    Utility: Emit Single Byte or Byte + Operand
    ------------------------------------------------------- */
@@ -74,6 +160,16 @@ static void emit_two_bytes(BytecodeChunk* chunk, uint8_t b1, uint8_t b2) {
     emit_byte(chunk, b2);
 }
 
+// Line of the outermost import being compiled, or 0. The line table has no
+// file names, so code merged in from an import is attributed to the import
+// statement rather than to lines of a file the reader can't see.
+static _Thread_local int import_line = 0;
+
+// Attribute the code emitted next to the source line of `node`
+static void mark_line(BytecodeChunk* chunk, const ASTNode* node) {
+    vm_chunk_mark_line(chunk, import_line ? import_line : node->line);
+}
+
 static int emit_jump(BytecodeChunk* chunk, uint8_t jumpOp) {
     // Emit the jump opcode plus two bytes for the jump offset (16-bit, big-endian)
     emit_byte(chunk, jumpOp);
@@ -100,10 +196,176 @@ static void emit_constant(BytecodeChunk* chunk, RuntimeValue val) {
     emit_byte(chunk, (uint8_t)index);
 }
 
+static void emit_null(BytecodeChunk* chunk) {
+    RuntimeValue nullVal;
+    nullVal.type = RUNTIME_VALUE_NULL;
+    emit_constant(chunk, nullVal);
+}
+
+// Constant index of property name `name`, shared by every site that uses it
+static int property_name_constant(BytecodeChunk* chunk, const char* name) {
+    for (int i = 0; i < chunk->constants_count; i++) {
+        const RuntimeValue* c = &chunk->constants[i];
+        if (c->type == RUNTIME_VALUE_STRING && strcmp(string_cstr(c->string_value), name) == 0) {
+            return i;
+        }
+    }
+    RuntimeValue nameVal;
+    nameVal.type = RUNTIME_VALUE_STRING;
+    nameVal.string_value = string_from_cstr(name);
+    return add_constant(chunk, nameVal);
+}
+
+// OP_GET_PROPERTY / OP_SET_PROPERTY: name constant, then a 16-bit inline
+// cache slot unique to this site
+static void emit_property_op(BytecodeChunk* chunk, uint8_t op, const char* name) {
+    int nameIndex = property_name_constant(chunk, name);
+    if (nameIndex > UINT8_MAX) {
+        fprintf(stderr, "Compiler error: Too many constants for property '%s'.\n", name);
+    }
+    int cacheIndex = VM_PROPERTY_CACHE_NONE;
+    if (chunk->property_cache_count < VM_PROPERTY_CACHE_NONE) {
+        cacheIndex = chunk->property_cache_count++;
+    }
+    emit_byte(chunk, op);
+    emit_byte(chunk, (uint8_t)nameIndex);
+    emit_two_bytes(chunk, (cacheIndex >> 8) & 0xFF, cacheIndex & 0xFF);
+}
+
+// Load or store `name`: a frame slot inside a function if it is one of its
+// locals, otherwise a global
+static void emit_variable(BytecodeChunk* chunk, SymbolTable* symtab, const char* name, bool store) {
+    int slot = scope_resolve(symtab->scope, name);
+    if (slot >= 0) {
+        emit_byte(chunk, store ? OP_STORE_LOCAL : OP_LOAD_LOCAL);
+        emit_byte(chunk, (uint8_t)slot);
+        return;
+    }
+    int varIndex = symbol_table_get_or_add(symtab, name, false);
+    emit_byte(chunk, store ? OP_STORE_VAR : OP_LOAD_VAR);
+    emit_byte(chunk, (uint8_t)varIndex);
+}
+
 /* -------------------------------------------------------
    Expression Compiler
    ------------------------------------------------------- */
+static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symtab);
+
+static bool is_print_call(const ASTNode* node) {
+    return node->type == AST_FUNCTION_CALL &&
+           strcmp(node->function_call.function_name, "print") == 0;
+}
+
+static void compile_print_arguments(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symtab) {
+    for (int i = 0; i < node->function_call.argument_count; i++) {
+        compile_expression(node->function_call.arguments[i], chunk, symtab);
+        emit_byte(chunk, OP_PRINT);
+    }
+}
+
+// The coroutine intrinsics map straight onto opcodes. Returns false if
+// `node` is not one of them.
+static bool compile_coroutine_intrinsic(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symtab) {
+    const char* name = node->function_call.function_name;
+    int argc = node->function_call.argument_count;
+    ASTNode** args = node->function_call.arguments;
+
+    if (strcmp(name, "coroutine_create") == 0) {
+        if (argc != 1) {
+            fprintf(stderr, "Compiler error: coroutine_create takes one function.\n");
+            emit_null(chunk);
+            return true;
+        }
+        compile_expression(args[0], chunk, symtab);
+        emit_byte(chunk, OP_NEW_COROUTINE);
+        return true;
+    }
+    if (strcmp(name, "coroutine_resume") == 0) {
+        if (argc < 1 || argc > 2) {
+            fprintf(stderr, "Compiler error: coroutine_resume takes a coroutine and an optional value.\n");
+            emit_null(chunk);
+            return true;
+        }
+        compile_expression(args[0], chunk, symtab);
+        if (argc == 2) {
+            compile_expression(args[1], chunk, symtab);
+        } else {
+            emit_null(chunk);
+        }
+        emit_byte(chunk, OP_RESUME);
+        return true;
+    }
+    if (strcmp(name, "coroutine_yield") == 0) {
+        if (argc > 1) {
+            fprintf(stderr, "Compiler error: coroutine_yield takes at most one value.\n");
+        }
+        if (argc >= 1) {
+            compile_expression(args[0], chunk, symtab);
+        } else {
+            emit_null(chunk);
+        }
+        emit_byte(chunk, OP_YIELD);
+        return true;
+    }
+    return false;
+}
+
+// sleep(ms) / wait_event(name): hand the VM back to its scheduler
+static bool compile_scheduler_intrinsic(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symtab) {
+    const char* name = node->function_call.function_name;
+    OpCode op;
+    if (strcmp(name, "sleep") == 0) {
+        op = OP_SLEEP;
+    } else if (strcmp(name, "wait_event") == 0) {
+        op = OP_WAIT_EVENT;
+    } else {
+        return false;
+    }
+    if (node->function_call.argument_count != 1) {
+        fprintf(stderr, "Compiler error: %s takes exactly one argument.\n", name);
+        emit_null(chunk);
+        return true;
+    }
+    compile_expression(node->function_call.arguments[0], chunk, symtab);
+    emit_byte(chunk, (uint8_t)op);
+    return true;
+}
+
+// len(x) / push(array, value) / slice(array, start[, end]) run inline so
+// they work on packed arrays without a host call
+static bool compile_array_intrinsic(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symtab) {
+    const char* name = node->function_call.function_name;
+    int argc = node->function_call.argument_count;
+    ASTNode** args = node->function_call.arguments;
+    OpCode op;
+    int min_args, max_args;
+    if (strcmp(name, "len") == 0) {
+        op = OP_LEN; min_args = 1; max_args = 1;
+    } else if (strcmp(name, "push") == 0) {
+        op = OP_ARRAY_PUSH; min_args = 2; max_args = 2;
+    } else if (strcmp(name, "slice") == 0) {
+        op = OP_SLICE; min_args = 2; max_args = 3;
+    } else {
+        return false;
+    }
+    if (argc < min_args || argc > max_args) {
+        fprintf(stderr, "Compiler error: Wrong number of arguments to %s.\n", name);
+        emit_null(chunk);
+        return true;
+    }
+    for (int i = 0; i < argc; i++) {
+        compile_expression(args[i], chunk, symtab);
+    }
+    if (op == OP_SLICE && argc == 2) {
+        // No end: slice to the end of the array
+        emit_null(chunk);
+    }
+    emit_byte(chunk, (uint8_t)op);
+    return true;
+}
+
 static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symtab) {
+    mark_line(chunk, node);
     switch (node->type) {
         case AST_LITERAL: {
             RuntimeValue cval;
@@ -111,11 +373,11 @@ static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
             switch (node->literal.token_type) {
                 case TOKEN_NUMBER:
                     cval.type = RUNTIME_VALUE_NUMBER;
-                    cval.number_value = atof(node->literal.value);
+                    cval.number_value = node->literal.number;
                     break;
                 case TOKEN_STRING:
                     cval.type = RUNTIME_VALUE_STRING;
-                    cval.string_value = strdup(node->literal.value);
+                    cval.string_value = string_from_cstr(node->literal.value);
                     break;
                 case TOKEN_BOOLEAN:
                     cval.type = RUNTIME_VALUE_BOOLEAN;
@@ -133,25 +395,24 @@ static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
         }
         case AST_VARIABLE: {
             // Load from variable
-            int varIndex = symbol_table_get_or_add(symtab, node->variable.variable_name, false);
-            emit_byte(chunk, OP_LOAD_VAR);
-            emit_byte(chunk, (uint8_t)varIndex);
+            emit_variable(chunk, symtab, node->variable.variable_name, false);
             break;
         }
         case AST_ASSIGNMENT: {
             // compile right-hand side
             compile_expression(node->assignment.value, chunk, symtab);
+            // Stores consume their operand; keep a copy as the expression's value
+            emit_byte(chunk, OP_DUP);
             // store into variable
-            int varIndex = symbol_table_get_or_add(symtab, node->assignment.variable, false);
-            emit_byte(chunk, OP_STORE_VAR);
-            emit_byte(chunk, (uint8_t)varIndex);
-            // The value remains on stack (if you want the assignment to produce a value).
+            emit_variable(chunk, symtab, node->assignment.variable, true);
             break;
         }
         case AST_BINARY_OP: {
             // compile left, then right
             compile_expression(node->binary_op.left, chunk, symtab);
             compile_expression(node->binary_op.right, chunk, symtab);
+            // The operands may have spanned lines; the operator is on this one
+            mark_line(chunk, node);
             // pick an opcode
             const char* op = node->binary_op.op_symbol;
             if (strcmp(op, "+") == 0) {
@@ -162,6 +423,12 @@ static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
                 emit_byte(chunk, OP_MUL);
             } else if (strcmp(op, "/") == 0) {
                 emit_byte(chunk, OP_DIV);
+            } else if (strcmp(op, "%") == 0) {
+                emit_byte(chunk, OP_MOD);
+            } else if (strcmp(op, "&&") == 0) {
+                emit_byte(chunk, OP_AND);
+            } else if (strcmp(op, "||") == 0) {
+                emit_byte(chunk, OP_OR);
             } else if (strcmp(op, "==") == 0) {
                 emit_byte(chunk, OP_EQ);
             } else if (strcmp(op, "!=") == 0) {
@@ -180,15 +447,31 @@ static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
             break;
         }
         case AST_FUNCTION_CALL: {
+            // A script function or variable of the same name takes precedence
+            // over the intrinsics and host builtins below
+            bool shadowed = symbol_table_has(symtab, node->function_call.function_name);
             // Special-case “print(…)" as a builtin
             // TODO(SD) this is an example placeholder
             if (strcmp(node->function_call.function_name, "print") == 0) {
-                // Evaluate the arguments (for adventure_game.ember, we assume 1 arg)
+                // Print each argument; OP_PRINT consumes its operand
+                compile_print_arguments(node, chunk, symtab);
+                // As an expression, print(...) evaluates to null
+                emit_null(chunk);
+            } else if (!shadowed && compile_coroutine_intrinsic(node, chunk, symtab)) {
+                // coroutine_create / coroutine_resume / coroutine_yield
+            } else if (!shadowed && compile_scheduler_intrinsic(node, chunk, symtab)) {
+                // sleep / wait_event
+            } else if (!shadowed && compile_array_intrinsic(node, chunk, symtab)) {
+                // len / push / slice
+            } else if (!shadowed && builtins_native_index(node->function_call.function_name) >= 0) {
+                // A host builtin the script does not shadow with its own function
                 for (int i = 0; i < node->function_call.argument_count; i++) {
                     compile_expression(node->function_call.arguments[i], chunk, symtab);
                 }
-                // OP_PRINT
-                emit_byte(chunk, OP_PRINT);
+                mark_line(chunk, node);
+                emit_byte(chunk, OP_CALL_NATIVE);
+                emit_byte(chunk, (uint8_t)builtins_native_index(node->function_call.function_name));
+                emit_byte(chunk, (uint8_t)node->function_call.argument_count);
             } else {
                 // For user-defined function calls:
                 //  1) push arguments (left->right)
@@ -198,6 +481,7 @@ static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
                 //  2) Identify function (store index in constant or symbol table)
                 int funcIndex = symbol_table_get_or_add(symtab, node->function_call.function_name, true);
                 //  3) OP_CALL <funcIndex> <argCount>
+                mark_line(chunk, node);
                 emit_byte(chunk, OP_CALL);
                 emit_byte(chunk, (uint8_t)funcIndex);
                 emit_byte(chunk, (uint8_t)node->function_call.argument_count);
@@ -211,11 +495,9 @@ static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
             emit_byte(chunk, OP_NEW_ARRAY);
             // Now stack has a new empty array
             for (int i = 0; i < count; i++) {
-                // push the array ref again
-                emit_byte(chunk, OP_DUP);
                 // compile the element
                 compile_expression(node->array_literal.elements[i], chunk, symtab);
-                // OP_ARRAY_PUSH
+                // OP_ARRAY_PUSH pops the value and the array, then pushes the array back
                 emit_byte(chunk, OP_ARRAY_PUSH);
             }
             // The resulting array is on the stack top
@@ -230,6 +512,37 @@ static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
             emit_byte(chunk, OP_GET_INDEX);
             break;
         }
+        case AST_OBJECT_LITERAL: {
+            // OP_NEW_OBJECT, then store each property into a copy of it
+            emit_byte(chunk, OP_NEW_OBJECT);
+            for (int i = 0; i < node->object_literal.property_count; i++) {
+                emit_byte(chunk, OP_DUP);
+                compile_expression(node->object_literal.values[i], chunk, symtab);
+                emit_property_op(chunk, OP_SET_PROPERTY, node->object_literal.keys[i]);
+                // OP_SET_PROPERTY leaves the stored value behind
+                emit_byte(chunk, OP_POP);
+            }
+            break;
+        }
+        case AST_PROPERTY_ACCESS: {
+            compile_expression(node->property_access.object_expr, chunk, symtab);
+            emit_property_op(chunk, OP_GET_PROPERTY, node->property_access.property_name);
+            break;
+        }
+        case AST_INDEX_ASSIGNMENT: {
+            compile_expression(node->index_assignment.array_expr, chunk, symtab);
+            compile_expression(node->index_assignment.index_expr, chunk, symtab);
+            compile_expression(node->index_assignment.value, chunk, symtab);
+            // OP_SET_INDEX leaves the stored value behind
+            emit_byte(chunk, OP_SET_INDEX);
+            break;
+        }
+        case AST_PROPERTY_ASSIGNMENT: {
+            compile_expression(node->property_assignment.object_expr, chunk, symtab);
+            compile_expression(node->property_assignment.value, chunk, symtab);
+            emit_property_op(chunk, OP_SET_PROPERTY, node->property_assignment.property_name);
+            break;
+        }
         case AST_UNARY_OP: {
             // e.g. !x
             compile_expression(node->unary_op.operand, chunk, symtab);
@@ -253,6 +566,7 @@ static void compile_expression(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
    Statement Compiler
    ------------------------------------------------------- */
 static void compile_statement(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symtab) {
+    mark_line(chunk, node);
     switch (node->type) {
         case AST_VARIABLE_DECL: {
             // var X = <expr>;
@@ -264,9 +578,11 @@ static void compile_statement(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
                 cval.type = RUNTIME_VALUE_NULL;
                 emit_constant(chunk, cval);
             }
-            int varIndex = symbol_table_get_or_add(symtab, node->variable_decl.variable_name, false);
-            emit_byte(chunk, OP_STORE_VAR);
-            emit_byte(chunk, (uint8_t)varIndex);
+            // Inside a function every `var` gets a frame slot
+            if (symtab->scope) {
+                scope_declare(symtab->scope, node->variable_decl.variable_name);
+            }
+            emit_variable(chunk, symtab, node->variable_decl.variable_name, true);
             break;
         }
         case AST_ASSIGNMENT:
@@ -274,9 +590,18 @@ static void compile_statement(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
         case AST_FUNCTION_CALL:
         case AST_ARRAY_LITERAL:
         case AST_INDEX_ACCESS:
+        case AST_OBJECT_LITERAL:
+        case AST_PROPERTY_ACCESS:
+        case AST_PROPERTY_ASSIGNMENT:
+        case AST_INDEX_ASSIGNMENT:
         case AST_UNARY_OP:
         case AST_LITERAL:
         case AST_VARIABLE: {
+            // A bare print(...) statement leaves nothing behind to pop
+            if (is_print_call(node)) {
+                compile_print_arguments(node, chunk, symtab);
+                break;
+            }
             // Expression statement
             compile_expression(node, chunk, symtab);
             // pop result (unless we want to keep it)
@@ -314,6 +639,7 @@ static void compile_statement(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
             // compile body
             compile_node(node->while_loop.body, chunk, symtab);
             // jump back to loopStart
+            mark_line(chunk, node);
             emit_byte(chunk, OP_LOOP);
             // We store a 2-byte offset for OP_LOOP
             // Distance = current - loopStart + 2 (the size of OP_LOOP itself)
@@ -345,13 +671,19 @@ static void compile_statement(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
 
             if (!import_root) {
                 fprintf(stderr, "Compiler error: Parsing '%s' failed.\n", filename);
-                free(import_parser);
-                free(import_source);
+                ember_free(import_parser);
+                ember_free(import_source);
                 return;
             }
             
-            // 3) Compile the new AST into *this same* chunk + symtab
+            // 3) Compile the new AST into *this same* chunk + symtab,
+            //    attributing all of it to the import statement's line
+            int outer_import_line = import_line;
+            if (!outer_import_line) {
+                import_line = node->line;
+            }
             bool ok = compile_ast(import_root, chunk, symtab);
+            import_line = outer_import_line;
             if (!ok) {
                 fprintf(stderr, "Compiler error: Sub-compile for '%s' failed.\n", filename);
             }
@@ -365,8 +697,8 @@ static void compile_statement(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
 
             // 5) Cleanup
             free_ast(import_root);
-            free(import_parser);
-            free(import_source);
+            ember_free(import_parser);
+            ember_free(import_source);
 
             // no code needed at runtime => we just physically merged it
             break;
@@ -402,6 +734,7 @@ static void compile_statement(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
                 emit_byte(chunk, OP_POP); // discard inc result
             }
             // jump back to loopStart
+            mark_line(chunk, node);
             emit_byte(chunk, OP_LOOP);
             int offset = chunk->code_count - loopStart + 2;
             emit_byte(chunk, (offset >> 8) & 0xFF);
@@ -412,28 +745,52 @@ static void compile_statement(ASTNode* node, BytecodeChunk* chunk, SymbolTable*
             break;
         }
         case AST_FUNCTION_DEF: {
-            // A minimal approach:
-            //   1) We skip emitting code for the body right now, OR
-            //   2) We compile the function body into the same chunk at some label,
-            //      store that label in a constant or symbol table, then store it in a variable.
-            //
-            // For adventure_game.ember, we _do_ have function definitions. Let's store them as
-            // “functionName -> instruction pointer offset” in the symbol table. We'll place
-            // them in a separate “jump over function” block for now.
-            //
-            // For simplicity, we’ll do nothing but store a “null” if we just want to parse it
-            // without actually using VM calls. The example below does a partial approach.
-            //
-            // Better approach is: 
-            //   - Record the current IP
-            //   - compile the function body (like a mini chunk)
-            //   - store function meta in the symtab
-            //   - when calling, jump to that IP, then jump back
-            // But that’s more advanced than we want for the first pass. 
-            //
-            // Let's do a do-nothing placeholder so we can parse the script successfully:
-            int funcIndex = symbol_table_get_or_add(symtab, node->function_def.function_name, true);
-            // We won't generate real code for the function body. So let's just ignore parameters & body:
+            // The body is compiled inline and jumped over; defining the
+            // function stores a FUNCTION_TYPE_BYTECODE constant in its global.
+            BytecodeFunction* fn = (BytecodeFunction*)ember_malloc(EMBER_MEM_COMPILER, sizeof(BytecodeFunction));
+            if (!fn) {
+                fprintf(stderr, "Error: Memory allocation failed for BytecodeFunction.\n");
+                exit(EXIT_FAILURE);
+            }
+            fn->name = ember_strdup(EMBER_MEM_COMPILER, node->function_def.function_name);
+            fn->arity = node->function_def.parameter_count;
+
+            int skipJump = emit_jump(chunk, OP_JUMP);
+            fn->entry = chunk->code_count;
+
+            LocalScope scope = { NULL, 0, 0 };
+            LocalScope* enclosing = symtab->scope;
+            symtab->scope = &scope;
+            for (int i = 0; i < fn->arity; i++) {
+                scope_declare(&scope, node->function_def.parameters[i]);
+            }
+            compile_node(node->function_def.body, chunk, symtab);
+            // Falling off the end returns null
+            emit_null(chunk);
+            emit_byte(chunk, OP_RETURN);
+            symtab->scope = enclosing;
+
+            fn->local_count = scope.count;
+            scope_free(&scope);
+            patch_jump(chunk, skipJump);
+
+            RuntimeValue fnVal;
+            fnVal.type = RUNTIME_VALUE_FUNCTION;
+            fnVal.function_value.function_type = FUNCTION_TYPE_BYTECODE;
+            fnVal.function_value.bytecode_function = fn;
+            emit_constant(chunk, fnVal);
+            int funcIndex = symbol_table_get_or_add(symtab, fn->name, true);
+            emit_byte(chunk, OP_STORE_VAR);
+            emit_byte(chunk, (uint8_t)funcIndex);
+            break;
+        }
+        case AST_RETURN: {
+            if (node->return_stmt.value) {
+                compile_expression(node->return_stmt.value, chunk, symtab);
+            } else {
+                emit_null(chunk);
+            }
+            emit_byte(chunk, OP_RETURN);
             break;
         }
         case AST_BLOCK: {
@@ -475,11 +832,16 @@ static void compile_node(ASTNode* node, BytecodeChunk* chunk, SymbolTable* symta
         case AST_BINARY_OP:
         case AST_ARRAY_LITERAL:
         case AST_INDEX_ACCESS:
+        case AST_OBJECT_LITERAL:
+        case AST_PROPERTY_ACCESS:
+        case AST_PROPERTY_ASSIGNMENT:
+        case AST_INDEX_ASSIGNMENT:
         case AST_UNARY_OP:
         case AST_LITERAL:
         case AST_VARIABLE:
         case AST_IMPORT:
         case AST_SWITCH_CASE:
+        case AST_RETURN:
             compile_statement(node, chunk, symtab);
             break;
 
@@ -498,9 +860,234 @@ bool compile_ast(ASTNode* ast, BytecodeChunk* chunk, SymbolTable* symtab) {
         return false;
     }
 
+    declare_functions(ast, symtab);
     compile_node(ast, chunk, symtab);
 
     // Finally, emit an OP_EOF or OP_RETURN to cleanly end
     emit_byte(chunk, OP_EOF);
+
+    // Record how deep the operand stack gets so the VM can pre-size it
+    int depth = compile_max_stack_depth(chunk);
+    if (depth < 0) {
+        fprintf(stderr, "Compiler error: Generated bytecode has an inconsistent stack depth.\n");
+        return false;
+    }
+    chunk->max_stack_depth = depth;
     return true;
 }
+
+/* -------------------------------------------------------
+   Stack Depth Analysis
+   ------------------------------------------------------- */
+
+/**
+ * Decode the instruction at `offset`: its encoded length, its net effect on
+ * the operand stack and, for branches, the jump target. Returns false for
+ * opcodes the VM cannot execute.
+ */
+static bool instruction_info(const BytecodeChunk* chunk, int offset,
+                             int* length, int* effect, int* target,
+                             bool* falls_through) {
+    const uint8_t* code = chunk->code;
+    *target = -1;
+    *falls_through = true;
+
+    switch (code[offset]) {
+        case OP_NOOP:
+        case OP_SWAP:
+        case OP_NEG:
+        case OP_NOT:
+        case OP_TO_STRING:
+            *length = 1; *effect = 0; return true;
+        case OP_EOF:
+            *length = 1; *effect = 0; *falls_through = false; return true;
+        case OP_RETURN:
+            *length = 1; *effect = -1; *falls_through = false; return true;
+        case OP_YIELD:
+        case OP_NEW_COROUTINE:
+        case OP_SLEEP:
+        case OP_WAIT_EVENT:
+        case OP_LEN:
+            *length = 1; *effect = 0; return true;
+        case OP_RESUME:
+            *length = 1; *effect = -1; return true;
+        case OP_POP:
+        case OP_PRINT:
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_AND: case OP_OR:
+        case OP_EQ: case OP_NEQ: case OP_LT: case OP_GT: case OP_LTE: case OP_GTE:
+        case OP_ARRAY_PUSH:
+        case OP_GET_INDEX:
+            *length = 1; *effect = -1; return true;
+        case OP_SET_INDEX:
+        case OP_SLICE:
+            *length = 1; *effect = -2; return true;
+        case OP_DUP:
+        case OP_NEW_ARRAY:
+        case OP_NEW_OBJECT:
+            *length = 1; *effect = 1; return true;
+        case OP_GET_PROPERTY:
+        case OP_SET_PROPERTY: {
+            if (offset + 3 >= chunk->code_count) return false;
+            // The VM reads the name without checking it
+            int nameIndex = code[offset + 1];
+            if (nameIndex >= chunk->constants_count ||
+                chunk->constants[nameIndex].type != RUNTIME_VALUE_STRING ||
+                !chunk->constants[nameIndex].string_value) {
+                return false;
+            }
+            *length = 4;
+            *effect = code[offset] == OP_GET_PROPERTY ? 0 : -1;
+            return true;
+        }
+        case OP_LOAD_CONST:
+        case OP_LOAD_VAR:
+        case OP_LOAD_LOCAL:
+            *length = 2; *effect = 1; return true;
+        case OP_STORE_VAR:
+        case OP_STORE_LOCAL:
+            *length = 2; *effect = -1; return true;
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_LOOP: {
+            if (offset + 2 >= chunk->code_count) return false;
+            int distance = (code[offset + 1] << 8) | code[offset + 2];
+            *length = 3;
+            if (code[offset] == OP_LOOP) {
+                *target = offset + 3 - distance;
+                *effect = 0;
+                *falls_through = false;
+            } else if (code[offset] == OP_JUMP) {
+                *target = offset + 3 + distance;
+                *effect = 0;
+                *falls_through = false;
+            } else {
+                *target = offset + 3 + distance;
+                *effect = -1;
+            }
+            return true;
+        }
+        case OP_CALL_NATIVE:
+            if (offset + 2 >= chunk->code_count || !builtins_native(code[offset + 1])) return false;
+            *length = 3;
+            *effect = 1 - code[offset + 2];
+            return true;
+        case OP_CALL: {
+            if (offset + 2 >= chunk->code_count) return false;
+            // Arguments are replaced by a single result
+            *length = 3;
+            *effect = 1 - code[offset + 2];
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+int compile_max_stack_depth(const BytecodeChunk* chunk) {
+    if (!chunk || chunk->code_count == 0) return 0;
+
+    // depth_at[i] = stack depth on entry to the instruction at offset i (-1 = unvisited)
+    int* depth_at = (int*)ember_malloc(EMBER_MEM_COMPILER, sizeof(int) * chunk->code_count);
+    int* worklist = (int*)ember_malloc(EMBER_MEM_COMPILER, sizeof(int) * chunk->code_count);
+    if (!depth_at || !worklist) {
+        ember_free(depth_at);
+        ember_free(worklist);
+        return -1;
+    }
+    for (int i = 0; i < chunk->code_count; i++) depth_at[i] = -1;
+
+    int max_depth = 0;
+    int pending = 0;
+    depth_at[0] = 0;
+    worklist[pending++] = 0;
+
+    // Function bodies are only reached through calls; each starts a fresh
+    // frame holding its locals. The deepest single frame is what we report.
+    for (int i = 0; i < chunk->constants_count; i++) {
+        const RuntimeValue* c = &chunk->constants[i];
+        if (c->type != RUNTIME_VALUE_FUNCTION ||
+            c->function_value.function_type != FUNCTION_TYPE_BYTECODE) {
+            continue;
+        }
+        const BytecodeFunction* fn = c->function_value.bytecode_function;
+        if (!fn || fn->entry < 0 || fn->entry >= chunk->code_count ||
+            fn->arity < 0 || fn->local_count < fn->arity || fn->local_count > 256) {
+            ember_free(depth_at);
+            ember_free(worklist);
+            return -1;
+        }
+        if (depth_at[fn->entry] != -1) continue;
+        depth_at[fn->entry] = fn->local_count;
+        worklist[pending++] = fn->entry;
+        if (fn->local_count > max_depth) max_depth = fn->local_count;
+    }
+
+    while (pending > 0) {
+        int offset = worklist[--pending];
+        int depth = depth_at[offset];
+
+        int length, effect, target;
+        bool falls_through;
+        if (!instruction_info(chunk, offset, &length, &effect, &target, &falls_through)) {
+            max_depth = -1;
+            break;
+        }
+
+        // Conditional jumps pop before branching, so both edges see the same depth
+        int after = depth + effect;
+        if (after < 0) {
+            max_depth = -1;
+            break;
+        }
+        if (after > max_depth) max_depth = after;
+
+        int successors[2];
+        int successor_count = 0;
+        if (falls_through) successors[successor_count++] = offset + length;
+        if (target >= 0) successors[successor_count++] = target;
+
+        for (int i = 0; i < successor_count; i++) {
+            int next = successors[i];
+            if (next < 0 || next >= chunk->code_count) continue;
+            if (depth_at[next] == -1) {
+                depth_at[next] = after;
+                worklist[pending++] = next;
+            } else if (depth_at[next] != after) {
+                // Control-flow merge with mismatched depths
+                max_depth = -1;
+                break;
+            }
+        }
+        if (max_depth < 0) break;
+    }
+
+    ember_free(depth_at);
+    ember_free(worklist);
+    return max_depth;
+}
+
+int compile_property_cache_count(const BytecodeChunk* chunk) {
+    if (!chunk) return 0;
+
+    // Instructions are laid out back to back (function bodies included), so
+    // a linear walk sees every property site
+    int count = 0;
+    int offset = 0;
+    while (offset < chunk->code_count) {
+        int length, effect, target;
+        bool falls_through;
+        if (!instruction_info(chunk, offset, &length, &effect, &target, &falls_through)) {
+            return -1;
+        }
+        uint8_t op = chunk->code[offset];
+        if (op == OP_GET_PROPERTY || op == OP_SET_PROPERTY) {
+            int cacheIndex = (chunk->code[offset + 2] << 8) | chunk->code[offset + 3];
+            if (cacheIndex != VM_PROPERTY_CACHE_NONE && cacheIndex >= count) {
+                count = cacheIndex + 1;
+            }
+        }
+        offset += length;
+    }
+    return count;
+}
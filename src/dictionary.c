@@ -0,0 +1,203 @@
+// dictionary.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "dictionary.h"
+#include "ember_alloc.h"
+
+// Control byte of a slot that has never held a key. Full slots store the
+// low seven bits of their hash, so they are never negative.
+#define CTRL_EMPTY ((int8_t)-128)
+
+/* -------------------------------------------------------
+   Hashing
+   ------------------------------------------------------- */
+
+// 64-bit FNV-1a with a final avalanche so both the group index (high bits)
+// and the control tag (low bits) depend on every byte of the key
+static uint64_t dictionary_hash(const char* key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static inline int8_t hash_tag(uint64_t hash) {
+    return (int8_t)(hash & 0x7F);
+}
+
+/* -------------------------------------------------------
+   Group matching: bit i of the result is set when control
+   byte i of the group equals `tag`
+   ------------------------------------------------------- */
+
+static inline uint32_t group_match(const int8_t* group, int8_t tag) {
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(tag)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < DICTIONARY_GROUP_WIDTH; i++) {
+        if (group[i] == tag) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+static inline int lowest_bit(uint32_t mask) {
+    return __builtin_ctz(mask);
+}
+
+/* -------------------------------------------------------
+   Table
+   ------------------------------------------------------- */
+
+static bool dictionary_alloc(Dictionary* dict, size_t capacity) {
+    int8_t* ctrl = (int8_t*)ember_malloc(EMBER_MEM_RUNTIME, capacity);
+    DictionaryEntry* entries = (DictionaryEntry*)ember_malloc(EMBER_MEM_RUNTIME,
+                                                              sizeof(DictionaryEntry) * capacity);
+    if (!ctrl || !entries) {
+        ember_free(ctrl);
+        ember_free(entries);
+        return false;
+    }
+    memset(ctrl, CTRL_EMPTY, capacity);
+    dict->ctrl = ctrl;
+    dict->entries = entries;
+    dict->capacity = capacity;
+    return true;
+}
+
+Dictionary* dictionary_create(size_t expected) {
+    Dictionary* dict = (Dictionary*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(Dictionary));
+    if (!dict) {
+        fprintf(stderr, "Error: Memory allocation failed for dictionary.\n");
+        return NULL;
+    }
+    // Stay under the 7/8 load limit without an immediate resize
+    size_t capacity = DICTIONARY_GROUP_WIDTH;
+    while (capacity * 7 / 8 < expected) {
+        capacity *= 2;
+    }
+    if (!dictionary_alloc(dict, capacity)) {
+        fprintf(stderr, "Error: Memory allocation failed for dictionary.\n");
+        ember_free(dict);
+        return NULL;
+    }
+    dict->count = 0;
+    return dict;
+}
+
+void dictionary_free(Dictionary* dict) {
+    if (!dict) return;
+    for (size_t i = 0; i < dict->capacity; i++) {
+        if (dict->ctrl[i] != CTRL_EMPTY) {
+            ember_free(dict->entries[i].key);
+            runtime_free_value(&dict->entries[i].value);
+        }
+    }
+    ember_free(dict->ctrl);
+    ember_free(dict->entries);
+    ember_free(dict);
+}
+
+static DictionaryEntry* dictionary_lookup(const Dictionary* dict, const char* key, uint64_t hash) {
+    int8_t tag = hash_tag(hash);
+    // Groups are visited in triangular order (g, g+1, g+3, g+6, ...), which
+    // covers every group of a power-of-two table before repeating
+    size_t group_mask = dict->capacity / DICTIONARY_GROUP_WIDTH - 1;
+    size_t index = (hash >> 7) & group_mask;
+    for (size_t step = 1; step <= group_mask + 1; step++) {
+        size_t base = index * DICTIONARY_GROUP_WIDTH;
+        const int8_t* group = dict->ctrl + base;
+        for (uint32_t match = group_match(group, tag); match; match &= match - 1) {
+            DictionaryEntry* entry = &dict->entries[base + lowest_bit(match)];
+            if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+                return entry;
+            }
+        }
+        // Keys are never removed, so an empty slot ends the probe sequence
+        if (group_match(group, CTRL_EMPTY)) {
+            return NULL;
+        }
+        index = (index + step) & group_mask;
+    }
+    return NULL;
+}
+
+// First empty slot along `hash`'s probe sequence; the table must have one
+static size_t dictionary_free_slot(const Dictionary* dict, uint64_t hash) {
+    size_t group_mask = dict->capacity / DICTIONARY_GROUP_WIDTH - 1;
+    size_t index = (hash >> 7) & group_mask;
+    for (size_t step = 1; step <= group_mask + 1; step++) {
+        size_t base = index * DICTIONARY_GROUP_WIDTH;
+        uint32_t empty = group_match(dict->ctrl + base, CTRL_EMPTY);
+        if (empty) {
+            return base + lowest_bit(empty);
+        }
+        index = (index + step) & group_mask;
+    }
+    return 0; // unreachable while the load limit holds
+}
+
+static bool dictionary_grow(Dictionary* dict) {
+    Dictionary old = *dict;
+    if (!dictionary_alloc(dict, old.capacity * 2)) {
+        return false;
+    }
+    // Entries keep their hash, so moving them never re-hashes a key
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.ctrl[i] == CTRL_EMPTY) continue;
+        size_t slot = dictionary_free_slot(dict, old.entries[i].hash);
+        dict->ctrl[slot] = hash_tag(old.entries[i].hash);
+        dict->entries[slot] = old.entries[i];
+    }
+    ember_free(old.ctrl);
+    ember_free(old.entries);
+    return true;
+}
+
+RuntimeValue* dictionary_find(const Dictionary* dict, const char* key) {
+    DictionaryEntry* entry = dictionary_lookup(dict, key, dictionary_hash(key));
+    return entry ? &entry->value : NULL;
+}
+
+RuntimeValue* dictionary_insert(Dictionary* dict, const char* key) {
+    uint64_t hash = dictionary_hash(key);
+    DictionaryEntry* existing = dictionary_lookup(dict, key, hash);
+    if (existing) {
+        return &existing->value;
+    }
+
+    if ((dict->count + 1) * 8 > dict->capacity * 7 && !dictionary_grow(dict)) {
+        fprintf(stderr, "Error: Memory allocation failed while growing dictionary.\n");
+        return NULL;
+    }
+    char* owned = ember_strdup(EMBER_MEM_RUNTIME, key);
+    if (!owned) {
+        fprintf(stderr, "Error: Memory allocation failed for dictionary key.\n");
+        return NULL;
+    }
+
+    size_t slot = dictionary_free_slot(dict, hash);
+    dict->ctrl[slot] = hash_tag(hash);
+    DictionaryEntry* entry = &dict->entries[slot];
+    entry->key = owned;
+    entry->hash = hash;
+    entry->value.type = RUNTIME_VALUE_NULL;
+    dict->count++;
+    return &entry->value;
+}
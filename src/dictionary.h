@@ -0,0 +1,56 @@
+// dictionary.h
+//
+// String-keyed hash map backing objects in dictionary mode. It is laid out
+// like a SwissTable: a control byte per slot holding seven bits of the key's
+// hash (or EMPTY), scanned sixteen at a time, so a probe touches the entries
+// array only for likely matches.
+
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "runtime.h"
+
+/// Slots whose control bytes are compared in one step.
+#define DICTIONARY_GROUP_WIDTH 16
+
+typedef struct {
+    char* key;
+    uint64_t hash;
+    RuntimeValue value;
+} DictionaryEntry;
+
+typedef struct {
+    int8_t* ctrl;              // One control byte per slot
+    DictionaryEntry* entries;
+    size_t capacity;           // Power of two, at least one group
+    size_t count;
+} Dictionary;
+
+/**
+ * Create a map sized for about `expected` keys. Returns NULL on allocation
+ * failure.
+ */
+Dictionary* dictionary_create(size_t expected);
+
+/**
+ * Free the map, its keys and (with runtime_free_value) its values.
+ */
+void dictionary_free(Dictionary* dict);
+
+/**
+ * Value stored under `key`, or NULL.
+ */
+RuntimeValue* dictionary_find(const Dictionary* dict, const char* key);
+
+/**
+ * Value stored under `key`, inserting a null one first if it is absent.
+ * The pointer stays valid until the next insertion. Returns NULL on
+ * allocation failure.
+ */
+RuntimeValue* dictionary_insert(Dictionary* dict, const char* key);
+
+#endif // DICTIONARY_H
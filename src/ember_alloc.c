@@ -0,0 +1,139 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ember_alloc.h"
+
+static void* default_alloc(void* user, size_t size) {
+    (void)user;
+    return malloc(size);
+}
+
+static void* default_realloc(void* user, void* ptr, size_t size) {
+    (void)user;
+    return realloc(ptr, size);
+}
+
+static void default_free(void* user, void* ptr) {
+    (void)user;
+    free(ptr);
+}
+
+static const EmberAllocator default_allocator = {
+    default_alloc, default_realloc, default_free, NULL
+};
+
+static EmberAllocator current = {
+    default_alloc, default_realloc, default_free, NULL
+};
+
+// Relaxed atomics: the counters are statistics and order nothing else
+typedef struct {
+    atomic_uint_fast64_t calls;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t failures;
+} SubsystemCounters;
+
+static SubsystemCounters counters[EMBER_MEM_SUBSYSTEM_COUNT];
+
+static const char* subsystem_names[EMBER_MEM_SUBSYSTEM_COUNT] = {
+    "lexer", "parser", "compiler", "vm", "runtime", "builtins"
+};
+
+static void count_request(EmberMemSubsystem subsystem, size_t size, const void* result) {
+    SubsystemCounters* c = &counters[subsystem];
+    atomic_fetch_add_explicit(&c->calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->bytes, size, memory_order_relaxed);
+    if (!result) {
+        atomic_fetch_add_explicit(&c->failures, 1, memory_order_relaxed);
+    }
+}
+
+void ember_set_allocator(const EmberAllocator* allocator) {
+    current = allocator ? *allocator : default_allocator;
+}
+
+const EmberAllocator* ember_get_allocator(void) {
+    return &current;
+}
+
+void* ember_malloc(EmberMemSubsystem subsystem, size_t size) {
+    void* result = current.alloc(current.user, size);
+    count_request(subsystem, size, result);
+    return result;
+}
+
+void* ember_calloc(EmberMemSubsystem subsystem, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        count_request(subsystem, 0, NULL);
+        return NULL;
+    }
+    size_t total = count * size;
+    void* result = current.alloc(current.user, total);
+    count_request(subsystem, total, result);
+    if (result) {
+        memset(result, 0, total);
+    }
+    return result;
+}
+
+void* ember_realloc(EmberMemSubsystem subsystem, void* ptr, size_t size) {
+    void* result = current.realloc(current.user, ptr, size);
+    count_request(subsystem, size, result);
+    return result;
+}
+
+char* ember_strdup(EmberMemSubsystem subsystem, const char* s) {
+    size_t length = strlen(s) + 1;
+    char* copy = (char*)ember_malloc(subsystem, length);
+    if (copy) {
+        memcpy(copy, s, length);
+    }
+    return copy;
+}
+
+char* ember_strndup(EmberMemSubsystem subsystem, const char* s, size_t n) {
+    size_t length = 0;
+    while (length < n && s[length]) {
+        length++;
+    }
+    char* copy = (char*)ember_malloc(subsystem, length + 1);
+    if (copy) {
+        memcpy(copy, s, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+void ember_free(void* ptr) {
+    if (ptr) {
+        current.free(current.user, ptr);
+    }
+}
+
+EmberMemStats ember_mem_stats(EmberMemSubsystem subsystem) {
+    EmberMemStats stats = { 0, 0, 0 };
+    if (subsystem < 0 || subsystem >= EMBER_MEM_SUBSYSTEM_COUNT) {
+        return stats;
+    }
+    const SubsystemCounters* c = &counters[subsystem];
+    stats.calls = atomic_load_explicit(&c->calls, memory_order_relaxed);
+    stats.bytes = atomic_load_explicit(&c->bytes, memory_order_relaxed);
+    stats.failures = atomic_load_explicit(&c->failures, memory_order_relaxed);
+    return stats;
+}
+
+void ember_mem_stats_reset(void) {
+    for (int i = 0; i < EMBER_MEM_SUBSYSTEM_COUNT; i++) {
+        atomic_store_explicit(&counters[i].calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&counters[i].bytes, 0, memory_order_relaxed);
+        atomic_store_explicit(&counters[i].failures, 0, memory_order_relaxed);
+    }
+}
+
+const char* ember_mem_subsystem_name(EmberMemSubsystem subsystem) {
+    if (subsystem < 0 || subsystem >= EMBER_MEM_SUBSYSTEM_COUNT) {
+        return "unknown";
+    }
+    return subsystem_names[subsystem];
+}
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "event_bus.h"
+#include "ember_alloc.h"
+
+#define REGISTRY_INITIAL_CAPACITY 16
+
+/* -------------------------------------------------------
+   Handler registry (open addressing, linear probing)
+   ------------------------------------------------------- */
+
+typedef struct {
+    uint32_t hash;
+    char* name;              // NULL marks an empty slot
+    RuntimeValue* handlers;
+    int handler_count;
+    int handler_capacity;
+} EventSlot;
+
+/* -------------------------------------------------------
+   Posted events: Vyukov's intrusive MPSC queue. Producers swap
+   themselves in at `head`; the consumer walks from `tail`.
+   ------------------------------------------------------- */
+
+typedef struct PostedEvent {
+    _Atomic(struct PostedEvent*) next;
+    uint32_t hash;
+    bool has_data;
+    RuntimeValue data;
+    char name[];
+} PostedEvent;
+
+struct EventBus {
+    EventSlot* slots;
+    int slot_count;          // Occupied slots
+    int slot_capacity;       // Always a power of two
+
+    _Atomic(PostedEvent*) head;  // Producers
+    PostedEvent* tail;           // Consumer only
+    PostedEvent stub;
+};
+
+static _Thread_local EventBus* bound_bus = NULL;
+
+uint32_t event_bus_hash(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void event_bus_bind(EventBus* bus) {
+    bound_bus = bus;
+}
+
+EventBus* event_bus_current(void) {
+    return bound_bus;
+}
+
+static EventSlot* registry_find(const EventBus* bus, const char* name, uint32_t hash) {
+    uint32_t mask = (uint32_t)bus->slot_capacity - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        EventSlot* slot = &bus->slots[i];
+        if (!slot->name) {
+            return NULL;
+        }
+        if (slot->hash == hash && strcmp(slot->name, name) == 0) {
+            return slot;
+        }
+    }
+}
+
+static bool registry_grow(EventBus* bus) {
+    int capacity = bus->slot_capacity * 2;
+    EventSlot* slots = (EventSlot*)ember_calloc(EMBER_MEM_RUNTIME, (size_t)capacity, sizeof(EventSlot));
+    if (!slots) {
+        return false;
+    }
+    uint32_t mask = (uint32_t)capacity - 1;
+    for (int i = 0; i < bus->slot_capacity; i++) {
+        EventSlot* old = &bus->slots[i];
+        if (!old->name) {
+            continue;
+        }
+        uint32_t j = old->hash & mask;
+        while (slots[j].name) {
+            j = (j + 1) & mask;
+        }
+        slots[j] = *old;
+    }
+    ember_free(bus->slots);
+    bus->slots = slots;
+    bus->slot_capacity = capacity;
+    return true;
+}
+
+/* -------------------------------------------------------
+   Queue
+   ------------------------------------------------------- */
+
+static void queue_push(EventBus* bus, PostedEvent* event) {
+    atomic_store_explicit(&event->next, NULL, memory_order_relaxed);
+    PostedEvent* prev = atomic_exchange_explicit(&bus->head, event, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, event, memory_order_release);
+}
+
+// Consumer only. Returns NULL when empty, or when a producer has swapped in
+// but not yet linked its event (it becomes visible on a later call).
+static PostedEvent* queue_pop(EventBus* bus) {
+    PostedEvent* tail = bus->tail;
+    PostedEvent* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (tail == &bus->stub) {
+        if (!next) {
+            return NULL;
+        }
+        bus->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+    if (next) {
+        bus->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&bus->head, memory_order_acquire)) {
+        return NULL;
+    }
+    // `tail` is the last event: park the stub behind it so it can be taken
+    queue_push(bus, &bus->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        bus->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+static void posted_event_free(PostedEvent* event) {
+    if (event->has_data) {
+        runtime_free_value(&event->data);
+    }
+    ember_free(event);
+}
+
+/* -------------------------------------------------------
+   Public API
+   ------------------------------------------------------- */
+
+EventBus* event_bus_create(void) {
+    EventBus* bus = (EventBus*)ember_calloc(EMBER_MEM_RUNTIME, 1, sizeof(EventBus));
+    if (!bus) {
+        fprintf(stderr, "Error: Memory allocation failed for event bus.\n");
+        return NULL;
+    }
+    bus->slots = (EventSlot*)ember_calloc(EMBER_MEM_RUNTIME, REGISTRY_INITIAL_CAPACITY, sizeof(EventSlot));
+    if (!bus->slots) {
+        fprintf(stderr, "Error: Memory allocation failed for event registry.\n");
+        ember_free(bus);
+        return NULL;
+    }
+    bus->slot_capacity = REGISTRY_INITIAL_CAPACITY;
+
+    atomic_init(&bus->stub.next, NULL);
+    atomic_init(&bus->head, &bus->stub);
+    bus->tail = &bus->stub;
+    return bus;
+}
+
+void event_bus_free(EventBus* bus) {
+    if (!bus) {
+        return;
+    }
+    PostedEvent* event;
+    while ((event = queue_pop(bus)) != NULL) {
+        posted_event_free(event);
+    }
+    for (int i = 0; i < bus->slot_capacity; i++) {
+        EventSlot* slot = &bus->slots[i];
+        if (!slot->name) {
+            continue;
+        }
+        for (int h = 0; h < slot->handler_count; h++) {
+            runtime_free_value(&slot->handlers[h]);
+        }
+        ember_free(slot->handlers);
+        ember_free(slot->name);
+    }
+    if (bound_bus == bus) {
+        bound_bus = NULL;
+    }
+    ember_free(bus->slots);
+    ember_free(bus);
+}
+
+bool event_bus_on(EventBus* bus, const char* name, const RuntimeValue* handler) {
+    if (!bus || !name || !handler || handler->type != RUNTIME_VALUE_FUNCTION) {
+        fprintf(stderr, "Error: on() expects an event name and a function.\n");
+        return false;
+    }
+
+    uint32_t hash = event_bus_hash(name);
+    EventSlot* slot = registry_find(bus, name, hash);
+    if (!slot) {
+        // Keep the load factor under 3/4 so probes stay short
+        if ((bus->slot_count + 1) * 4 > bus->slot_capacity * 3 && !registry_grow(bus)) {
+            fprintf(stderr, "Error: Memory allocation failed for event registry.\n");
+            return false;
+        }
+        char* copy = ember_strdup(EMBER_MEM_RUNTIME, name);
+        if (!copy) {
+            fprintf(stderr, "Error: Memory allocation failed for event name.\n");
+            return false;
+        }
+        uint32_t mask = (uint32_t)bus->slot_capacity - 1;
+        uint32_t i = hash & mask;
+        while (bus->slots[i].name) {
+            i = (i + 1) & mask;
+        }
+        slot = &bus->slots[i];
+        slot->hash = hash;
+        slot->name = copy;
+        bus->slot_count++;
+    }
+
+    if (slot->handler_count == slot->handler_capacity) {
+        int capacity = slot->handler_capacity ? slot->handler_capacity * 2 : 2;
+        RuntimeValue* handlers = (RuntimeValue*)ember_realloc(EMBER_MEM_RUNTIME, slot->handlers, sizeof(RuntimeValue) * (size_t)capacity);
+        if (!handlers) {
+            fprintf(stderr, "Error: Memory allocation failed for event handlers.\n");
+            return false;
+        }
+        slot->handlers = handlers;
+        slot->handler_capacity = capacity;
+    }
+    slot->handlers[slot->handler_count++] = runtime_value_copy(handler);
+    return true;
+}
+
+int event_bus_handler_count(const EventBus* bus, const char* name) {
+    if (!bus || !name) {
+        return 0;
+    }
+    const EventSlot* slot = registry_find(bus, name, event_bus_hash(name));
+    return slot ? slot->handler_count : 0;
+}
+
+bool event_bus_post(EventBus* bus, const char* name, const RuntimeValue* data) {
+    if (!bus || !name) {
+        return false;
+    }
+    size_t length = strlen(name) + 1;
+    PostedEvent* event = (PostedEvent*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(PostedEvent) + length);
+    if (!event) {
+        fprintf(stderr, "Error: Memory allocation failed for posted event.\n");
+        return false;
+    }
+    memcpy(event->name, name, length);
+    event->hash = event_bus_hash(name);
+    event->has_data = data != NULL;
+    if (data) {
+        event->data = runtime_value_copy(data);
+    }
+    queue_push(bus, event);
+    return true;
+}
+
+static int bus_run_handlers(EventBus* bus, Environment* env, const char* name,
+                            uint32_t hash, RuntimeValue* data) {
+    EventSlot* slot = registry_find(bus, name, hash);
+    if (!slot) {
+        return 0;
+    }
+    // A handler may call on() and move the slot, so look it up again each
+    // time; handlers added meanwhile wait for the next event
+    int count = slot->handler_count;
+    for (int i = 0; i < count; i++) {
+        slot = registry_find(bus, name, hash);
+        RuntimeValue handler = slot->handlers[i];
+        RuntimeValue result = runtime_call_function(env, &handler, data, data ? 1 : 0);
+        runtime_free_value(&result);
+    }
+    return count;
+}
+
+int event_bus_dispatch(EventBus* bus, Environment* env, int max_events) {
+    if (!bus) {
+        return 0;
+    }
+    if (max_events <= 0) {
+        max_events = EVENT_BUS_DEFAULT_BATCH;
+    }
+
+    // Take the batch before running anything, so handlers that post more
+    // events cannot keep this call going
+    PostedEvent* first = NULL;
+    PostedEvent* last = NULL;
+    int taken = 0;
+    while (taken < max_events) {
+        PostedEvent* event = queue_pop(bus);
+        if (!event) {
+            break;
+        }
+        atomic_store_explicit(&event->next, NULL, memory_order_relaxed);
+        if (last) {
+            atomic_store_explicit(&last->next, event, memory_order_relaxed);
+        } else {
+            first = event;
+        }
+        last = event;
+        taken++;
+    }
+
+    while (first) {
+        PostedEvent* next = atomic_load_explicit(&first->next, memory_order_relaxed);
+        bus_run_handlers(bus, env, first->name, first->hash, first->has_data ? &first->data : NULL);
+        posted_event_free(first);
+        first = next;
+    }
+    return taken;
+}
+
+int event_bus_emit(EventBus* bus, Environment* env, const char* name, const RuntimeValue* data) {
+    if (!bus || !name) {
+        return 0;
+    }
+    RuntimeValue arg;
+    if (data) {
+        arg = *data;
+    }
+    return bus_run_handlers(bus, env, name, event_bus_hash(name), data ? &arg : NULL);
+}
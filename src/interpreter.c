@@ -3,6 +3,8 @@
 #include "lexer.h"
 #include "parser.h"
 #include "runtime.h"
+#include "output_sink.h"
+#include "ember_alloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -27,7 +29,7 @@ int interpreter_execute_script(const char* source) {
     if (!root) {
         fprintf(stderr, "Error: Parsing failed.\n");
         // Clean up parser
-        free(parser);
+        ember_free(parser);
         return 1;
     }
 
@@ -38,7 +40,7 @@ int interpreter_execute_script(const char* source) {
     if (!chunk) {
         fprintf(stderr, "Error: Failed to create bytecode chunk.\n");
         free_ast(root);
-        free(parser);
+        ember_free(parser);
         return 1;
     }
 
@@ -50,7 +52,7 @@ int interpreter_execute_script(const char* source) {
         fprintf(stderr, "Error: Failed to create symbol table.\n");
         vm_free_chunk(chunk);
         free_ast(root);
-        free(parser);
+        ember_free(parser);
         return 1;
     }
 
@@ -62,7 +64,7 @@ int interpreter_execute_script(const char* source) {
         symbol_table_free(symtab);
         vm_free_chunk(chunk);
         free_ast(root);
-        free(parser);
+        ember_free(parser);
         return 1;
     }
 
@@ -75,11 +77,12 @@ int interpreter_execute_script(const char* source) {
         symbol_table_free(symtab);
         vm_free_chunk(chunk);
         free_ast(root);
-        free(parser);
+        ember_free(parser);
         return 1;
     }
 
     int vm_result = vm_run(vm);  // 0 on success, non-zero on error
+    output_sink_flush(output_sink_current());
 
     /* -----------------------------
        7) Cleanup
@@ -88,7 +91,7 @@ int interpreter_execute_script(const char* source) {
     symbol_table_free(symtab);
     vm_free_chunk(chunk);
     free_ast(root);
-    free(parser);
+    ember_free(parser);
 
     return vm_result;
 }
\ No newline at end of file
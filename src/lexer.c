@@ -1,12 +1,25 @@
 #include "lexer.h"
+#include "ember_alloc.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
+// Significant digits that always fit in a uint64_t mantissa
+#define NUMBER_MAX_DIGITS 19
+// Mantissas up to 2^53 and powers of ten up to 1e22 are exact doubles, so
+// one multiply or divide gives the correctly rounded result (Clinger)
+#define NUMBER_EXACT_MANTISSA (UINT64_C(1) << 53)
+#define NUMBER_EXACT_POWER 22
+
+static const double exact_powers_of_ten[NUMBER_EXACT_POWER + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
 void lexer_init(Lexer* lexer, const char* source) {
   lexer->source = source;
@@ -28,7 +41,8 @@ void lexer_advance(Lexer* lexer) {
 }
 
 char lexer_peek(Lexer* lexer) {
-    if (lexer->position + 1 < (int)strlen(lexer->source)) {
+    // The source is NUL-terminated, so the next byte exists unless we are at the end
+    if (lexer->current_char != '\0') {
         return lexer->source[lexer->position + 1];
     }
     return '\0'; // Return null character if out of bounds
@@ -73,7 +87,7 @@ char* lexer_read_identifier(Lexer* lexer) {
     int length = lexer->position - start;
 
     // Allocate memory for the identifier
-    char* identifier = (char*)malloc(length + 1);
+    char* identifier = (char*)ember_malloc(EMBER_MEM_LEXER, length + 1);
     if (!identifier) {
         fprintf(stderr, "Error: Memory allocation failed for identifier\n");
         return NULL;
@@ -87,12 +101,105 @@ char* lexer_read_identifier(Lexer* lexer) {
 }
 
 
+// Add one digit to the mantissa; returns false once digits have to be dropped
+static bool number_push_digit(uint64_t* mantissa, int* digits, char c) {
+    if (*digits == 0 && c == '0') {
+        return true; // Leading zeros are not significant
+    }
+    if (*digits >= NUMBER_MAX_DIGITS) {
+        return false;
+    }
+    *mantissa = *mantissa * 10 + (uint64_t)(c - '0');
+    (*digits)++;
+    return true;
+}
+
+// strtod() on the literal's text, for the rare value the fast path can't
+// round exactly
+static double number_parse_slow(const char* text, int length) {
+    char buffer[64];
+    char* copy = length < (int)sizeof(buffer) ? buffer
+                                               : (char*)ember_malloc(EMBER_MEM_LEXER, (size_t)length + 1);
+    if (!copy) {
+        fprintf(stderr, "Error: Memory allocation failed for number literal\n");
+        return 0;
+    }
+    memcpy(copy, text, (size_t)length);
+    copy[length] = '\0';
+    double value = strtod(copy, NULL);
+    if (copy != buffer) {
+        ember_free(copy);
+    }
+    return value;
+}
+
+double lexer_read_number(Lexer* lexer) {
+    int start = lexer->position;
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool exact = true;
+
+    while (isdigit((unsigned char)lexer->current_char)) {
+        if (!number_push_digit(&mantissa, &digits, lexer->current_char)) {
+            // A dropped integer digit still scales the value
+            exponent++;
+            exact = exact && lexer->current_char == '0';
+        }
+        lexer_advance(lexer);
+    }
+    if (lexer->current_char == '.' && isdigit((unsigned char)lexer_peek(lexer))) {
+        lexer_advance(lexer);
+        while (isdigit((unsigned char)lexer->current_char)) {
+            if (number_push_digit(&mantissa, &digits, lexer->current_char)) {
+                exponent--;
+            } else {
+                exact = exact && lexer->current_char == '0';
+            }
+            lexer_advance(lexer);
+        }
+    }
+    if (lexer->current_char == 'e' || lexer->current_char == 'E') {
+        // Only an exponent if digits follow, so `2else` stays two tokens
+        const char* next = &lexer->source[lexer->position + 1];
+        if (*next == '+' || *next == '-') {
+            next++;
+        }
+        if (isdigit((unsigned char)*next)) {
+            lexer_advance(lexer);
+            bool negative = lexer->current_char == '-';
+            if (lexer->current_char == '+' || lexer->current_char == '-') {
+                lexer_advance(lexer);
+            }
+            int written = 0;
+            while (isdigit((unsigned char)lexer->current_char)) {
+                if (written < 100000) {
+                    written = written * 10 + (lexer->current_char - '0');
+                }
+                lexer_advance(lexer);
+            }
+            exponent += negative ? -written : written;
+        }
+    }
+
+    if (mantissa == 0) {
+        return 0;
+    }
+    if (exact && mantissa <= NUMBER_EXACT_MANTISSA &&
+        exponent >= -NUMBER_EXACT_POWER && exponent <= NUMBER_EXACT_POWER) {
+        // Whole numbers land here with exponent 0: no floating-point work at all
+        double value = (double)mantissa;
+        return exponent < 0 ? value / exact_powers_of_ten[-exponent]
+                            : value * exact_powers_of_ten[exponent];
+    }
+    return number_parse_slow(&lexer->source[start], lexer->position - start);
+}
 Token lexer_next_token(Lexer* lexer) {
     lexer_skip_whitespace_and_comments(lexer);
 
     // End of input
     if (lexer->current_char == '\0') {
-        return (Token){TOKEN_EOF, NULL, lexer->line, lexer->column};
+        return (Token){.type = TOKEN_EOF, .value = NULL, .line = lexer->line, .column = lexer->column};
     }
 
     // Identifiers and keywords
@@ -100,27 +207,20 @@ Token lexer_next_token(Lexer* lexer) {
         char* identifier = lexer_read_identifier(lexer);
 
         if (strcmp(identifier, "true") == 0 || strcmp(identifier, "false") == 0) {
-            return (Token){TOKEN_BOOLEAN, identifier, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_BOOLEAN, .value = identifier, .line = lexer->line, .column = lexer->column};
         } else if (strcmp(identifier, "null") == 0) {
-            return (Token){TOKEN_NULL, identifier, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_NULL, .value = identifier, .line = lexer->line, .column = lexer->column};
         } else if (is_keyword(identifier)) {
-            return (Token){TOKEN_KEYWORD, identifier, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_KEYWORD, .value = identifier, .line = lexer->line, .column = lexer->column};
         } else {
-            return (Token){TOKEN_IDENTIFIER, identifier, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_IDENTIFIER, .value = identifier, .line = lexer->line, .column = lexer->column};
         }
     }
 
     // Numbers
     if (isdigit(lexer->current_char)) {
-        int start = lexer->position;
-        while (isdigit(lexer->current_char) || lexer->current_char == '.') {
-            lexer_advance(lexer);
-        }
-        int length = lexer->position - start;
-        char* number = (char*)malloc(length + 1);
-        strncpy(number, &lexer->source[start], length);
-        number[length] = '\0';
-        return (Token){TOKEN_NUMBER, number, lexer->line, lexer->column};
+        double number = lexer_read_number(lexer);
+        return (Token){.type = TOKEN_NUMBER, .value = NULL, .line = lexer->line, .column = lexer->column, .number = number};
     }
 
     // Strings
@@ -131,10 +231,10 @@ Token lexer_next_token(Lexer* lexer) {
         size_t buffer_size = 64;
         size_t string_index = 0;
 
-        string = malloc(buffer_size);
+        string = ember_malloc(EMBER_MEM_LEXER, buffer_size);
         if (!string) {
             fprintf(stderr, "Error: Memory allocation failed for string literal\n");
-            return (Token){TOKEN_EOF, NULL, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_EOF, .value = NULL, .line = lexer->line, .column = lexer->column};
         }
 
         while (lexer->current_char != '"' && lexer->current_char != '\0') {
@@ -148,8 +248,8 @@ Token lexer_next_token(Lexer* lexer) {
                     default:
                         fprintf(stderr, "Error (Line %d, Position %d): Invalid escape sequence '\\%c'\n",
                                 lexer->line, lexer->position, lexer->current_char);
-                        free(string);
-                        return (Token){TOKEN_ERROR, NULL, lexer->line, lexer->column};
+                        ember_free(string);
+                        return (Token){.type = TOKEN_ERROR, .value = NULL, .line = lexer->line, .column = lexer->column};
                 }
             } else {
                 string[string_index++] = lexer->current_char;
@@ -157,11 +257,11 @@ Token lexer_next_token(Lexer* lexer) {
 
              if (string_index >= buffer_size - 1) {
                 buffer_size *= 2;
-                char* temp = realloc(string, buffer_size);
+                char* temp = ember_realloc(EMBER_MEM_LEXER, string, buffer_size);
                 if (!temp) {
                     fprintf(stderr, "Error: Memory allocation failed while reading string literal\n");
-                    free(string);
-                    return (Token){TOKEN_ERROR, NULL, lexer->line, lexer->column};
+                    ember_free(string);
+                    return (Token){.type = TOKEN_ERROR, .value = NULL, .line = lexer->line, .column = lexer->column};
                 }
                 string = temp;
             }
@@ -170,13 +270,13 @@ Token lexer_next_token(Lexer* lexer) {
 
         if (lexer->current_char == '\0') {
             fprintf(stderr, "Error: Unterminated string literal\n");
-            free(string);
-            return (Token){TOKEN_ERROR, NULL, lexer->line, lexer->column};
+            ember_free(string);
+            return (Token){.type = TOKEN_ERROR, .value = NULL, .line = lexer->line, .column = lexer->column};
         }
 
         string[string_index] = '\0'; // Null-terminate the string
         lexer_advance(lexer); // Skip closing quote
-        return (Token){TOKEN_STRING, string, lexer->line, lexer->column};
+        return (Token){.type = TOKEN_STRING, .value = string, .line = lexer->line, .column = lexer->column};
     }
 
     // Multi-character operators
@@ -188,31 +288,31 @@ Token lexer_next_token(Lexer* lexer) {
 
         if (lexer->current_char == '=') { // e.g., ==, !=, <=, >=
             lexer_advance(lexer);
-            char* operator = (char*)malloc(3);
+            char* operator = (char*)ember_malloc(EMBER_MEM_LEXER, 3);
             operator[0] = first_char;
             operator[1] = '=';
             operator[2] = '\0';
-            return (Token){TOKEN_OPERATOR, operator, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_OPERATOR, .value = operator, .line = lexer->line, .column = lexer->column};
         } else if (first_char == '&' && lexer->current_char == '&') { // &&
             lexer_advance(lexer);
-            char* operator = (char*)malloc(3);
+            char* operator = (char*)ember_malloc(EMBER_MEM_LEXER, 3);
             operator[0] = '&';
             operator[1] = '&';
             operator[2] = '\0';
-            return (Token){TOKEN_OPERATOR, operator, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_OPERATOR, .value = operator, .line = lexer->line, .column = lexer->column};
         } else if (first_char == '|' && lexer->current_char == '|') { // ||
             lexer_advance(lexer);
-            char* operator = (char*)malloc(3);
+            char* operator = (char*)ember_malloc(EMBER_MEM_LEXER, 3);
             operator[0] = '|';
             operator[1] = '|';
             operator[2] = '\0';
-            return (Token){TOKEN_OPERATOR, operator, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_OPERATOR, .value = operator, .line = lexer->line, .column = lexer->column};
         } else {
             // Single-character operator (e.g., =, <, >, !)
-            char* operator = (char*)malloc(2);
+            char* operator = (char*)ember_malloc(EMBER_MEM_LEXER, 2);
             operator[0] = first_char;
             operator[1] = '\0';
-            return (Token){TOKEN_OPERATOR, operator, lexer->line, lexer->column};
+            return (Token){.type = TOKEN_OPERATOR, .value = operator, .line = lexer->line, .column = lexer->column};
         }
     }
 
@@ -223,21 +323,21 @@ Token lexer_next_token(Lexer* lexer) {
     // Handle supported single-character operators
     if (strchr("+-*/%", current_char)) {
         // Arithmetic operators
-        char* operator = (char*)malloc(2);
+        char* operator = (char*)ember_malloc(EMBER_MEM_LEXER, 2);
         operator[0] = current_char;
         operator[1] = '\0';
-        return (Token){TOKEN_OPERATOR, operator, lexer->line, lexer->column};
+        return (Token){.type = TOKEN_OPERATOR, .value = operator, .line = lexer->line, .column = lexer->column};
     } else if (strchr("(){}[],;.", current_char)) {
         // Punctuation
-        char* punctuation = (char*)malloc(2);
+        char* punctuation = (char*)ember_malloc(EMBER_MEM_LEXER, 2);
         punctuation[0] = current_char;
         punctuation[1] = '\0';
-        return (Token){TOKEN_PUNCTUATION, punctuation, lexer->line, lexer->column};
+        return (Token){.type = TOKEN_PUNCTUATION, .value = punctuation, .line = lexer->line, .column = lexer->column};
     }
 
     // Unsupported token
     fprintf(stderr, "Error: Unexpected character '%c'\n", current_char);
-    return (Token){TOKEN_ERROR, NULL, lexer->line, lexer->column};
+    return (Token){.type = TOKEN_ERROR, .value = NULL, .line = lexer->line, .column = lexer->column};
 }
 
 
@@ -263,6 +363,9 @@ void print_token(const Token* token) {
         printf("Token: EOF\n");
     } else if (token->type == TOKEN_ERROR) {
         printf("Token: ERROR\n");
+    } else if (token->type == TOKEN_NUMBER) {
+        // Numbers carry no text, only their value
+        printf("Token: Type=%d, Value=%.17g\n", token->type, token->number);
     } else {
         printf("Token: Type=%d, Value=%s\n", token->type, token->value);
     }
@@ -270,7 +373,7 @@ void print_token(const Token* token) {
 
 void free_token(Token* token) {
     if (token->value) {
-        free(token->value);
+        ember_free(token->value);
         token->value = NULL;
     }
 }
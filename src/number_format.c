@@ -0,0 +1,384 @@
+// number_format.c
+//
+// Double to round-trip decimal text with Grisu2 (Loitsch, "Printing
+// Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010).
+// The value is scaled by a cached power of ten so its digits can be
+// generated with 64-bit integer arithmetic, inside bounds that guarantee the
+// text reads back as the same double. For about 99.9% of doubles that text
+// is also the shortest possible; the rest get at most a digit more. Whole
+// numbers below 2^53 skip all of this and are written as integers.
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "number_format.h"
+
+#define DOUBLE_SIGNIFICAND_BITS 52
+#define DOUBLE_HIDDEN_BIT (UINT64_C(1) << DOUBLE_SIGNIFICAND_BITS)
+#define DOUBLE_SIGNIFICAND_MASK (DOUBLE_HIDDEN_BIT - 1)
+#define DOUBLE_EXPONENT_BIAS (0x3FF + DOUBLE_SIGNIFICAND_BITS)
+// Largest magnitude whose integer part every double represents exactly
+#define INTEGER_FAST_PATH_LIMIT 9007199254740992.0
+
+// A floating-point number f * 2^e with a full 64-bit significand
+typedef struct {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+// Normalized 10^k for k = -348, -340, ..., 340, rounded to nearest
+static const DiyFp cached_powers[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220 },  // 1e-348
+    { 0xbaaee17fa23ebf76ULL, -1193 },  // 1e-340
+    { 0x8b16fb203055ac76ULL, -1166 },  // 1e-332
+    { 0xcf42894a5dce35eaULL, -1140 },  // 1e-324
+    { 0x9a6bb0aa55653b2dULL, -1113 },  // 1e-316
+    { 0xe61acf033d1a45dfULL, -1087 },  // 1e-308
+    { 0xab70fe17c79ac6caULL, -1060 },  // 1e-300
+    { 0xff77b1fcbebcdc4fULL, -1034 },  // 1e-292
+    { 0xbe5691ef416bd60cULL, -1007 },  // 1e-284
+    { 0x8dd01fad907ffc3cULL,  -980 },  // 1e-276
+    { 0xd3515c2831559a83ULL,  -954 },  // 1e-268
+    { 0x9d71ac8fada6c9b5ULL,  -927 },  // 1e-260
+    { 0xea9c227723ee8bcbULL,  -901 },  // 1e-252
+    { 0xaecc49914078536dULL,  -874 },  // 1e-244
+    { 0x823c12795db6ce57ULL,  -847 },  // 1e-236
+    { 0xc21094364dfb5637ULL,  -821 },  // 1e-228
+    { 0x9096ea6f3848984fULL,  -794 },  // 1e-220
+    { 0xd77485cb25823ac7ULL,  -768 },  // 1e-212
+    { 0xa086cfcd97bf97f4ULL,  -741 },  // 1e-204
+    { 0xef340a98172aace5ULL,  -715 },  // 1e-196
+    { 0xb23867fb2a35b28eULL,  -688 },  // 1e-188
+    { 0x84c8d4dfd2c63f3bULL,  -661 },  // 1e-180
+    { 0xc5dd44271ad3cdbaULL,  -635 },  // 1e-172
+    { 0x936b9fcebb25c996ULL,  -608 },  // 1e-164
+    { 0xdbac6c247d62a584ULL,  -582 },  // 1e-156
+    { 0xa3ab66580d5fdaf6ULL,  -555 },  // 1e-148
+    { 0xf3e2f893dec3f126ULL,  -529 },  // 1e-140
+    { 0xb5b5ada8aaff80b8ULL,  -502 },  // 1e-132
+    { 0x87625f056c7c4a8bULL,  -475 },  // 1e-124
+    { 0xc9bcff6034c13053ULL,  -449 },  // 1e-116
+    { 0x964e858c91ba2655ULL,  -422 },  // 1e-108
+    { 0xdff9772470297ebdULL,  -396 },  // 1e-100
+    { 0xa6dfbd9fb8e5b88fULL,  -369 },  // 1e-92
+    { 0xf8a95fcf88747d94ULL,  -343 },  // 1e-84
+    { 0xb94470938fa89bcfULL,  -316 },  // 1e-76
+    { 0x8a08f0f8bf0f156bULL,  -289 },  // 1e-68
+    { 0xcdb02555653131b6ULL,  -263 },  // 1e-60
+    { 0x993fe2c6d07b7facULL,  -236 },  // 1e-52
+    { 0xe45c10c42a2b3b06ULL,  -210 },  // 1e-44
+    { 0xaa242499697392d3ULL,  -183 },  // 1e-36
+    { 0xfd87b5f28300ca0eULL,  -157 },  // 1e-28
+    { 0xbce5086492111aebULL,  -130 },  // 1e-20
+    { 0x8cbccc096f5088ccULL,  -103 },  // 1e-12
+    { 0xd1b71758e219652cULL,   -77 },  // 1e-4
+    { 0x9c40000000000000ULL,   -50 },  // 1e4
+    { 0xe8d4a51000000000ULL,   -24 },  // 1e12
+    { 0xad78ebc5ac620000ULL,     3 },  // 1e20
+    { 0x813f3978f8940984ULL,    30 },  // 1e28
+    { 0xc097ce7bc90715b3ULL,    56 },  // 1e36
+    { 0x8f7e32ce7bea5c70ULL,    83 },  // 1e44
+    { 0xd5d238a4abe98068ULL,   109 },  // 1e52
+    { 0x9f4f2726179a2245ULL,   136 },  // 1e60
+    { 0xed63a231d4c4fb27ULL,   162 },  // 1e68
+    { 0xb0de65388cc8ada8ULL,   189 },  // 1e76
+    { 0x83c7088e1aab65dbULL,   216 },  // 1e84
+    { 0xc45d1df942711d9aULL,   242 },  // 1e92
+    { 0x924d692ca61be758ULL,   269 },  // 1e100
+    { 0xda01ee641a708deaULL,   295 },  // 1e108
+    { 0xa26da3999aef774aULL,   322 },  // 1e116
+    { 0xf209787bb47d6b85ULL,   348 },  // 1e124
+    { 0xb454e4a179dd1877ULL,   375 },  // 1e132
+    { 0x865b86925b9bc5c2ULL,   402 },  // 1e140
+    { 0xc83553c5c8965d3dULL,   428 },  // 1e148
+    { 0x952ab45cfa97a0b3ULL,   455 },  // 1e156
+    { 0xde469fbd99a05fe3ULL,   481 },  // 1e164
+    { 0xa59bc234db398c25ULL,   508 },  // 1e172
+    { 0xf6c69a72a3989f5cULL,   534 },  // 1e180
+    { 0xb7dcbf5354e9beceULL,   561 },  // 1e188
+    { 0x88fcf317f22241e2ULL,   588 },  // 1e196
+    { 0xcc20ce9bd35c78a5ULL,   614 },  // 1e204
+    { 0x98165af37b2153dfULL,   641 },  // 1e212
+    { 0xe2a0b5dc971f303aULL,   667 },  // 1e220
+    { 0xa8d9d1535ce3b396ULL,   694 },  // 1e228
+    { 0xfb9b7cd9a4a7443cULL,   720 },  // 1e236
+    { 0xbb764c4ca7a44410ULL,   747 },  // 1e244
+    { 0x8bab8eefb6409c1aULL,   774 },  // 1e252
+    { 0xd01fef10a657842cULL,   800 },  // 1e260
+    { 0x9b10a4e5e9913129ULL,   827 },  // 1e268
+    { 0xe7109bfba19c0c9dULL,   853 },  // 1e276
+    { 0xac2820d9623bf429ULL,   880 },  // 1e284
+    { 0x80444b5e7aa7cf85ULL,   907 },  // 1e292
+    { 0xbf21e44003acdd2dULL,   933 },  // 1e300
+    { 0x8e679c2f5e44ff8fULL,   960 },  // 1e308
+    { 0xd433179d9c8cb841ULL,   986 },  // 1e316
+    { 0x9e19db92b4e31ba9ULL,  1013 },  // 1e324
+    { 0xeb96bf6ebadf77d9ULL,  1039 },  // 1e332
+    { 0xaf87023b9bf0ee6bULL,  1066 },  // 1e340
+};
+
+#define CACHED_POWER_MIN_EXPONENT (-348)
+#define CACHED_POWER_STEP 8
+
+static const uint64_t powers_of_ten[] = {
+    UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+    UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+    UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+    UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+    UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+    UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+    UINT64_C(10000000000000000000)
+};
+
+/* -------------------------------------------------------
+   DiyFp arithmetic
+   ------------------------------------------------------- */
+
+static DiyFp diyfp_from_double(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased_exponent = (int)((bits >> DOUBLE_SIGNIFICAND_BITS) & 0x7FF);
+    uint64_t significand = bits & DOUBLE_SIGNIFICAND_MASK;
+    DiyFp result;
+    if (biased_exponent != 0) {
+        result.f = significand + DOUBLE_HIDDEN_BIT;
+        result.e = biased_exponent - DOUBLE_EXPONENT_BIAS;
+    } else {
+        // Subnormal
+        result.f = significand;
+        result.e = 1 - DOUBLE_EXPONENT_BIAS;
+    }
+    return result;
+}
+
+// Product rounded to the upper 64 bits
+static DiyFp diyfp_multiply(DiyFp x, DiyFp y) {
+    const uint64_t mask = 0xFFFFFFFFu;
+    uint64_t a = x.f >> 32, b = x.f & mask;
+    uint64_t c = y.f >> 32, d = y.f & mask;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t middle = (bd >> 32) + (ad & mask) + (bc & mask);
+    middle += UINT64_C(1) << 31;
+    DiyFp result = { ac + (ad >> 32) + (bc >> 32) + (middle >> 32), x.e + y.e + 64 };
+    return result;
+}
+
+static DiyFp diyfp_normalize(DiyFp x) {
+    int shift = __builtin_clzll(x.f);
+    x.f <<= shift;
+    x.e -= shift;
+    return x;
+}
+
+// The neighbours halfway to the adjacent doubles, sharing one exponent
+static void diyfp_boundaries(DiyFp v, DiyFp* minus, DiyFp* plus) {
+    DiyFp upper = { (v.f << 1) + 1, v.e - 1 };
+    upper = diyfp_normalize(upper);
+    // The gap below a power of two is half the gap above it
+    DiyFp lower = v.f == DOUBLE_HIDDEN_BIT ? (DiyFp){ (v.f << 2) - 1, v.e - 2 }
+                                           : (DiyFp){ (v.f << 1) - 1, v.e - 1 };
+    lower.f <<= lower.e - upper.e;
+    lower.e = upper.e;
+    *minus = lower;
+    *plus = upper;
+}
+
+// A cached 10^-k that brings a number with binary exponent `e` into the
+// range digit generation expects; `*k` receives the decimal exponent.
+static DiyFp cached_power(int e, int* k) {
+    double estimate = (-61 - e) * 0.30102999566398114 + 347;
+    int rounded = (int)estimate;
+    if (estimate - rounded > 0.0) {
+        rounded++;
+    }
+    int index = (rounded >> 3) + 1;
+    *k = -(CACHED_POWER_MIN_EXPONENT + index * CACHED_POWER_STEP);
+    return cached_powers[index];
+}
+
+/* -------------------------------------------------------
+   Digit generation
+   ------------------------------------------------------- */
+
+static int decimal_digit_count(uint32_t n) {
+    int digits = 1;
+    while (digits < 10 && n >= powers_of_ten[digits]) {
+        digits++;
+    }
+    return digits;
+}
+
+// Nudge the last digit down while that moves the text closer to the exact
+// value and keeps it inside the safe interval
+static void grisu_round(char* digits, int length, uint64_t delta, uint64_t rest,
+                        uint64_t ten_kappa, uint64_t distance) {
+    while (rest < distance && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < distance || distance - rest > rest + ten_kappa - distance)) {
+        digits[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int generate_digits(DiyFp w, DiyFp upper, uint64_t delta, char* digits, int* k) {
+    const int shift = -upper.e;
+    const uint64_t one = UINT64_C(1) << shift;
+    const uint64_t distance = upper.f - w.f;
+    uint32_t integral = (uint32_t)(upper.f >> shift);
+    uint64_t fraction = upper.f & (one - 1);
+    int kappa = decimal_digit_count(integral);
+    int length = 0;
+
+    while (kappa > 0) {
+        uint32_t divisor = (uint32_t)powers_of_ten[kappa - 1];
+        uint32_t digit = integral / divisor;
+        integral %= divisor;
+        if (digit || length) {
+            digits[length++] = (char)('0' + digit);
+        }
+        kappa--;
+        uint64_t rest = ((uint64_t)integral << shift) + fraction;
+        if (rest <= delta) {
+            *k += kappa;
+            grisu_round(digits, length, delta, rest, powers_of_ten[kappa] << shift, distance);
+            return length;
+        }
+    }
+
+    for (;;) {
+        fraction *= 10;
+        delta *= 10;
+        char digit = (char)(fraction >> shift);
+        if (digit || length) {
+            digits[length++] = (char)('0' + digit);
+        }
+        fraction &= one - 1;
+        kappa--;
+        if (fraction < delta) {
+            *k += kappa;
+            int index = -kappa;
+            grisu_round(digits, length, delta, fraction, one,
+                        index < 20 ? distance * powers_of_ten[index] : 0);
+            return length;
+        }
+    }
+}
+
+// Digits of a positive finite `value` such that value ~= digits * 10^k
+static int grisu2(double value, char* digits, int* k) {
+    DiyFp v = diyfp_from_double(value);
+    DiyFp minus, plus;
+    diyfp_boundaries(v, &minus, &plus);
+
+    DiyFp scale = cached_power(plus.e, k);
+    DiyFp w = diyfp_multiply(diyfp_normalize(v), scale);
+    DiyFp upper = diyfp_multiply(plus, scale);
+    DiyFp lower = diyfp_multiply(minus, scale);
+    // Stay strictly inside the interval; the products may be off by one
+    upper.f--;
+    lower.f++;
+    return generate_digits(w, upper, upper.f - lower.f, digits, k);
+}
+
+/* -------------------------------------------------------
+   Layout
+   ------------------------------------------------------- */
+
+static char* write_exponent(int exponent, char* out) {
+    *out++ = 'e';
+    *out++ = exponent < 0 ? '-' : '+';
+    if (exponent < 0) {
+        exponent = -exponent;
+    }
+    if (exponent >= 100) {
+        *out++ = (char)('0' + exponent / 100);
+        exponent %= 100;
+        *out++ = (char)('0' + exponent / 10);
+    } else if (exponent >= 10) {
+        *out++ = (char)('0' + exponent / 10);
+    }
+    *out++ = (char)('0' + exponent % 10);
+    return out;
+}
+
+// Lay out `length` digits scaled by 10^k in place; returns the end
+static char* layout_digits(char* digits, int length, int k) {
+    const int point = length + k; // 10^(point-1) <= value < 10^point
+
+    if (k >= 0 && point <= 21) {
+        // 1234e3 -> 1234000
+        memset(digits + length, '0', (size_t)k);
+        return digits + point;
+    }
+    if (point > 0 && point <= 21) {
+        // 1234e-2 -> 12.34
+        memmove(digits + point + 1, digits + point, (size_t)(length - point));
+        digits[point] = '.';
+        return digits + length + 1;
+    }
+    if (point > -6 && point <= 0) {
+        // 1234e-6 -> 0.001234
+        const int offset = 2 - point;
+        memmove(digits + offset, digits, (size_t)length);
+        digits[0] = '0';
+        digits[1] = '.';
+        memset(digits + 2, '0', (size_t)(offset - 2));
+        return digits + length + offset;
+    }
+    if (length == 1) {
+        // 1e30
+        return write_exponent(point - 1, digits + 1);
+    }
+    // 1234e30 -> 1.234e+33
+    memmove(digits + 2, digits + 1, (size_t)(length - 1));
+    digits[1] = '.';
+    return write_exponent(point - 1, digits + length + 1);
+}
+
+static char* write_integer(uint64_t value, char* out) {
+    char reversed[20];
+    int count = 0;
+    do {
+        reversed[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (count > 0) {
+        *out++ = reversed[--count];
+    }
+    return out;
+}
+
+size_t number_format(double value, char* out) {
+    char* end;
+    if (isnan(value)) {
+        memcpy(out, "nan", 4);
+        return 3;
+    }
+    if (isinf(value)) {
+        const char* text = value < 0 ? "-inf" : "inf";
+        size_t length = strlen(text);
+        memcpy(out, text, length + 1);
+        return length;
+    }
+
+    char* cursor = out;
+    if (value < 0) {
+        *cursor++ = '-';
+        value = -value;
+    }
+
+    if (value == 0) {
+        // Covers -0 as well
+        cursor = out;
+        *cursor++ = '0';
+        end = cursor;
+    } else if (value < INTEGER_FAST_PATH_LIMIT && value == (double)(uint64_t)value) {
+        end = write_integer((uint64_t)value, cursor);
+    } else {
+        int k = 0;
+        int length = grisu2(value, cursor, &k);
+        end = layout_digits(cursor, length, k);
+    }
+    *end = '\0';
+    return (size_t)(end - out);
+}
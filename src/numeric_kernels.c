@@ -0,0 +1,319 @@
+// numeric_kernels.c
+//
+// Scalar, SSE2 and AVX2 versions of the loops behind sum/min/max/dot/
+// scale/add_arrays/clamp_all. The AVX2 versions are compiled with a target
+// attribute rather than a global -mavx2, so the binary still runs on CPUs
+// without it; numeric_kernels() asks CPUID once which set to use.
+
+#include <math.h>
+#include <pthread.h>
+
+#include "numeric_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NUMERIC_X86 1
+#include <immintrin.h>
+#endif
+
+/* -------------------------------------------------------
+   Scalar
+   ------------------------------------------------------- */
+
+static double scalar_sum(const double* values, size_t count) {
+    double total = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        total += values[i];
+    }
+    return total;
+}
+
+static double scalar_min(const double* values, size_t count) {
+    double best = INFINITY;
+    for (size_t i = 0; i < count; i++) {
+        best = values[i] < best ? values[i] : best;
+    }
+    return best;
+}
+
+static double scalar_max(const double* values, size_t count) {
+    double best = -INFINITY;
+    for (size_t i = 0; i < count; i++) {
+        best = values[i] > best ? values[i] : best;
+    }
+    return best;
+}
+
+static double scalar_dot(const double* a, const double* b, size_t count) {
+    double total = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        total += a[i] * b[i];
+    }
+    return total;
+}
+
+static void scalar_scale(double* out, const double* values, size_t count, double factor) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = values[i] * factor;
+    }
+}
+
+static void scalar_add(double* out, const double* a, const double* b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+static void scalar_clamp(double* out, const double* values, size_t count, double lo, double hi) {
+    for (size_t i = 0; i < count; i++) {
+        double v = values[i] > lo ? values[i] : lo;
+        out[i] = v < hi ? v : hi;
+    }
+}
+
+static const NumericKernels scalar_kernels = {
+    NUMERIC_ISA_SCALAR, "scalar",
+    scalar_sum, scalar_min, scalar_max, scalar_dot,
+    scalar_scale, scalar_add, scalar_clamp
+};
+
+#ifdef NUMERIC_X86
+
+/* -------------------------------------------------------
+   SSE2: two lanes, two accumulators to hide add latency
+   ------------------------------------------------------- */
+
+// minpd/maxpd return their second operand when either lane is NaN. Passing
+// the element first and the accumulator (or clamp bound) second makes them
+// compute `v < best ? v : best`, so NaN elements are skipped exactly as in
+// the scalar loops above.
+
+__attribute__((target("sse2")))
+static double sse2_sum(const double* values, size_t count) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(values + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(values + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + scalar_sum(values + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static double sse2_min(const double* values, size_t count) {
+    __m128d best = _mm_set1_pd(INFINITY);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        best = _mm_min_pd(_mm_loadu_pd(values + i), best);
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, best);
+    double tail = scalar_min(values + i, count - i);
+    double m = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    return tail < m ? tail : m;
+}
+
+__attribute__((target("sse2")))
+static double sse2_max(const double* values, size_t count) {
+    __m128d best = _mm_set1_pd(-INFINITY);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        best = _mm_max_pd(_mm_loadu_pd(values + i), best);
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, best);
+    double tail = scalar_max(values + i, count - i);
+    double m = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    return tail > m ? tail : m;
+}
+
+__attribute__((target("sse2")))
+static double sse2_dot(const double* a, const double* b, size_t count) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + scalar_dot(a + i, b + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_scale(double* out, const double* values, size_t count, double factor) {
+    __m128d k = _mm_set1_pd(factor);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(values + i), k));
+    }
+    scalar_scale(out + i, values + i, count - i, factor);
+}
+
+__attribute__((target("sse2")))
+static void sse2_add(double* out, const double* a, const double* b, size_t count) {
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    scalar_add(out + i, a + i, b + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_clamp(double* out, const double* values, size_t count, double lo, double hi) {
+    __m128d vlo = _mm_set1_pd(lo);
+    __m128d vhi = _mm_set1_pd(hi);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d v = _mm_max_pd(_mm_loadu_pd(values + i), vlo);
+        _mm_storeu_pd(out + i, _mm_min_pd(v, vhi));
+    }
+    scalar_clamp(out + i, values + i, count - i, lo, hi);
+}
+
+static const NumericKernels sse2_kernels = {
+    NUMERIC_ISA_SSE2, "sse2",
+    sse2_sum, sse2_min, sse2_max, sse2_dot,
+    sse2_scale, sse2_add, sse2_clamp
+};
+
+/* -------------------------------------------------------
+   AVX2: four lanes, two accumulators
+   ------------------------------------------------------- */
+
+__attribute__((target("avx2")))
+static double avx2_reduce_add(__m256d v) {
+    __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+__attribute__((target("avx2")))
+static double avx2_sum(const double* values, size_t count) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + i + 4));
+    }
+    return avx2_reduce_add(_mm256_add_pd(acc0, acc1)) + scalar_sum(values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static double avx2_min(const double* values, size_t count) {
+    __m256d best = _mm256_set1_pd(INFINITY);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        best = _mm256_min_pd(_mm256_loadu_pd(values + i), best);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, best);
+    double m = scalar_min(lanes, 4);
+    double tail = scalar_min(values + i, count - i);
+    return tail < m ? tail : m;
+}
+
+__attribute__((target("avx2")))
+static double avx2_max(const double* values, size_t count) {
+    __m256d best = _mm256_set1_pd(-INFINITY);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        best = _mm256_max_pd(_mm256_loadu_pd(values + i), best);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, best);
+    double m = scalar_max(lanes, 4);
+    double tail = scalar_max(values + i, count - i);
+    return tail > m ? tail : m;
+}
+
+__attribute__((target("avx2")))
+static double avx2_dot(const double* a, const double* b, size_t count) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    return avx2_reduce_add(_mm256_add_pd(acc0, acc1)) + scalar_dot(a + i, b + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_scale(double* out, const double* values, size_t count, double factor) {
+    __m256d k = _mm256_set1_pd(factor);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(values + i), k));
+    }
+    scalar_scale(out + i, values + i, count - i, factor);
+}
+
+__attribute__((target("avx2")))
+static void avx2_add(double* out, const double* a, const double* b, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    scalar_add(out + i, a + i, b + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_clamp(double* out, const double* values, size_t count, double lo, double hi) {
+    __m256d vlo = _mm256_set1_pd(lo);
+    __m256d vhi = _mm256_set1_pd(hi);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_max_pd(_mm256_loadu_pd(values + i), vlo);
+        _mm256_storeu_pd(out + i, _mm256_min_pd(v, vhi));
+    }
+    scalar_clamp(out + i, values + i, count - i, lo, hi);
+}
+
+static const NumericKernels avx2_kernels = {
+    NUMERIC_ISA_AVX2, "avx2",
+    avx2_sum, avx2_min, avx2_max, avx2_dot,
+    avx2_scale, avx2_add, avx2_clamp
+};
+
+#endif // NUMERIC_X86
+
+/* -------------------------------------------------------
+   Dispatch
+   ------------------------------------------------------- */
+
+const NumericKernels* numeric_kernels_for(NumericIsa isa) {
+    switch (isa) {
+        case NUMERIC_ISA_SCALAR:
+            return &scalar_kernels;
+#ifdef NUMERIC_X86
+        case NUMERIC_ISA_SSE2:
+            return __builtin_cpu_supports("sse2") ? &sse2_kernels : NULL;
+        case NUMERIC_ISA_AVX2:
+            return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+static const NumericKernels* selected_kernels = &scalar_kernels;
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+static void select_kernels(void) {
+    for (int isa = NUMERIC_ISA_COUNT - 1; isa >= 0; isa--) {
+        const NumericKernels* kernels = numeric_kernels_for((NumericIsa)isa);
+        if (kernels) {
+            selected_kernels = kernels;
+            return;
+        }
+    }
+}
+
+const NumericKernels* numeric_kernels(void) {
+    pthread_once(&select_once, select_kernels);
+    return selected_kernels;
+}
@@ -0,0 +1,274 @@
+// object.c
+//
+// Objects with hidden classes. A shape is an immutable list of property
+// names; objects point at one and keep their values in a flat slot array
+// indexed by position in that list. Shapes form a tree rooted at the empty
+// shape: adding a property walks (or grows) a transition edge, so objects
+// built the same way end up sharing the same shape pointer. Objects used
+// as dictionaries leave the shape tree and keep their properties in a hash
+// table instead (see dictionary.c).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include "object_layout.h"
+#include "ember_alloc.h"
+
+#define OBJECT_MIN_CAPACITY 4
+
+static Shape root_shape;
+
+// Shape of every object in dictionary mode. It has no slots and no
+// transitions, so a shape check against it never finds a property and
+// inline caches never remember it.
+static Shape dictionary_shape;
+
+// Serialises transition creation; lookups of existing transitions are lock-free
+static pthread_mutex_t transition_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* -------------------------------------------------------
+   Shapes
+   ------------------------------------------------------- */
+
+const Shape* shape_root(void) {
+    return &root_shape;
+}
+
+int shape_lookup(const Shape* shape, const char* key) {
+    // Newest properties first: they are the ones a constructor just added
+    for (int i = shape->slot_count - 1; i >= 0; i--) {
+        if (strcmp(shape->keys[i], key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int shape_property_count(const Shape* shape) {
+    return shape->slot_count;
+}
+
+const char* shape_key(const Shape* shape, int slot) {
+    if (slot < 0 || slot >= shape->slot_count) {
+        return NULL;
+    }
+    return shape->keys[slot];
+}
+
+static const Shape* find_transition(const Shape* shape, const char* key) {
+    Shape* child = atomic_load_explicit(&((Shape*)shape)->transitions, memory_order_acquire);
+    for (; child; child = child->sibling) {
+        if (strcmp(child->keys[child->slot_count - 1], key) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+const Shape* shape_transition(const Shape* shape, const char* key) {
+    const Shape* existing = find_transition(shape, key);
+    if (existing) {
+        return existing;
+    }
+
+    pthread_mutex_lock(&transition_lock);
+    // Another thread may have added it while we waited
+    existing = find_transition(shape, key);
+    if (existing) {
+        pthread_mutex_unlock(&transition_lock);
+        return existing;
+    }
+
+    Shape* child = (Shape*)ember_calloc(EMBER_MEM_RUNTIME, 1, sizeof(Shape));
+    char** keys = (char**)ember_malloc(EMBER_MEM_RUNTIME, sizeof(char*) * (shape->slot_count + 1));
+    char* name = ember_strdup(EMBER_MEM_RUNTIME, key);
+    if (!child || !keys || !name) {
+        fprintf(stderr, "Error: Memory allocation failed for object shape.\n");
+        ember_free(child);
+        ember_free(keys);
+        ember_free(name);
+        pthread_mutex_unlock(&transition_lock);
+        return NULL;
+    }
+    if (shape->slot_count > 0) {
+        memcpy(keys, shape->keys, sizeof(char*) * shape->slot_count);
+    }
+    keys[shape->slot_count] = name;
+    child->keys = keys;
+    child->slot_count = shape->slot_count + 1;
+    child->parent = shape;
+
+    // Publish only once the child is fully built
+    Shape* mutable_parent = (Shape*)shape;
+    child->sibling = atomic_load_explicit(&mutable_parent->transitions, memory_order_relaxed);
+    atomic_store_explicit(&mutable_parent->transitions, child, memory_order_release);
+    pthread_mutex_unlock(&transition_lock);
+    return child;
+}
+
+/* -------------------------------------------------------
+   Objects
+   ------------------------------------------------------- */
+
+ScriptObject* object_create(void) {
+    ScriptObject* object = (ScriptObject*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(ScriptObject));
+    if (!object) {
+        fprintf(stderr, "Error: Memory allocation failed for object.\n");
+        return NULL;
+    }
+    atomic_init(&object->refcount, 1);
+    object->shape = &root_shape;
+    object->slots = NULL;
+    object->capacity = 0;
+    object->dictionary = NULL;
+    return object;
+}
+
+void object_retain(ScriptObject* object) {
+    if (object) {
+        atomic_fetch_add_explicit(&object->refcount, 1, memory_order_relaxed);
+    }
+}
+
+void object_release(ScriptObject* object) {
+    if (!object || atomic_fetch_sub_explicit(&object->refcount, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    for (int i = 0; i < object->shape->slot_count; i++) {
+        runtime_free_value(&object->slots[i]);
+    }
+    ember_free(object->slots);
+    dictionary_free(object->dictionary);
+    ember_free(object);
+}
+
+const Shape* object_shape(const ScriptObject* object) {
+    return object->shape;
+}
+
+bool object_append_slot(ScriptObject* object, const Shape* next, RuntimeValue value) {
+    int slot = next->slot_count - 1;
+    if (slot >= object->capacity) {
+        int capacity = object->capacity < OBJECT_MIN_CAPACITY ? OBJECT_MIN_CAPACITY : object->capacity * 2;
+        RuntimeValue* slots = (RuntimeValue*)ember_realloc(EMBER_MEM_RUNTIME, object->slots,
+                                                           sizeof(RuntimeValue) * capacity);
+        if (!slots) {
+            fprintf(stderr, "Error: Memory allocation failed for object properties.\n");
+            return false;
+        }
+        object->slots = slots;
+        object->capacity = capacity;
+    }
+    object->slots[slot] = value;
+    object->shape = next;
+    return true;
+}
+
+bool object_is_dictionary(const ScriptObject* object) {
+    return object->dictionary != NULL;
+}
+
+int object_property_count(const ScriptObject* object) {
+    return object->dictionary ? (int)object->dictionary->count : object->shape->slot_count;
+}
+
+static bool is_identifier(const char* key) {
+    if (!isalpha((unsigned char)key[0]) && key[0] != '_') {
+        return false;
+    }
+    for (const char* p = key + 1; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Move every property into a hash table; the object never goes back
+static bool object_make_dictionary(ScriptObject* object) {
+    int count = object->shape->slot_count;
+    Dictionary* dict = dictionary_create((size_t)count * 2);
+    if (!dict) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        RuntimeValue* slot = dictionary_insert(dict, object->shape->keys[i]);
+        if (!slot) {
+            // The values still belong to the slots; don't let the table free them
+            for (int j = 0; j < i; j++) {
+                dictionary_find(dict, object->shape->keys[j])->type = RUNTIME_VALUE_NULL;
+            }
+            dictionary_free(dict);
+            return false;
+        }
+        *slot = object->slots[i];
+    }
+    ember_free(object->slots);
+    object->slots = NULL;
+    object->capacity = 0;
+    object->dictionary = dict;
+    object->shape = &dictionary_shape;
+    return true;
+}
+
+RuntimeValue* object_get(ScriptObject* object, const char* key) {
+    if (object->dictionary) {
+        return dictionary_find(object->dictionary, key);
+    }
+    int slot = shape_lookup(object->shape, key);
+    return slot >= 0 ? &object->slots[slot] : NULL;
+}
+
+RuntimeValue* object_define(ScriptObject* object, const char* key) {
+    if (!object->dictionary) {
+        int slot = shape_lookup(object->shape, key);
+        if (slot >= 0) {
+            return &object->slots[slot];
+        }
+        // Big or id-keyed objects would grow a shape per object; hash them instead
+        if (object->shape->slot_count < OBJECT_DICTIONARY_THRESHOLD && is_identifier(key)) {
+            const Shape* next = shape_transition(object->shape, key);
+            RuntimeValue null_value = { .type = RUNTIME_VALUE_NULL };
+            if (!next || !object_append_slot(object, next, null_value)) {
+                return NULL;
+            }
+            return &object->slots[next->slot_count - 1];
+        }
+        if (!object_make_dictionary(object)) {
+            return NULL;
+        }
+    }
+    return dictionary_insert(object->dictionary, key);
+}
+
+bool object_set(ScriptObject* object, const char* key, RuntimeValue value) {
+    RuntimeValue* slot = object_define(object, key);
+    if (!slot) {
+        runtime_free_value(&value);
+        return false;
+    }
+    runtime_free_value(slot);
+    *slot = value;
+    return true;
+}
+
+void object_for_each(ScriptObject* object,
+                     void (*visit)(const char* key, RuntimeValue* value, void* context),
+                     void* context) {
+    if (object->dictionary) {
+        Dictionary* dict = object->dictionary;
+        for (size_t i = 0; i < dict->capacity; i++) {
+            // Occupied slots hold a seven-bit hash tag; EMPTY is negative
+            if (dict->ctrl[i] >= 0) {
+                visit(dict->entries[i].key, &dict->entries[i].value, context);
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < object->shape->slot_count; i++) {
+        visit(object->shape->keys[i], &object->slots[i], context);
+    }
+}
@@ -0,0 +1,45 @@
+// object_layout.h
+//
+// Field layout of shapes and objects, shared by object.c and the VM's
+// dispatch loop so a cached property access compiles to a pointer compare
+// and an indexed load. Everything else goes through object.h.
+
+#ifndef OBJECT_LAYOUT_H
+#define OBJECT_LAYOUT_H
+
+#include <stdatomic.h>
+
+#include "object.h"
+#include "dictionary.h"
+
+struct Shape {
+    char** keys;         // keys[i] names slot i; shared with the parent's entries
+    int slot_count;
+    const struct Shape* parent;
+    struct Shape* sibling;              // Next transition out of `parent`
+    _Atomic(struct Shape*) transitions; // Children, newest first; append-only
+};
+
+struct ScriptObject {
+    atomic_int refcount;
+    const Shape* shape;
+    RuntimeValue* slots; // shape->slot_count values
+    int capacity;
+    Dictionary* dictionary; // Set in dictionary mode; `shape` is then a shared
+                            // placeholder with no slots and `slots` is unused
+};
+
+/**
+ * Slot for `key`, adding it (as null) if the object lacks it; may switch
+ * the object to dictionary mode. The pointer stays valid until the next
+ * property is added. Returns NULL on allocation failure.
+ */
+RuntimeValue* object_define(ScriptObject* object, const char* key);
+
+/**
+ * Move `object` to `next` (a transition out of its current shape) and store
+ * `value` in the new slot. The value is stored as-is, without copying.
+ */
+bool object_append_slot(ScriptObject* object, const Shape* next, RuntimeValue value);
+
+#endif // OBJECT_LAYOUT_H
@@ -0,0 +1,258 @@
+// output_sink.c
+//
+// Buffered destinations for script output. Printing a value used to be a
+// printf() per value, which is a write() per line when stdout is line
+// buffered. Stdout and file sinks collect output and hand it to stdio in
+// buffer-sized pieces instead; a memory sink lets the host read what a
+// script printed without redirecting file descriptors.
+
+// fileno() and isatty() under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "output_sink.h"
+#include "ember_alloc.h"
+
+#define MEMORY_SINK_INITIAL_CAPACITY 256
+
+struct OutputSink {
+    OutputSinkKind kind;
+    pthread_mutex_t lock;
+    FILE* file;            // stdout, or the file this sink opened
+    bool write_through;    // Capacity 0: every write goes straight to stdio
+    char* data;            // Pending output, or the capture of a memory sink
+    size_t length;
+    size_t capacity;
+};
+
+// Used when nothing is bound or installed. Static so that printing never
+// allocates behind a host's custom allocator.
+static char default_buffer[OUTPUT_SINK_DEFAULT_BUFFER];
+static OutputSink default_sink = {
+    .kind = OUTPUT_SINK_STDOUT,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .data = default_buffer,
+    .capacity = sizeof(default_buffer),
+};
+static pthread_once_t default_sink_once = PTHREAD_ONCE_INIT;
+
+static _Atomic(OutputSink*) installed_sink = NULL;
+static _Thread_local OutputSink* bound_sink = NULL;
+
+/* -------------------------------------------------------
+   Writing
+   ------------------------------------------------------- */
+
+// Pass pending output to stdio and on to the file descriptor
+static bool flush_locked(OutputSink* sink) {
+    if (sink->kind == OUTPUT_SINK_MEMORY) {
+        return true;
+    }
+    bool ok = fwrite(sink->data, 1, sink->length, sink->file) == sink->length;
+    sink->length = 0;
+    return fflush(sink->file) == 0 && ok;
+}
+
+static bool capture_locked(OutputSink* sink, const char* data, size_t length) {
+    if (sink->length + length > sink->capacity) {
+        size_t capacity = sink->capacity ? sink->capacity : MEMORY_SINK_INITIAL_CAPACITY;
+        while (capacity < sink->length + length) {
+            capacity *= 2;
+        }
+        char* grown = (char*)ember_realloc(EMBER_MEM_RUNTIME, sink->data, capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for captured output.\n");
+            return false;
+        }
+        sink->data = grown;
+        sink->capacity = capacity;
+    }
+    memcpy(sink->data + sink->length, data, length);
+    sink->length += length;
+    return true;
+}
+
+static bool write_locked(OutputSink* sink, const char* data, size_t length) {
+    bool ok = true;
+    if (sink->kind == OUTPUT_SINK_MEMORY) {
+        ok = capture_locked(sink, data, length);
+    } else if (sink->write_through) {
+        // A terminal: stdio's own line buffering decides when to write
+        ok = fwrite(data, 1, length, sink->file) == length;
+    } else {
+        if (sink->length + length > sink->capacity) {
+            ok = flush_locked(sink);
+        }
+        if (length >= sink->capacity) {
+            ok = fwrite(data, 1, length, sink->file) == length && fflush(sink->file) == 0 && ok;
+        } else {
+            memcpy(sink->data + sink->length, data, length);
+            sink->length += length;
+        }
+    }
+    return ok;
+}
+
+bool output_sink_write(OutputSink* sink, const char* data, size_t length) {
+    pthread_mutex_lock(&sink->lock);
+    bool ok = write_locked(sink, data, length);
+    pthread_mutex_unlock(&sink->lock);
+    return ok;
+}
+
+bool output_sink_write_line(OutputSink* sink, const char* data, size_t length) {
+    pthread_mutex_lock(&sink->lock);
+    bool ok = write_locked(sink, data, length);
+    ok = write_locked(sink, "\n", 1) && ok;
+    pthread_mutex_unlock(&sink->lock);
+    return ok;
+}
+
+void output_sink_error(const char* format, ...) {
+    // Stderr is unbuffered; the pending output has to reach stdout first
+    output_sink_flush(output_sink_current());
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+bool output_sink_flush(OutputSink* sink) {
+    pthread_mutex_lock(&sink->lock);
+    bool ok = flush_locked(sink);
+    pthread_mutex_unlock(&sink->lock);
+    return ok;
+}
+
+/* -------------------------------------------------------
+   Sinks
+   ------------------------------------------------------- */
+
+static OutputSink* sink_create(OutputSinkKind kind, FILE* file, size_t buffer_size) {
+    OutputSink* sink = (OutputSink*)ember_calloc(EMBER_MEM_RUNTIME, 1, sizeof(OutputSink));
+    if (!sink) {
+        fprintf(stderr, "Error: Memory allocation failed for output sink.\n");
+        return NULL;
+    }
+    sink->kind = kind;
+    sink->file = file;
+    if (kind != OUTPUT_SINK_MEMORY) {
+        sink->capacity = buffer_size ? buffer_size : OUTPUT_SINK_DEFAULT_BUFFER;
+        sink->data = (char*)ember_malloc(EMBER_MEM_RUNTIME, sink->capacity);
+        if (!sink->data) {
+            fprintf(stderr, "Error: Memory allocation failed for output buffer.\n");
+            ember_free(sink);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&sink->lock, NULL);
+    return sink;
+}
+
+OutputSink* output_sink_create_stdout(size_t buffer_size) {
+    return sink_create(OUTPUT_SINK_STDOUT, stdout, buffer_size);
+}
+
+OutputSink* output_sink_create_file(const char* path, bool append, size_t buffer_size) {
+    FILE* file = fopen(path, append ? "ab" : "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open output file '%s'\n", path);
+        return NULL;
+    }
+    // The sink's buffer is the only one; stdio would just copy it again
+    setvbuf(file, NULL, _IONBF, 0);
+    OutputSink* sink = sink_create(OUTPUT_SINK_FILE, file, buffer_size);
+    if (!sink) {
+        fclose(file);
+    }
+    return sink;
+}
+
+OutputSink* output_sink_create_memory(void) {
+    return sink_create(OUTPUT_SINK_MEMORY, NULL, 0);
+}
+
+void output_sink_free(OutputSink* sink) {
+    if (!sink || sink == &default_sink) {
+        return;
+    }
+    flush_locked(sink);
+    if (sink->kind == OUTPUT_SINK_FILE) {
+        fclose(sink->file);
+    }
+    pthread_mutex_destroy(&sink->lock);
+    ember_free(sink->data);
+    ember_free(sink);
+}
+
+OutputSinkKind output_sink_kind(const OutputSink* sink) {
+    return sink->kind;
+}
+
+const char* output_sink_contents(const OutputSink* sink, size_t* length) {
+    if (sink->kind != OUTPUT_SINK_MEMORY) {
+        if (length) {
+            *length = 0;
+        }
+        return NULL;
+    }
+    if (length) {
+        *length = sink->length;
+    }
+    return sink->data ? sink->data : "";
+}
+
+void output_sink_reset(OutputSink* sink) {
+    if (sink->kind == OUTPUT_SINK_MEMORY) {
+        pthread_mutex_lock(&sink->lock);
+        sink->length = 0;
+        pthread_mutex_unlock(&sink->lock);
+    }
+}
+
+/* -------------------------------------------------------
+   Selection
+   ------------------------------------------------------- */
+
+static void flush_default_sink(void) {
+    output_sink_flush(&default_sink);
+}
+
+static void default_sink_init(void) {
+    default_sink.file = stdout;
+    default_sink.write_through = isatty(fileno(stdout)) != 0;
+    atexit(flush_default_sink);
+}
+
+void output_sink_bind(OutputSink* sink) {
+    bound_sink = sink;
+}
+
+OutputSink* output_sink_install(OutputSink* sink) {
+    OutputSink* previous = atomic_exchange(&installed_sink, sink);
+    if (!previous) {
+        pthread_once(&default_sink_once, default_sink_init);
+    }
+    // Keep what was printed so far ahead of what the new sink gets
+    output_sink_flush(previous ? previous : &default_sink);
+    return previous;
+}
+
+OutputSink* output_sink_current(void) {
+    if (bound_sink) {
+        return bound_sink;
+    }
+    OutputSink* installed = atomic_load_explicit(&installed_sink, memory_order_acquire);
+    if (installed) {
+        return installed;
+    }
+    pthread_once(&default_sink_once, default_sink_init);
+    return &default_sink;
+}
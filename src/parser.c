@@ -1,5 +1,6 @@
 #include "parser.h"
 #include "lexer.h"
+#include "ember_alloc.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -16,7 +17,7 @@ void report_error(Parser* parser, char* message) {
 }
 
 ASTNode* create_ast_node(ASTNodeType type) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode* node = (ASTNode*)ember_malloc(EMBER_MEM_PARSER, sizeof(ASTNode));
     if (!node) {
         fprintf(stderr, "Error: Memory allocation failed for AST node\n");
         return NULL;
@@ -26,6 +27,14 @@ ASTNode* create_ast_node(ASTNodeType type) {
     return node;
 }
 
+// Record where a node starts, unless a nested parse already did
+static void set_position(ASTNode* node, int line, int column) {
+    if (node && node->line == 0) {
+        node->line = line;
+        node->column = column;
+    }
+}
+
 int get_operator_precedence(const char* op_symbol) {
     static const struct {
         const char* symbol;
@@ -53,12 +62,13 @@ Token peek_token(Parser* parser) {
 }
 
 Parser* parser_create(Lexer* lexer) {
-    Parser* parser = (Parser*)malloc(sizeof(Parser));
+    Parser* parser = (Parser*)ember_malloc(EMBER_MEM_PARSER, sizeof(Parser));
     if (!parser) {
         fprintf(stderr, "Error: Memory allocation failed for parser\n");
         return NULL;
     }
     parser->lexer = lexer;
+    parser->current_token.value = NULL;
     parser_advance(parser); // This sets the current_token
     parser->error_callback = NULL; // No error callback by default
     return parser;
@@ -66,7 +76,12 @@ Parser* parser_create(Lexer* lexer) {
 
 
 void print_current_token(Parser* parser) {
-    printf("Current token: type=%d, value=%s\n", parser->current_token.type, parser->current_token.value);
+    const Token* token = &parser->current_token;
+    if (token->type == TOKEN_NUMBER) {
+        printf("Current token: type=%d, value=%.17g\n", token->type, token->number);
+    } else {
+        printf("Current token: type=%d, value=%s\n", token->type, token->value ? token->value : "(null)");
+    }
 }
 
 void parser_advance(Parser* parser) {
@@ -75,7 +90,9 @@ void parser_advance(Parser* parser) {
         return;
     }
 
-    // Advance to the next token from the lexer
+    // Advance to the next token from the lexer. The AST copies whatever it
+    // keeps, so the previous token's text is released here.
+    free_token(&parser->current_token);
     parser->current_token = lexer_next_token(parser->lexer);
 }
 
@@ -86,26 +103,26 @@ void free_ast(ASTNode* node) {
 
     switch (node->type) {
         case AST_LITERAL:
-            free(node->literal.value);
+            ember_free(node->literal.value);
             break;
 
         case AST_BINARY_OP:
-            free(node->binary_op.op_symbol);
+            ember_free(node->binary_op.op_symbol);
             free_ast(node->binary_op.left);
             free_ast(node->binary_op.right);
             break;
 
         case AST_ASSIGNMENT:
-            free(node->assignment.variable);
+            ember_free(node->assignment.variable);
             free_ast(node->assignment.value);
             break;
 
         case AST_FUNCTION_CALL:
-            free(node->function_call.function_name);
+            ember_free(node->function_call.function_name);
             for (int i = 0; i < node->function_call.argument_count; i++) {
                 free_ast(node->function_call.arguments[i]);
             }
-            free(node->function_call.arguments);
+            ember_free(node->function_call.arguments);
             break;
 
        case AST_IF_STATEMENT:
@@ -129,7 +146,7 @@ void free_ast(ASTNode* node) {
             break;
 
         case AST_LOGICAL_OP:
-            free(node->logical_op.op_symbol);
+            ember_free(node->logical_op.op_symbol);
             free_ast(node->logical_op.left);
             free_ast(node->logical_op.right);
             break;
@@ -138,23 +155,23 @@ void free_ast(ASTNode* node) {
             for (int i = 0; i < node->block.statement_count; i++) {
                 free_ast(node->block.statements[i]);
             }
-            free(node->block.statements);
+            ember_free(node->block.statements);
             break;
 
         case AST_FUNCTION_DEF:
-            free(node->function_def.function_name);
+            ember_free(node->function_def.function_name);
             for (int i = 0; i < node->function_def.parameter_count; i++) {
-                free(node->function_def.parameters[i]);
+                ember_free(node->function_def.parameters[i]);
             }
-            free(node->function_def.parameters);
+            ember_free(node->function_def.parameters);
             free_ast(node->function_def.body);
             break;
         case AST_VARIABLE:
-            free(node->variable.variable_name);
+            ember_free(node->variable.variable_name);
             break;
 
         case AST_VARIABLE_DECL:
-            free(node->variable_decl.variable_name);
+            ember_free(node->variable_decl.variable_name);
             if (node->variable_decl.initial_value) {
                 free_ast(node->variable_decl.initial_value);
             }
@@ -165,7 +182,7 @@ void free_ast(ASTNode* node) {
                 free_ast(node->array_literal.elements[i]);
             }
             // Free the array of element pointers
-            free(node->array_literal.elements);
+            ember_free(node->array_literal.elements);
             break;
 
         case AST_INDEX_ACCESS:
@@ -175,7 +192,7 @@ void free_ast(ASTNode* node) {
             free_ast(node->index_access.index_expr);
             break; 
         case AST_UNARY_OP:
-            free(node->unary_op.op_symbol);
+            ember_free(node->unary_op.op_symbol);
             free_ast(node->unary_op.operand);
             break;
 
@@ -183,19 +200,46 @@ void free_ast(ASTNode* node) {
             // Implement freeing logic for switch cases
             break;
         case AST_IMPORT:
-            free(node->import_stmt.import_path);
+            ember_free(node->import_stmt.import_path);
+            break;
+        case AST_RETURN:
+            if (node->return_stmt.value) {
+                free_ast(node->return_stmt.value);
+            }
+            break;
+        case AST_OBJECT_LITERAL:
+            for (int i = 0; i < node->object_literal.property_count; i++) {
+                ember_free(node->object_literal.keys[i]);
+                free_ast(node->object_literal.values[i]);
+            }
+            ember_free(node->object_literal.keys);
+            ember_free(node->object_literal.values);
+            break;
+        case AST_PROPERTY_ACCESS:
+            free_ast(node->property_access.object_expr);
+            ember_free(node->property_access.property_name);
+            break;
+        case AST_PROPERTY_ASSIGNMENT:
+            free_ast(node->property_assignment.object_expr);
+            ember_free(node->property_assignment.property_name);
+            free_ast(node->property_assignment.value);
+            break;
+        case AST_INDEX_ASSIGNMENT:
+            free_ast(node->index_assignment.array_expr);
+            free_ast(node->index_assignment.index_expr);
+            free_ast(node->index_assignment.value);
             break;
         default:
             fprintf(stderr, "Error: Unknown AST node type\n");
             break;
     }
 
-    free(node);
+    ember_free(node);
 }
 
 ASTNode* parse_script(Parser* parser) {
     // Allocate a block node to hold all top-level statements
-    ASTNode* root = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode* root = (ASTNode*)ember_calloc(EMBER_MEM_PARSER, 1, sizeof(ASTNode));
     if (!root) {
         fprintf(stderr, "Error: Memory allocation failed for script block\n");
         return NULL;
@@ -215,7 +259,7 @@ ASTNode* parse_script(Parser* parser) {
         }
 
         // Expand the block's statement array to accommodate the new statement
-        root->block.statements = (ASTNode**)realloc(
+        root->block.statements = (ASTNode**)ember_realloc(EMBER_MEM_PARSER, 
             root->block.statements, 
             sizeof(ASTNode*) * (root->block.statement_count + 1)
         );
@@ -234,6 +278,116 @@ ASTNode* parse_script(Parser* parser) {
     return root;
 }
 
+// Parse `{ key = value, ... }`; keys are identifiers or strings, and a
+// trailing comma is allowed
+static ASTNode* parse_object_literal(Parser* parser) {
+    parser_advance(parser); // skip '{'
+
+    ASTNode* object_node = create_ast_node(AST_OBJECT_LITERAL);
+    if (!object_node) {
+        report_error(parser, "Failed to allocate AST_OBJECT_LITERAL node");
+        return NULL;
+    }
+    object_node->object_literal.keys = NULL;
+    object_node->object_literal.values = NULL;
+    object_node->object_literal.property_count = 0;
+
+    while (parser->current_token.type != TOKEN_PUNCTUATION ||
+           strcmp(parser->current_token.value, "}") != 0)
+    {
+        if (parser->current_token.type != TOKEN_IDENTIFIER &&
+            parser->current_token.type != TOKEN_STRING) {
+            report_error(parser, "Expected property name in object literal");
+            free_ast(object_node);
+            return NULL;
+        }
+        char* key = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
+        if (!key) {
+            report_error(parser, "Memory allocation failed for property name");
+            free_ast(object_node);
+            return NULL;
+        }
+        parser_advance(parser);
+
+        if (!match_token(parser, TOKEN_OPERATOR, "=")) {
+            report_error(parser, "Expected '=' after property name");
+            ember_free(key);
+            free_ast(object_node);
+            return NULL;
+        }
+
+        ASTNode* value = parse_expression(parser, 0);
+        if (!value) {
+            ember_free(key);
+            free_ast(object_node);
+            return NULL;
+        }
+
+        int count = object_node->object_literal.property_count;
+        char** keys = ember_realloc(EMBER_MEM_PARSER, object_node->object_literal.keys,
+                                    sizeof(char*) * (count + 1));
+        if (keys) {
+            object_node->object_literal.keys = keys;
+        }
+        ASTNode** values = ember_realloc(EMBER_MEM_PARSER, object_node->object_literal.values,
+                                         sizeof(ASTNode*) * (count + 1));
+        if (values) {
+            object_node->object_literal.values = values;
+        }
+        if (!keys || !values) {
+            report_error(parser, "Memory allocation failed while parsing object properties");
+            ember_free(key);
+            free_ast(value);
+            free_ast(object_node);
+            return NULL;
+        }
+        keys[count] = key;
+        values[count] = value;
+        object_node->object_literal.property_count = count + 1;
+
+        if (parser->current_token.type == TOKEN_PUNCTUATION &&
+            strcmp(parser->current_token.value, ",") == 0)
+        {
+            parser_advance(parser); // skip the comma
+        } else {
+            break;
+        }
+    }
+
+    if (!match_token(parser, TOKEN_PUNCTUATION, "}")) {
+        report_error(parser, "Expected '}' at the end of object literal");
+        free_ast(object_node);
+        return NULL;
+    }
+    return object_node;
+}
+
+// Parse `.name` following `object_expr`; consumes `object_expr` either way
+static ASTNode* parse_property_access(Parser* parser, ASTNode* object_expr) {
+    parser_advance(parser); // skip '.'
+
+    if (parser->current_token.type != TOKEN_IDENTIFIER) {
+        report_error(parser, "Expected property name after '.'");
+        free_ast(object_expr);
+        return NULL;
+    }
+
+    ASTNode* access_node = create_ast_node(AST_PROPERTY_ACCESS);
+    char* name = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
+    if (!access_node || !name) {
+        report_error(parser, "Memory allocation failed for AST_PROPERTY_ACCESS");
+        ember_free(access_node);
+        ember_free(name);
+        free_ast(object_expr);
+        return NULL;
+    }
+    parser_advance(parser);
+
+    access_node->property_access.object_expr = object_expr;
+    access_node->property_access.property_name = name;
+    return access_node;
+}
+
 ASTNode* parse_factor(Parser* parser) {
     ASTNode* factor_node = NULL;
 
@@ -242,7 +396,7 @@ ASTNode* parse_factor(Parser* parser) {
         (strcmp(parser->current_token.value, "-") == 0 ||
          strcmp(parser->current_token.value, "!") == 0)) {
         // Save the operator
-        char* operator = strdup(parser->current_token.value);
+        char* operator = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
         if (!operator) {
             report_error(parser, "Memory allocation failed for operator");
             return NULL;
@@ -255,7 +409,7 @@ ASTNode* parse_factor(Parser* parser) {
         ASTNode* operand = parse_factor(parser);
         if (!operand) {
             report_error(parser, "Failed to parse operand for unary operation");
-            free(operator);
+            ember_free(operator);
             return NULL;
         }
 
@@ -263,7 +417,7 @@ ASTNode* parse_factor(Parser* parser) {
         ASTNode* unary_op = create_ast_node(AST_UNARY_OP);
         if (!unary_op) {
             report_error(parser, "Memory allocation failed for unary operation node");
-            free(operator);
+            ember_free(operator);
             free_ast(operand);
             return NULL;
         }
@@ -288,10 +442,15 @@ ASTNode* parse_factor(Parser* parser) {
         // Store the token type
         literal->literal.token_type = parser->current_token.type;
 
-        literal->literal.value = strdup(parser->current_token.value);
-        if (!literal->literal.value) {
+        // Numbers were parsed by the lexer and carry no text
+        literal->literal.number = parser->current_token.number;
+        literal->literal.value = NULL;
+        if (parser->current_token.type != TOKEN_NUMBER) {
+            literal->literal.value = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
+        }
+        if (parser->current_token.type != TOKEN_NUMBER && !literal->literal.value) {
             report_error(parser, "Memory allocation failed for literal value");
-            free(literal);
+            ember_free(literal);
             return NULL;
         }
 
@@ -355,7 +514,7 @@ ASTNode* parse_factor(Parser* parser) {
 
             // Grow the elements array by 1
             array_node->array_literal.element_count++;
-            array_node->array_literal.elements = realloc(
+            array_node->array_literal.elements = ember_realloc(EMBER_MEM_PARSER, 
                 array_node->array_literal.elements,
                 sizeof(ASTNode*) * array_node->array_literal.element_count
             );
@@ -393,9 +552,18 @@ ASTNode* parse_factor(Parser* parser) {
         parser_advance(parser);
         factor_node = array_node;
     }
+    // Object literal: '{' key = value, ... '}'
+    else if (parser->current_token.type == TOKEN_PUNCTUATION &&
+        strcmp(parser->current_token.value, "{") == 0)
+    {
+        factor_node = parse_object_literal(parser);
+        if (!factor_node) {
+            return NULL;
+        }
+    }
     // Handle identifiers (variables and function calls)
     else if (parser->current_token.type == TOKEN_IDENTIFIER) {
-        char* identifier = strdup(parser->current_token.value);
+        char* identifier = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
         if (!identifier) {
             report_error(parser, "Memory allocation failed for identifier");
             return NULL;
@@ -417,23 +585,23 @@ ASTNode* parse_factor(Parser* parser) {
                     ASTNode* arg = parse_expression(parser, 0);
                     if (!arg) {
                         report_error(parser, "Failed to parse function argument");
-                        free(identifier);
+                        ember_free(identifier);
                         // Free previously allocated arguments
                         for (int i = 0; i < argument_count; i++) {
                             free_ast(arguments[i]);
                         }
-                        free(arguments);
+                        ember_free(arguments);
                         return NULL;
                     }
-                    ASTNode** temp = realloc(arguments, sizeof(ASTNode*) * (argument_count + 1));
+                    ASTNode** temp = ember_realloc(EMBER_MEM_PARSER, arguments, sizeof(ASTNode*) * (argument_count + 1));
                     if (!temp) {
                         report_error(parser, "Memory allocation failed for arguments");
-                        free(identifier);
+                        ember_free(identifier);
                         free_ast(arg);
                         for (int i = 0; i < argument_count; i++) {
                             free_ast(arguments[i]);
                         }
-                        free(arguments);
+                        ember_free(arguments);
                         return NULL;
                     }
                     arguments = temp;
@@ -451,11 +619,11 @@ ASTNode* parse_factor(Parser* parser) {
                 // Expect a closing parenthesis ')'
                 if (!match_token(parser, TOKEN_PUNCTUATION, ")")) {
                     report_error(parser, "Expected ')' after function arguments");
-                    free(identifier);
+                    ember_free(identifier);
                     for (int i = 0; i < argument_count; i++) {
                         free_ast(arguments[i]);
                     }
-                    free(arguments);
+                    ember_free(arguments);
                     return NULL;
                 }
             } else {
@@ -467,11 +635,11 @@ ASTNode* parse_factor(Parser* parser) {
             ASTNode* func_call = create_ast_node(AST_FUNCTION_CALL);
             if (!func_call) {
                 report_error(parser, "Memory allocation failed for function call node");
-                free(identifier);
+                ember_free(identifier);
                 for (int i = 0; i < argument_count; i++) {
                     free_ast(arguments[i]);
                 }
-                free(arguments);
+                ember_free(arguments);
                 return NULL;
             }
             func_call->function_call.function_name = identifier;
@@ -484,7 +652,7 @@ ASTNode* parse_factor(Parser* parser) {
             ASTNode* var_node = create_ast_node(AST_VARIABLE);
             if (!var_node) {
                 report_error(parser, "Memory allocation failed for variable node");
-                free(identifier);
+                ember_free(identifier);
                 return NULL;
             }
             var_node->variable.variable_name = identifier;
@@ -496,9 +664,18 @@ ASTNode* parse_factor(Parser* parser) {
         return NULL;
     }
 
-     while (parser->current_token.type == TOKEN_PUNCTUATION &&
-           strcmp(parser->current_token.value, "[") == 0)
+    while (parser->current_token.type == TOKEN_PUNCTUATION &&
+           (strcmp(parser->current_token.value, "[") == 0 ||
+            strcmp(parser->current_token.value, ".") == 0))
     {
+        if (strcmp(parser->current_token.value, ".") == 0) {
+            factor_node = parse_property_access(parser, factor_node);
+            if (!factor_node) {
+                return NULL;
+            }
+            continue;
+        }
+
         // We have an index access, e.g. "myArray[ indexExpr ]"
         parser_advance(parser); // skip '['
 
@@ -543,12 +720,16 @@ ASTNode* parse_factor(Parser* parser) {
 }
 
 ASTNode* parse_expression(Parser* parser, int min_precedence) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+
     // 1. Parse the initial left-hand side (factor)
     ASTNode* left = parse_factor(parser);
     if (!left) {
         fprintf(stderr, "Error: Failed to parse left-hand side of expression\n");
         return NULL;
     }
+    set_position(left, line, column);
 
     // 2. Loop to handle multiple operators in sequence
     //    (e.g., left + right + right2, etc.)
@@ -580,6 +761,44 @@ ASTNode* parse_expression(Parser* parser, int min_precedence) {
                 return NULL;
             }
 
+            // `a.b = value` stores into the object instead of a variable
+            if (left->type == AST_PROPERTY_ACCESS) {
+                ember_free(assignment_node);
+                ASTNode* store_node = create_ast_node(AST_PROPERTY_ASSIGNMENT);
+                if (!store_node) {
+                    fprintf(stderr, "Error: Memory allocation failed for property assignment node\n");
+                    free_ast(left);
+                    free_ast(right);
+                    return NULL;
+                }
+                store_node->property_assignment.object_expr = left->property_access.object_expr;
+                store_node->property_assignment.property_name = left->property_access.property_name;
+                store_node->property_assignment.value = right;
+                set_position(store_node, line, column);
+                ember_free(left);
+                left = store_node;
+                continue;
+            }
+
+            // `a[i] = value` stores into the array or object
+            if (left->type == AST_INDEX_ACCESS) {
+                ember_free(assignment_node);
+                ASTNode* store_node = create_ast_node(AST_INDEX_ASSIGNMENT);
+                if (!store_node) {
+                    fprintf(stderr, "Error: Memory allocation failed for index assignment node\n");
+                    free_ast(left);
+                    free_ast(right);
+                    return NULL;
+                }
+                store_node->index_assignment.array_expr = left->index_access.array_expr;
+                store_node->index_assignment.index_expr = left->index_access.index_expr;
+                store_node->index_assignment.value = right;
+                set_position(store_node, line, column);
+                ember_free(left);
+                left = store_node;
+                continue;
+            }
+
              if (left->type != AST_VARIABLE) {
                  report_error(parser, "Left-hand side of '=' must be a variable");
                  free_ast(left);
@@ -597,14 +816,15 @@ ASTNode* parse_expression(Parser* parser, int min_precedence) {
                 left->variable.variable_name = NULL; 
             } else {
                 // If you don't enforce variable left-sides, you might do something else:
-                assignment_node->assignment.variable = strdup("<nonVariable>");
+                assignment_node->assignment.variable = ember_strdup(EMBER_MEM_PARSER, "<nonVariable>");
             }
 
             // Attach the right side
             assignment_node->assignment.value = right;
+            set_position(assignment_node, line, column);
 
             // We no longer need 'left' as an AST node
-            free(left);
+            ember_free(left);
             
             // The assignment node becomes our new "left"
             left = assignment_node;
@@ -621,7 +841,9 @@ ASTNode* parse_expression(Parser* parser, int min_precedence) {
             }
 
             // Otherwise, consume the operator
-            char* operator = strdup(op);
+            int op_line = parser->current_token.line;
+            int op_column = parser->current_token.column;
+            char* operator = ember_strdup(EMBER_MEM_PARSER, op);
             if (!operator) {
                 fprintf(stderr, "Error: Memory allocation failed for operator\n");
                 free_ast(left);
@@ -634,7 +856,7 @@ ASTNode* parse_expression(Parser* parser, int min_precedence) {
             ASTNode* right = parse_expression(parser, precedence + 1);
             if (!right) {
                 fprintf(stderr, "Error: Failed to parse right-hand side of expression\n");
-                free(operator);
+                ember_free(operator);
                 free_ast(left);
                 return NULL;
             }
@@ -643,7 +865,7 @@ ASTNode* parse_expression(Parser* parser, int min_precedence) {
             ASTNode* binary_op = create_ast_node(AST_BINARY_OP);
             if (!binary_op) {
                 fprintf(stderr, "Error: Memory allocation failed for binary operation node\n");
-                free(operator);
+                ember_free(operator);
                 free_ast(left);
                 free_ast(right);
                 return NULL;
@@ -653,6 +875,7 @@ ASTNode* parse_expression(Parser* parser, int min_precedence) {
             binary_op->binary_op.left = left;
             binary_op->binary_op.right = right;
             binary_op->binary_op.op_symbol = operator;
+            set_position(binary_op, op_line, op_column);
 
             // That becomes our new left side
             left = binary_op;
@@ -666,7 +889,17 @@ ASTNode* parse_expression(Parser* parser, int min_precedence) {
     return left;
 }
 
+static ASTNode* parse_statement_node(Parser* parser);
+
 ASTNode* parse_statement(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    ASTNode* statement = parse_statement_node(parser);
+    set_position(statement, line, column);
+    return statement;
+}
+
+static ASTNode* parse_statement_node(Parser* parser) {
     // Match an if statement
     if (parser->current_token.type == TOKEN_KEYWORD &&
         strcmp(parser->current_token.value, "if") == 0) {
@@ -696,6 +929,12 @@ ASTNode* parse_statement(Parser* parser) {
         return parse_import_statement(parser);
     }
 
+    // Match a return statement
+    if (parser->current_token.type == TOKEN_KEYWORD &&
+        strcmp(parser->current_token.value, "return") == 0) {
+        return parse_return_statement(parser);
+    }
+
     // Match a block
     if (parser->current_token.type == TOKEN_PUNCTUATION &&
         strcmp(parser->current_token.value, "{") == 0) {
@@ -712,7 +951,9 @@ ASTNode* parse_statement(Parser* parser) {
     if (parser->current_token.type == TOKEN_IDENTIFIER) {
         // Peek ahead to check for assignment operator '='
         Token next_token = peek_token(parser);
-        if (next_token.type == TOKEN_OPERATOR && strcmp(next_token.value, "=") == 0) {
+        bool is_assignment = next_token.type == TOKEN_OPERATOR && strcmp(next_token.value, "=") == 0;
+        free_token(&next_token);
+        if (is_assignment) {
             return parse_assignment(parser);
         }
     }
@@ -734,6 +975,38 @@ ASTNode* parse_statement(Parser* parser) {
     return NULL;
 }
 
+ASTNode* parse_return_statement(Parser* parser) {
+    if (!match_token(parser, TOKEN_KEYWORD, "return")) {
+        report_error(parser, "Expected 'return' keyword");
+        return NULL;
+    }
+
+    ASTNode* value = NULL;
+    if (parser->current_token.type != TOKEN_PUNCTUATION ||
+        strcmp(parser->current_token.value, ";") != 0) {
+        value = parse_expression(parser, 0);
+        if (!value) {
+            report_error(parser, "Expected expression after 'return'");
+            return NULL;
+        }
+    }
+
+    if (!match_token(parser, TOKEN_PUNCTUATION, ";")) {
+        report_error(parser, "Expected ';' after return statement");
+        free_ast(value);
+        return NULL;
+    }
+
+    ASTNode* node = create_ast_node(AST_RETURN);
+    if (!node) {
+        report_error(parser, "Memory allocation failed for return node");
+        free_ast(value);
+        return NULL;
+    }
+    node->return_stmt.value = value;
+    return node;
+}
+
 ASTNode* parse_block(Parser* parser) {
     // Ensure the block starts with '{'
     if (!match_token(parser, TOKEN_PUNCTUATION, "{")) {
@@ -762,7 +1035,7 @@ ASTNode* parse_block(Parser* parser) {
         }
 
         // Add the parsed statement to the block's statements array
-        ASTNode** temp = realloc(block_node->block.statements,
+        ASTNode** temp = ember_realloc(EMBER_MEM_PARSER, block_node->block.statements,
                                  sizeof(ASTNode*) * (block_node->block.statement_count + 1));
         if (!temp) {
             report_error(parser, "Memory allocation failed for block statements");
@@ -798,7 +1071,7 @@ ASTNode* parse_function_definition(Parser* parser) {
     }
 
     // Capture the function name
-    char* function_name = strdup(parser->current_token.value);
+    char* function_name = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
     if (!function_name) {
         report_error(parser, "Memory allocation failed for function name");
         return NULL;
@@ -808,7 +1081,7 @@ ASTNode* parse_function_definition(Parser* parser) {
     // Expect an opening parenthesis '('
     if (!match_token(parser, TOKEN_PUNCTUATION, "(")) {
         report_error(parser, "Expected '(' after function name");
-        free(function_name);
+        ember_free(function_name);
         return NULL;
     }
 
@@ -822,36 +1095,36 @@ ASTNode* parse_function_definition(Parser* parser) {
 
         if (parser->current_token.type != TOKEN_IDENTIFIER) {
             report_error(parser, "Expected parameter name");
-            free(function_name);
+            ember_free(function_name);
             for (int i = 0; i < parameter_count; i++) {
-                free(parameters[i]);
+                ember_free(parameters[i]);
             }
-            free(parameters);
+            ember_free(parameters);
             return NULL;
         }
 
         // Capture parameter name
-        char* param_name = strdup(parser->current_token.value);
+        char* param_name = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
         if (!param_name) {
             report_error(parser, "Memory allocation failed for parameter name");
-            free(function_name);
+            ember_free(function_name);
             for (int i = 0; i < parameter_count; i++) {
-                free(parameters[i]);
+                ember_free(parameters[i]);
             }
-            free(parameters);
+            ember_free(parameters);
             return NULL;
         }
 
         // Add parameter name to the list
-        char** temp = realloc(parameters, sizeof(char*) * (parameter_count + 1));
+        char** temp = ember_realloc(EMBER_MEM_PARSER, parameters, sizeof(char*) * (parameter_count + 1));
         if (!temp) {
             report_error(parser, "Memory allocation failed for parameters");
-            free(param_name);
-            free(function_name);
+            ember_free(param_name);
+            ember_free(function_name);
             for (int i = 0; i < parameter_count; i++) {
-                free(parameters[i]);
+                ember_free(parameters[i]);
             }
-            free(parameters);
+            ember_free(parameters);
             return NULL;
         }
         parameters = temp;
@@ -869,11 +1142,11 @@ ASTNode* parse_function_definition(Parser* parser) {
             break;
         } else {
             report_error(parser, "Expected ',' or ')' in parameter list");
-            free(function_name);
+            ember_free(function_name);
             for (int i = 0; i < parameter_count; i++) {
-                free(parameters[i]);
+                ember_free(parameters[i]);
             }
-            free(parameters);
+            ember_free(parameters);
             return NULL;
         }
     }
@@ -881,11 +1154,11 @@ ASTNode* parse_function_definition(Parser* parser) {
     // Consume the closing parenthesis ')'
     if (!match_token(parser, TOKEN_PUNCTUATION, ")")) {
         report_error(parser, "Expected ')' after parameters");
-        free(function_name);
+        ember_free(function_name);
         for (int i = 0; i < parameter_count; i++) {
-            free(parameters[i]);
+            ember_free(parameters[i]);
         }
-        free(parameters);
+        ember_free(parameters);
         return NULL;
     }
 
@@ -893,11 +1166,11 @@ ASTNode* parse_function_definition(Parser* parser) {
     ASTNode* body = parse_block(parser);
     if (!body) {
         report_error(parser, "Failed to parse function body");
-        free(function_name);
+        ember_free(function_name);
         for (int i = 0; i < parameter_count; i++) {
-            free(parameters[i]);
+            ember_free(parameters[i]);
         }
-        free(parameters);
+        ember_free(parameters);
         return NULL;
     }
 
@@ -905,11 +1178,11 @@ ASTNode* parse_function_definition(Parser* parser) {
     ASTNode* function_def_node = create_ast_node(AST_FUNCTION_DEF);
     if (!function_def_node) {
         report_error(parser, "Memory allocation failed for function definition node");
-        free(function_name);
+        ember_free(function_name);
         for (int i = 0; i < parameter_count; i++) {
-            free(parameters[i]);
+            ember_free(parameters[i]);
         }
-        free(parameters);
+        ember_free(parameters);
         free_ast(body);
         return NULL;
     }
@@ -942,7 +1215,7 @@ ASTNode* parse_import_statement(Parser* parser)
     }
 
     // Start our import_path with the first identifier
-    char* import_path = strdup(parser->current_token.value);
+    char* import_path = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
     if (!import_path) {
         report_error(parser, "Memory allocation failed for import path");
         return NULL;
@@ -959,22 +1232,22 @@ ASTNode* parse_import_statement(Parser* parser)
         // Next token must be another identifier
         if (parser->current_token.type != TOKEN_IDENTIFIER) {
             report_error(parser, "Expected identifier after '.' in import path");
-            free(import_path);
+            ember_free(import_path);
             return NULL;
         }
 
         // Append ".identifier" to import_path
         size_t old_len = strlen(import_path);
         size_t extra_len = strlen(parser->current_token.value) + 2; // +1 for '.' +1 for '\0'
-        char* new_path = (char*)malloc(old_len + extra_len);
+        char* new_path = (char*)ember_malloc(EMBER_MEM_PARSER, old_len + extra_len);
         if (!new_path) {
             report_error(parser, "Memory allocation failed while appending to import path");
-            free(import_path);
+            ember_free(import_path);
             return NULL;
         }
 
         sprintf(new_path, "%s.%s", import_path, parser->current_token.value);
-        free(import_path);
+        ember_free(import_path);
         import_path = new_path;
 
         // Advance past this identifier
@@ -984,7 +1257,7 @@ ASTNode* parse_import_statement(Parser* parser)
     // 4) Expect a semicolon to close the import statement
     if (!match_token(parser, TOKEN_PUNCTUATION, ";")) {
         report_error(parser, "Expected ';' after import statement");
-        free(import_path);
+        ember_free(import_path);
         return NULL;
     }
 
@@ -992,7 +1265,7 @@ ASTNode* parse_import_statement(Parser* parser)
     ASTNode* node = create_ast_node(AST_IMPORT);
     if (!node) {
         report_error(parser, "Memory allocation failed for AST_IMPORT node");
-        free(import_path);
+        ember_free(import_path);
         return NULL;
     }
     node->import_stmt.import_path = import_path;
@@ -1112,7 +1385,7 @@ ASTNode* parse_while_loop(Parser* parser) {
     }
 
     // Create the while loop AST node
-    ASTNode* while_node = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode* while_node = (ASTNode*)ember_calloc(EMBER_MEM_PARSER, 1, sizeof(ASTNode));
     if (!while_node) {
         fprintf(stderr, "Error: Memory allocation failed for 'while' loop node\n");
         free_ast(condition);
@@ -1291,7 +1564,7 @@ ASTNode* parse_switch_case(Parser* parser) {
     parser_advance(parser); // Skip '{'
 
     // Initialize the switch_case node
-    ASTNode* switch_node = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode* switch_node = (ASTNode*)ember_calloc(EMBER_MEM_PARSER, 1, sizeof(ASTNode));
     if (!switch_node) {
         fprintf(stderr, "Error: Memory allocation failed for switch node\n");
         free_ast(condition);
@@ -1337,7 +1610,7 @@ ASTNode* parse_switch_case(Parser* parser) {
 
             // Add the case to the cases array
             switch_node->switch_case.case_count++;
-            switch_node->switch_case.cases = realloc(switch_node->switch_case.cases,
+            switch_node->switch_case.cases = ember_realloc(EMBER_MEM_PARSER, switch_node->switch_case.cases,
                 sizeof(ASTNode*) * switch_node->switch_case.case_count);
             if (!switch_node->switch_case.cases) {
                 fprintf(stderr, "Error: Memory allocation failed for switch cases\n");
@@ -1348,7 +1621,7 @@ ASTNode* parse_switch_case(Parser* parser) {
             }
 
             // Create a case node and add it
-            ASTNode* case_node = (ASTNode*)malloc(sizeof(ASTNode));
+            ASTNode* case_node = (ASTNode*)ember_calloc(EMBER_MEM_PARSER, 1, sizeof(ASTNode));
             if (!case_node) {
                 fprintf(stderr, "Error: Memory allocation failed for case node\n");
                 free_ast(case_value);
@@ -1358,7 +1631,7 @@ ASTNode* parse_switch_case(Parser* parser) {
             }
 
             case_node->type = AST_BLOCK; // Each case is treated as a block
-            case_node->block.statements = malloc(2 * sizeof(ASTNode*));
+            case_node->block.statements = ember_malloc(EMBER_MEM_PARSER, 2 * sizeof(ASTNode*));
             case_node->block.statements[0] = case_value;
             case_node->block.statements[1] = case_body;
             case_node->block.statement_count = 2;
@@ -1404,7 +1677,7 @@ ASTNode* parse_assignment(Parser* parser) {
     }
 
     // Store the variable name
-    char* variable_name = strdup(parser->current_token.value);
+    char* variable_name = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
     if (!variable_name) {
         fprintf(stderr, "Error: Memory allocation failed for variable name\n");
         return NULL;
@@ -1416,7 +1689,7 @@ ASTNode* parse_assignment(Parser* parser) {
     // Ensure the next token is the '=' operator
     if (parser->current_token.type != TOKEN_OPERATOR || strcmp(parser->current_token.value, "=") != 0) {
         report_error(parser, "Expected '=' in assignment statement");
-        free(variable_name);
+        ember_free(variable_name);
         return NULL;
     }
 
@@ -1427,15 +1700,15 @@ ASTNode* parse_assignment(Parser* parser) {
     ASTNode* value_node = parse_expression(parser, 0);
     if (!value_node) {
         fprintf(stderr, "Error: Failed to parse right-hand side of assignment\n");
-        free(variable_name);
+        ember_free(variable_name);
         return NULL;
     }
 
     // Create the assignment node
-    ASTNode* assignment_node = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode* assignment_node = (ASTNode*)ember_calloc(EMBER_MEM_PARSER, 1, sizeof(ASTNode));
     if (!assignment_node) {
         fprintf(stderr, "Error: Memory allocation failed for assignment node\n");
-        free(variable_name);
+        ember_free(variable_name);
         free_ast(value_node);
         return NULL;
     }
@@ -1443,9 +1716,9 @@ ASTNode* parse_assignment(Parser* parser) {
     // Expect a semicolon ';' after the assignment
     if (!match_token(parser, TOKEN_PUNCTUATION, ";")) {
         report_error(parser, "Expected ';' after assignment");
-        free(variable_name);
+        ember_free(variable_name);
         free_ast(value_node);
-        free(assignment_node);
+        ember_free(assignment_node);
         return NULL;
     }
 
@@ -1477,7 +1750,7 @@ ASTNode* parse_variable_declaration(Parser* parser, bool inForHeader) {
     }
 
     // Store the variable name
-    char* variable_name = strdup(parser->current_token.value);
+    char* variable_name = ember_strdup(EMBER_MEM_PARSER, parser->current_token.value);
     if (!variable_name) {
         fprintf(stderr, "Error: Memory allocation failed for variable name\n");
         return NULL;
@@ -1496,7 +1769,7 @@ ASTNode* parse_variable_declaration(Parser* parser, bool inForHeader) {
         initial_value = parse_expression(parser, 0);
         if (!initial_value) {
             fprintf(stderr, "Error: Failed to parse initializer for variable declaration\n");
-            free(variable_name);
+            ember_free(variable_name);
             return NULL;
         }
     }
@@ -1505,7 +1778,7 @@ ASTNode* parse_variable_declaration(Parser* parser, bool inForHeader) {
     ASTNode* variable_decl_node = create_ast_node(AST_VARIABLE_DECL);
     if (!variable_decl_node) {
         fprintf(stderr, "Error: Memory allocation failed for variable declaration node\n");
-        free(variable_name);
+        ember_free(variable_name);
         if (initial_value) free_ast(initial_value);
         return NULL;
     }
@@ -1517,9 +1790,9 @@ ASTNode* parse_variable_declaration(Parser* parser, bool inForHeader) {
     if (!inForHeader) {
         if (!match_token(parser, TOKEN_PUNCTUATION, ";")) {
             report_error(parser, "Expected ';' after variable declaration");
-            free(variable_name);
+            ember_free(variable_name);
             if (initial_value) free_ast(initial_value);
-            free(variable_decl_node);
+            ember_free(variable_decl_node);
             return NULL;
         }
     }
@@ -1534,7 +1807,7 @@ ASTNode* parse_anonymous_block(Parser* parser) {
     }
 
     // Create a block node
-    ASTNode* block_node = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode* block_node = (ASTNode*)ember_calloc(EMBER_MEM_PARSER, 1, sizeof(ASTNode));
     if (!block_node) {
         fprintf(stderr, "Error: Memory allocation failed for anonymous block.\n");
         return NULL;
@@ -1555,7 +1828,7 @@ ASTNode* parse_anonymous_block(Parser* parser) {
 
         // Grow the statements array
         block_node->block.statement_count++;
-        block_node->block.statements = (ASTNode**)realloc(
+        block_node->block.statements = (ASTNode**)ember_realloc(EMBER_MEM_PARSER, 
             block_node->block.statements,
             block_node->block.statement_count * sizeof(ASTNode*)
         );
@@ -1609,7 +1882,7 @@ bool match_token(Parser* parser, ScriptTokenType type, const char* value) {
 
 ParserError* parser_error(Parser* parser, const char* message) {
     // Allocate memory for the error object
-    ParserError* error = (ParserError*)malloc(sizeof(ParserError));
+    ParserError* error = (ParserError*)ember_malloc(EMBER_MEM_PARSER, sizeof(ParserError));
     if (!error) {
         fprintf(stderr, "Error: Memory allocation failed for ParserError.\n");
         return NULL;
@@ -1618,7 +1891,7 @@ ParserError* parser_error(Parser* parser, const char* message) {
     // Set the error properties
     error->line = parser->lexer->line;
     error->column = parser->lexer->position;
-    error->message = strdup(message); // Duplicate the error message for safe storage
+    error->message = ember_strdup(EMBER_MEM_PARSER, message); // Duplicate the error message for safe storage
 
     // Print the error to standard error for immediate feedback
     fprintf(stderr, "Parser Error at line %d, column %d: %s\n", error->line, error->column, error->message);
@@ -1639,7 +1912,11 @@ void print_ast(const ASTNode* node, int depth) {
     // Print the node type
     switch (node->type) {
         case AST_LITERAL:
-            printf("Literal: %s\n", node->literal.value);
+            if (node->literal.token_type == TOKEN_NUMBER) {
+                printf("Literal: %.17g\n", node->literal.number);
+            } else {
+                printf("Literal: %s\n", node->literal.value);
+            }
             break;
 
         case AST_BINARY_OP:
@@ -1732,6 +2009,35 @@ void print_ast(const ASTNode* node, int depth) {
             }
             break;
 
+        case AST_OBJECT_LITERAL:
+            printf("Object Literal:\n");
+            for (int i = 0; i < node->object_literal.property_count; i++) {
+                for (int j = 0; j < depth + 1; j++) {
+                    printf("  ");
+                }
+                printf("%s =\n", node->object_literal.keys[i]);
+                print_ast(node->object_literal.values[i], depth + 2);
+            }
+            break;
+
+        case AST_PROPERTY_ACCESS:
+            printf("Property Access: .%s\n", node->property_access.property_name);
+            print_ast(node->property_access.object_expr, depth + 1);
+            break;
+
+        case AST_PROPERTY_ASSIGNMENT:
+            printf("Property Assignment: .%s\n", node->property_assignment.property_name);
+            print_ast(node->property_assignment.object_expr, depth + 1);
+            print_ast(node->property_assignment.value, depth + 1);
+            break;
+
+        case AST_INDEX_ASSIGNMENT:
+            printf("Index Assignment:\n");
+            print_ast(node->index_assignment.array_expr, depth + 1);
+            print_ast(node->index_assignment.index_expr, depth + 1);
+            print_ast(node->index_assignment.value, depth + 1);
+            break;
+
         default:
             printf("Unknown AST Node Type\n");
             break;
@@ -2,34 +2,134 @@
 #include <stdlib.h>     // For memory allocation (e.g., malloc, free)
 #include <string.h>     // For string manipulation (e.g., strcpy, strcmp)
 #include <stdbool.h>    // For boolean data type
-#ifdef _WIN32
- #include <windows.h>
- // Define pthread_t as a HANDLE on Windows
-typedef HANDLE pthread_t;
-#else
-#include <pthread.h>    // Only include pthread.h if not on Windows
-#endif
 #include <ctype.h>
 #include <math.h>
+#include <stdint.h>
 
 #include "runtime.h"
+#include "event_bus.h"
+#include "object.h"
+#include "array.h"
+#include "script_string.h"
+#include "number_format.h"
+#include "output_sink.h"
 #include "utils.h"
+#include "ember_alloc.h"
+
+/* -------------------------------------------------------
+   Environment node pool
+   ------------------------------------------------------- */
+
+// Upper bound on cached nodes per thread; anything beyond this goes back to malloc.
+#define RUNTIME_ENV_POOL_MAX 4096
+
+// Each thread keeps its own free list, so no locking is needed. Nodes are
+// individually malloc'd, which means a node may be released on a different
+// thread than the one that allocated it.
+static _Thread_local Environment* env_pool_head = NULL;
+static _Thread_local int env_pool_count = 0;
+
+static Environment* env_node_acquire(void) {
+    Environment* node = env_pool_head;
+    if (node) {
+        env_pool_head = node->next;
+        env_pool_count--;
+    } else {
+        node = (Environment*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(Environment));
+        if (!node) {
+            return NULL;
+        }
+        node->variable_name = NULL;
+        node->name_capacity = 0;
+    }
+    node->value.type = RUNTIME_VALUE_NULL;
+    node->value.string_value = NULL;
+    node->next = NULL;
+    node->parent = NULL;
+    node->shared = false;
+    return node;
+}
+
+static void env_node_release(Environment* node) {
+    if (env_pool_count >= RUNTIME_ENV_POOL_MAX) {
+        ember_free(node->variable_name);
+        ember_free(node);
+        return;
+    }
+    // Keep the name buffer; the next variable bound to this cell reuses it.
+    if (node->variable_name) {
+        node->variable_name[0] = '\0';
+    }
+    node->next = env_pool_head;
+    env_pool_head = node;
+    env_pool_count++;
+}
+
+static void env_pool_reserve(int count) {
+    while (env_pool_count < count && env_pool_count < RUNTIME_ENV_POOL_MAX) {
+        Environment* node = (Environment*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(Environment));
+        if (!node) {
+            return;
+        }
+        node->variable_name = NULL;
+        node->name_capacity = 0;
+        node->next = env_pool_head;
+        env_pool_head = node;
+        env_pool_count++;
+    }
+}
+
+// Bind `name` to a pooled cell, reusing the cell's previous name buffer when it fits.
+static bool env_node_set_name(Environment* node, const char* name) {
+    size_t length = strlen(name) + 1;
+    if (length > node->name_capacity) {
+        char* buffer = (char*)ember_realloc(EMBER_MEM_RUNTIME, node->variable_name, length);
+        if (!buffer) {
+            return false;
+        }
+        node->variable_name = buffer;
+        node->name_capacity = length;
+    }
+    memcpy(node->variable_name, name, length);
+    return true;
+}
+
+void runtime_env_pool_trim(void) {
+    while (env_pool_head) {
+        Environment* next = env_pool_head->next;
+        ember_free(env_pool_head->variable_name);
+        ember_free(env_pool_head);
+        env_pool_head = next;
+    }
+    env_pool_count = 0;
+}
+
+/* -------------------------------------------------------
+   Return propagation
+   ------------------------------------------------------- */
+
+// Set by a `return` statement. Blocks and loops stop executing while it is
+// set, until the enclosing function call (or top-level entry point) takes
+// the value. Thread-local so pool workers never see each other's returns.
+static _Thread_local bool return_pending = false;
+static _Thread_local RuntimeValue return_value;
+
+static RuntimeValue runtime_take_return_value(void) {
+    RuntimeValue value = { .type = RUNTIME_VALUE_NULL };
+    if (return_pending) {
+        value = return_value;
+        return_value.type = RUNTIME_VALUE_NULL;
+        return_pending = false;
+    }
+    return value;
+}
 
 Environment* runtime_create_environment() {
-    // Allocate memory for the environment
-    Environment* env = (Environment*)malloc(sizeof(Environment));
+    Environment* env = env_node_acquire();
     if (!env) {
-        fprintf(stderr, "Error: Memory allocation failed for global environment.\n");
+        output_sink_error("Error: Memory allocation failed for global environment.\n");
         return NULL;
     }
-
-    // Initialize environment fields
-    env->variable_name = NULL;
-    env->value.type = RUNTIME_VALUE_NULL;
-    env->value.string_value = NULL;
-    env->next = NULL;
-    env->parent = NULL;
-
     return env;
 }
 
@@ -39,13 +139,35 @@ RuntimeValue runtime_value_copy(const RuntimeValue* value) {
 
     switch (value->type) {
         case RUNTIME_VALUE_STRING:
-            if (value->string_value) {
-                copy.string_value = strdup(value->string_value);
-            }
+            // Strings are immutable and shared: a copy is another reference
+            string_retain(value->string_value);
             break;
         case RUNTIME_VALUE_FUNCTION:
-            // For user-defined functions, we assume the function definition is shared
-            // If you need to deep copy functions, implement it here
+            // runtime_free_value releases the name and parameter list, so each
+            // copy needs its own; the body stays shared with the AST
+            if (value->function_value.function_type == FUNCTION_TYPE_USER &&
+                value->function_value.user_function) {
+                const UserDefinedFunction* src = value->function_value.user_function;
+                UserDefinedFunction* dst = (UserDefinedFunction*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(UserDefinedFunction));
+                if (!dst) {
+                    output_sink_error("Error: Memory allocation failed for UserDefinedFunction.\n");
+                    exit(EXIT_FAILURE);
+                }
+                *dst = *src;
+                dst->name = src->name ? ember_strdup(EMBER_MEM_RUNTIME, src->name) : NULL;
+                dst->parameters = (char**)ember_malloc(EMBER_MEM_RUNTIME, sizeof(char*) * (src->parameter_count > 0 ? src->parameter_count : 1));
+                for (int i = 0; i < src->parameter_count; i++) {
+                    dst->parameters[i] = ember_strdup(EMBER_MEM_RUNTIME, src->parameters[i]);
+                }
+                copy.function_value.user_function = dst;
+            }
+            break;
+        case RUNTIME_VALUE_OBJECT:
+            // Objects are shared: a copy is another reference
+            object_retain(value->object_value);
+            break;
+        case RUNTIME_VALUE_ARRAY:
+            array_retain(value->array_value);
             break;
         default:
             // Other types (number, boolean, null) don't require special handling
@@ -55,30 +177,208 @@ RuntimeValue runtime_value_copy(const RuntimeValue* value) {
     return copy;
 }
 
+// Originals already cloned during one runtime_value_clone(), with their
+// clones, so shared and cyclic references come out the same way. Open
+// addressing on the original's address; `capacity` is a power of two.
+typedef struct {
+    const void* original;
+    RuntimeValue clone;
+} CloneEntry;
+
+typedef struct {
+    CloneEntry* entries;
+    size_t count;
+    size_t capacity;
+} CloneMap;
+
+static RuntimeValue clone_value(const RuntimeValue* value, CloneMap* seen);
+
+static size_t clone_map_slot(const CloneMap* seen, const void* original) {
+    size_t mask = seen->capacity - 1;
+    size_t slot = (size_t)(((uintptr_t)original >> 4) * 0x9E3779B97F4A7C15ull) & mask;
+    while (seen->entries[slot].original && seen->entries[slot].original != original) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static const RuntimeValue* clone_map_find(const CloneMap* seen, const void* original) {
+    if (seen->count == 0) {
+        return NULL;
+    }
+    const CloneEntry* entry = &seen->entries[clone_map_slot(seen, original)];
+    return entry->original ? &entry->clone : NULL;
+}
+
+static bool clone_map_add(CloneMap* seen, const void* original, RuntimeValue clone) {
+    if ((seen->count + 1) * 2 > seen->capacity) {
+        CloneMap grown = { NULL, 0, seen->capacity < 16 ? 16 : seen->capacity * 2 };
+        grown.entries = (CloneEntry*)ember_calloc(EMBER_MEM_RUNTIME, grown.capacity, sizeof(CloneEntry));
+        if (!grown.entries) {
+            output_sink_error("Error: Memory allocation failed while cloning a value.\n");
+            return false;
+        }
+        for (size_t i = 0; i < seen->capacity; i++) {
+            if (seen->entries[i].original) {
+                grown.entries[clone_map_slot(&grown, seen->entries[i].original)] = seen->entries[i];
+            }
+        }
+        grown.count = seen->count;
+        ember_free(seen->entries);
+        *seen = grown;
+    }
+    CloneEntry* entry = &seen->entries[clone_map_slot(seen, original)];
+    entry->original = original;
+    entry->clone = clone;
+    seen->count++;
+    return true;
+}
+
+typedef struct {
+    ScriptObject* clone;
+    CloneMap* seen;
+} ObjectCloneContext;
+
+static void clone_property(const char* key, RuntimeValue* value, void* context) {
+    ObjectCloneContext* ctx = (ObjectCloneContext*)context;
+    object_set(ctx->clone, key, clone_value(value, ctx->seen));
+}
+
+static RuntimeValue clone_value(const RuntimeValue* value, CloneMap* seen) {
+    const void* original;
+    if (value->type == RUNTIME_VALUE_ARRAY) {
+        original = value->array_value;
+    } else if (value->type == RUNTIME_VALUE_OBJECT) {
+        original = value->object_value;
+    } else {
+        return runtime_value_copy(value);
+    }
+    const RuntimeValue* done = clone_map_find(seen, original);
+    if (done) {
+        return runtime_value_copy(done);
+    }
+
+    RuntimeValue clone = *value;
+    if (value->type == RUNTIME_VALUE_ARRAY) {
+        const ScriptArray* array = value->array_value;
+        if (array_kind(array) == ARRAY_KIND_DOUBLE) {
+            // Numbers only: nothing inside to clone
+            clone.array_value = array_slice(array, 0, array_count(array));
+            return clone.array_value ? clone : (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+        }
+        clone.array_value = array_create(array_count(array));
+        if (!clone.array_value || !clone_map_add(seen, original, clone)) {
+            runtime_free_value(&clone);
+            return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+        }
+        for (int i = 0; i < array_count(array); i++) {
+            RuntimeValue element = array_get(array, i);
+            RuntimeValue copy = clone_value(&element, seen);
+            if (!array_push(clone.array_value, copy)) {
+                runtime_free_value(&copy);
+            }
+        }
+        return clone;
+    }
+
+    clone.object_value = object_create();
+    if (!clone.object_value || !clone_map_add(seen, original, clone)) {
+        runtime_free_value(&clone);
+        return (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+    }
+    ObjectCloneContext context = { clone.object_value, seen };
+    object_for_each(value->object_value, clone_property, &context);
+    return clone;
+}
+
+RuntimeValue runtime_value_clone(const RuntimeValue* value) {
+    CloneMap seen = { NULL, 0, 0 };
+    RuntimeValue clone = clone_value(value, &seen);
+    ember_free(seen.entries);
+    return clone;
+}
+
+Environment* runtime_snapshot_environment(Environment* env) {
+    Environment* snapshot = runtime_create_environment();
+    if (!snapshot) {
+        return NULL;
+    }
+
+    // Innermost bindings win; outer ones they shadow are skipped
+    for (Environment* scope = env; scope; scope = scope->parent) {
+        for (Environment* var = scope->next; var; var = var->next) {
+            if (!var->variable_name) {
+                continue;
+            }
+            bool shadowed = false;
+            for (Environment* seen = snapshot->next; seen; seen = seen->next) {
+                if (strcmp(seen->variable_name, var->variable_name) == 0) {
+                    shadowed = true;
+                    break;
+                }
+            }
+            if (shadowed) {
+                continue;
+            }
+            // Arrays and objects are shared by reference; the snapshot gets
+            // its own so nothing run against it can reach the caller's
+            RuntimeValue clone = runtime_value_clone(&var->value);
+            runtime_set_variable(snapshot, var->variable_name, clone);
+            runtime_free_value(&clone);
+        }
+    }
+    return snapshot;
+}
+
+void runtime_share_environment(Environment* env) {
+    env->shared = true;
+}
+
 Environment* runtime_create_child_environment(Environment* parent) {
-    // Allocate memory for the new child environment
-    Environment* child_env = (Environment*)malloc(sizeof(Environment));
+    Environment* child_env = env_node_acquire();
     if (!child_env) {
-        fprintf(stderr, "Error: Memory allocation failed for child environment.\n");
+        output_sink_error("Error: Memory allocation failed for child environment.\n");
         exit(EXIT_FAILURE);
     }
-
-    // Initialize the child environment
-    child_env->variable_name = NULL;
-    child_env->value = (RuntimeValue){.type = RUNTIME_VALUE_NULL};
-    child_env->next = NULL;
     child_env->parent = parent;
-
     return child_env;
 }
 
+Environment* runtime_create_frame(Environment* parent, int slot_hint) {
+    // One node for the frame header plus one per expected variable
+    env_pool_reserve(slot_hint + 1);
+    return runtime_create_child_environment(parent);
+}
+
+// Prepend a new binding to the current environment's linked list
+static void runtime_add_variable(Environment* env, const char* name, RuntimeValue value) {
+    Environment* new_var = env_node_acquire();
+    if (!new_var) {
+        output_sink_error("Error: Memory allocation failed for new variable.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!env_node_set_name(new_var, name)) {
+        output_sink_error("Error: Memory allocation failed for variable name.\n");
+        exit(EXIT_FAILURE);
+    }
+    new_var->value = runtime_value_copy(&value);
+    new_var->next = env->next;
+    env->next = new_var;
+}
+
 void runtime_set_variable(Environment* env, const char* name, RuntimeValue value) {
     // Search for the variable in the current environment or parent environments
     Environment* current_env = env;
+    Environment* below = NULL;
     while (current_env) {
         Environment* var = current_env->next;
         while (var) {
             if (var->variable_name && strcmp(var->variable_name, name) == 0) {
+                if (current_env->shared && below) {
+                    // Shadow the read-only binding in the scope below it
+                    runtime_add_variable(below, name, value);
+                    return;
+                }
                 // Variable exists; update its value
                 runtime_free_value(&var->value);
                 var->value = runtime_value_copy(&value);
@@ -86,54 +386,93 @@ void runtime_set_variable(Environment* env, const char* name, RuntimeValue value
             }
             var = var->next;
         }
+        below = current_env;
         current_env = current_env->parent;
     }
 
     // Variable does not exist in the current environment; create it
-    Environment* new_var = (Environment*)malloc(sizeof(Environment));
-    if (!new_var) {
-        fprintf(stderr, "Error: Memory allocation failed for new variable.\n");
-        exit(EXIT_FAILURE);
-    }
+    runtime_add_variable(env, name, value);
+}
 
-    // Initialize the new variable
-    new_var->variable_name = strdup(name);
-    if (!new_var->variable_name) {
-        fprintf(stderr, "Error: Memory allocation failed for variable name.\n");
-        exit(EXIT_FAILURE);
+// Bind `name` in `env` itself, shadowing any binding in a parent scope
+static void runtime_bind_local(Environment* env, const char* name, RuntimeValue value) {
+    for (Environment* var = env->next; var; var = var->next) {
+        if (var->variable_name && strcmp(var->variable_name, name) == 0) {
+            runtime_free_value(&var->value);
+            var->value = runtime_value_copy(&value);
+            return;
+        }
     }
 
-    new_var->value = runtime_value_copy(&value);
-    new_var->next = env->next;
-    new_var->parent = NULL;
-
-    // Add the new variable to the current environment's linked list
-    env->next = new_var;
+    runtime_add_variable(env, name, value);
 }
 
 RuntimeValue* runtime_get_variable(Environment* env, const char* name) {
     Environment* current_env = env;
+    Environment* below = NULL;
 
     while (current_env) {
         Environment* var = current_env->next;
         while (var) {
             if (var->variable_name && strcmp(var->variable_name, name) == 0) {
+                if (current_env->shared && below &&
+                    (var->value.type == RUNTIME_VALUE_ARRAY || var->value.type == RUNTIME_VALUE_OBJECT)) {
+                    // Arrays and objects can be changed in place, so the
+                    // reader gets its own
+                    RuntimeValue clone = runtime_value_clone(&var->value);
+                    if (clone.type == RUNTIME_VALUE_NULL) {
+                        return NULL;
+                    }
+                    runtime_add_variable(below, name, clone);
+                    runtime_free_value(&clone);
+                    return &below->next->value;
+                }
                 return &var->value;
             }
             var = var->next;
         }
+        below = current_env;
         current_env = current_env->parent;
     }
 
     return NULL;
 }
 
+// Count `var` declarations reachable from a function body without crossing
+// into nested function definitions. Used to pre-size call frames.
+static int runtime_count_locals(const ASTNode* node) {
+    if (!node) {
+        return 0;
+    }
+    switch (node->type) {
+        case AST_VARIABLE_DECL:
+            return 1;
+        case AST_BLOCK: {
+            int count = 0;
+            for (int i = 0; i < node->block.statement_count; i++) {
+                count += runtime_count_locals(node->block.statements[i]);
+            }
+            return count;
+        }
+        case AST_IF_STATEMENT:
+            return runtime_count_locals(node->if_statement.body) +
+                   runtime_count_locals(node->if_statement.else_body);
+        case AST_WHILE_LOOP:
+            return runtime_count_locals(node->while_loop.body);
+        case AST_FOR_LOOP:
+            return runtime_count_locals(node->for_loop.initializer) +
+                   runtime_count_locals(node->for_loop.body);
+        default:
+            return 0;
+    }
+}
+
 RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
     RuntimeValue result;
     result.type = RUNTIME_VALUE_NULL;
 
     if (!node) {
-        fprintf(stderr, "Error: Attempted to evaluate a NULL AST node.\n");
+        output_sink_error("Error: Attempted to evaluate a NULL AST node.\n");
         return result;
     }
 
@@ -142,11 +481,11 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
             switch (node->literal.token_type) {
                 case TOKEN_NUMBER:
                     result.type = RUNTIME_VALUE_NUMBER;
-                    result.number_value = atof(node->literal.value);
+                    result.number_value = node->literal.number;
                     break;
                 case TOKEN_STRING:
                     result.type = RUNTIME_VALUE_STRING;
-                    result.string_value = strdup(node->literal.value);
+                    result.string_value = string_from_cstr(node->literal.value);
                     break;
                 case TOKEN_BOOLEAN:
                     result.type = RUNTIME_VALUE_BOOLEAN;
@@ -156,7 +495,7 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                     result.type = RUNTIME_VALUE_NULL;
                     break;
                 default:
-                    fprintf(stderr, "Error: Unknown literal type.\n");
+                    output_sink_error("Error: Unknown literal type.\n");
                     break;
             }
             break;
@@ -192,26 +531,21 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                     result.type = RUNTIME_VALUE_NUMBER;
                     result.number_value = left.number_value + right.number_value;
                 } else {
-                    // String concatenation or mixed types
-                    char* left_str = runtime_value_to_string(&left);
-                    char* right_str = runtime_value_to_string(&right);
-                    size_t total_length = strlen(left_str) + strlen(right_str) + 1;
-                    char* concatenated = (char*)malloc(total_length);
+                    // String concatenation or mixed types; strings are read
+                    // in place, anything else is formatted into scratch space
+                    char left_scratch[RUNTIME_VALUE_TEXT_SIZE];
+                    char right_scratch[RUNTIME_VALUE_TEXT_SIZE];
+                    size_t left_length, right_length;
+                    const char* left_text = runtime_value_text(&left, left_scratch, &left_length);
+                    const char* right_text = runtime_value_text(&right, right_scratch, &right_length);
+                    ScriptString* concatenated = string_concat(left_text, left_length, right_text, right_length);
                     if (!concatenated) {
-                        fprintf(stderr, "Error: Memory allocation failed for string concatenation.\n");
-                        free(left_str);
-                        free(right_str);
+                        output_sink_error("Error: Memory allocation failed for string concatenation.\n");
                         result.type = RUNTIME_VALUE_NULL;
-                        break;
+                    } else {
+                        result.type = RUNTIME_VALUE_STRING;
+                        result.string_value = concatenated;
                     }
-                    strcpy(concatenated, left_str);
-                    strcat(concatenated, right_str);
-
-                    result.type = RUNTIME_VALUE_STRING;
-                    result.string_value = concatenated;
-
-                    free(left_str);
-                    free(right_str);
                 }
             } else if (strcmp(op, "-") == 0 || strcmp(op, "*") == 0 || strcmp(op, "/") == 0 || strcmp(op, "%") == 0) {
                 // Numeric operations
@@ -223,7 +557,7 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                         result.number_value = left.number_value * right.number_value;
                     } else if (strcmp(op, "/") == 0) {
                         if (right.number_value == 0) {
-                            fprintf(stderr, "Error: Division by zero.\n");
+                            output_sink_error("Error: Division by zero.\n");
                             result.type = RUNTIME_VALUE_NULL;
                         } else {
                             result.number_value = left.number_value / right.number_value;
@@ -232,7 +566,7 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                         result.number_value = fmod(left.number_value, right.number_value);
                     }
                 } else {
-                    fprintf(stderr, "Error: Operator '%s' requires numeric operands.\n", op);
+                    output_sink_error("Error: Operator '%s' requires numeric operands.\n", op);
                     result.type = RUNTIME_VALUE_NULL;
                 }
             } else if (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) {
@@ -245,7 +579,7 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                     } else if (left.type == RUNTIME_VALUE_BOOLEAN) {
                         result.boolean_value = (left.boolean_value == right.boolean_value);
                     } else if (left.type == RUNTIME_VALUE_STRING) {
-                        result.boolean_value = (strcmp(left.string_value, right.string_value) == 0);
+                        result.boolean_value = string_equals(left.string_value, right.string_value);
                     } else if (left.type == RUNTIME_VALUE_NULL) {
                         result.boolean_value = true; // Both are null
                     } else {
@@ -274,7 +608,7 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                         result.boolean_value = left.number_value >= right.number_value;
                     }
                 } else {
-                    fprintf(stderr, "Error: Operator '%s' requires numeric operands.\n", op);
+                    output_sink_error("Error: Operator '%s' requires numeric operands.\n", op);
                     result.type = RUNTIME_VALUE_NULL;
                 }
             } else if (strcmp(op, "&&") == 0 || strcmp(op, "||") == 0) {
@@ -287,29 +621,32 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                         result.boolean_value = left.boolean_value || right.boolean_value;
                     }
                 } else {
-                    fprintf(stderr, "Error: Operator '%s' requires boolean operands.\n", op);
+                    output_sink_error("Error: Operator '%s' requires boolean operands.\n", op);
                     result.type = RUNTIME_VALUE_NULL;
                 }
             } else {
-                fprintf(stderr, "Error: Unknown binary operator '%s'.\n", op);
+                output_sink_error("Error: Unknown binary operator '%s'.\n", op);
                 result.type = RUNTIME_VALUE_NULL;
             }
+            runtime_free_value(&left);
+            runtime_free_value(&right);
             break;
         }
         case AST_FUNCTION_DEF: {
             // Create a UserDefinedFunction structure
-            UserDefinedFunction* user_function = (UserDefinedFunction*)malloc(sizeof(UserDefinedFunction));
+            UserDefinedFunction* user_function = (UserDefinedFunction*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(UserDefinedFunction));
             if (!user_function) {
-                fprintf(stderr, "Error: Memory allocation failed for UserDefinedFunction.\n");
+                output_sink_error("Error: Memory allocation failed for UserDefinedFunction.\n");
                 exit(EXIT_FAILURE);
             }
 
-            user_function->name = strdup(node->function_def.function_name);
+            user_function->name = ember_strdup(EMBER_MEM_RUNTIME, node->function_def.function_name);
             user_function->parameter_count = node->function_def.parameter_count;
-            user_function->parameters = (char**)malloc(sizeof(char*) * user_function->parameter_count);
+            user_function->parameters = (char**)ember_malloc(EMBER_MEM_RUNTIME, sizeof(char*) * user_function->parameter_count);
             for (int i = 0; i < user_function->parameter_count; i++) {
-                user_function->parameters[i] = strdup(node->function_def.parameters[i]);
+                user_function->parameters[i] = ember_strdup(EMBER_MEM_RUNTIME, node->function_def.parameters[i]);
             }
+            user_function->local_count = runtime_count_locals(node->function_def.body);
             user_function->body = node->function_def.body;
 
             // Create a RuntimeValue to store the function
@@ -318,8 +655,9 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
             function_value.function_value.function_type = FUNCTION_TYPE_USER;
             function_value.function_value.user_function = user_function;
 
-            // Register the function in the environment
+            // Register the function in the environment (it stores its own copy)
             runtime_set_variable(env, user_function->name, function_value);
+            runtime_free_value(&function_value);
 
             // The result is null
             result.type = RUNTIME_VALUE_NULL;
@@ -329,13 +667,23 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
             result = runtime_execute_function_call(env, node);
             break;
         }
+        case AST_RETURN: {
+            RuntimeValue value = { .type = RUNTIME_VALUE_NULL };
+            if (node->return_stmt.value) {
+                value = runtime_evaluate(env, node->return_stmt.value);
+            }
+            runtime_free_value(&return_value);
+            return_value = value;
+            return_pending = true;
+            break;
+        }
         case AST_IMPORT: {
             // node->import_stmt.import_path => e.g. "items.ember"
             bool ok = runtime_execute_file_in_environment(env, 
                                  node->import_stmt.import_path);
             if (!ok) {
-                fprintf(stderr, "Error: Failed to import '%s'\n",
-                        node->import_stmt.import_path);
+                output_sink_error("Error: Failed to import '%s'\n",
+                                  node->import_stmt.import_path);
             }
             // keep result=null
             break;
@@ -347,19 +695,20 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                     result.type = RUNTIME_VALUE_BOOLEAN;
                     result.boolean_value = !operand.boolean_value;
                 } else {
-                    fprintf(stderr, "Error: '!' operator requires a boolean operand.\n");
+                    output_sink_error("Error: '!' operator requires a boolean operand.\n");
                     result.type = RUNTIME_VALUE_NULL;
                 }
             } else {
-                fprintf(stderr, "Error: Unknown unary operator '%s'.\n", node->unary_op.op_symbol);
+                output_sink_error("Error: Unknown unary operator '%s'.\n", node->unary_op.op_symbol);
                 result.type = RUNTIME_VALUE_NULL;
             }
+            runtime_free_value(&operand);
             break;
         }
         case AST_VARIABLE: {
             RuntimeValue* value = runtime_get_variable(env, node->variable.variable_name);
             if (!value) {
-                fprintf(stderr, "Error: Undefined variable '%s'.\n", node->variable.variable_name);
+                output_sink_error("Error: Undefined variable '%s'.\n", node->variable.variable_name);
                 result.type = RUNTIME_VALUE_NULL;
             } else {
                 result = runtime_value_copy(value); // Return a copy to avoid sharing the same pointer
@@ -367,28 +716,22 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
             break;
         }
         case AST_ARRAY_LITERAL: {
-            // We have an array literal: we want to create a RUNTIME_VALUE_ARRAY
-            // with elements.
             int count = node->array_literal.element_count;
-
-            // Allocate a new array to store the evaluated elements
-            RuntimeValue* elementValues = malloc(sizeof(RuntimeValue) * count);
-            if (!elementValues) {
-                fprintf(stderr, "Error: Memory allocation failed for array literal\n");
+            ScriptArray* array = array_create(count);
+            if (!array) {
                 break;
             }
 
-            // Evaluate each child expression
+            // Numbers stay unboxed until the first element that is not one
             for (int i = 0; i < count; i++) {
-                ASTNode* elemNode = node->array_literal.elements[i];
-                elementValues[i] = runtime_evaluate(env, elemNode);
-                // You may or may not want to do further checks here
+                RuntimeValue element = runtime_evaluate(env, node->array_literal.elements[i]);
+                if (!array_push(array, element)) {
+                    runtime_free_value(&element);
+                }
             }
 
-            // Populate the result as an array
             result.type = RUNTIME_VALUE_ARRAY;
-            result.array_value.elements = elementValues;
-            result.array_value.count    = count;
+            result.array_value = array;
             break;
         }
         case AST_INDEX_ACCESS: {
@@ -398,41 +741,139 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
             // Evaluate the index expression
             RuntimeValue indexVal = runtime_evaluate(env, node->index_access.index_expr);
 
+            // obj["key"] reads a property; missing ones are null
+            if (arrayVal.type == RUNTIME_VALUE_OBJECT) {
+                if (indexVal.type != RUNTIME_VALUE_STRING) {
+                    output_sink_error("Error: Object keys must be strings.\n");
+                } else {
+                    RuntimeValue* slot = object_get(arrayVal.object_value, string_cstr(indexVal.string_value));
+                    if (slot) {
+                        result = runtime_value_copy(slot);
+                    }
+                }
+                runtime_free_value(&arrayVal);
+                runtime_free_value(&indexVal);
+                break;
+            }
+
             // Check that arrayVal is actually an array
             if (arrayVal.type != RUNTIME_VALUE_ARRAY) {
-                fprintf(stderr, "Error: Attempted indexing on non-array type.\n");
+                output_sink_error("Error: Attempted indexing on non-array type.\n");
+                runtime_free_value(&arrayVal);
+                runtime_free_value(&indexVal);
                 result.type = RUNTIME_VALUE_NULL;
                 break;
             }
 
             // Check that indexVal is a number
             if (indexVal.type != RUNTIME_VALUE_NUMBER) {
-                fprintf(stderr, "Error: Array index must be numeric.\n");
+                output_sink_error("Error: Array index must be numeric.\n");
+                runtime_free_value(&arrayVal);
+                runtime_free_value(&indexVal);
                 result.type = RUNTIME_VALUE_NULL;
                 break;
             }
 
             // Convert the index to an integer
             int idx = (int)indexVal.number_value;
-            if (idx < 0 || idx >= arrayVal.array_value.count) {
-                fprintf(stderr, "Error: Array index %d out of bounds.\n", idx);
+            if (idx < 0 || idx >= array_count(arrayVal.array_value)) {
+                output_sink_error("Error: Array index %d out of bounds.\n", idx);
+                runtime_free_value(&arrayVal);
                 result.type = RUNTIME_VALUE_NULL;
                 break;
             }
 
-            // The array's elements are stored in arrayVal.array_value.elements
-            // so we retrieve the element at idx
-            RuntimeValue element = arrayVal.array_value.elements[idx];
-
-            // We typically *copy* the element if your language semantics treat them as distinct
-            // For a shallow approach, you might do:
+            // Copy the element out: the array keeps its own
+            RuntimeValue element = array_get(arrayVal.array_value, idx);
             result = runtime_value_copy(&element);
-
+            runtime_free_value(&arrayVal);
+            break;
+        }
+        case AST_OBJECT_LITERAL: {
+            ScriptObject* object = object_create();
+            if (!object) {
+                break;
+            }
+            // Properties are added in source order, so literals written the
+            // same way share a shape
+            for (int i = 0; i < node->object_literal.property_count; i++) {
+                RuntimeValue value = runtime_evaluate(env, node->object_literal.values[i]);
+                object_set(object, node->object_literal.keys[i], value);
+            }
+            result.type = RUNTIME_VALUE_OBJECT;
+            result.object_value = object;
+            break;
+        }
+        case AST_PROPERTY_ACCESS: {
+            RuntimeValue target = runtime_evaluate(env, node->property_access.object_expr);
+            if (target.type != RUNTIME_VALUE_OBJECT) {
+                output_sink_error("Error: Cannot read property '%s' of a non-object.\n",
+                                  node->property_access.property_name);
+                runtime_free_value(&target);
+                break;
+            }
+            // Missing properties read as null
+            RuntimeValue* slot = object_get(target.object_value, node->property_access.property_name);
+            if (slot) {
+                result = runtime_value_copy(slot);
+            }
+            runtime_free_value(&target);
+            break;
+        }
+        case AST_PROPERTY_ASSIGNMENT: {
+            RuntimeValue target = runtime_evaluate(env, node->property_assignment.object_expr);
+            RuntimeValue value = runtime_evaluate(env, node->property_assignment.value);
+            if (target.type != RUNTIME_VALUE_OBJECT) {
+                output_sink_error("Error: Cannot set property '%s' on a non-object.\n",
+                                  node->property_assignment.property_name);
+                runtime_free_value(&target);
+                runtime_free_value(&value);
+                break;
+            }
+            object_set(target.object_value, node->property_assignment.property_name,
+                       runtime_value_copy(&value));
+            runtime_free_value(&target);
+            result = value;
+            break;
+        }
+        case AST_INDEX_ASSIGNMENT: {
+            RuntimeValue target = runtime_evaluate(env, node->index_assignment.array_expr);
+            RuntimeValue indexVal = runtime_evaluate(env, node->index_assignment.index_expr);
+            RuntimeValue value = runtime_evaluate(env, node->index_assignment.value);
+            if (target.type == RUNTIME_VALUE_OBJECT) {
+                if (indexVal.type != RUNTIME_VALUE_STRING) {
+                    output_sink_error("Error: Object keys must be strings.\n");
+                    runtime_free_value(&value);
+                } else {
+                    object_set(target.object_value, string_cstr(indexVal.string_value), runtime_value_copy(&value));
+                    result = value;
+                }
+            } else if (target.type == RUNTIME_VALUE_ARRAY) {
+                // Array copies share their elements, so this writes through
+                int idx = indexVal.type == RUNTIME_VALUE_NUMBER ? (int)indexVal.number_value : -1;
+                if (indexVal.type != RUNTIME_VALUE_NUMBER) {
+                    output_sink_error("Error: Array index must be numeric.\n");
+                    runtime_free_value(&value);
+                } else if (idx < 0 || idx >= array_count(target.array_value)) {
+                    output_sink_error("Error: Array index %d out of bounds.\n", idx);
+                    runtime_free_value(&value);
+                } else {
+                    array_set(target.array_value, idx, runtime_value_copy(&value));
+                    result = value;
+                }
+            } else {
+                output_sink_error("Error: Attempted indexing on non-array type.\n");
+                runtime_free_value(&value);
+            }
+            runtime_free_value(&target);
+            runtime_free_value(&indexVal);
             break;
         }
         case AST_IF_STATEMENT: {
             RuntimeValue condition = runtime_evaluate(env, node->if_statement.condition);
-            if (condition.type == RUNTIME_VALUE_BOOLEAN && condition.boolean_value) {
+            bool taken = condition.type == RUNTIME_VALUE_BOOLEAN && condition.boolean_value;
+            runtime_free_value(&condition);
+            if (taken) {
                 runtime_execute_block(env, node->if_statement.body);
             }
             result.type = RUNTIME_VALUE_NULL;
@@ -444,7 +885,8 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
 
             // Execute initializer if it exists
             if (node->for_loop.initializer) {
-                runtime_evaluate(loop_env, node->for_loop.initializer);
+                RuntimeValue discarded = runtime_evaluate(loop_env, node->for_loop.initializer);
+                runtime_free_value(&discarded);
             }
 
             // Loop condition
@@ -452,17 +894,23 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
                 // Evaluate condition if it exists
                 if (node->for_loop.condition) {
                     RuntimeValue condition = runtime_evaluate(loop_env, node->for_loop.condition);
-                    if (condition.type != RUNTIME_VALUE_BOOLEAN || !condition.boolean_value) {
+                    bool taken = condition.type == RUNTIME_VALUE_BOOLEAN && condition.boolean_value;
+                    runtime_free_value(&condition);
+                    if (!taken) {
                         break;
                     }
                 }
 
                 // Execute loop body
                 runtime_execute_block(loop_env, node->for_loop.body);
+                if (return_pending) {
+                    break;
+                }
 
                 // Execute increment if it exists
                 if (node->for_loop.increment) {
-                    runtime_evaluate(loop_env, node->for_loop.increment);
+                    RuntimeValue discarded = runtime_evaluate(loop_env, node->for_loop.increment);
+                    runtime_free_value(&discarded);
                 }
             }
 
@@ -475,16 +923,21 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
         case AST_WHILE_LOOP: {
             while (true) {
                 RuntimeValue condition = runtime_evaluate(env, node->while_loop.condition);
-                if (condition.type != RUNTIME_VALUE_BOOLEAN || !condition.boolean_value) {
+                bool taken = condition.type == RUNTIME_VALUE_BOOLEAN && condition.boolean_value;
+                runtime_free_value(&condition);
+                if (!taken) {
                     break;
                 }
                 runtime_execute_block(env, node->while_loop.body);
+                if (return_pending) {
+                    break;
+                }
             }
             result.type = RUNTIME_VALUE_NULL;
             break;
         }
         default:
-            fprintf(stderr, "Error: Unhandled AST node type %d.\n", node->type);
+            output_sink_error("Error: Unhandled AST node type %d.\n", node->type);
             result.type = RUNTIME_VALUE_NULL;
             break;
     }
@@ -494,13 +947,15 @@ RuntimeValue runtime_evaluate(Environment* env, ASTNode* node) {
 
 void runtime_execute_block(Environment* env, ASTNode* block) {
     if (!block || block->type != AST_BLOCK) {
-        fprintf(stderr, "Error: Invalid block node provided for execution.\n");
+        output_sink_error("Error: Invalid block node provided for execution.\n");
         return;
     }
 
-    for (int i = 0; i < block->block.statement_count; i++) {
+    for (int i = 0; i < block->block.statement_count && !return_pending; i++) {
         ASTNode* statement = block->block.statements[i];
-        runtime_evaluate(env, statement);
+        // A statement's own value (e.g. an assignment's) is not kept
+        RuntimeValue discarded = runtime_evaluate(env, statement);
+        runtime_free_value(&discarded);
     }
 }
 
@@ -508,7 +963,7 @@ bool runtime_execute_file_in_environment(Environment* env, const char* filename)
     // 1) Read file
     char* script_content = read_file(filename);
     if (!script_content) {
-        fprintf(stderr, "Error: Could not open import file '%s'\n", filename);
+        output_sink_error("Error: Could not open import file '%s'\n", filename);
         return false;
     }
 
@@ -517,99 +972,106 @@ bool runtime_execute_file_in_environment(Environment* env, const char* filename)
     lexer_init(&lex, script_content);
     Parser* p = parser_create(&lex);
     ASTNode* root = parse_script(p);
-    free(p); // free parser struct if needed
+    ember_free(p); // free parser struct if needed
 
     if (!root) {
-        fprintf(stderr, "Error: Parsing import file '%s' failed.\n", filename);
-        free(script_content);
+        output_sink_error("Error: Parsing import file '%s' failed.\n", filename);
+        ember_free(script_content);
         return false;
     }
 
     // 3) Evaluate the top-level AST in the SAME environment
     //    which merges the variables and functions into the current environment.
     runtime_execute_block(env, root);
-    // or if parse_script returns a block node, we can do:
-    // runtime_execute_block(env, root);
+    // A top-level `return` only ends this file
+    RuntimeValue discarded = runtime_take_return_value();
+    runtime_free_value(&discarded);
 
     free_ast(root);
-    free(script_content);
+    ember_free(script_content);
     return true;
 }
 
-RuntimeValue runtime_execute_function_call(Environment* env, ASTNode* function_call) {
-    const char* function_name = function_call->function_call.function_name;
-
-   // Retrieve the function from the environment
-    RuntimeValue* function_value = runtime_get_variable(env, function_name);
-    if (function_value && function_value->type == RUNTIME_VALUE_FUNCTION) {
-        if (function_value->function_value.function_type == FUNCTION_TYPE_BUILTIN) {
-            // Built-in function
-            BuiltinFunction builtin_function = function_value->function_value.builtin_function;
-            
-            int arg_count = function_call->function_call.argument_count;
-            RuntimeValue* args = (RuntimeValue*)malloc(arg_count * sizeof(RuntimeValue));
-            if (!args) {
-                fprintf(stderr, "Error: Memory allocation failed for function arguments.\n");
-                RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
-                return result;
-            }
-
-            // Evaluate arguments
-            for (int i = 0; i < arg_count; i++) {
-                args[i] = runtime_evaluate(env, function_call->function_call.arguments[i]);
-            }
+RuntimeValue runtime_call_function(Environment* env, const RuntimeValue* function,
+                                   RuntimeValue* args, int arg_count) {
+    RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
 
-            // Execute the built-in function
-            RuntimeValue result = builtin_function(env, args, arg_count);
+    if (!function || function->type != RUNTIME_VALUE_FUNCTION) {
+        output_sink_error("Error: Attempted to call a non-function value.\n");
+        return result;
+    }
 
-            // Free the allocated memory
-            free(args);
+    if (function->function_value.function_type == FUNCTION_TYPE_BUILTIN) {
+        return function->function_value.builtin_function(env, args, arg_count);
+    }
+    if (function->function_value.function_type != FUNCTION_TYPE_USER) {
+        output_sink_error("Error: Compiled functions can only be called from the VM.\n");
+        return result;
+    }
 
-            return result;
+    UserDefinedFunction* user_function = function->function_value.user_function;
 
-        } else if (function_value->function_value.function_type == FUNCTION_TYPE_USER) {
-            // User-defined function
-            UserDefinedFunction* user_function = function_value->function_value.user_function;
+    // Create a frame sized for the function's parameters and locals
+    Environment* child_env = runtime_create_frame(
+        env, user_function->parameter_count + user_function->local_count);
 
-            // Create a child environment for the function
-            Environment* child_env = runtime_create_child_environment(env);
+    // Map parameters to argument values; missing arguments are null. Parameters
+    // are always local, even when the caller has a variable of the same name.
+    for (int i = 0; i < user_function->parameter_count; i++) {
+        RuntimeValue arg_value = (i < arg_count) ? args[i] : (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
+        runtime_bind_local(child_env, user_function->parameters[i], arg_value);
+    }
 
-            // Map parameters to argument values
-            for (int i = 0; i < user_function->parameter_count; i++) {
-                const char* param_name = user_function->parameters[i];
-                RuntimeValue arg_value = (i < function_call->function_call.argument_count)
-                    ? runtime_evaluate(env, function_call->function_call.arguments[i])
-                    : (RuntimeValue){ .type = RUNTIME_VALUE_NULL };
-                runtime_set_variable(child_env, param_name, arg_value);
-            }
+    // Execute the function body; falling off the end returns null
+    runtime_execute_block(child_env, user_function->body);
+    result = runtime_take_return_value();
 
-            // Execute the function body
-            runtime_execute_block(child_env, user_function->body);
+    // Free the child environment
+    runtime_free_environment(child_env);
 
-            // For simplicity, functions return null (you can extend this to support return statements)
-            RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
+    return result;
+}
 
-            // Free the child environment
-            runtime_free_environment(child_env);
+RuntimeValue runtime_execute_function_call(Environment* env, ASTNode* function_call) {
+    const char* function_name = function_call->function_call.function_name;
 
-            return result;
-        }
-    } else {
+   // Retrieve the function from the environment
+    RuntimeValue* function_value = runtime_get_variable(env, function_name);
+    if (!function_value || function_value->type != RUNTIME_VALUE_FUNCTION) {
         // Function not found
-        fprintf(stderr, "Error: Undefined function '%s'.\n", function_name);
+        output_sink_error("Error: Undefined function '%s'.\n", function_name);
         RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
         return result;
     }
 
-    RuntimeValue result;
-    result.type = RUNTIME_VALUE_NULL;
+    int arg_count = function_call->function_call.argument_count;
+    RuntimeValue* args = (RuntimeValue*)ember_malloc(EMBER_MEM_RUNTIME, (arg_count > 0 ? arg_count : 1) * sizeof(RuntimeValue));
+    if (!args) {
+        output_sink_error("Error: Memory allocation failed for function arguments.\n");
+        RuntimeValue result = { .type = RUNTIME_VALUE_NULL };
+        return result;
+    }
+
+    // Evaluate arguments
+    for (int i = 0; i < arg_count; i++) {
+        args[i] = runtime_evaluate(env, function_call->function_call.arguments[i]);
+    }
+
+    RuntimeValue result = runtime_call_function(env, function_value, args, arg_count);
+
+    // The callee copied anything it keeps, so the evaluated arguments are ours
+    for (int i = 0; i < arg_count; i++) {
+        runtime_free_value(&args[i]);
+    }
+    ember_free(args);
+
     return result;
 }
 
 
 void runtime_register_builtin(Environment* env, const char* name, BuiltinFunction function) {
     if (!env || !name || !function) {
-        fprintf(stderr, "Error: Invalid arguments for registering a built-in function.\n");
+        output_sink_error("Error: Invalid arguments for registering a built-in function.\n");
         return;
     }
 
@@ -625,14 +1087,15 @@ void runtime_register_builtin(Environment* env, const char* name, BuiltinFunctio
 
 void runtime_register_function(Environment* env, UserDefinedFunction* function) {
     if (!env || !function || !function->name) {
-        fprintf(stderr, "Error: Invalid arguments for registering a user-defined function.\n");
+        output_sink_error("Error: Invalid arguments for registering a user-defined function.\n");
         return;
     }
 
     // Create a runtime value to store the user-defined function
     RuntimeValue function_value;
-    function_value.type = RUNTIME_VALUE_STRING; // Using string storage to hold the pointer
-    function_value.string_value = (char*)function;
+    function_value.type = RUNTIME_VALUE_FUNCTION;
+    function_value.function_value.function_type = FUNCTION_TYPE_USER;
+    function_value.function_value.user_function = function;
 
     // Add the function to the environment
     runtime_set_variable(env, function->name, function_value);
@@ -640,15 +1103,15 @@ void runtime_register_function(Environment* env, UserDefinedFunction* function)
 
 UserDefinedFunction* runtime_get_function(Environment* env, const char* name) {
     if (!env || !name) {
-        fprintf(stderr, "Error: Invalid arguments for retrieving a user-defined function.\n");
+        output_sink_error("Error: Invalid arguments for retrieving a user-defined function.\n");
         return NULL;
     }
 
     // Search for the function in the environment
     RuntimeValue* value = runtime_get_variable(env, name);
-    if (value && value->type == RUNTIME_VALUE_STRING) {
-        // Assume the string value stores the pointer to the user-defined function
-        return (UserDefinedFunction*)value->string_value;
+    if (value && value->type == RUNTIME_VALUE_FUNCTION &&
+        value->function_value.function_type == FUNCTION_TYPE_USER) {
+        return value->function_value.user_function;
     }
 
     // Function not found
@@ -657,14 +1120,14 @@ UserDefinedFunction* runtime_get_function(Environment* env, const char* name) {
 
 void runtime_error(RuntimeError* error) {
     if (!error) {
-        fprintf(stderr, "Error: A runtime error occurred, but no details were provided.\n");
+        output_sink_error("Error: A runtime error occurred, but no details were provided.\n");
         exit(EXIT_FAILURE);
     }
 
-    fprintf(stderr, "Runtime Error: %s (Line: %d, Column: %d)\n", 
-            error->message ? error->message : "Unknown error", 
-            error->line, 
-            error->column);
+    output_sink_error("Runtime Error: %s (Line: %d, Column: %d)\n", 
+                      error->message ? error->message : "Unknown error", 
+                      error->line, 
+                      error->column);
     
     // Terminate execution
     exit(EXIT_FAILURE);
@@ -673,24 +1136,24 @@ void runtime_error(RuntimeError* error) {
 void runtime_report_error(Environment* env, const char* message, const ASTNode* node) {
     (void)env; // Suppress unused parameter warning
     if (!message || !node) {
-        fprintf(stderr, "Error: runtime_report_error called with invalid arguments.\n");
+        output_sink_error("Error: runtime_report_error called with invalid arguments.\n");
         exit(EXIT_FAILURE);
     }
 
     // Create and populate the runtime error structure
     RuntimeError error;
-    error.message = strdup(message); // Duplicate the message for safety
+    error.message = ember_strdup(EMBER_MEM_RUNTIME, message); // Duplicate the message for safety
     error.line = node->line;         // Assume the ASTNode has line information
     error.column = node->column;     // Assume the ASTNode has column information
 
     // Print the error details
-    fprintf(stderr, "Runtime Error: %s (Line: %d, Column: %d)\n", 
-            error.message, 
-            error.line, 
-            error.column);
+    output_sink_error("Runtime Error: %s (Line: %d, Column: %d)\n", 
+                      error.message, 
+                      error.line, 
+                      error.column);
 
     // Free the duplicated message
-    free(error.message);
+    ember_free(error.message);
 
     // Terminate execution
     exit(EXIT_FAILURE);
@@ -700,16 +1163,11 @@ void runtime_free_environment(Environment* env) {
     while (env) {
         Environment* next = env->next;
 
-        // Free the variable name
-        if (env->variable_name) {
-            free(env->variable_name);
-        }
-
         // Free the value
         runtime_free_value(&env->value);
 
-        // Free the environment itself
-        free(env);
+        // Hand the node (and its name buffer) back to the pool
+        env_node_release(env);
 
         env = next;
     }
@@ -722,26 +1180,32 @@ void runtime_free_value(RuntimeValue* value) {
 
     switch (value->type) {
         case RUNTIME_VALUE_STRING:
-            if (value->string_value) {
-                free(value->string_value);
-                value->string_value = NULL;
-            }
+            string_release(value->string_value);
+            value->string_value = NULL;
             break;
         case RUNTIME_VALUE_FUNCTION:
             if (value->function_value.function_type == FUNCTION_TYPE_USER) {
                 UserDefinedFunction* user_function = value->function_value.user_function;
                 if (user_function) {
-                    free(user_function->name);
+                    ember_free(user_function->name);
                     for (int i = 0; i < user_function->parameter_count; i++) {
-                        free(user_function->parameters[i]);
+                        ember_free(user_function->parameters[i]);
                     }
-                    free(user_function->parameters);
+                    ember_free(user_function->parameters);
                     // Do not free user_function->body here; it's part of the AST and will be freed separately
-                    free(user_function);
+                    ember_free(user_function);
                 }
             }
             // No action needed for built-in functions
             break;
+        case RUNTIME_VALUE_OBJECT:
+            object_release(value->object_value);
+            value->object_value = NULL;
+            break;
+        case RUNTIME_VALUE_ARRAY:
+            array_release(value->array_value);
+            value->array_value = NULL;
+            break;
         default:
             // No action needed for other types
             break;
@@ -765,7 +1229,7 @@ void print_runtime_value(const RuntimeValue* value) {
 
         case RUNTIME_VALUE_STRING:
             if (value->string_value) {
-                printf("String: \"%s\"\n", value->string_value);
+                printf("String: \"%s\"\n", string_cstr(value->string_value));
             } else {
                 printf("String: NULL\n");
             }
@@ -801,104 +1265,115 @@ void runtime_print_environment(const Environment* env) {
 }
 
 char* runtime_value_to_string(const RuntimeValue* value) {
-    if (!value) {
-        return strdup("null");
-    }
+    char scratch[RUNTIME_VALUE_TEXT_SIZE];
+    size_t length;
+    const char* text = runtime_value_text(value, scratch, &length);
+    return ember_strndup(EMBER_MEM_RUNTIME, text, length);
+}
 
-    char* result = NULL;
+const char* runtime_value_text(const RuntimeValue* value, char* scratch, size_t* length) {
+    const char* text;
+    if (!value) {
+        text = "null";
+    } else {
+        switch (value->type) {
+            case RUNTIME_VALUE_NUMBER:
+                *length = number_format(value->number_value, scratch);
+                return scratch;
+
+            case RUNTIME_VALUE_STRING:
+                // Do not add extra quotes
+                *length = string_length(value->string_value);
+                return string_data(value->string_value);
+
+            case RUNTIME_VALUE_BOOLEAN:
+                text = value->boolean_value ? "true" : "false";
+                break;
 
-    switch (value->type) {
-        case RUNTIME_VALUE_NUMBER: {
-            // Allocate enough space for a double value in string form
-            result = (char*)malloc(32);
-            if (result) {
-                snprintf(result, 32, "%.2f", value->number_value);
-            }
-            break;
-        }
+            case RUNTIME_VALUE_NULL:
+                text = "null";
+                break;
 
-        case RUNTIME_VALUE_STRING: {
-            // Do not add extra quotes
-            result = strdup(value->string_value);
-            break;
-        }
+            case RUNTIME_VALUE_OBJECT:
+                text = "[object]";
+                break;
 
-        case RUNTIME_VALUE_BOOLEAN: {
-            // Convert boolean to "true" or "false"
-            result = strdup(value->boolean_value ? "true" : "false");
-            break;
-        }
+            case RUNTIME_VALUE_ARRAY:
+                text = "[array]";
+                break;
 
-        case RUNTIME_VALUE_NULL: {
-            // Return "null" for null values
-            result = strdup("null");
-            break;
-        }
+            case RUNTIME_VALUE_FUNCTION:
+                text = "[function]";
+                break;
 
-        default: {
-            // Handle unexpected types
-            result = strdup("unknown");
-            break;
+            default:
+                text = "unknown";
+                break;
         }
     }
-
-    return result;
+    *length = strlen(text);
+    return text;
 }
 
-// Thread function to execute the block
-static void* thread_execute_block(void* arg) {
+// Pool task: run the block against its private snapshot, then drop it
+static void thread_execute_block(void* arg) {
     ThreadExecutionData* data = (ThreadExecutionData*)arg;
 
     if (!data || !data->env || !data->block) {
-        fprintf(stderr, "Error: Invalid data passed to thread_execute_block.\n");
-        free(data);
-        return NULL;
+        output_sink_error("Error: Invalid data passed to thread_execute_block.\n");
+        ember_free(data);
+        return;
     }
 
-    // Execute the block
     runtime_execute_block(data->env, data->block);
+    RuntimeValue discarded = runtime_take_return_value();
+    runtime_free_value(&discarded);
 
-    // Free the allocated thread data
-    free(data);
-
-    return NULL;
+    runtime_free_environment(data->env);
+    ember_free(data);
 }
 
-void runtime_execute_in_thread(Environment* env, ASTNode* block) {
+ThreadPoolTask* runtime_execute_in_thread(Environment* env, ASTNode* block) {
     if (!env || !block) {
-        fprintf(stderr, "Error: Cannot execute in thread with NULL environment or block.\n");
-        return;
+        output_sink_error("Error: Cannot execute in thread with NULL environment or block.\n");
+        return NULL;
+    }
+
+    ThreadPool* pool = thread_pool_default();
+    if (!pool) {
+        output_sink_error("Error: Thread pool is unavailable.\n");
+        return NULL;
     }
 
     // Allocate memory for thread data
-    ThreadExecutionData* data = (ThreadExecutionData*)malloc(sizeof(ThreadExecutionData));
+    ThreadExecutionData* data = (ThreadExecutionData*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(ThreadExecutionData));
     if (!data) {
-        fprintf(stderr, "Error: Failed to allocate memory for thread data.\n");
-        return;
+        output_sink_error("Error: Failed to allocate memory for thread data.\n");
+        return NULL;
     }
 
-    // Initialize the thread data
-    data->env = env;
+    // Take the snapshot here, on the caller's thread, so the task never
+    // touches the caller's environment
+    data->env = runtime_snapshot_environment(env);
     data->block = block;
-
-    // Create a new thread
-    pthread_t thread;
-    int result = pthread_create(&thread, NULL, thread_execute_block, data);
-    if (result != 0) {
-        fprintf(stderr, "Error: Failed to create thread (error code %d).\n", result);
-        free(data);
-        return;
+    if (!data->env) {
+        ember_free(data);
+        return NULL;
     }
 
-    // Detach the thread so it cleans up automatically
-    pthread_detach(thread);
+    ThreadPoolTask* task = thread_pool_submit(pool, thread_execute_block, data);
+    if (!task) {
+        runtime_free_environment(data->env);
+        ember_free(data);
+    }
+    return task;
 }
 
 GarbageCollector* runtime_gc_init() {
     // Allocate memory for the GarbageCollector
-    GarbageCollector* gc = (GarbageCollector*)malloc(sizeof(GarbageCollector));
+    GarbageCollector* gc = (GarbageCollector*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(GarbageCollector));
     if (!gc) {
-        fprintf(stderr, "Error: Failed to allocate memory for garbage collector.\n");
+        output_sink_error("Error: Failed to allocate memory for garbage collector.\n");
         return NULL;
     }
 
@@ -912,16 +1387,16 @@ GarbageCollector* runtime_gc_init() {
 
 void runtime_gc_track(GarbageCollector* gc, RuntimeValue value) {
     if (!gc) {
-        fprintf(stderr, "Error: Garbage collector is NULL.\n");
+        output_sink_error("Error: Garbage collector is NULL.\n");
         return;
     }
 
     // Resize the tracked values array if necessary
     if (gc->value_count >= gc->value_capacity) {
         size_t new_capacity = gc->value_capacity == 0 ? 16 : gc->value_capacity * 2;
-        RuntimeValue* new_values = realloc(gc->values, new_capacity * sizeof(RuntimeValue));
+        RuntimeValue* new_values = ember_realloc(EMBER_MEM_RUNTIME, gc->values, new_capacity * sizeof(RuntimeValue));
         if (!new_values) {
-            fprintf(stderr, "Error: Failed to allocate memory for garbage collector tracking.\n");
+            output_sink_error("Error: Failed to allocate memory for garbage collector tracking.\n");
             return;
         }
         gc->values = new_values;
@@ -935,7 +1410,7 @@ void runtime_gc_track(GarbageCollector* gc, RuntimeValue value) {
 
 void runtime_gc_collect(GarbageCollector* gc) {
     if (!gc) {
-        fprintf(stderr, "Error: Garbage collector is NULL.\n");
+        output_sink_error("Error: Garbage collector is NULL.\n");
         return;
     }
 
@@ -944,7 +1419,7 @@ void runtime_gc_collect(GarbageCollector* gc) {
 
         // Free memory for string values
         if (value->type == RUNTIME_VALUE_STRING && value->string_value) {
-            free(value->string_value);
+            string_release(value->string_value);
             value->string_value = NULL;
         }
 
@@ -960,21 +1435,27 @@ void runtime_gc_free(GarbageCollector* gc) {
     if (gc) {
         // Free the array of tracked values if it exists
         if (gc->values) {
-            free(gc->values);
+            ember_free(gc->values);
         }
 
         // Free the GarbageCollector structure itself
-        free(gc);
+        ember_free(gc);
     }
 }
 
 void runtime_trigger_event(Environment* env, RuntimeEvent* event) {
     if (!env || !event) {
-        fprintf(stderr, "Error: Environment or event is NULL in runtime_trigger_event.\n");
+        output_sink_error("Error: Environment or event is NULL in runtime_trigger_event.\n");
+        return;
+    }
+
+    // Handlers registered with on() take precedence
+    EventBus* bus = event_bus_current();
+    if (bus && event_bus_emit(bus, env, event->event_name, event->data) > 0) {
         return;
     }
 
-    // Navigate through the environment to find event handlers
+    // Otherwise fall back to a function variable named after the event
     Environment* current_env = env;
 
     while (current_env) {
@@ -988,7 +1469,8 @@ void runtime_trigger_event(Environment* env, RuntimeEvent* event) {
 
                 if (handler_function) {
                     // Create a new environment for the function call
-                    Environment* function_env = runtime_create_child_environment(current_env);
+                    Environment* function_env = runtime_create_frame(
+                        current_env, handler_function->parameter_count + handler_function->local_count);
 
                     // Bind event data as function arguments (assumes single data value)
                     if (handler_function->parameter_count == 1 && event->data) {
@@ -997,6 +1479,8 @@ void runtime_trigger_event(Environment* env, RuntimeEvent* event) {
 
                     // Execute the handler function body
                     runtime_execute_block(function_env, handler_function->body);
+                    RuntimeValue discarded = runtime_take_return_value();
+                    runtime_free_value(&discarded);
 
                     // Free the child environment after the function call
                     runtime_free_environment(function_env);
@@ -1027,5 +1511,5 @@ void runtime_trigger_event(Environment* env, RuntimeEvent* event) {
     }
 
     // If we reached here, no handler was found for the event
-    fprintf(stderr, "Warning: No handler found for event '%s'.\n", event->event_name);
+    output_sink_error("Warning: No handler found for event '%s'.\n", event->event_name);
 }
\ No newline at end of file
@@ -0,0 +1,508 @@
+// clock_gettime() and pthread_condattr_setclock() under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "scheduler.h"
+#include "ember_alloc.h"
+
+#define NO_WAKEUP UINT64_MAX
+
+struct Fiber {
+    Scheduler* sched;
+    VM* vm;
+    _Atomic int state;  // FiberState
+    int result;         // VMResult once FIBER_DONE
+    Fiber* next;        // Link in a ready queue or the waiter list
+    Fiber* all_next;    // Link in the scheduler's list of every fiber
+    uint64_t wake_at;   // Monotonic ns deadline while FIBER_SLEEPING
+    char* event;        // Event name while FIBER_WAITING
+};
+
+typedef struct {
+    pthread_mutex_t lock;
+    Fiber* head;
+    Fiber* tail;
+} ReadyQueue;
+
+typedef struct {
+    Scheduler* sched;
+    unsigned int seed;  // xorshift state for picking steal victims
+    pthread_t thread;
+    ReadyQueue ready;
+} SchedulerWorker;
+
+struct Scheduler {
+    SchedulerWorker* workers;
+    int worker_count;
+    int started_count;       // Workers whose thread is running
+    long slice_budget;
+    atomic_uint next_queue;  // Round-robin target for fibers made ready off-worker
+
+    // Idle workers sleep here until `pending` becomes non-zero or a sleeper is due
+    pthread_mutex_t idle_lock;
+    pthread_cond_t work_available;
+    atomic_int pending;      // Fibers sitting in ready queues
+    atomic_int idle_workers;
+    atomic_bool shutdown;    // Checked between slices; unfinished fibers are abandoned
+
+    // Sleeping fibers (min-heap on wake_at) and event waiters
+    pthread_mutex_t wait_lock;
+    Fiber** sleepers;
+    int sleeper_count;
+    int sleeper_capacity;
+    _Atomic uint64_t next_wake;
+    Fiber* waiters;
+
+    // scheduler_wait_idle() sleeps here until `active` drops to zero
+    pthread_mutex_t done_lock;
+    pthread_cond_t all_idle;
+    atomic_int active;       // Fibers that are ready, running or sleeping
+
+    pthread_mutex_t fibers_lock;
+    Fiber* fibers;
+};
+
+static _Thread_local SchedulerWorker* current_worker = NULL;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* -------------------------------------------------------
+   Ready queues
+   ------------------------------------------------------- */
+
+static void queue_push(ReadyQueue* q, Fiber* f) {
+    f->next = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->tail) {
+        q->tail->next = f;
+    } else {
+        q->head = f;
+    }
+    q->tail = f;
+    pthread_mutex_unlock(&q->lock);
+}
+
+static Fiber* queue_pop(ReadyQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    Fiber* f = q->head;
+    if (f) {
+        q->head = f->next;
+        if (!q->head) {
+            q->tail = NULL;
+        }
+        f->next = NULL;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return f;
+}
+
+// Queue a ready fiber: on the calling worker if it belongs to this
+// scheduler, otherwise round-robin across the workers.
+static void sched_make_ready(Scheduler* sched, Fiber* f) {
+    atomic_store(&f->state, FIBER_READY);
+    SchedulerWorker* self = current_worker;
+    if (!self || self->sched != sched) {
+        unsigned int i = atomic_fetch_add(&sched->next_queue, 1);
+        self = &sched->workers[i % (unsigned int)sched->worker_count];
+    }
+    queue_push(&self->ready, f);
+
+    atomic_fetch_add(&sched->pending, 1);
+    if (atomic_load(&sched->idle_workers) > 0) {
+        pthread_mutex_lock(&sched->idle_lock);
+        pthread_cond_signal(&sched->work_available);
+        pthread_mutex_unlock(&sched->idle_lock);
+    }
+}
+
+// Own queue first, then steal the oldest fiber of a random victim.
+static Fiber* worker_find_fiber(SchedulerWorker* self) {
+    Scheduler* sched = self->sched;
+    Fiber* f = queue_pop(&self->ready);
+    if (!f && sched->worker_count > 1) {
+        self->seed ^= self->seed << 13;
+        self->seed ^= self->seed >> 17;
+        self->seed ^= self->seed << 5;
+        int start = (int)(self->seed % (unsigned int)sched->worker_count);
+        for (int i = 0; i < sched->worker_count && !f; i++) {
+            SchedulerWorker* victim = &sched->workers[(start + i) % sched->worker_count];
+            if (victim != self) {
+                f = queue_pop(&victim->ready);
+            }
+        }
+    }
+    if (f) {
+        atomic_fetch_sub(&sched->pending, 1);
+    }
+    return f;
+}
+
+/* -------------------------------------------------------
+   Sleepers and waiters
+   ------------------------------------------------------- */
+
+static void heap_swap(Fiber** heap, int a, int b) {
+    Fiber* t = heap[a];
+    heap[a] = heap[b];
+    heap[b] = t;
+}
+
+// Caller holds wait_lock.
+static bool sleepers_push(Scheduler* sched, Fiber* f) {
+    if (sched->sleeper_count == sched->sleeper_capacity) {
+        int capacity = sched->sleeper_capacity ? sched->sleeper_capacity * 2 : 16;
+        Fiber** grown = (Fiber**)ember_realloc(EMBER_MEM_VM, sched->sleepers, sizeof(Fiber*) * (size_t)capacity);
+        if (!grown) {
+            return false;
+        }
+        sched->sleepers = grown;
+        sched->sleeper_capacity = capacity;
+    }
+    Fiber** heap = sched->sleepers;
+    int i = sched->sleeper_count++;
+    heap[i] = f;
+    while (i > 0 && heap[(i - 1) / 2]->wake_at > heap[i]->wake_at) {
+        heap_swap(heap, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    atomic_store(&sched->next_wake, heap[0]->wake_at);
+    return true;
+}
+
+// Caller holds wait_lock.
+static Fiber* sleepers_pop(Scheduler* sched) {
+    Fiber** heap = sched->sleepers;
+    Fiber* top = heap[0];
+    heap[0] = heap[--sched->sleeper_count];
+    int i = 0;
+    for (;;) {
+        int smallest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < sched->sleeper_count && heap[l]->wake_at < heap[smallest]->wake_at) smallest = l;
+        if (r < sched->sleeper_count && heap[r]->wake_at < heap[smallest]->wake_at) smallest = r;
+        if (smallest == i) break;
+        heap_swap(heap, i, smallest);
+        i = smallest;
+    }
+    atomic_store(&sched->next_wake, sched->sleeper_count ? heap[0]->wake_at : NO_WAKEUP);
+    return top;
+}
+
+// Move every sleeper whose deadline has passed back to a ready queue.
+static void sched_wake_sleepers(Scheduler* sched) {
+    uint64_t now = monotonic_ns();
+    if (atomic_load(&sched->next_wake) > now) {
+        return;
+    }
+    Fiber* due = NULL;
+    pthread_mutex_lock(&sched->wait_lock);
+    while (sched->sleeper_count > 0 && sched->sleepers[0]->wake_at <= now) {
+        Fiber* f = sleepers_pop(sched);
+        f->next = due;
+        due = f;
+    }
+    pthread_mutex_unlock(&sched->wait_lock);
+
+    while (due) {
+        Fiber* next = due->next;
+        sched_make_ready(sched, due);
+        due = next;
+    }
+}
+
+static void sched_fiber_inactive(Scheduler* sched) {
+    if (atomic_fetch_sub(&sched->active, 1) == 1) {
+        pthread_mutex_lock(&sched->done_lock);
+        pthread_cond_broadcast(&sched->all_idle);
+        pthread_mutex_unlock(&sched->done_lock);
+    }
+}
+
+/* -------------------------------------------------------
+   Workers
+   ------------------------------------------------------- */
+
+// Monotonic deadline `wait_ms` from now, saturating instead of wrapping
+static uint64_t sleep_deadline(double wait_ms) {
+    const uint64_t max_delay = 1ull << 62; // ~146 years
+    double ns = wait_ms * 1e6;
+    uint64_t delay = ns >= (double)max_delay ? max_delay : (uint64_t)ns;
+    uint64_t now = monotonic_ns();
+    return delay > UINT64_MAX - now ? UINT64_MAX : now + delay;
+}
+
+static void worker_run_slice(SchedulerWorker* self, Fiber* f) {
+    Scheduler* sched = self->sched;
+    atomic_store(&f->state, FIBER_RUNNING);
+    int status = vm_run_slice(f->vm, sched->slice_budget);
+
+    if (status == VM_RESULT_YIELDED) {
+        sched_make_ready(sched, f);
+        return;
+    }
+
+    if (status == VM_RESULT_SUSPENDED && f->vm->wait_kind == VM_WAIT_SLEEP) {
+        f->wake_at = sleep_deadline(f->vm->wait_ms);
+        atomic_store(&f->state, FIBER_SLEEPING);
+        pthread_mutex_lock(&sched->wait_lock);
+        bool queued = sleepers_push(sched, f);
+        pthread_mutex_unlock(&sched->wait_lock);
+        if (queued) {
+            // An idle worker may be waiting on a later deadline
+            if (atomic_load(&sched->idle_workers) > 0) {
+                pthread_mutex_lock(&sched->idle_lock);
+                pthread_cond_broadcast(&sched->work_available);
+                pthread_mutex_unlock(&sched->idle_lock);
+            }
+            return;
+        }
+        fprintf(stderr, "Error: Memory allocation failed for sleeping fiber.\n");
+        status = VM_RESULT_ERROR;
+    } else if (status == VM_RESULT_SUSPENDED && f->vm->wait_kind == VM_WAIT_EVENT) {
+        // Copy the name: it belongs to a VM value that may not outlive the wait
+        f->event = ember_strdup(EMBER_MEM_VM, f->vm->wait_event);
+        if (f->event) {
+            atomic_store(&f->state, FIBER_WAITING);
+            pthread_mutex_lock(&sched->wait_lock);
+            f->next = sched->waiters;
+            sched->waiters = f;
+            pthread_mutex_unlock(&sched->wait_lock);
+            sched_fiber_inactive(sched);
+            return;
+        }
+        fprintf(stderr, "Error: Memory allocation failed for waiting fiber.\n");
+        status = VM_RESULT_ERROR;
+    }
+
+    f->result = status;
+    atomic_store(&f->state, FIBER_DONE);
+    sched_fiber_inactive(sched);
+}
+
+static void* worker_main(void* arg) {
+    SchedulerWorker* self = (SchedulerWorker*)arg;
+    Scheduler* sched = self->sched;
+    current_worker = self;
+
+    while (!atomic_load(&sched->shutdown)) {
+        sched_wake_sleepers(sched);
+        Fiber* f = worker_find_fiber(self);
+        if (f) {
+            worker_run_slice(self, f);
+            continue;
+        }
+
+        pthread_mutex_lock(&sched->idle_lock);
+        atomic_fetch_add(&sched->idle_workers, 1);
+        while (atomic_load(&sched->pending) == 0 && !atomic_load(&sched->shutdown)) {
+            uint64_t wake = atomic_load(&sched->next_wake);
+            if (wake == NO_WAKEUP) {
+                pthread_cond_wait(&sched->work_available, &sched->idle_lock);
+                continue;
+            }
+            if (wake <= monotonic_ns()) {
+                break;
+            }
+            struct timespec deadline;
+            deadline.tv_sec = (time_t)(wake / 1000000000u);
+            deadline.tv_nsec = (long)(wake % 1000000000u);
+            pthread_cond_timedwait(&sched->work_available, &sched->idle_lock, &deadline);
+        }
+        atomic_fetch_sub(&sched->idle_workers, 1);
+        pthread_mutex_unlock(&sched->idle_lock);
+    }
+
+    current_worker = NULL;
+    return NULL;
+}
+
+/* -------------------------------------------------------
+   Public API
+   ------------------------------------------------------- */
+
+Scheduler* scheduler_create(int worker_count, long slice_budget) {
+    if (worker_count <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = cores > 0 ? (int)cores : 1;
+    }
+
+    Scheduler* sched = (Scheduler*)ember_calloc(EMBER_MEM_VM, 1, sizeof(Scheduler));
+    if (!sched) {
+        fprintf(stderr, "Error: Memory allocation failed for scheduler.\n");
+        return NULL;
+    }
+    sched->workers = (SchedulerWorker*)ember_calloc(EMBER_MEM_VM, (size_t)worker_count, sizeof(SchedulerWorker));
+    if (!sched->workers) {
+        fprintf(stderr, "Error: Memory allocation failed for scheduler workers.\n");
+        ember_free(sched);
+        return NULL;
+    }
+    sched->slice_budget = slice_budget > 0 ? slice_budget : SCHEDULER_DEFAULT_SLICE;
+
+    // Deadlines are monotonic, so time the idle waits on the same clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sched->work_available, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_init(&sched->idle_lock, NULL);
+    pthread_mutex_init(&sched->wait_lock, NULL);
+    pthread_mutex_init(&sched->done_lock, NULL);
+    pthread_cond_init(&sched->all_idle, NULL);
+    pthread_mutex_init(&sched->fibers_lock, NULL);
+    atomic_init(&sched->next_queue, 0);
+    atomic_init(&sched->pending, 0);
+    atomic_init(&sched->idle_workers, 0);
+    atomic_init(&sched->active, 0);
+    atomic_init(&sched->shutdown, false);
+    atomic_init(&sched->next_wake, NO_WAKEUP);
+
+    for (int i = 0; i < worker_count; i++) {
+        SchedulerWorker* w = &sched->workers[i];
+        w->sched = sched;
+        w->seed = 2463534242u + (unsigned int)i * 2654435761u;
+        pthread_mutex_init(&w->ready.lock, NULL);
+    }
+
+    // Workers read worker_count while stealing, so fix it before any start
+    sched->worker_count = worker_count;
+    for (int i = 0; i < worker_count; i++) {
+        int result = pthread_create(&sched->workers[i].thread, NULL, worker_main, &sched->workers[i]);
+        if (result != 0) {
+            fprintf(stderr, "Error: Failed to create scheduler thread (error code %d).\n", result);
+            scheduler_destroy(sched);
+            return NULL;
+        }
+        sched->started_count++;
+    }
+
+    return sched;
+}
+
+void scheduler_destroy(Scheduler* sched) {
+    if (!sched) {
+        return;
+    }
+
+    pthread_mutex_lock(&sched->idle_lock);
+    atomic_store(&sched->shutdown, true);
+    pthread_cond_broadcast(&sched->work_available);
+    pthread_mutex_unlock(&sched->idle_lock);
+
+    for (int i = 0; i < sched->started_count; i++) {
+        pthread_join(sched->workers[i].thread, NULL);
+    }
+
+    Fiber* f = sched->fibers;
+    while (f) {
+        Fiber* next = f->all_next;
+        ember_free(f->event);
+        ember_free(f);
+        f = next;
+    }
+
+    for (int i = 0; i < sched->worker_count; i++) {
+        pthread_mutex_destroy(&sched->workers[i].ready.lock);
+    }
+    pthread_mutex_destroy(&sched->idle_lock);
+    pthread_cond_destroy(&sched->work_available);
+    pthread_mutex_destroy(&sched->wait_lock);
+    pthread_mutex_destroy(&sched->done_lock);
+    pthread_cond_destroy(&sched->all_idle);
+    pthread_mutex_destroy(&sched->fibers_lock);
+    ember_free(sched->sleepers);
+    ember_free(sched->workers);
+    ember_free(sched);
+}
+
+Fiber* scheduler_spawn(Scheduler* sched, VM* vm) {
+    if (!sched || !vm) {
+        fprintf(stderr, "Error: Cannot spawn a fiber without a scheduler and a VM.\n");
+        return NULL;
+    }
+    Fiber* f = (Fiber*)ember_calloc(EMBER_MEM_VM, 1, sizeof(Fiber));
+    if (!f) {
+        fprintf(stderr, "Error: Memory allocation failed for fiber.\n");
+        return NULL;
+    }
+    f->sched = sched;
+    f->vm = vm;
+    atomic_init(&f->state, FIBER_READY);
+    f->result = VM_RESULT_OK;
+
+    pthread_mutex_lock(&sched->fibers_lock);
+    f->all_next = sched->fibers;
+    sched->fibers = f;
+    pthread_mutex_unlock(&sched->fibers_lock);
+
+    atomic_fetch_add(&sched->active, 1);
+    sched_make_ready(sched, f);
+    return f;
+}
+
+int scheduler_signal(Scheduler* sched, const char* event) {
+    if (!sched || !event) {
+        return 0;
+    }
+
+    Fiber* woken = NULL;
+    int count = 0;
+    pthread_mutex_lock(&sched->wait_lock);
+    Fiber** link = &sched->waiters;
+    while (*link) {
+        Fiber* f = *link;
+        if (strcmp(f->event, event) == 0) {
+            *link = f->next;
+            ember_free(f->event);
+            f->event = NULL;
+            f->next = woken;
+            woken = f;
+            count++;
+        } else {
+            link = &f->next;
+        }
+    }
+    pthread_mutex_unlock(&sched->wait_lock);
+
+    while (woken) {
+        Fiber* next = woken->next;
+        atomic_fetch_add(&sched->active, 1);
+        sched_make_ready(sched, woken);
+        woken = next;
+    }
+    return count;
+}
+
+void scheduler_wait_idle(Scheduler* sched) {
+    if (!sched) {
+        return;
+    }
+    pthread_mutex_lock(&sched->done_lock);
+    while (atomic_load(&sched->active) > 0) {
+        pthread_cond_wait(&sched->all_idle, &sched->done_lock);
+    }
+    pthread_mutex_unlock(&sched->done_lock);
+}
+
+FiberState scheduler_fiber_state(const Fiber* fiber) {
+    return (FiberState)atomic_load(&((Fiber*)fiber)->state);
+}
+
+int scheduler_fiber_result(const Fiber* fiber) {
+    return fiber->result;
+}
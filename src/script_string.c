@@ -0,0 +1,155 @@
+// script_string.c
+//
+// Reference-counted strings. A flat string keeps its bytes inline after the
+// header; a slice points into a flat parent and holds a reference to it, so
+// walking a long string with substring() costs no copy per step. Slices
+// always refer to the root flat string, never to another slice.
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "script_string.h"
+#include "ember_alloc.h"
+
+// Ranges up to this long are cheaper to copy than to track as a slice
+#define STRING_SLICE_MIN_LENGTH 32
+// A parent at least this long is not pinned by a slice under
+// 1/STRING_SLICE_PIN_RATIO of its size; the slice is copied instead
+#define STRING_SLICE_PIN_PARENT 4096
+#define STRING_SLICE_PIN_RATIO 16
+
+struct ScriptString {
+    atomic_int refcount;
+    StringKind kind;
+    size_t length;
+    const char* chars;            // Flat: inline_chars; slice: into the parent
+    ScriptString* parent;         // Slice only
+    _Atomic(char*) terminated;    // Slice only: copy made by string_cstr()
+    char inline_chars[];          // Flat only, length + 1 bytes
+};
+
+ScriptString* string_create_uninit(size_t length, char** chars) {
+    ScriptString* string = (ScriptString*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(ScriptString) + length + 1);
+    if (!string) {
+        fprintf(stderr, "Error: Memory allocation failed for string.\n");
+        return NULL;
+    }
+    atomic_init(&string->refcount, 1);
+    string->kind = STRING_KIND_FLAT;
+    string->length = length;
+    string->chars = string->inline_chars;
+    string->parent = NULL;
+    atomic_init(&string->terminated, NULL);
+    string->inline_chars[length] = '\0';
+    *chars = string->inline_chars;
+    return string;
+}
+
+ScriptString* string_create(const char* chars, size_t length) {
+    char* buffer;
+    ScriptString* string = string_create_uninit(length, &buffer);
+    if (string && length > 0) {
+        memcpy(buffer, chars, length);
+    }
+    return string;
+}
+
+ScriptString* string_from_cstr(const char* chars) {
+    return string_create(chars, strlen(chars));
+}
+
+void string_retain(ScriptString* string) {
+    if (string) {
+        atomic_fetch_add_explicit(&string->refcount, 1, memory_order_relaxed);
+    }
+}
+
+void string_release(ScriptString* string) {
+    if (!string || atomic_fetch_sub_explicit(&string->refcount, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    if (string->kind == STRING_KIND_SLICE) {
+        ember_free(atomic_load_explicit(&string->terminated, memory_order_acquire));
+        string_release(string->parent);
+    }
+    ember_free(string);
+}
+
+StringKind string_kind(const ScriptString* string) {
+    return string->kind;
+}
+
+size_t string_length(const ScriptString* string) {
+    return string->length;
+}
+
+const char* string_data(const ScriptString* string) {
+    return string->chars;
+}
+
+const char* string_cstr(const ScriptString* string) {
+    if (string->kind == STRING_KIND_FLAT) {
+        return string->chars;
+    }
+    ScriptString* slice = (ScriptString*)string;
+    char* terminated = atomic_load_explicit(&slice->terminated, memory_order_acquire);
+    if (terminated) {
+        return terminated;
+    }
+    char* copy = ember_strndup(EMBER_MEM_RUNTIME, slice->chars, slice->length);
+    if (!copy) {
+        fprintf(stderr, "Error: Memory allocation failed for string.\n");
+        return "";
+    }
+    // Another thread may have raced us here; keep whichever copy won
+    if (!atomic_compare_exchange_strong_explicit(&slice->terminated, &terminated, copy,
+                                                 memory_order_acq_rel, memory_order_acquire)) {
+        ember_free(copy);
+        return terminated;
+    }
+    return copy;
+}
+
+ScriptString* string_substring(ScriptString* string, size_t start, size_t length) {
+    if (start == 0 && length == string->length) {
+        string_retain(string);
+        return string;
+    }
+    ScriptString* root = string->kind == STRING_KIND_SLICE ? string->parent : string;
+    const char* chars = string->chars + start;
+    if (length <= STRING_SLICE_MIN_LENGTH ||
+        (root->length >= STRING_SLICE_PIN_PARENT &&
+         length < root->length / STRING_SLICE_PIN_RATIO)) {
+        return string_create(chars, length);
+    }
+
+    ScriptString* slice = (ScriptString*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(ScriptString));
+    if (!slice) {
+        fprintf(stderr, "Error: Memory allocation failed for string.\n");
+        return NULL;
+    }
+    atomic_init(&slice->refcount, 1);
+    slice->kind = STRING_KIND_SLICE;
+    slice->length = length;
+    slice->chars = chars;
+    slice->parent = root;
+    atomic_init(&slice->terminated, NULL);
+    string_retain(root);
+    return slice;
+}
+
+bool string_equals(const ScriptString* a, const ScriptString* b) {
+    return a == b || (a->length == b->length && memcmp(a->chars, b->chars, a->length) == 0);
+}
+
+ScriptString* string_concat(const char* a, size_t a_length, const char* b, size_t b_length) {
+    char* buffer;
+    ScriptString* string = string_create_uninit(a_length + b_length, &buffer);
+    if (!string) {
+        return NULL;
+    }
+    memcpy(buffer, a, a_length);
+    memcpy(buffer + a_length, b, b_length);
+    return string;
+}
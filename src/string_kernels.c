@@ -0,0 +1,216 @@
+// string_kernels.c
+//
+// Substring search and case mapping behind index_of, replace, to_upper and
+// to_lower. SSE2 is part of the x86-64 baseline, so like the dictionary
+// probe these use it directly and keep a scalar loop for other targets and
+// for the last few bytes.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "string_kernels.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* -------------------------------------------------------
+   Search
+   ------------------------------------------------------- */
+
+// memchr for the first byte, then compare the rest
+static size_t scalar_find(const char* haystack, size_t haystack_len, size_t from,
+                          const char* needle, size_t needle_len) {
+    size_t last_start = haystack_len - needle_len;
+    while (from <= last_start) {
+        const char* hit = memchr(haystack + from, needle[0], last_start - from + 1);
+        if (!hit) {
+            return STRING_NOT_FOUND;
+        }
+        size_t at = (size_t)(hit - haystack);
+        if (memcmp(hit + 1, needle + 1, needle_len - 1) == 0) {
+            return at;
+        }
+        from = at + 1;
+    }
+    return STRING_NOT_FOUND;
+}
+
+size_t string_find(const char* haystack, size_t haystack_len,
+                   const char* needle, size_t needle_len) {
+    if (needle_len == 0) {
+        return 0;
+    }
+    if (needle_len > haystack_len) {
+        return STRING_NOT_FOUND;
+    }
+    if (needle_len == 1) {
+        const char* hit = memchr(haystack, needle[0], haystack_len);
+        return hit ? (size_t)(hit - haystack) : STRING_NOT_FOUND;
+    }
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    // A block of sixteen candidate starts is worth a full compare only
+    // where both the first and the last needle byte line up.
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    for (; i + needle_len - 1 + 16 <= haystack_len; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + i + needle_len - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (memcmp(haystack + i + bit + 1, needle + 1, needle_len - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    return scalar_find(haystack, haystack_len, i, needle, needle_len);
+}
+
+size_t string_count(const char* haystack, size_t haystack_len,
+                    const char* needle, size_t needle_len) {
+    if (needle_len == 0) {
+        return 0;
+    }
+    size_t count = 0;
+    size_t offset = 0;
+    for (;;) {
+        size_t at = string_find(haystack + offset, haystack_len - offset, needle, needle_len);
+        if (at == STRING_NOT_FOUND) {
+            return count;
+        }
+        count++;
+        offset += at + needle_len;
+    }
+}
+
+/* -------------------------------------------------------
+   Case mapping
+   ------------------------------------------------------- */
+
+// Code points U+0080..U+07FF whose other case is also two bytes long
+// Latin Extended-A pairs each capital with the next code point. In these
+// runs capitals are even...
+static bool extended_a_even_upper(uint32_t cp) {
+    return (cp >= 0x100 && cp <= 0x12F) || (cp >= 0x132 && cp <= 0x137) ||
+           (cp >= 0x14A && cp <= 0x177);
+}
+
+// ...and in these they are odd. İ ı ĸ ŉ ſ are in neither: their other
+// case is a different length or does not exist.
+static bool extended_a_odd_upper(uint32_t cp) {
+    return (cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E);
+}
+
+static uint32_t upper_code_point(uint32_t cp) {
+    if ((cp >= 0xE0 && cp <= 0xFE && cp != 0xF7) ||   // Latin-1
+        (cp >= 0x3B1 && cp <= 0x3C9 && cp != 0x3C2) || // Greek, except final sigma
+        (cp >= 0x430 && cp <= 0x44F)) {                 // Cyrillic
+        return cp - 0x20;
+    }
+    if (cp >= 0x450 && cp <= 0x45F) {
+        return cp - 0x50;
+    }
+    if (extended_a_even_upper(cp)) {
+        return cp & ~1u;
+    }
+    if (extended_a_odd_upper(cp)) {
+        return (cp & 1u) ? cp : cp - 1;
+    }
+    if (cp == 0xFF) {
+        return 0x178;
+    }
+    return cp;
+}
+
+static uint32_t lower_code_point(uint32_t cp) {
+    if ((cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) ||
+        (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) ||
+        (cp >= 0x410 && cp <= 0x42F)) {
+        return cp + 0x20;
+    }
+    if (cp >= 0x400 && cp <= 0x40F) {
+        return cp + 0x50;
+    }
+    if (extended_a_even_upper(cp)) {
+        return cp | 1u;
+    }
+    if (extended_a_odd_upper(cp)) {
+        return (cp & 1u) ? cp + 1 : cp;
+    }
+    if (cp == 0x178) {
+        return 0xFF;
+    }
+    return cp;
+}
+
+// Map the character at in[i] into out[i...] and return its length in bytes
+static size_t map_scalar(char* out, const char* in, size_t len, size_t i, bool upper) {
+    unsigned char c = (unsigned char)in[i];
+    if (c < 0x80) {
+        if (upper && c >= 'a' && c <= 'z') {
+            c -= 0x20;
+        } else if (!upper && c >= 'A' && c <= 'Z') {
+            c += 0x20;
+        }
+        out[i] = (char)c;
+        return 1;
+    }
+    unsigned char next = i + 1 < len ? (unsigned char)in[i + 1] : 0;
+    if (c >= 0xC2 && c <= 0xDF && (next & 0xC0) == 0x80) {
+        uint32_t cp = ((uint32_t)(c & 0x1F) << 6) | (next & 0x3F);
+        cp = upper ? upper_code_point(cp) : lower_code_point(cp);
+        out[i] = (char)(0xC0 | (cp >> 6));
+        out[i + 1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    // Longer sequences, continuation bytes and invalid leads pass through
+    out[i] = (char)c;
+    return 1;
+}
+
+static void map_case(char* out, const char* in, size_t len, bool upper) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // Biasing by 0x80 - 'a' moves 'a'..'z' to the bottom of the signed
+    // byte range, so one compare selects exactly the letters to flip.
+    const __m128i bias = _mm_set1_epi8((char)(0x80 - (upper ? 'a' : 'A')));
+    const __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+#endif
+    while (i < len) {
+#if defined(__SSE2__)
+        if (i + 16 <= len) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(in + i));
+            if (_mm_movemask_epi8(block) == 0) {
+                __m128i letters = _mm_cmplt_epi8(_mm_add_epi8(block, bias), limit);
+                _mm_storeu_si128((__m128i*)(out + i),
+                                 _mm_xor_si128(block, _mm_and_si128(letters, flip)));
+                i += 16;
+                continue;
+            }
+            // Non-ASCII somewhere in the block: finish it character by character
+            size_t end = i + 16;
+            while (i < end) {
+                i += map_scalar(out, in, len, i, upper);
+            }
+            continue;
+        }
+#endif
+        i += map_scalar(out, in, len, i, upper);
+    }
+}
+
+void string_to_upper(char* out, const char* in, size_t len) {
+    map_case(out, in, len, true);
+}
+
+void string_to_lower(char* out, const char* in, size_t len) {
+    map_case(out, in, len, false);
+}
@@ -0,0 +1,447 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+#include "runtime.h"
+#include "ember_alloc.h"
+
+/* -------------------------------------------------------
+   Chase-Lev work-stealing deque
+   (Lê, Pop, Cohen & Zappa Nardelli, "Correct and Efficient
+   Work-Stealing for Weak Memory Models", PPoPP 2013)
+   ------------------------------------------------------- */
+
+#define DEQUE_INITIAL_CAPACITY 64
+
+typedef struct DequeArray {
+    long capacity;               // Always a power of two
+    struct DequeArray* retired;  // Older, smaller arrays still visible to thieves
+    _Atomic(ThreadPoolTask*) slots[];
+} DequeArray;
+
+typedef struct {
+    atomic_long top;     // Thieves take from here
+    atomic_long bottom;  // Owner pushes and pops here
+    _Atomic(DequeArray*) array;
+} Deque;
+
+static DequeArray* deque_array_create(long capacity) {
+    DequeArray* a = (DequeArray*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(DequeArray) + sizeof(_Atomic(ThreadPoolTask*)) * capacity);
+    if (!a) {
+        return NULL;
+    }
+    a->capacity = capacity;
+    a->retired = NULL;
+    return a;
+}
+
+static bool deque_init(Deque* q) {
+    DequeArray* a = deque_array_create(DEQUE_INITIAL_CAPACITY);
+    if (!a) {
+        return false;
+    }
+    atomic_init(&q->top, 0);
+    atomic_init(&q->bottom, 0);
+    atomic_init(&q->array, a);
+    return true;
+}
+
+static void deque_destroy(Deque* q) {
+    DequeArray* a = atomic_load_explicit(&q->array, memory_order_relaxed);
+    while (a) {
+        DequeArray* older = a->retired;
+        ember_free(a);
+        a = older;
+    }
+}
+
+// Owner only. Old arrays are kept until the deque is destroyed because a
+// thief may still be reading from them.
+static DequeArray* deque_grow(Deque* q, DequeArray* a, long top, long bottom) {
+    DequeArray* bigger = deque_array_create(a->capacity * 2);
+    if (!bigger) {
+        return NULL;
+    }
+    for (long i = top; i < bottom; i++) {
+        ThreadPoolTask* t = atomic_load_explicit(&a->slots[i & (a->capacity - 1)], memory_order_relaxed);
+        atomic_store_explicit(&bigger->slots[i & (bigger->capacity - 1)], t, memory_order_relaxed);
+    }
+    bigger->retired = a;
+    atomic_store_explicit(&q->array, bigger, memory_order_release);
+    return bigger;
+}
+
+// Owner only.
+static bool deque_push(Deque* q, ThreadPoolTask* task) {
+    long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    DequeArray* a = atomic_load_explicit(&q->array, memory_order_relaxed);
+    if (b - t > a->capacity - 1) {
+        a = deque_grow(q, a, t, b);
+        if (!a) {
+            return false;
+        }
+    }
+    atomic_store_explicit(&a->slots[b & (a->capacity - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+// Owner only.
+static ThreadPoolTask* deque_pop(Deque* q) {
+    long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    DequeArray* a = atomic_load_explicit(&q->array, memory_order_relaxed);
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+
+    ThreadPoolTask* task = NULL;
+    if (t <= b) {
+        task = atomic_load_explicit(&a->slots[b & (a->capacity - 1)], memory_order_relaxed);
+        if (t == b) {
+            // Last element: race any thief for it
+            if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                                                         memory_order_seq_cst, memory_order_relaxed)) {
+                task = NULL;
+            }
+            atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+// Any thread. Returns NULL if empty or if another thread won the race.
+static ThreadPoolTask* deque_steal(Deque* q) {
+    long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+    if (t >= b) {
+        return NULL;
+    }
+    DequeArray* a = atomic_load_explicit(&q->array, memory_order_acquire);
+    ThreadPoolTask* task = atomic_load_explicit(&a->slots[t & (a->capacity - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+/* -------------------------------------------------------
+   Pool
+   ------------------------------------------------------- */
+
+struct ThreadPoolTask {
+    ThreadPool* pool;
+    ThreadPoolFn fn;
+    void* arg;
+    ThreadPoolTask* next_injected; // Link in the injector queue
+    atomic_int done;
+    atomic_int refs;               // One for the pool, one for the handle
+};
+
+typedef struct {
+    ThreadPool* pool;
+    int index;
+    unsigned int seed;  // xorshift state for picking steal victims
+    pthread_t thread;
+    Deque deque;
+} Worker;
+
+struct ThreadPool {
+    Worker* workers;
+    int worker_count;
+
+    // Tasks submitted from outside the pool
+    pthread_mutex_t injector_lock;
+    ThreadPoolTask* injector_head;
+    ThreadPoolTask* injector_tail;
+
+    // Idle workers sleep here until `pending` becomes non-zero
+    pthread_mutex_t idle_lock;
+    pthread_cond_t work_available;
+    atomic_int pending;  // Queued tasks not yet taken by a worker
+    bool shutdown;
+
+    // Non-worker joiners sleep here
+    pthread_mutex_t done_lock;
+    pthread_cond_t task_done;
+};
+
+static _Thread_local Worker* current_worker = NULL;
+
+static void task_release(ThreadPoolTask* task) {
+    if (atomic_fetch_sub_explicit(&task->refs, 1, memory_order_acq_rel) == 1) {
+        ember_free(task);
+    }
+}
+
+static void pool_run_task(ThreadPool* pool, ThreadPoolTask* task) {
+    task->fn(task->arg);
+    atomic_store_explicit(&task->done, 1, memory_order_release);
+
+    pthread_mutex_lock(&pool->done_lock);
+    pthread_cond_broadcast(&pool->task_done);
+    pthread_mutex_unlock(&pool->done_lock);
+
+    task_release(task);
+}
+
+static ThreadPoolTask* pool_take_injected(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->injector_lock);
+    ThreadPoolTask* task = pool->injector_head;
+    if (task) {
+        pool->injector_head = task->next_injected;
+        if (!pool->injector_head) {
+            pool->injector_tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&pool->injector_lock);
+    return task;
+}
+
+// Own deque first, then the injector, then steal from a random victim.
+static ThreadPoolTask* worker_find_task(Worker* self) {
+    ThreadPool* pool = self->pool;
+    ThreadPoolTask* task = deque_pop(&self->deque);
+    if (!task) {
+        task = pool_take_injected(pool);
+    }
+    if (!task && pool->worker_count > 1) {
+        self->seed ^= self->seed << 13;
+        self->seed ^= self->seed >> 17;
+        self->seed ^= self->seed << 5;
+        int start = (int)(self->seed % (unsigned int)pool->worker_count);
+        for (int i = 0; i < pool->worker_count && !task; i++) {
+            Worker* victim = &pool->workers[(start + i) % pool->worker_count];
+            if (victim != self) {
+                task = deque_steal(&victim->deque);
+            }
+        }
+    }
+    if (task) {
+        atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static void* worker_main(void* arg) {
+    Worker* self = (Worker*)arg;
+    ThreadPool* pool = self->pool;
+    current_worker = self;
+
+    for (;;) {
+        ThreadPoolTask* task = worker_find_task(self);
+        if (task) {
+            pool_run_task(pool, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idle_lock);
+        while (atomic_load(&pool->pending) == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_available, &pool->idle_lock);
+        }
+        bool stop = pool->shutdown && atomic_load(&pool->pending) == 0;
+        pthread_mutex_unlock(&pool->idle_lock);
+        if (stop) {
+            break;
+        }
+    }
+
+    current_worker = NULL;
+    runtime_env_pool_trim();
+    return NULL;
+}
+
+static void pool_signal_work(ThreadPool* pool) {
+    atomic_fetch_add_explicit(&pool->pending, 1, memory_order_relaxed);
+    pthread_mutex_lock(&pool->idle_lock);
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->idle_lock);
+}
+
+ThreadPool* thread_pool_create(int worker_count) {
+    if (worker_count <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = cores > 0 ? (int)cores : 1;
+    }
+
+    ThreadPool* pool = (ThreadPool*)ember_calloc(EMBER_MEM_RUNTIME, 1, sizeof(ThreadPool));
+    if (!pool) {
+        fprintf(stderr, "Error: Memory allocation failed for thread pool.\n");
+        return NULL;
+    }
+    pool->workers = (Worker*)ember_calloc(EMBER_MEM_RUNTIME, (size_t)worker_count, sizeof(Worker));
+    if (!pool->workers) {
+        fprintf(stderr, "Error: Memory allocation failed for thread pool workers.\n");
+        ember_free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->injector_lock, NULL);
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->work_available, NULL);
+    pthread_mutex_init(&pool->done_lock, NULL);
+    pthread_cond_init(&pool->task_done, NULL);
+    atomic_init(&pool->pending, 0);
+
+    for (int i = 0; i < worker_count; i++) {
+        Worker* w = &pool->workers[i];
+        w->pool = pool;
+        w->index = i;
+        w->seed = 2463534242u + (unsigned int)i * 2654435761u;
+        if (!deque_init(&w->deque)) {
+            fprintf(stderr, "Error: Memory allocation failed for worker deque.\n");
+            // No threads are running yet; just unwind the deques made so far
+            for (int j = 0; j < i; j++) {
+                deque_destroy(&pool->workers[j].deque);
+            }
+            pool->worker_count = 0;
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    // Workers read worker_count while stealing, so fix it before any start
+    pool->worker_count = worker_count;
+    for (int i = 0; i < worker_count; i++) {
+        int result = pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]);
+        if (result != 0) {
+            fprintf(stderr, "Error: Failed to create worker thread (error code %d).\n", result);
+            pthread_mutex_lock(&pool->idle_lock);
+            pool->shutdown = true;
+            pthread_cond_broadcast(&pool->work_available);
+            pthread_mutex_unlock(&pool->idle_lock);
+            for (int j = 0; j < i; j++) {
+                pthread_join(pool->workers[j].thread, NULL);
+            }
+            for (int j = 0; j < worker_count; j++) {
+                deque_destroy(&pool->workers[j].deque);
+            }
+            pool->worker_count = 0;
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->idle_lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (int i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+        deque_destroy(&pool->workers[i].deque);
+    }
+
+    pthread_mutex_destroy(&pool->injector_lock);
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_mutex_destroy(&pool->done_lock);
+    pthread_cond_destroy(&pool->task_done);
+    ember_free(pool->workers);
+    ember_free(pool);
+}
+
+static ThreadPool* default_pool = NULL;
+static pthread_once_t default_pool_once = PTHREAD_ONCE_INIT;
+
+static void default_pool_init(void) {
+    default_pool = thread_pool_create(0);
+}
+
+ThreadPool* thread_pool_default(void) {
+    pthread_once(&default_pool_once, default_pool_init);
+    return default_pool;
+}
+
+int thread_pool_worker_count(const ThreadPool* pool) {
+    return pool ? pool->worker_count : 0;
+}
+
+ThreadPoolTask* thread_pool_submit(ThreadPool* pool, ThreadPoolFn fn, void* arg) {
+    if (!pool || !fn) {
+        fprintf(stderr, "Error: Cannot submit a task without a pool and a function.\n");
+        return NULL;
+    }
+
+    ThreadPoolTask* task = (ThreadPoolTask*)ember_malloc(EMBER_MEM_RUNTIME, sizeof(ThreadPoolTask));
+    if (!task) {
+        fprintf(stderr, "Error: Memory allocation failed for pool task.\n");
+        return NULL;
+    }
+    task->pool = pool;
+    task->fn = fn;
+    task->arg = arg;
+    task->next_injected = NULL;
+    atomic_init(&task->done, 0);
+    atomic_init(&task->refs, 2);
+
+    Worker* self = current_worker;
+    if (self && self->pool == pool && deque_push(&self->deque, task)) {
+        pool_signal_work(pool);
+        return task;
+    }
+
+    pthread_mutex_lock(&pool->injector_lock);
+    if (pool->injector_tail) {
+        pool->injector_tail->next_injected = task;
+    } else {
+        pool->injector_head = task;
+    }
+    pool->injector_tail = task;
+    pthread_mutex_unlock(&pool->injector_lock);
+
+    pool_signal_work(pool);
+    return task;
+}
+
+void thread_pool_join(ThreadPoolTask* task) {
+    if (!task) {
+        return;
+    }
+
+    ThreadPool* pool = task->pool;
+    Worker* self = current_worker;
+    if (self && self->pool == pool) {
+        // Help out rather than block a worker the task may be queued behind
+        while (!atomic_load_explicit(&task->done, memory_order_acquire)) {
+            ThreadPoolTask* other = worker_find_task(self);
+            if (other) {
+                pool_run_task(pool, other);
+            } else {
+                sched_yield();
+            }
+        }
+    } else {
+        pthread_mutex_lock(&pool->done_lock);
+        while (!atomic_load_explicit(&task->done, memory_order_acquire)) {
+            pthread_cond_wait(&pool->task_done, &pool->done_lock);
+        }
+        pthread_mutex_unlock(&pool->done_lock);
+    }
+
+    task_release(task);
+}
+
+void thread_pool_detach(ThreadPoolTask* task) {
+    if (task) {
+        task_release(task);
+    }
+}
@@ -0,0 +1,299 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timer_wheel.h"
+#include "ember_alloc.h"
+
+#define SLOT_BITS 8
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define NIL (-1)
+
+// A timer id packs the node index with the node's generation, so an id
+// kept after its timer fired cannot cancel whatever reuses the node.
+// Both fit in a double's 53-bit mantissa.
+#define ID_INDEX_BITS 24
+#define ID_MAX_TIMERS (1 << ID_INDEX_BITS)
+#define ID_GENERATION_MASK ((1u << 28) - 1)
+
+// Placement never looks further ahead than the top level can hold; timers
+// beyond it are re-placed each time their slot cascades.
+#define MAX_HORIZON ((1ull << (SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+typedef struct {
+    uint64_t expires;      // Absolute tick
+    uint64_t interval;     // 0 for one-shot timers
+    uint32_t generation;
+    int32_t prev;          // Slot list links; `next` also links the free list
+    int32_t next;
+    int level;             // -1 while not on a slot list (free or firing)
+    int slot;
+    bool in_use;
+    bool cancelled;        // Cancelled from inside its own callback
+    RuntimeValue callback;
+} TimerNode;
+
+struct TimerWheel {
+    uint64_t now;
+    TimerNode* nodes;      // Indexed by id; grows, so keep indices, not pointers
+    int node_count;
+    int node_capacity;
+    int32_t free_head;
+    int pending;
+    int32_t heads[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    int32_t tails[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+static _Thread_local TimerWheel* bound_wheel = NULL;
+
+void timer_wheel_bind(TimerWheel* wheel) {
+    bound_wheel = wheel;
+}
+
+TimerWheel* timer_wheel_current(void) {
+    return bound_wheel;
+}
+
+/* -------------------------------------------------------
+   Node slab
+   ------------------------------------------------------- */
+
+static int32_t node_alloc(TimerWheel* w) {
+    if (w->free_head != NIL) {
+        int32_t i = w->free_head;
+        w->free_head = w->nodes[i].next;
+        return i;
+    }
+    if (w->node_count == w->node_capacity) {
+        int capacity = w->node_capacity ? w->node_capacity * 2 : 64;
+        if (capacity > ID_MAX_TIMERS) {
+            capacity = ID_MAX_TIMERS;
+        }
+        if (capacity == w->node_count) {
+            return NIL;
+        }
+        TimerNode* nodes = (TimerNode*)ember_realloc(EMBER_MEM_RUNTIME, w->nodes, sizeof(TimerNode) * (size_t)capacity);
+        if (!nodes) {
+            return NIL;
+        }
+        w->nodes = nodes;
+        w->node_capacity = capacity;
+    }
+    int32_t i = w->node_count++;
+    w->nodes[i].generation = 0;
+    return i;
+}
+
+static void node_free(TimerWheel* w, int32_t i) {
+    TimerNode* node = &w->nodes[i];
+    runtime_free_value(&node->callback);
+    node->in_use = false;
+    node->generation = (node->generation + 1) & ID_GENERATION_MASK;
+    node->next = w->free_head;
+    w->free_head = i;
+}
+
+/* -------------------------------------------------------
+   Slot lists
+   ------------------------------------------------------- */
+
+static void wheel_link(TimerWheel* w, int32_t i) {
+    TimerNode* node = &w->nodes[i];
+    uint64_t delta = node->expires > w->now ? node->expires - w->now : 0;
+    uint64_t when = node->expires;
+    if (delta > MAX_HORIZON) {
+        when = w->now + MAX_HORIZON;
+        delta = MAX_HORIZON;
+    }
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ull << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (int)((when >> (SLOT_BITS * level)) & SLOT_MASK);
+
+    node->level = level;
+    node->slot = slot;
+    node->next = NIL;
+    node->prev = w->tails[level][slot];
+    if (node->prev != NIL) {
+        w->nodes[node->prev].next = i;
+    } else {
+        w->heads[level][slot] = i;
+    }
+    w->tails[level][slot] = i;
+    w->pending++;
+}
+
+static void wheel_unlink(TimerWheel* w, int32_t i) {
+    TimerNode* node = &w->nodes[i];
+    if (node->prev != NIL) {
+        w->nodes[node->prev].next = node->next;
+    } else {
+        w->heads[node->level][node->slot] = node->next;
+    }
+    if (node->next != NIL) {
+        w->nodes[node->next].prev = node->prev;
+    } else {
+        w->tails[node->level][node->slot] = node->prev;
+    }
+    node->level = -1;
+    w->pending--;
+}
+
+// Re-place every timer in a higher-level slot now that it is in range.
+static void wheel_cascade(TimerWheel* w, int level, int slot) {
+    int32_t i = w->heads[level][slot];
+    w->heads[level][slot] = NIL;
+    w->tails[level][slot] = NIL;
+    while (i != NIL) {
+        int32_t next = w->nodes[i].next;
+        w->pending--;
+        wheel_link(w, i);
+        i = next;
+    }
+}
+
+/* -------------------------------------------------------
+   Public API
+   ------------------------------------------------------- */
+
+TimerWheel* timer_wheel_create(void) {
+    TimerWheel* w = (TimerWheel*)ember_calloc(EMBER_MEM_RUNTIME, 1, sizeof(TimerWheel));
+    if (!w) {
+        fprintf(stderr, "Error: Memory allocation failed for timer wheel.\n");
+        return NULL;
+    }
+    w->free_head = NIL;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            w->heads[level][slot] = NIL;
+            w->tails[level][slot] = NIL;
+        }
+    }
+    return w;
+}
+
+void timer_wheel_free(TimerWheel* wheel) {
+    if (!wheel) {
+        return;
+    }
+    for (int i = 0; i < wheel->node_count; i++) {
+        if (wheel->nodes[i].in_use) {
+            runtime_free_value(&wheel->nodes[i].callback);
+        }
+    }
+    if (bound_wheel == wheel) {
+        bound_wheel = NULL;
+    }
+    ember_free(wheel->nodes);
+    ember_free(wheel);
+}
+
+// Whole milliseconds in [floor, MAX_HORIZON]; checked before the cast
+// because NaN and huge doubles have no uint64_t value
+static uint64_t clamp_delay(double ms, uint64_t floor) {
+    if (!(ms >= 1)) {
+        return floor;
+    }
+    if (ms >= (double)MAX_HORIZON) {
+        return MAX_HORIZON;
+    }
+    return (uint64_t)ms;
+}
+
+double timer_wheel_schedule(TimerWheel* wheel, const RuntimeValue* callback,
+                            double delay_ms, double interval_ms) {
+    if (!wheel || !callback || callback->type != RUNTIME_VALUE_FUNCTION) {
+        fprintf(stderr, "Error: A timer needs a function to call.\n");
+        return -1;
+    }
+    int32_t i = node_alloc(wheel);
+    if (i == NIL) {
+        fprintf(stderr, "Error: Memory allocation failed for timer.\n");
+        return -1;
+    }
+
+    TimerNode* node = &wheel->nodes[i];
+    node->expires = wheel->now + clamp_delay(delay_ms, 1);
+    node->interval = clamp_delay(interval_ms, 0);
+    node->in_use = true;
+    node->cancelled = false;
+    node->callback = runtime_value_copy(callback);
+    wheel_link(wheel, i);
+
+    return (double)node->generation * ID_MAX_TIMERS + i;
+}
+
+bool timer_wheel_cancel(TimerWheel* wheel, double id) {
+    // Ids are below 2^(28 + 24); anything else (NaN included) names no timer
+    if (!wheel || !(id >= 0) || id >= (double)(ID_GENERATION_MASK + 1ull) * ID_MAX_TIMERS) {
+        return false;
+    }
+    uint64_t raw = (uint64_t)id;
+    int32_t i = (int32_t)(raw & (ID_MAX_TIMERS - 1));
+    uint32_t generation = (uint32_t)(raw >> ID_INDEX_BITS);
+    if (i >= wheel->node_count) {
+        return false;
+    }
+    TimerNode* node = &wheel->nodes[i];
+    if (!node->in_use || node->generation != generation || node->cancelled) {
+        return false;
+    }
+    if (node->level < 0) {
+        // Its callback is running; timer_wheel_tick frees it afterwards
+        node->cancelled = true;
+        return true;
+    }
+    wheel_unlink(wheel, i);
+    node_free(wheel, i);
+    return true;
+}
+
+int timer_wheel_pending(const TimerWheel* wheel) {
+    return wheel ? wheel->pending : 0;
+}
+
+int timer_wheel_tick(TimerWheel* wheel, Environment* env, uint64_t elapsed_ms) {
+    if (!wheel) {
+        return 0;
+    }
+    int fired = 0;
+    for (uint64_t step = 0; step < elapsed_ms; step++) {
+        if (wheel->pending == 0) {
+            // Nothing can come due; jump straight to the end
+            wheel->now += elapsed_ms - step;
+            break;
+        }
+        wheel->now++;
+
+        // Each time a level wraps, pull the matching slot of the next level down
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (wheel->now & ((1ull << (SLOT_BITS * level)) - 1)) {
+                break;
+            }
+            wheel_cascade(wheel, level, (int)((wheel->now >> (SLOT_BITS * level)) & SLOT_MASK));
+        }
+
+        int slot = (int)(wheel->now & SLOT_MASK);
+        int32_t i;
+        while ((i = wheel->heads[0][slot]) != NIL) {
+            wheel_unlink(wheel, i);
+            RuntimeValue callback = wheel->nodes[i].callback;
+            RuntimeValue result = runtime_call_function(env, &callback, NULL, 0);
+            runtime_free_value(&result);
+            fired++;
+
+            // The callback may have scheduled timers and moved the slab
+            TimerNode* node = &wheel->nodes[i];
+            if (node->interval && !node->cancelled) {
+                node->expires = wheel->now + node->interval;
+                wheel_link(wheel, i);
+            } else {
+                node_free(wheel, i);
+            }
+        }
+    }
+    return fired;
+}
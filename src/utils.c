@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "ember_alloc.h"
 
 #include <stdio.h>   // For FILE, fopen, fread, fclose, etc.
 #include <stdlib.h>  // For malloc, free
@@ -30,7 +31,7 @@ char* read_file(const char* filename)
     rewind(file);
 
     // Allocate buffer (+1 for the terminating null)
-    char* buffer = (char*)malloc((size_t)length + 1);
+    char* buffer = (char*)ember_malloc(EMBER_MEM_RUNTIME, (size_t)length + 1);
     if (!buffer) {
         fprintf(stderr, "Error: Memory allocation failed for reading '%s'\n", filename);
         fclose(file);
@@ -1,17 +1,27 @@
+// nanosleep() for vm_run's blocking sleep under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdatomic.h>
 
 #include "virtual_machine.h"
+#include "object_layout.h"
+#include "array_layout.h"
+#include "script_string.h"
+#include "output_sink.h"
+#include "builtins.h"
+#include "ember_alloc.h"
 
 /* ----------------
    Chunk Functions
    ---------------- */
 
 BytecodeChunk* vm_create_chunk() {
-    BytecodeChunk* chunk = (BytecodeChunk*)malloc(sizeof(BytecodeChunk));
+    BytecodeChunk* chunk = (BytecodeChunk*)ember_malloc(EMBER_MEM_VM, sizeof(BytecodeChunk));
     if (!chunk) {
-        fprintf(stderr, "Error: Memory allocation failed for BytecodeChunk.\n");
+        output_sink_error("Error: Memory allocation failed for BytecodeChunk.\n");
         return NULL;
     }
     chunk->code = NULL;
@@ -22,18 +32,36 @@ BytecodeChunk* vm_create_chunk() {
     chunk->constants_count = 0;
     chunk->constants_capacity = 0;
 
+    chunk->max_stack_depth = 0;
+
+    chunk->lines = NULL;
+    chunk->line_count = 0;
+    chunk->line_capacity = 0;
+
+    chunk->property_cache_count = 0;
+
     return chunk;
 }
 
 void vm_free_chunk(BytecodeChunk* chunk) {
     if (!chunk) return;
-    if (chunk->code) free(chunk->code);
+    if (chunk->code) ember_free(chunk->code);
     if (chunk->constants) {
-        // Strings or other allocated data in constants,
-        // we might free them individually here.
-        free(chunk->constants);
+        for (int i = 0; i < chunk->constants_count; i++) {
+            RuntimeValue* c = &chunk->constants[i];
+            if (c->type == RUNTIME_VALUE_STRING) {
+                string_release(c->string_value);
+            } else if (c->type == RUNTIME_VALUE_FUNCTION &&
+                c->function_value.function_type == FUNCTION_TYPE_BYTECODE &&
+                c->function_value.bytecode_function) {
+                ember_free(c->function_value.bytecode_function->name);
+                ember_free(c->function_value.bytecode_function);
+            }
+        }
+        ember_free(chunk->constants);
     }
-    free(chunk);
+    ember_free(chunk->lines);
+    ember_free(chunk);
 }
 
 static void ensure_code_capacity(BytecodeChunk* chunk, int additional) {
@@ -45,9 +73,9 @@ static void ensure_code_capacity(BytecodeChunk* chunk, int additional) {
     while (new_capacity < required) {
         new_capacity *= 2;
     }
-    uint8_t* new_code = (uint8_t*)realloc(chunk->code, new_capacity * sizeof(uint8_t));
+    uint8_t* new_code = (uint8_t*)ember_realloc(EMBER_MEM_VM, chunk->code, new_capacity * sizeof(uint8_t));
     if (!new_code) {
-        fprintf(stderr, "Error: Memory allocation failed for code reallocation.\n");
+        output_sink_error("Error: Memory allocation failed for code reallocation.\n");
         return;
     }
     chunk->code = new_code;
@@ -60,15 +88,60 @@ void vm_chunk_write_byte(BytecodeChunk* chunk, uint8_t byte) {
     chunk->code_count++;
 }
 
+void vm_chunk_mark_line(BytecodeChunk* chunk, int line) {
+    if (!chunk || line < 1) return;
+    if (chunk->line_count > 0) {
+        LineRun* last = &chunk->lines[chunk->line_count - 1];
+        if (last->line == line) return;
+        if (last->offset == chunk->code_count) {
+            // Nothing was emitted for the previous line
+            last->line = line;
+            if (chunk->line_count > 1 && chunk->lines[chunk->line_count - 2].line == line) {
+                chunk->line_count--;
+            }
+            return;
+        }
+    }
+    if (chunk->line_count == chunk->line_capacity) {
+        int new_capacity = chunk->line_capacity < 8 ? 8 : chunk->line_capacity * 2;
+        LineRun* lines = (LineRun*)ember_realloc(EMBER_MEM_VM, chunk->lines, sizeof(LineRun) * new_capacity);
+        if (!lines) {
+            output_sink_error("Error: Memory allocation failed for line table.\n");
+            return;
+        }
+        chunk->lines = lines;
+        chunk->line_capacity = new_capacity;
+    }
+    chunk->lines[chunk->line_count].offset = chunk->code_count;
+    chunk->lines[chunk->line_count].line = line;
+    chunk->line_count++;
+}
+
+int vm_chunk_line_at(const BytecodeChunk* chunk, int offset) {
+    if (!chunk || chunk->line_count == 0 || offset < chunk->lines[0].offset) return 0;
+    // Last run starting at or before `offset`
+    int lo = 0;
+    int hi = chunk->line_count - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (chunk->lines[mid].offset <= offset) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return chunk->lines[lo].line;
+}
+
 static void ensure_constants_capacity(BytecodeChunk* chunk) {
     if (chunk->constants_count < chunk->constants_capacity) return;
     int new_capacity = (chunk->constants_capacity < 8) ? 8 : chunk->constants_capacity * 2;
-    RuntimeValue* new_constants = (RuntimeValue*)realloc(
+    RuntimeValue* new_constants = (RuntimeValue*)ember_realloc(EMBER_MEM_VM, 
         chunk->constants,
         new_capacity * sizeof(RuntimeValue)
     );
     if (!new_constants) {
-        fprintf(stderr, "Error: Memory allocation failed for constants reallocation.\n");
+        output_sink_error("Error: Memory allocation failed for constants reallocation.\n");
         return;
     }
     chunk->constants = new_constants;
@@ -87,39 +160,264 @@ int vm_chunk_add_constant(BytecodeChunk* chunk, RuntimeValue value) {
    ---------------- */
 
 VM* vm_create(BytecodeChunk* chunk) {
-    VM* vm = (VM*)malloc(sizeof(VM));
+    VM* vm = (VM*)ember_malloc(EMBER_MEM_VM, sizeof(VM));
     if (!vm) {
-        fprintf(stderr, "Error: Memory allocation failed for VM.\n");
+        output_sink_error("Error: Memory allocation failed for VM.\n");
         return NULL;
     }
     vm->chunk = chunk;
     vm->ip = chunk->code; // Start at the beginning of the code
 
-    // TODO(SD) For now, let's pick a default stack size
-    vm->stack_capacity = 256;
-    vm->stack = (RuntimeValue*)malloc(sizeof(RuntimeValue) * vm->stack_capacity);
+    // Size the stack from the compiler's depth analysis; it grows if that was
+    // unknown (e.g. hand-built chunks) or too small.
+    vm->stack_capacity = chunk->max_stack_depth > VM_MIN_STACK_CAPACITY
+        ? chunk->max_stack_depth
+        : VM_MIN_STACK_CAPACITY;
+    vm->stack_limit = VM_DEFAULT_STACK_LIMIT;
+    if (vm->stack_capacity > vm->stack_limit) {
+        vm->stack_capacity = vm->stack_limit;
+    }
+    vm->stack = (RuntimeValue*)ember_malloc(EMBER_MEM_VM, sizeof(RuntimeValue) * vm->stack_capacity);
+    if (!vm->stack) {
+        output_sink_error("Error: Memory allocation failed for VM stack.\n");
+        ember_free(vm);
+        return NULL;
+    }
     vm->stack_top = vm->stack;
-    // Initialize the stack with nulls if you want
-    for (int i = 0; i < vm->stack_capacity; i++) {
-        vm->stack[i].type = RUNTIME_VALUE_NULL;
+    vm->error_jump = NULL;
+
+    vm->globals = (RuntimeValue*)ember_malloc(EMBER_MEM_VM, sizeof(RuntimeValue) * VM_MAX_GLOBALS);
+    if (!vm->globals) {
+        output_sink_error("Error: Memory allocation failed for VM globals.\n");
+        ember_free(vm->stack);
+        ember_free(vm);
+        return NULL;
+    }
+    for (int i = 0; i < VM_MAX_GLOBALS; i++) {
+        vm->globals[i].type = RUNTIME_VALUE_NULL;
+    }
+
+    vm->frame_count = 0;
+    vm->frames_changing = 0;
+    vm->frame_capacity = VM_INITIAL_FRAMES;
+    vm->frames = (CallFrame*)ember_malloc(EMBER_MEM_VM, sizeof(CallFrame) * vm->frame_capacity);
+    if (!vm->frames) {
+        output_sink_error("Error: Memory allocation failed for VM call frames.\n");
+        ember_free(vm->globals);
+        ember_free(vm->stack);
+        ember_free(vm);
+        return NULL;
+    }
+
+    memset(&vm->root, 0, sizeof(vm->root));
+    vm->root.status = COROUTINE_RUNNING;
+    vm->current = &vm->root;
+    vm->coroutines = NULL;
+
+    vm->fuel = VM_UNLIMITED_FUEL;
+    vm->fuel_per_run = 0;
+    vm->wait_kind = VM_WAIT_NONE;
+    vm->wait_ms = 0;
+    vm->wait_event = NULL;
+    vm->wait_event_name = NULL;
+    vm->profile = NULL;
+
+    // Caches start empty; a site fills its entries the first time it runs
+    vm->property_cache_count = chunk->property_cache_count;
+    vm->property_caches = NULL;
+    if (vm->property_cache_count > 0) {
+        vm->property_caches = (PropertyCache*)ember_calloc(EMBER_MEM_VM, vm->property_cache_count,
+                                                           sizeof(PropertyCache));
+        if (!vm->property_caches) {
+            // Every site then takes the uncached path
+            vm->property_cache_count = 0;
+        }
     }
 
     return vm;
 }
 
+RuntimeValue vm_get_global(const VM* vm, int index) {
+    if (!vm || index < 0 || index >= VM_MAX_GLOBALS) {
+        RuntimeValue v; v.type = RUNTIME_VALUE_NULL;
+        return v;
+    }
+    return vm->globals[index];
+}
+
+void vm_set_profile(VM* vm, VMProfile* profile) {
+    if (!vm) return;
+    vm->profile = profile;
+}
+
+const char* vm_opcode_name(int opcode) {
+    static const char* const names[] = {
+        "NOOP", "EOF", "POP", "DUP", "SWAP",
+        "LOAD_CONST", "LOAD_VAR", "STORE_VAR", "LOAD_GLOBAL", "STORE_GLOBAL",
+        "LOAD_UPVALUE", "STORE_UPVALUE",
+        "ADD", "SUB", "MUL", "DIV", "MOD", "NEG",
+        "NOT", "AND", "OR", "EQ", "NEQ", "LT", "GT", "LTE", "GTE",
+        "JUMP", "JUMP_IF_FALSE", "JUMP_IF_TRUE", "LOOP",
+        "CALL", "RETURN",
+        "NEW_ARRAY", "ARRAY_PUSH", "GET_INDEX", "SET_INDEX",
+        "NEW_OBJECT", "SET_PROPERTY", "GET_PROPERTY",
+        "PRINT", "TO_STRING",
+        "YIELD", "RESUME",
+        "THROW", "TRY_CATCH",
+        "LOAD_LOCAL", "STORE_LOCAL", "NEW_COROUTINE",
+        "SLEEP", "WAIT_EVENT",
+        "LEN", "SLICE", "CALL_NATIVE"
+    };
+    if (opcode < 0 || opcode >= (int)(sizeof(names) / sizeof(names[0]))) {
+        return "UNKNOWN";
+    }
+    return names[opcode];
+}
+
+void vm_set_fuel(VM* vm, long fuel) {
+    if (!vm) return;
+    vm->fuel_per_run = fuel > 0 ? fuel : 0;
+}
+
+void vm_set_stack_limit(VM* vm, int max_slots) {
+    if (!vm || max_slots < 1) return;
+    vm->stack_limit = max_slots;
+}
+
+// Release every value in [from, to)
+static void vm_release_values(RuntimeValue* from, RuntimeValue* to) {
+    for (RuntimeValue* value = from; value < to; value++) {
+        runtime_free_value(value);
+    }
+}
+
 void vm_free(VM* vm) {
     if (!vm) return;
+
+    // If a coroutine is running, the VM registers hold its stack and the
+    // main context's are parked in `root`
+    if (vm->current != &vm->root) {
+        vm->current->stack = vm->stack;
+        vm->current->stack_top = vm->stack_top;
+        vm->current->frames = vm->frames;
+        vm->stack = vm->root.stack;
+        vm->stack_top = vm->root.stack_top;
+        vm->frames = vm->root.frames;
+    }
+
+    // A finished coroutine's stack is already gone (and its values released)
+    Coroutine* co = vm->coroutines;
+    while (co) {
+        Coroutine* next = co->next;
+        if (co->stack) {
+            vm_release_values(co->stack, co->stack_top);
+        }
+        ember_free(co->stack);
+        ember_free(co->frames);
+        ember_free(co);
+        co = next;
+    }
+
     if (vm->stack) {
-        // Free each stack element if needed
-        free(vm->stack);
+        vm_release_values(vm->stack, vm->stack_top);
+        ember_free(vm->stack);
+    }
+    ember_free(vm->frames);
+    vm_release_values(vm->globals, vm->globals + VM_MAX_GLOBALS);
+    ember_free(vm->globals);
+    string_release(vm->wait_event_name);
+    ember_free(vm->property_caches);
+    ember_free(vm);
+}
+
+/**
+ * Truthiness used by conditional jumps and the logical operators:
+ * false, 0 and null are false, everything else is true.
+ */
+static bool vm_is_truthy(RuntimeValue value) {
+    switch (value.type) {
+        case RUNTIME_VALUE_BOOLEAN: return value.boolean_value;
+        case RUNTIME_VALUE_NUMBER:  return value.number_value != 0;
+        case RUNTIME_VALUE_NULL:    return false;
+        default:                    return true;
+    }
+}
+
+/**
+ * Inline cache of property site `index`, or NULL if the site is uncached
+ * (VM_PROPERTY_CACHE_NONE, or caches could not be allocated).
+ */
+static inline PropertyCache* vm_property_cache(VM* vm, int index) {
+    return index < vm->property_cache_count ? &vm->property_caches[index] : NULL;
+}
+
+static inline const PropertyCacheEntry* vm_property_cache_find(const PropertyCache* cache,
+                                                              const Shape* shape) {
+    if (!cache) return NULL;
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i].shape == shape) {
+            return &cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Remember `shape` at a site. Once a site has seen more shapes than it has
+ * ways it is megamorphic: the entries are dropped and it stays uncached.
+ */
+static void vm_property_cache_add(PropertyCache* cache, const Shape* shape,
+                                  const Shape* transition, int slot) {
+    if (!cache || cache->megamorphic) return;
+    if (cache->count == VM_PROPERTY_CACHE_WAYS) {
+        cache->megamorphic = true;
+        cache->count = 0;
+        return;
+    }
+    PropertyCacheEntry* entry = &cache->entries[cache->count++];
+    entry->shape = shape;
+    entry->transition = transition;
+    entry->slot = slot;
+}
+
+/**
+ * Grow the operand stack so at least `needed` more slots fit.
+ * Returns false if that would exceed `stack_limit` or allocation fails.
+ */
+static bool vm_grow_stack(VM* vm, int needed) {
+    int used = (int)(vm->stack_top - vm->stack);
+    if (used + needed > vm->stack_limit) {
+        return false;
     }
-    free(vm);
+
+    int new_capacity = vm->stack_capacity * 2;
+    while (new_capacity < used + needed) {
+        new_capacity *= 2;
+    }
+    if (new_capacity > vm->stack_limit) {
+        new_capacity = vm->stack_limit;
+    }
+
+    RuntimeValue* new_stack = (RuntimeValue*)ember_realloc(EMBER_MEM_VM, vm->stack, sizeof(RuntimeValue) * new_capacity);
+    if (!new_stack) {
+        return false;
+    }
+
+    // Anything holding a raw pointer into the stack must be rebased here;
+    // today that is only stack_top.
+    vm->stack = new_stack;
+    vm->stack_top = new_stack + used;
+    vm->stack_capacity = new_capacity;
+    return true;
 }
 
 void vm_push(VM* vm, RuntimeValue value) {
-    // Check for overflow
-    if (vm->stack_top - vm->stack >= vm->stack_capacity) {
-        fprintf(stderr, "VM Error: Stack overflow.\n");
+    if (vm->stack_top - vm->stack >= vm->stack_capacity && !vm_grow_stack(vm, 1)) {
+        output_sink_error("VM Error: Stack overflow (limit %d slots).\n", vm->stack_limit);
+        runtime_free_value(&value);
+        if (vm->error_jump) {
+            longjmp(*vm->error_jump, VM_RESULT_STACK_OVERFLOW);
+        }
         return;
     }
     *vm->stack_top = value;
@@ -129,7 +427,7 @@ void vm_push(VM* vm, RuntimeValue value) {
 RuntimeValue vm_pop(VM* vm) {
     // Check for underflow
     if (vm->stack_top == vm->stack) {
-        fprintf(stderr, "VM Error: Stack underflow.\n");
+        output_sink_error("VM Error: Stack underflow.\n");
         RuntimeValue v; v.type = RUNTIME_VALUE_NULL;
         return v;
     }
@@ -142,509 +440,227 @@ static RuntimeValue vm_peek(VM* vm, int distance) {
     return vm->stack_top[-1 - distance];
 }
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
-
-#include "virtual_machine.h"
-#include "runtime.h"
-
-/**
- * For now, let's store variables in a fixed global array.
- * The compiler assigns each variable an index (0..255).
- */
-static RuntimeValue g_globals[256]; // You can adapt as needed
-
-int vm_run(VM* vm) {
-    for (;;) {
-        // Fetch the next instruction
-        uint8_t instruction = *vm->ip++;
-
-        switch (instruction) {
-
-            case OP_NOOP: {
-                // do nothing
-                break;
-            }
-
-            case OP_EOF: {
-                // End of the bytecode
-                return 0;
-            }
-
-            case OP_POP: {
-                // Pop and discard top of stack
-                vm_pop(vm);
-                break;
-            }
-
-            case OP_DUP: {
-                // Duplicate the top stack value
-                RuntimeValue topVal = vm_pop(vm);
-                vm_push(vm, topVal);
-                vm_push(vm, topVal);
-                break;
-            }
-
-            case OP_SWAP: {
-                // Swap top two stack items
-                RuntimeValue a = vm_pop(vm);
-                RuntimeValue b = vm_pop(vm);
-                vm_push(vm, a);
-                vm_push(vm, b);
-                break;
-            }
-
-            /* -----------------------------
-               Constants & Variables
-               ----------------------------- */
-            case OP_LOAD_CONST: {
-                // The next byte is the index into constants
-                uint8_t const_index = *vm->ip++;
-                RuntimeValue c = vm->chunk->constants[const_index];
-                vm_push(vm, c);
-                break;
-            }
-
-            case OP_LOAD_VAR: {
-                // The next byte is the variable index
-                uint8_t varIndex = *vm->ip++;
-                vm_push(vm, g_globals[varIndex]);
-                break;
-            }
-
-            case OP_STORE_VAR: {
-                // The next byte is the variable index
-                uint8_t varIndex = *vm->ip++;
-                // Pop top of stack and store in global array
-                RuntimeValue value = vm_pop(vm);
-                g_globals[varIndex] = value;
-                // push it back for language’s assignment returning value
-                // vm_push(vm, value);
-                break;
-            }
-
-            /* -----------------------------
-               Arithmetic & Logic
-               ----------------------------- */
-            case OP_ADD: {
-                RuntimeValue b = vm_pop(vm);
-                RuntimeValue a = vm_pop(vm);
-
-                // 1) string + string
-                if (a.type == RUNTIME_VALUE_STRING && b.type == RUNTIME_VALUE_STRING) {
-                    size_t lenA = strlen(a.string_value);
-                    size_t lenB = strlen(b.string_value);
-                    char* newStr = (char*)malloc(lenA + lenB + 1);
-                    if (!newStr) {
-                        fprintf(stderr, "VM Error: Memory allocation failed for string concat.\n");
-                        return 1;
-                    }
-                    strcpy(newStr, a.string_value);
-                    strcat(newStr, b.string_value);
-
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_STRING;
-                    result.string_value = newStr;
-                    vm_push(vm, result);
-                }
-                // 2) string + X
-                else if (a.type == RUNTIME_VALUE_STRING) {
-                    // Convert b to string, then do string+string
-                    char* bStr = runtime_value_to_string(&b);
-                    if (!bStr) {
-                        fprintf(stderr, "VM Error: Failed to convert operand to string.\n");
-                        return 1;
-                    }
-                    size_t lenA = strlen(a.string_value);
-                    size_t lenB = strlen(bStr);
-                    char* newStr = (char*)malloc(lenA + lenB + 1);
-                    if (!newStr) {
-                        fprintf(stderr, "VM Error: Memory allocation failed for string concat.\n");
-                        free(bStr);
-                        return 1;
-                    }
-                    strcpy(newStr, a.string_value);
-                    strcat(newStr, bStr);
-
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_STRING;
-                    result.string_value = newStr;
-                    vm_push(vm, result);
-
-                    free(bStr);  // done using the temporary string
-                }
-                // 3) X + string
-                else if (b.type == RUNTIME_VALUE_STRING) {
-                    // Convert a to string, then do string+string
-                    char* aStr = runtime_value_to_string(&a);
-                    if (!aStr) {
-                        fprintf(stderr, "VM Error: Failed to convert operand to string.\n");
-                        return 1;
-                    }
-                    size_t lenA = strlen(aStr);
-                    size_t lenB = strlen(b.string_value);
-                    char* newStr = (char*)malloc(lenA + lenB + 1);
-                    if (!newStr) {
-                        fprintf(stderr, "VM Error: Memory allocation failed for string concat.\n");
-                        free(aStr);
-                        return 1;
-                    }
-                    strcpy(newStr, aStr);
-                    strcat(newStr, b.string_value);
-
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_STRING;
-                    result.string_value = newStr;
-                    vm_push(vm, result);
-
-                    free(aStr);  // done using the temporary string
-                }
-                // 4) number + number
-                else if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_NUMBER;
-                    result.number_value = a.number_value + b.number_value;
-                    vm_push(vm, result);
-                }
-                // 5) fallback error
-                else {
-                    fprintf(stderr, "VM Error: OP_ADD cannot handle these operand types.\n");
-                    return 1;
-                }
-                break;
-            }
-            case OP_SUB: {
-                RuntimeValue b = vm_pop(vm);
-                RuntimeValue a = vm_pop(vm);
-                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_NUMBER;
-                    result.number_value = a.number_value - b.number_value;
-                    vm_push(vm, result);
-                } else {
-                    fprintf(stderr, "VM Error: OP_SUB expects two numbers.\n");
-                    return 1;
-                }
-                break;
-            }
+/* ----------------
+   Calls & Coroutines
+   ---------------- */
 
-            case OP_MUL: {
-                RuntimeValue b = vm_pop(vm);
-                RuntimeValue a = vm_pop(vm);
-                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_NUMBER;
-                    result.number_value = a.number_value * b.number_value;
-                    vm_push(vm, result);
-                } else {
-                    fprintf(stderr, "VM Error: OP_MUL expects two numbers.\n");
-                    return 1;
-                }
-                break;
-            }
+// A sampling profiler may interrupt this thread at any instruction and walk
+// `vm->frames`. Bracket every point where the array is freed, moved or
+// swapped for another context so it skips those samples instead. The fences
+// only stop the compiler from moving the frame updates across the flag.
+static inline void vm_frames_begin_change(VM* vm) {
+    vm->frames_changing++;
+    atomic_signal_fence(memory_order_seq_cst);
+}
 
-            case OP_DIV: {
-                RuntimeValue b = vm_pop(vm);
-                RuntimeValue a = vm_pop(vm);
-                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
-                    if (b.number_value == 0) {
-                        fprintf(stderr, "VM Error: Division by zero.\n");
-                        return 1;
-                    }
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_NUMBER;
-                    result.number_value = a.number_value / b.number_value;
-                    vm_push(vm, result);
-                } else {
-                    fprintf(stderr, "VM Error: OP_DIV expects two numbers.\n");
-                    return 1;
-                }
-                break;
-            }
+static inline void vm_frames_end_change(VM* vm) {
+    atomic_signal_fence(memory_order_seq_cst);
+    vm->frames_changing--;
+}
 
-            case OP_MOD: {
-                // a % b
-                RuntimeValue b = vm_pop(vm);
-                RuntimeValue a = vm_pop(vm);
-                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
-                    if (b.number_value == 0) {
-                        fprintf(stderr, "VM Error: Modulo by zero.\n");
-                        return 1;
-                    }
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_NUMBER;
-                    // Use fmod for floating mod
-                    result.number_value = fmod(a.number_value, b.number_value);
-                    vm_push(vm, result);
-                } else {
-                    fprintf(stderr, "VM Error: OP_MOD expects two numbers.\n");
-                    return 1;
-                }
-                break;
+static void vm_push_frame(VM* vm, const BytecodeFunction* fn, uint8_t* return_ip, int base) {
+    if (vm->frame_count == vm->frame_capacity) {
+        int new_capacity = vm->frame_capacity * 2;
+        CallFrame* frames = NULL;
+        vm_frames_begin_change(vm);
+        if (vm->frame_capacity < vm->stack_limit) {
+            frames = (CallFrame*)ember_realloc(EMBER_MEM_VM, vm->frames, sizeof(CallFrame) * new_capacity);
+        }
+        if (!frames) {
+            vm_frames_end_change(vm);
+            output_sink_error("VM Error: Call stack overflow (limit %d frames).\n", vm->stack_limit);
+            if (vm->error_jump) {
+                longjmp(*vm->error_jump, VM_RESULT_STACK_OVERFLOW);
             }
+            return;
+        }
+        vm->frames = frames;
+        vm->frame_capacity = new_capacity;
+        vm_frames_end_change(vm);
+    }
+    vm->frames[vm->frame_count].return_ip = return_ip;
+    vm->frames[vm->frame_count].base = base;
+    vm->frames[vm->frame_count].function = fn;
+    // Publish the frame only once it is filled in
+    atomic_signal_fence(memory_order_release);
+    vm->frame_count++;
+}
 
-            case OP_NEG: {
-                // Unary negation
-                RuntimeValue val = vm_pop(vm);
-                if (val.type == RUNTIME_VALUE_NUMBER) {
-                    val.number_value = -val.number_value;
-                    vm_push(vm, val);
-                } else {
-                    fprintf(stderr, "VM Error: OP_NEG expects a number.\n");
-                    return 1;
-                }
-                break;
-            }
+// The top `arg_count` stack values are the arguments. Extra arguments are
+// dropped, missing ones and the function's locals start as null.
+static void vm_enter_function(VM* vm, const BytecodeFunction* fn, int arg_count, uint8_t* return_ip) {
+    if (arg_count > fn->arity) {
+        vm_release_values(vm->stack_top - (arg_count - fn->arity), vm->stack_top);
+        vm->stack_top -= arg_count - fn->arity;
+        arg_count = fn->arity;
+    }
+    int base = (int)(vm->stack_top - vm->stack) - arg_count;
+    RuntimeValue nullVal;
+    nullVal.type = RUNTIME_VALUE_NULL;
+    for (int i = arg_count; i < fn->local_count; i++) {
+        vm_push(vm, nullVal);
+    }
+    vm_push_frame(vm, fn, return_ip, base);
+    vm->ip = vm->chunk->code + fn->entry;
+}
 
-            case OP_NOT: {
-                // Logical NOT
-                RuntimeValue val = vm_pop(vm);
-                if (val.type == RUNTIME_VALUE_BOOLEAN) {
-                    val.boolean_value = !val.boolean_value;
-                    vm_push(vm, val);
-                } else {
-                    // Non-boolean? Convert to boolean “truthiness” then invert
-                    bool truthy = false;
-                    if (val.type == RUNTIME_VALUE_NUMBER) {
-                        truthy = (val.number_value != 0);
-                    } else if (val.type == RUNTIME_VALUE_STRING) {
-                        truthy = (val.string_value && val.string_value[0] != '\0');
-                    }
-                    RuntimeValue result;
-                    result.type = RUNTIME_VALUE_BOOLEAN;
-                    result.boolean_value = !truthy;
-                    vm_push(vm, result);
-                }
-                break;
-            }
+static void vm_save_context(VM* vm, Coroutine* co) {
+    co->ip = vm->ip;
+    co->stack = vm->stack;
+    co->stack_top = vm->stack_top;
+    co->stack_capacity = vm->stack_capacity;
+    co->frames = vm->frames;
+    co->frame_count = vm->frame_count;
+    co->frame_capacity = vm->frame_capacity;
+}
 
-            case OP_EQ: 
-            case OP_NEQ:
-            case OP_LT:
-            case OP_GT:
-            case OP_LTE:
-            case OP_GTE: {
-                RuntimeValue b = vm_pop(vm);
-                RuntimeValue a = vm_pop(vm);
-                RuntimeValue result;
-                result.type = RUNTIME_VALUE_BOOLEAN;
-                bool comparison = false;
-
-                // For simplicity, only handle numbers
-                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
-                    double x = a.number_value;
-                    double y = b.number_value;
-
-                    switch (instruction) {
-                        case OP_EQ:  comparison = (x == y); break;
-                        case OP_NEQ: comparison = (x != y); break;
-                        case OP_LT:  comparison = (x <  y); break;
-                        case OP_GT:  comparison = (x >  y); break;
-                        case OP_LTE: comparison = (x <= y); break;
-                        case OP_GTE: comparison = (x >= y); break;
-                        default: break;
-                    }
-                }
-                else {
-                    // String == string, etc., handle here
-                    if (instruction == OP_EQ || instruction == OP_NEQ) {
-                        // As a naive fallback, treat different types as 'not equal'
-                        bool equal = false;
-                        if (a.type == b.type) {
-                            // Check equality for booleans, strings, etc.
-                            if (a.type == RUNTIME_VALUE_BOOLEAN) {
-                                equal = (a.boolean_value == b.boolean_value);
-                            } else if (a.type == RUNTIME_VALUE_STRING && b.string_value && a.string_value) {
-                                equal = (strcmp(a.string_value, b.string_value) == 0);
-                            } else if (a.type == RUNTIME_VALUE_NULL) {
-                                equal = true; // both null
-                            }
-                        }
-                        comparison = equal;
-                        if (instruction == OP_NEQ) comparison = !comparison;
-                    }
-                }
-
-                result.boolean_value = comparison;
-                vm_push(vm, result);
-                break;
-            }
+static void vm_load_context(VM* vm, Coroutine* co) {
+    vm_frames_begin_change(vm);
+    vm->ip = co->ip;
+    vm->stack = co->stack;
+    vm->stack_top = co->stack_top;
+    vm->stack_capacity = co->stack_capacity;
+    vm->frames = co->frames;
+    vm->frame_count = co->frame_count;
+    vm->frame_capacity = co->frame_capacity;
+    vm->current = co;
+    co->status = COROUTINE_RUNNING;
+    vm_frames_end_change(vm);
+}
 
-            /* -----------------------------
-               Branching (Jumps)
-               ----------------------------- */
-            case OP_JUMP_IF_FALSE: {
-                // 16-bit offset
-                uint16_t offset = (uint16_t)(((*vm->ip++) << 8) | (*vm->ip++));
-                RuntimeValue cond = vm_pop(vm);
-
-                // Evaluate as boolean
-                bool isFalse = false;
-                if (cond.type == RUNTIME_VALUE_BOOLEAN) {
-                    isFalse = (cond.boolean_value == false);
-                }
-                else if (cond.type == RUNTIME_VALUE_NUMBER) {
-                    isFalse = (cond.number_value == 0);
-                }
-                else if (cond.type == RUNTIME_VALUE_NULL) {
-                    isFalse = true;
-                }
-
-                if (isFalse) {
-                    vm->ip += offset;  // jump forward
-                }
-                break;
-            }
+static Coroutine* vm_new_coroutine(VM* vm, RuntimeValue function) {
+    Coroutine* co = (Coroutine*)ember_calloc(EMBER_MEM_VM, 1, sizeof(Coroutine));
+    if (!co) {
+        return NULL;
+    }
+    co->stack = (RuntimeValue*)ember_malloc(EMBER_MEM_VM, sizeof(RuntimeValue) * VM_COROUTINE_STACK_SLOTS);
+    co->frames = (CallFrame*)ember_malloc(EMBER_MEM_VM, sizeof(CallFrame) * VM_COROUTINE_FRAMES);
+    if (!co->stack || !co->frames) {
+        ember_free(co->stack);
+        ember_free(co->frames);
+        ember_free(co);
+        return NULL;
+    }
+    co->function = function;
+    co->status = COROUTINE_SUSPENDED;
+    co->stack_top = co->stack;
+    co->stack_capacity = VM_COROUTINE_STACK_SLOTS;
+    co->frame_capacity = VM_COROUTINE_FRAMES;
+
+    co->next = vm->coroutines;
+    vm->coroutines = co;
+    return co;
+}
 
-            case OP_JUMP: {
-                // unconditional jump
-                uint16_t offset = (uint16_t)(((*vm->ip++) << 8) | (*vm->ip++));
-                vm->ip += offset;
-                break;
-            }
+// Switch from the running coroutine back to whoever resumed it, handing
+// over `value` as the result of their resume.
+static void vm_return_to_caller(VM* vm, RuntimeValue value) {
+    Coroutine* co = vm->current;
+    Coroutine* caller = co->caller;
+    co->caller = NULL;
+    vm_load_context(vm, caller);
+    vm_push(vm, value);
+}
 
-            case OP_LOOP: {
-                // jump backward by offset
-                uint16_t offset = (uint16_t)(((*vm->ip++) << 8) | (*vm->ip++));
-                vm->ip -= offset; // Move IP *backwards*
-                break;
-            }
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
 
-            /* -----------------------------
-               Functions & Return
-               ----------------------------- */
-            case OP_CALL: {
-                // For a minimal pass, handle built-in calls or do placeholders
-                // Byte 1: function index, Byte 2: argCount
-                uint8_t funcIndex = *vm->ip++;
-                uint8_t argCount  = *vm->ip++;
-                
-                // If we have user-defined functions with real call frames, we would implement them here.
-                // For now, just do nothing or handle built-ins.
-
-                // e.g. no-op placeholder
-                (void)funcIndex;
-                (void)argCount;
-                break;
-            }
+#include "virtual_machine.h"
+#include "vm_profile.h"
+#include "runtime.h"
 
-            case OP_RETURN: {
-                // Typically we would pop a return value, handle call frames, etc.
-                // For now, let’s just return success from vm_run.
-                return 0;
-            }
+// Read a big-endian 16-bit operand and advance past it
+#define READ_SHORT(vm) ((vm)->ip += 2, (uint16_t)(((vm)->ip[-2] << 8) | (vm)->ip[-1]))
+
+static int vm_execute(VM* vm);
+static int vm_execute_profiled(VM* vm);
+
+// After an error, print the line being executed and the line of every
+// pending call, innermost first. Silent for chunks without a line table.
+static void vm_report_error_location(VM* vm) {
+    const BytecodeChunk* chunk = vm->chunk;
+    if (chunk->line_count == 0 || !vm->ip) return;
+
+    int line = vm_chunk_line_at(chunk, (int)(vm->ip - chunk->code) - 1);
+    for (int i = vm->frame_count - 1; i >= -1; i--) {
+        const char* name = "<script>";
+        if (i >= 0) {
+            const BytecodeFunction* fn = vm->frames[i].function;
+            name = fn && fn->name ? fn->name : "<anonymous>";
+        }
+        if (line > 0) {
+            output_sink_error("  [line %d] in %s\n", line, name);
+        }
+        if (i < 0 || !vm->frames[i].return_ip) {
+            break; // Reached the script, or a coroutine body's outermost frame
+        }
+        line = vm_chunk_line_at(chunk, (int)(vm->frames[i].return_ip - chunk->code) - 1);
+    }
+}
 
-            /* -----------------------------
-               Arrays / Indexing
-               ----------------------------- */
-            case OP_NEW_ARRAY: {
-                // Create a new array (RUNTIME_VALUE_ARRAY with 0 elements)
-                RuntimeValue arr;
-                arr.type = RUNTIME_VALUE_ARRAY;
-                arr.array_value.count = 0;
-                arr.array_value.elements = NULL; // empty
-
-                vm_push(vm, arr);
-                break;
-            }
+static int vm_execute_protected(VM* vm) {
+    vm->wait_kind = VM_WAIT_NONE;
+    vm->wait_event = NULL;
+    string_release(vm->wait_event_name);
+    vm->wait_event_name = NULL;
+
+    // Stack overflow raised from vm_push unwinds to here
+    jmp_buf handler;
+    jmp_buf* outer = vm->error_jump;
+    vm->error_jump = &handler;
+
+    int status;
+    if (setjmp(handler) == 0) {
+        // Picked once per run, so the plain loop never checks for a profile
+        status = vm->profile ? vm_execute_profiled(vm) : vm_execute(vm);
+    } else {
+        status = VM_RESULT_STACK_OVERFLOW;
+    }
+    if (status == VM_RESULT_ERROR || status == VM_RESULT_STACK_OVERFLOW) {
+        vm_report_error_location(vm);
+    }
 
-            case OP_ARRAY_PUSH: {
-                // Expect: top => value, below => array
-                RuntimeValue val = vm_pop(vm);
-                RuntimeValue arr = vm_pop(vm);
-
-                if (arr.type != RUNTIME_VALUE_ARRAY) {
-                    fprintf(stderr, "VM Error: OP_ARRAY_PUSH on non-array.\n");
-                    return 1;
-                }
-
-                // Expand array by 1
-                int newCount = arr.array_value.count + 1;
-                RuntimeValue* newElems = realloc(
-                    arr.array_value.elements,
-                    newCount * sizeof(RuntimeValue)
-                );
-                if (!newElems) {
-                    fprintf(stderr, "VM Error: Array push reallocation failed.\n");
-                    return 1;
-                }
-                newElems[arr.array_value.count] = val;
-                arr.array_value.elements = newElems;
-                arr.array_value.count = newCount;
-
-                // Push the updated array back
-                vm_push(vm, arr);
-                break;
-            }
+    vm->error_jump = outer;
+    return status;
+}
 
-            case OP_GET_INDEX: {
-                // Expect: top => index, below => array
-                RuntimeValue indexVal = vm_pop(vm);
-                RuntimeValue arrVal   = vm_pop(vm);
-
-                if (arrVal.type != RUNTIME_VALUE_ARRAY) {
-                    fprintf(stderr, "VM Error: OP_GET_INDEX on non-array.\n");
-                    return 1;
-                }
-                if (indexVal.type != RUNTIME_VALUE_NUMBER) {
-                    fprintf(stderr, "VM Error: OP_GET_INDEX requires numeric index.\n");
-                    return 1;
-                }
-
-                int idx = (int)indexVal.number_value;
-                if (idx < 0 || idx >= arrVal.array_value.count) {
-                    fprintf(stderr, "VM Error: Array index %d out of bounds.\n", idx);
-                    return 1;
-                }
-
-                // Retrieve element
-                RuntimeValue element = arrVal.array_value.elements[idx];
-                vm_push(vm, element);
-                break;
-            }
+int vm_run_slice(VM* vm, long budget) {
+    vm->fuel = budget > 0 ? budget : VM_UNLIMITED_FUEL;
+    return vm_execute_protected(vm);
+}
 
-            /* -----------------------------
-               Printing, etc.
-               ----------------------------- */
-            case OP_PRINT: {
-                // pop top
-                RuntimeValue v = vm_pop(vm);
-
-                // Convert to string (your runtime has a helper, or do a quick approach):
-                if (v.type == RUNTIME_VALUE_NUMBER) {
-                    printf("%g\n", v.number_value);
-                }
-                else if (v.type == RUNTIME_VALUE_STRING && v.string_value) {
-                    printf("%s\n", v.string_value);
-                }
-                else if (v.type == RUNTIME_VALUE_BOOLEAN) {
-                    printf("%s\n", v.boolean_value ? "true" : "false");
-                }
-                else if (v.type == RUNTIME_VALUE_NULL) {
-                    printf("null\n");
-                }
-                else {
-                    // For arrays or other objects, do something minimal:
-                    printf("[Object or Array]\n");
-                }
-                break;
-            }
+int vm_run(VM* vm) {
+    // Sleeping does not refill the tank; only the next vm_run() does
+    vm->fuel = vm->fuel_per_run > 0 ? vm->fuel_per_run : VM_UNLIMITED_FUEL;
+    for (;;) {
+        int status = vm_execute_protected(vm);
+        if (status != VM_RESULT_SUSPENDED) {
+            return status;
+        }
+        if (vm->wait_kind == VM_WAIT_EVENT) {
+            output_sink_error("VM Error: wait_event('%s') needs a scheduler to signal it.\n",
+                              vm->wait_event ? vm->wait_event : "");
+            return VM_RESULT_ERROR;
+        }
+        // No scheduler to hand the thread to; just block it
+        // Capped at INT32_MAX seconds (~68 years) so the cast fits any time_t
+        struct timespec ts;
+        double seconds = vm->wait_ms / 1000;
+        ts.tv_sec = seconds >= (double)INT32_MAX ? (time_t)INT32_MAX : (time_t)seconds;
+        ts.tv_nsec = (long)(fmod(vm->wait_ms, 1000) * 1000000);
+        nanosleep(&ts, NULL);
+    }
+}
 
-            case OP_TO_STRING: {
-                // If we want to convert the top value to a string in place
-                // For now, just skip or handle as needed
-                break;
-            }
+#define VM_DISPATCH_FN vm_execute
+#include "vm_dispatch.h"
+#undef VM_DISPATCH_FN
 
-            /* -----------------------------
-               Default (unknown opcode)
-               ----------------------------- */
-            default: {
-                fprintf(stderr, "VM Error: Unknown opcode %d.\n", instruction);
-                return 1;
-            }
-        } // end switch
-    } // end for
-}
+#define VM_DISPATCH_FN vm_execute_profiled
+#define VM_DISPATCH_PROFILE
+#include "vm_dispatch.h"
+#undef VM_DISPATCH_PROFILE
+#undef VM_DISPATCH_FN
@@ -0,0 +1,899 @@
+// vm_dispatch.h
+//
+// The VM's fetch/decode/execute loop. virtual_machine.c includes this file
+// twice: once as the plain loop, and once with VM_DISPATCH_PROFILE defined
+// to build the instrumented copy used by `emberc run --profile`, so the
+// plain loop carries no profiling code at all.
+//
+// Define VM_DISPATCH_FN to the function name before including.
+
+static int VM_DISPATCH_FN(VM* vm) {
+    for (;;) {
+#ifdef VM_DISPATCH_PROFILE
+        VMProfile* profile = vm->profile;
+        int offset = (int)(vm->ip - vm->chunk->code);
+        uint64_t started = vm_profile_clock();
+#endif
+        // Fetch the next instruction
+        uint8_t instruction = *vm->ip++;
+#ifdef VM_DISPATCH_PROFILE
+        profile->op_counts[instruction]++;
+        if (offset < profile->code_size) {
+            profile->offset_hits[offset]++;
+        }
+#endif
+
+        switch (instruction) {
+
+            case OP_NOOP: {
+                // do nothing
+                break;
+            }
+
+            case OP_EOF: {
+                // End of the bytecode
+                return 0;
+            }
+
+            case OP_POP: {
+                // Pop and discard top of stack
+                RuntimeValue discarded = vm_pop(vm);
+                runtime_free_value(&discarded);
+                break;
+            }
+
+            case OP_DUP: {
+                // Duplicate the top stack value; each slot holds its own reference
+                RuntimeValue topVal = vm_pop(vm);
+                vm_push(vm, runtime_value_copy(&topVal));
+                vm_push(vm, topVal);
+                break;
+            }
+
+            case OP_SWAP: {
+                // Swap top two stack items
+                RuntimeValue a = vm_pop(vm);
+                RuntimeValue b = vm_pop(vm);
+                vm_push(vm, a);
+                vm_push(vm, b);
+                break;
+            }
+
+            /* -----------------------------
+               Constants & Variables
+               ----------------------------- */
+            case OP_LOAD_CONST: {
+                // The next byte is the index into constants
+                uint8_t const_index = *vm->ip++;
+                // The chunk keeps its constants; the stack gets another reference
+                vm_push(vm, runtime_value_copy(&vm->chunk->constants[const_index]));
+                break;
+            }
+
+            case OP_LOAD_VAR: {
+                // The next byte is the variable index
+                uint8_t varIndex = *vm->ip++;
+                vm_push(vm, runtime_value_copy(&vm->globals[varIndex]));
+                break;
+            }
+
+            case OP_STORE_VAR: {
+                // The next byte is the variable index
+                uint8_t varIndex = *vm->ip++;
+                // Pop top of stack and store in this VM's global slots,
+                // releasing whatever the slot held before
+                RuntimeValue value = vm_pop(vm);
+                runtime_free_value(&vm->globals[varIndex]);
+                vm->globals[varIndex] = value;
+                // push it back for language’s assignment returning value
+                // vm_push(vm, value);
+                break;
+            }
+
+            /* -----------------------------
+               Arithmetic & Logic
+               ----------------------------- */
+            case OP_ADD: {
+                RuntimeValue b = vm_pop(vm);
+                RuntimeValue a = vm_pop(vm);
+
+                // 1) string + anything: strings are read in place, anything
+                //    else is formatted into scratch space first
+                if (a.type == RUNTIME_VALUE_STRING || b.type == RUNTIME_VALUE_STRING) {
+                    char aScratch[RUNTIME_VALUE_TEXT_SIZE];
+                    char bScratch[RUNTIME_VALUE_TEXT_SIZE];
+                    size_t aLength, bLength;
+                    const char* aText = runtime_value_text(&a, aScratch, &aLength);
+                    const char* bText = runtime_value_text(&b, bScratch, &bLength);
+                    ScriptString* newStr = string_concat(aText, aLength, bText, bLength);
+                    runtime_free_value(&a);
+                    runtime_free_value(&b);
+                    if (!newStr) {
+                        output_sink_error("VM Error: Memory allocation failed for string concat.\n");
+                        return 1;
+                    }
+
+                    RuntimeValue result;
+                    result.type = RUNTIME_VALUE_STRING;
+                    result.string_value = newStr;
+                    vm_push(vm, result);
+                }
+                // 2) number + number
+                else if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
+                    RuntimeValue result;
+                    result.type = RUNTIME_VALUE_NUMBER;
+                    result.number_value = a.number_value + b.number_value;
+                    vm_push(vm, result);
+                }
+                // 3) fallback error
+                else {
+                    runtime_free_value(&a);
+                    runtime_free_value(&b);
+                    output_sink_error("VM Error: OP_ADD cannot handle these operand types.\n");
+                    return 1;
+                }
+                break;
+            }
+            case OP_SUB: {
+                RuntimeValue b = vm_pop(vm);
+                RuntimeValue a = vm_pop(vm);
+                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
+                    RuntimeValue result;
+                    result.type = RUNTIME_VALUE_NUMBER;
+                    result.number_value = a.number_value - b.number_value;
+                    vm_push(vm, result);
+                } else {
+                    runtime_free_value(&a);
+                    runtime_free_value(&b);
+                    output_sink_error("VM Error: OP_SUB expects two numbers.\n");
+                    return 1;
+                }
+                break;
+            }
+
+            case OP_MUL: {
+                RuntimeValue b = vm_pop(vm);
+                RuntimeValue a = vm_pop(vm);
+                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
+                    RuntimeValue result;
+                    result.type = RUNTIME_VALUE_NUMBER;
+                    result.number_value = a.number_value * b.number_value;
+                    vm_push(vm, result);
+                } else {
+                    runtime_free_value(&a);
+                    runtime_free_value(&b);
+                    output_sink_error("VM Error: OP_MUL expects two numbers.\n");
+                    return 1;
+                }
+                break;
+            }
+
+            case OP_DIV: {
+                RuntimeValue b = vm_pop(vm);
+                RuntimeValue a = vm_pop(vm);
+                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
+                    if (b.number_value == 0) {
+                        output_sink_error("VM Error: Division by zero.\n");
+                        return 1;
+                    }
+                    RuntimeValue result;
+                    result.type = RUNTIME_VALUE_NUMBER;
+                    result.number_value = a.number_value / b.number_value;
+                    vm_push(vm, result);
+                } else {
+                    runtime_free_value(&a);
+                    runtime_free_value(&b);
+                    output_sink_error("VM Error: OP_DIV expects two numbers.\n");
+                    return 1;
+                }
+                break;
+            }
+
+            case OP_MOD: {
+                // a % b
+                RuntimeValue b = vm_pop(vm);
+                RuntimeValue a = vm_pop(vm);
+                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
+                    if (b.number_value == 0) {
+                        output_sink_error("VM Error: Modulo by zero.\n");
+                        return 1;
+                    }
+                    RuntimeValue result;
+                    result.type = RUNTIME_VALUE_NUMBER;
+                    // Use fmod for floating mod
+                    result.number_value = fmod(a.number_value, b.number_value);
+                    vm_push(vm, result);
+                } else {
+                    runtime_free_value(&a);
+                    runtime_free_value(&b);
+                    output_sink_error("VM Error: OP_MOD expects two numbers.\n");
+                    return 1;
+                }
+                break;
+            }
+
+            case OP_NEG: {
+                // Unary negation
+                RuntimeValue val = vm_pop(vm);
+                if (val.type == RUNTIME_VALUE_NUMBER) {
+                    val.number_value = -val.number_value;
+                    vm_push(vm, val);
+                } else {
+                    runtime_free_value(&val);
+                    output_sink_error("VM Error: OP_NEG expects a number.\n");
+                    return 1;
+                }
+                break;
+            }
+
+            case OP_NOT: {
+                // Logical NOT
+                RuntimeValue val = vm_pop(vm);
+                if (val.type == RUNTIME_VALUE_BOOLEAN) {
+                    val.boolean_value = !val.boolean_value;
+                    vm_push(vm, val);
+                } else {
+                    // Non-boolean? Convert to boolean “truthiness” then invert
+                    bool truthy = false;
+                    if (val.type == RUNTIME_VALUE_NUMBER) {
+                        truthy = (val.number_value != 0);
+                    } else if (val.type == RUNTIME_VALUE_STRING) {
+                        truthy = (val.string_value && string_length(val.string_value) > 0);
+                    }
+                    runtime_free_value(&val);
+                    RuntimeValue result;
+                    result.type = RUNTIME_VALUE_BOOLEAN;
+                    result.boolean_value = !truthy;
+                    vm_push(vm, result);
+                }
+                break;
+            }
+
+            case OP_AND:
+            case OP_OR: {
+                // Both operands are already evaluated; combine their truthiness
+                RuntimeValue b = vm_pop(vm);
+                RuntimeValue a = vm_pop(vm);
+                bool a_truthy = vm_is_truthy(a);
+                bool b_truthy = vm_is_truthy(b);
+                runtime_free_value(&a);
+                runtime_free_value(&b);
+                RuntimeValue result;
+                result.type = RUNTIME_VALUE_BOOLEAN;
+                result.boolean_value = (instruction == OP_AND) ? (a_truthy && b_truthy)
+                                                               : (a_truthy || b_truthy);
+                vm_push(vm, result);
+                break;
+            }
+
+            case OP_EQ: 
+            case OP_NEQ:
+            case OP_LT:
+            case OP_GT:
+            case OP_LTE:
+            case OP_GTE: {
+                RuntimeValue b = vm_pop(vm);
+                RuntimeValue a = vm_pop(vm);
+                RuntimeValue result;
+                result.type = RUNTIME_VALUE_BOOLEAN;
+                bool comparison = false;
+
+                // For simplicity, only handle numbers
+                if (a.type == RUNTIME_VALUE_NUMBER && b.type == RUNTIME_VALUE_NUMBER) {
+                    double x = a.number_value;
+                    double y = b.number_value;
+
+                    switch (instruction) {
+                        case OP_EQ:  comparison = (x == y); break;
+                        case OP_NEQ: comparison = (x != y); break;
+                        case OP_LT:  comparison = (x <  y); break;
+                        case OP_GT:  comparison = (x >  y); break;
+                        case OP_LTE: comparison = (x <= y); break;
+                        case OP_GTE: comparison = (x >= y); break;
+                        default: break;
+                    }
+                }
+                else {
+                    // String == string, etc., handle here
+                    if (instruction == OP_EQ || instruction == OP_NEQ) {
+                        // As a naive fallback, treat different types as 'not equal'
+                        bool equal = false;
+                        if (a.type == b.type) {
+                            // Check equality for booleans, strings, etc.
+                            if (a.type == RUNTIME_VALUE_BOOLEAN) {
+                                equal = (a.boolean_value == b.boolean_value);
+                            } else if (a.type == RUNTIME_VALUE_STRING && b.string_value && a.string_value) {
+                                equal = string_equals(a.string_value, b.string_value);
+                            } else if (a.type == RUNTIME_VALUE_NULL) {
+                                equal = true; // both null
+                            } else if (a.type == RUNTIME_VALUE_OBJECT) {
+                                equal = (a.object_value == b.object_value); // identity
+                            }
+                        }
+                        comparison = equal;
+                        if (instruction == OP_NEQ) comparison = !comparison;
+                    }
+                }
+
+                runtime_free_value(&a);
+                runtime_free_value(&b);
+                result.boolean_value = comparison;
+                vm_push(vm, result);
+                break;
+            }
+
+            /* -----------------------------
+               Branching (Jumps)
+               ----------------------------- */
+            case OP_JUMP_IF_FALSE: {
+                // 16-bit offset
+                uint16_t offset = READ_SHORT(vm);
+                RuntimeValue cond = vm_pop(vm);
+                bool truthy = vm_is_truthy(cond);
+                runtime_free_value(&cond);
+
+                if (!truthy) {
+                    vm->ip += offset;  // jump forward
+                }
+                break;
+            }
+
+            case OP_JUMP: {
+                // unconditional jump
+                uint16_t offset = READ_SHORT(vm);
+                vm->ip += offset;
+                break;
+            }
+
+            case OP_LOOP: {
+                // jump backward by offset
+                uint16_t offset = READ_SHORT(vm);
+                vm->ip -= offset; // Move IP *backwards*
+                // Every unbounded loop passes here, so this is where fuel
+                // is checked; the next run resumes at the loop head
+                if (--vm->fuel <= 0) {
+                    return VM_RESULT_YIELDED;
+                }
+                break;
+            }
+
+            /* -----------------------------
+               Functions & Return
+               ----------------------------- */
+            case OP_CALL: {
+                // Byte 1: global slot holding the callee, Byte 2: argCount
+                uint8_t funcIndex = *vm->ip++;
+                uint8_t argCount  = *vm->ip++;
+
+                if (vm->stack_top - vm->stack < argCount) {
+                    output_sink_error("VM Error: Stack underflow in OP_CALL.\n");
+                    return VM_RESULT_ERROR;
+                }
+
+                RuntimeValue callee = vm->globals[funcIndex];
+                if (callee.type == RUNTIME_VALUE_FUNCTION &&
+                    callee.function_value.function_type == FUNCTION_TYPE_BYTECODE) {
+                    vm_enter_function(vm, callee.function_value.bytecode_function, argCount, vm->ip);
+                    // Recursion can run forever without a loop; resume in the callee
+                    if (--vm->fuel <= 0) {
+                        return VM_RESULT_YIELDED;
+                    }
+                    break;
+                }
+
+                // Host built-ins are not bound into the VM yet: discard the
+                // arguments and produce null so the stack stays balanced.
+                vm_release_values(vm->stack_top - argCount, vm->stack_top);
+                vm->stack_top -= argCount;
+                RuntimeValue nullVal;
+                nullVal.type = RUNTIME_VALUE_NULL;
+                vm_push(vm, nullVal);
+                break;
+            }
+
+            case OP_CALL_NATIVE: {
+                // Byte 1: index into builtins_native(), Byte 2: argCount
+                uint8_t nativeIndex = *vm->ip++;
+                uint8_t argCount    = *vm->ip++;
+                BuiltinFunction native = builtins_native(nativeIndex);
+                if (!native) {
+                    output_sink_error("VM Error: Unknown native function %d.\n", nativeIndex);
+                    return VM_RESULT_ERROR;
+                }
+                // The arguments stay on the stack for the call (natives
+                // borrow them), then make way for the result
+                RuntimeValue* args = vm->stack_top - argCount;
+                RuntimeValue result = native(NULL, args, argCount);
+                vm_release_values(args, vm->stack_top);
+                vm->stack_top = args;
+                vm_push(vm, result);
+                break;
+            }
+
+            case OP_RETURN: {
+                RuntimeValue result = vm_pop(vm);
+
+                // `return` at the top level of the script ends it
+                if (vm->frame_count == 0) {
+                    runtime_free_value(&result);
+                    return VM_RESULT_OK;
+                }
+
+                // Drop the callee's arguments and locals
+                CallFrame frame = vm->frames[--vm->frame_count];
+                vm_release_values(vm->stack + frame.base, vm->stack_top);
+                vm->stack_top = vm->stack + frame.base;
+
+                if (frame.return_ip == NULL) {
+                    // A coroutine's body finished: release its stack and hand
+                    // the value to whoever resumed it
+                    Coroutine* done = vm->current;
+                    vm_frames_begin_change(vm);
+                    ember_free(vm->stack);
+                    ember_free(vm->frames);
+                    vm->stack = NULL;
+                    vm->frames = NULL;
+                    vm_save_context(vm, done);
+                    vm_return_to_caller(vm, result);
+                    vm_frames_end_change(vm);
+                    done->status = COROUTINE_DEAD;
+                    break;
+                }
+
+                vm->ip = frame.return_ip;
+                vm_push(vm, result);
+                break;
+            }
+
+            case OP_LOAD_LOCAL: {
+                uint8_t slot = *vm->ip++;
+                vm_push(vm, runtime_value_copy(&vm->stack[vm->frames[vm->frame_count - 1].base + slot]));
+                break;
+            }
+
+            case OP_STORE_LOCAL: {
+                uint8_t slot = *vm->ip++;
+                RuntimeValue value = vm_pop(vm);
+                RuntimeValue* local = &vm->stack[vm->frames[vm->frame_count - 1].base + slot];
+                runtime_free_value(local);
+                *local = value;
+                break;
+            }
+
+            /* -----------------------------
+               Coroutines
+               ----------------------------- */
+            case OP_NEW_COROUTINE: {
+                RuntimeValue function = vm_pop(vm);
+                if (function.type != RUNTIME_VALUE_FUNCTION ||
+                    function.function_value.function_type != FUNCTION_TYPE_BYTECODE) {
+                    runtime_free_value(&function);
+                    output_sink_error("VM Error: coroutine_create expects a script function.\n");
+                    return VM_RESULT_ERROR;
+                }
+                Coroutine* co = vm_new_coroutine(vm, function);
+                if (!co) {
+                    output_sink_error("VM Error: Memory allocation failed for coroutine.\n");
+                    return VM_RESULT_ERROR;
+                }
+                RuntimeValue handle;
+                handle.type = RUNTIME_VALUE_COROUTINE;
+                handle.coroutine_value = co;
+                vm_push(vm, handle);
+                break;
+            }
+
+            case OP_RESUME: {
+                // Stack: coroutine, value => value yielded or returned by it
+                RuntimeValue value = vm_pop(vm);
+                RuntimeValue target = vm_pop(vm);
+                if (target.type != RUNTIME_VALUE_COROUTINE) {
+                    runtime_free_value(&value);
+                    runtime_free_value(&target);
+                    output_sink_error("VM Error: coroutine_resume expects a coroutine.\n");
+                    return VM_RESULT_ERROR;
+                }
+                Coroutine* co = target.coroutine_value;
+                if (co->status != COROUTINE_SUSPENDED) {
+                    runtime_free_value(&value);
+                    output_sink_error("VM Error: Cannot resume a %s coroutine.\n",
+                                      co->status == COROUTINE_DEAD ? "dead" : "running");
+                    return VM_RESULT_ERROR;
+                }
+
+                Coroutine* self = vm->current;
+                vm_save_context(vm, self);
+                self->status = COROUTINE_NORMAL;
+                co->caller = self;
+                vm_load_context(vm, co);
+
+                // The first resume passes its value as the body's argument;
+                // later ones become the result of the pending yield
+                vm_push(vm, value);
+                if (!co->started) {
+                    co->started = true;
+                    vm_enter_function(vm, co->function.function_value.bytecode_function, 1, NULL);
+                }
+                break;
+            }
+
+            case OP_YIELD: {
+                RuntimeValue value = vm_pop(vm);
+                Coroutine* co = vm->current;
+                if (co == &vm->root) {
+                    runtime_free_value(&value);
+                    output_sink_error("VM Error: coroutine_yield called outside a coroutine.\n");
+                    return VM_RESULT_ERROR;
+                }
+                vm_save_context(vm, co);
+                vm_return_to_caller(vm, value);
+                co->status = COROUTINE_SUSPENDED;
+                break;
+            }
+
+            /* -----------------------------
+               Scheduling
+               ----------------------------- */
+            case OP_SLEEP: {
+                RuntimeValue ms = vm_pop(vm);
+                if (ms.type != RUNTIME_VALUE_NUMBER || !isfinite(ms.number_value) || ms.number_value < 0) {
+                    runtime_free_value(&ms);
+                    output_sink_error("VM Error: sleep expects a finite, non-negative number of milliseconds.\n");
+                    return VM_RESULT_ERROR;
+                }
+                // sleep(...) evaluates to null once the VM is resumed
+                RuntimeValue nullVal;
+                nullVal.type = RUNTIME_VALUE_NULL;
+                vm_push(vm, nullVal);
+                vm->wait_kind = VM_WAIT_SLEEP;
+                vm->wait_ms = ms.number_value;
+                return VM_RESULT_SUSPENDED;
+            }
+
+            case OP_WAIT_EVENT: {
+                RuntimeValue name = vm_pop(vm);
+                if (name.type != RUNTIME_VALUE_STRING || !name.string_value) {
+                    runtime_free_value(&name);
+                    output_sink_error("VM Error: wait_event expects an event name.\n");
+                    return VM_RESULT_ERROR;
+                }
+                RuntimeValue nullVal;
+                nullVal.type = RUNTIME_VALUE_NULL;
+                vm_push(vm, nullVal);
+                vm->wait_kind = VM_WAIT_EVENT;
+                // The VM keeps the reference so `wait_event` outlives this slice
+                vm->wait_event_name = name.string_value;
+                vm->wait_event = string_cstr(name.string_value);
+                return VM_RESULT_SUSPENDED;
+            }
+
+            /* -----------------------------
+               Arrays / Indexing
+               ----------------------------- */
+            case OP_NEW_ARRAY: {
+                // Arrays start out packed; OP_ARRAY_PUSH boxes them if needed
+                ScriptArray* array = array_create(0);
+                if (!array) {
+                    return VM_RESULT_ERROR;
+                }
+                RuntimeValue arr;
+                arr.type = RUNTIME_VALUE_ARRAY;
+                arr.array_value = array;
+                vm_push(vm, arr);
+                break;
+            }
+
+            case OP_ARRAY_PUSH: {
+                // Expect: top => value, below => array
+                RuntimeValue val = vm_pop(vm);
+                RuntimeValue arr = vm_pop(vm);
+
+                if (arr.type != RUNTIME_VALUE_ARRAY) {
+                    runtime_free_value(&val);
+                    runtime_free_value(&arr);
+                    output_sink_error("VM Error: OP_ARRAY_PUSH on non-array.\n");
+                    return 1;
+                }
+                // The array takes over the value's reference
+                if (!array_push(arr.array_value, val)) {
+                    runtime_free_value(&val);
+                    runtime_free_value(&arr);
+                    output_sink_error("VM Error: Array push reallocation failed.\n");
+                    return 1;
+                }
+
+                // Push the updated array back
+                vm_push(vm, arr);
+                break;
+            }
+
+            case OP_GET_INDEX: {
+                // Expect: top => index, below => array
+                RuntimeValue indexVal = vm_pop(vm);
+                RuntimeValue arrVal   = vm_pop(vm);
+                RuntimeValue element;
+                element.type = RUNTIME_VALUE_NULL;
+                int status = VM_RESULT_OK;
+
+                // obj["key"]: a hash probe once the object is a dictionary
+                if (arrVal.type == RUNTIME_VALUE_OBJECT) {
+                    if (indexVal.type != RUNTIME_VALUE_STRING) {
+                        output_sink_error("VM Error: Object keys must be strings.\n");
+                        status = VM_RESULT_ERROR;
+                    } else {
+                        RuntimeValue* slot = object_get(arrVal.object_value, string_cstr(indexVal.string_value));
+                        if (slot) {
+                            element = runtime_value_copy(slot);
+                        }
+                    }
+                } else if (arrVal.type != RUNTIME_VALUE_ARRAY) {
+                    output_sink_error("VM Error: OP_GET_INDEX on non-array.\n");
+                    status = VM_RESULT_ERROR;
+                } else if (indexVal.type != RUNTIME_VALUE_NUMBER) {
+                    output_sink_error("VM Error: OP_GET_INDEX requires numeric index.\n");
+                    status = VM_RESULT_ERROR;
+                } else {
+                    ScriptArray* array = arrVal.array_value;
+                    int idx = (int)indexVal.number_value;
+                    if (idx < 0 || idx >= array->count) {
+                        output_sink_error("VM Error: Array index %d out of bounds.\n", idx);
+                        status = VM_RESULT_ERROR;
+                    } else if (array->kind == ARRAY_KIND_DOUBLE) {
+                        // Packed arrays box the number on the way out
+                        element.type = RUNTIME_VALUE_NUMBER;
+                        element.number_value = array->numbers[idx];
+                    } else {
+                        element = runtime_value_copy(&array->values[idx]);
+                    }
+                }
+
+                runtime_free_value(&indexVal);
+                runtime_free_value(&arrVal);
+                if (status != VM_RESULT_OK) {
+                    return status;
+                }
+                vm_push(vm, element);
+                break;
+            }
+
+            case OP_SET_INDEX: {
+                // Expect: top => value, below => index, below => array or object. Leaves the value.
+                RuntimeValue value    = vm_pop(vm);
+                RuntimeValue indexVal = vm_pop(vm);
+                RuntimeValue target   = vm_pop(vm);
+                int status = VM_RESULT_OK;
+
+                if (target.type == RUNTIME_VALUE_OBJECT) {
+                    if (indexVal.type != RUNTIME_VALUE_STRING) {
+                        output_sink_error("VM Error: Object keys must be strings.\n");
+                        status = VM_RESULT_ERROR;
+                    } else if (!object_set(target.object_value, string_cstr(indexVal.string_value),
+                                           runtime_value_copy(&value))) {
+                        output_sink_error("VM Error: Memory allocation failed for object property.\n");
+                        status = VM_RESULT_ERROR;
+                    }
+                } else if (target.type == RUNTIME_VALUE_ARRAY) {
+                    int idx = indexVal.type == RUNTIME_VALUE_NUMBER ? (int)indexVal.number_value : 0;
+                    if (indexVal.type != RUNTIME_VALUE_NUMBER) {
+                        output_sink_error("VM Error: OP_SET_INDEX requires numeric index.\n");
+                        status = VM_RESULT_ERROR;
+                    } else if (idx < 0 || idx >= target.array_value->count) {
+                        output_sink_error("VM Error: Array index %d out of bounds.\n", idx);
+                        status = VM_RESULT_ERROR;
+                    } else if (!array_set(target.array_value, idx, runtime_value_copy(&value))) {
+                        status = VM_RESULT_ERROR;
+                    }
+                } else {
+                    output_sink_error("VM Error: OP_SET_INDEX on non-indexable value.\n");
+                    status = VM_RESULT_ERROR;
+                }
+
+                runtime_free_value(&indexVal);
+                runtime_free_value(&target);
+                if (status != VM_RESULT_OK) {
+                    runtime_free_value(&value);
+                    return status;
+                }
+                vm_push(vm, value);
+                break;
+            }
+
+            case OP_LEN: {
+                RuntimeValue target = vm_pop(vm);
+                RuntimeValue length;
+                length.type = RUNTIME_VALUE_NUMBER;
+                if (target.type == RUNTIME_VALUE_ARRAY) {
+                    length.number_value = target.array_value->count;
+                } else if (target.type == RUNTIME_VALUE_STRING && target.string_value) {
+                    length.number_value = (double)string_length(target.string_value);
+                } else {
+                    runtime_free_value(&target);
+                    output_sink_error("VM Error: len() requires a string or array.\n");
+                    return VM_RESULT_ERROR;
+                }
+                runtime_free_value(&target);
+                vm_push(vm, length);
+                break;
+            }
+
+            case OP_SLICE: {
+                // Expect: top => end (or null for "to the end"), below => start, below => array
+                RuntimeValue endVal   = vm_pop(vm);
+                RuntimeValue startVal = vm_pop(vm);
+                RuntimeValue arr      = vm_pop(vm);
+                if (arr.type != RUNTIME_VALUE_ARRAY || startVal.type != RUNTIME_VALUE_NUMBER ||
+                    (endVal.type != RUNTIME_VALUE_NUMBER && endVal.type != RUNTIME_VALUE_NULL)) {
+                    runtime_free_value(&endVal);
+                    runtime_free_value(&startVal);
+                    runtime_free_value(&arr);
+                    output_sink_error("VM Error: slice() requires an array and numeric bounds.\n");
+                    return VM_RESULT_ERROR;
+                }
+                if (!isfinite(startVal.number_value) ||
+                    (endVal.type == RUNTIME_VALUE_NUMBER && !isfinite(endVal.number_value))) {
+                    runtime_free_value(&arr);
+                    output_sink_error("VM Error: slice() requires finite bounds.\n");
+                    return VM_RESULT_ERROR;
+                }
+                int count = arr.array_value->count;
+                int start = array_slice_bound(startVal.number_value, count);
+                int end = endVal.type == RUNTIME_VALUE_NUMBER ? array_slice_bound(endVal.number_value, count)
+                                                              : count;
+                ScriptArray* slice = array_slice(arr.array_value, start, end);
+                runtime_free_value(&arr);
+                if (!slice) {
+                    return VM_RESULT_ERROR;
+                }
+                RuntimeValue result;
+                result.type = RUNTIME_VALUE_ARRAY;
+                result.array_value = slice;
+                vm_push(vm, result);
+                break;
+            }
+
+            /* -----------------------------
+               Objects
+               ----------------------------- */
+            case OP_NEW_OBJECT: {
+                ScriptObject* object = object_create();
+                if (!object) {
+                    return VM_RESULT_ERROR;
+                }
+                RuntimeValue obj;
+                obj.type = RUNTIME_VALUE_OBJECT;
+                obj.object_value = object;
+                vm_push(vm, obj);
+                break;
+            }
+
+            case OP_GET_PROPERTY: {
+                // Expect: top => object
+                uint8_t nameIndex = *vm->ip++;
+                int cacheIndex = (vm->ip[0] << 8) | vm->ip[1];
+                vm->ip += 2;
+                RuntimeValue target = vm_pop(vm);
+
+                if (target.type != RUNTIME_VALUE_OBJECT) {
+                    runtime_free_value(&target);
+                    output_sink_error("VM Error: Cannot read property '%s' of a non-object.\n",
+                                      string_cstr(vm->chunk->constants[nameIndex].string_value));
+                    return VM_RESULT_ERROR;
+                }
+                ScriptObject* object = target.object_value;
+
+                // Fast path: a shape this site has seen before
+                PropertyCache* cache = vm_property_cache(vm, cacheIndex);
+                const PropertyCacheEntry* hit = vm_property_cache_find(cache, object->shape);
+                if (hit) {
+                    RuntimeValue value = runtime_value_copy(&object->slots[hit->slot]);
+                    runtime_free_value(&target);
+                    vm_push(vm, value);
+                    break;
+                }
+
+                RuntimeValue* slot = object_get(object, string_cstr(vm->chunk->constants[nameIndex].string_value));
+                // Dictionaries share one placeholder shape, so they are never cached
+                if (slot && !object->dictionary) {
+                    vm_property_cache_add(cache, object->shape, NULL, (int)(slot - object->slots));
+                }
+                // Missing properties read as null
+                RuntimeValue value;
+                value.type = RUNTIME_VALUE_NULL;
+                if (slot) {
+                    value = runtime_value_copy(slot);
+                }
+                runtime_free_value(&target);
+                vm_push(vm, value);
+                break;
+            }
+
+            case OP_SET_PROPERTY: {
+                // Expect: top => value, below => object. Leaves the value.
+                uint8_t nameIndex = *vm->ip++;
+                int cacheIndex = (vm->ip[0] << 8) | vm->ip[1];
+                vm->ip += 2;
+                RuntimeValue value = vm_pop(vm);
+                RuntimeValue target = vm_pop(vm);
+
+                if (target.type != RUNTIME_VALUE_OBJECT) {
+                    runtime_free_value(&value);
+                    runtime_free_value(&target);
+                    output_sink_error("VM Error: Cannot set property '%s' on a non-object.\n",
+                                      string_cstr(vm->chunk->constants[nameIndex].string_value));
+                    return VM_RESULT_ERROR;
+                }
+                ScriptObject* object = target.object_value;
+                const Shape* shape = object->shape;
+
+                PropertyCache* cache = vm_property_cache(vm, cacheIndex);
+                const PropertyCacheEntry* hit = vm_property_cache_find(cache, shape);
+                // The object gets its own reference; `value` stays on the stack
+                bool stored = true;
+                if (hit && !hit->transition) {
+                    runtime_free_value(&object->slots[hit->slot]);
+                    object->slots[hit->slot] = runtime_value_copy(&value);
+                } else if (hit) {
+                    RuntimeValue copy = runtime_value_copy(&value);
+                    stored = object_append_slot(object, hit->transition, copy);
+                    if (!stored) {
+                        runtime_free_value(&copy);
+                    }
+                } else {
+                    RuntimeValue* slot = object_define(object, string_cstr(vm->chunk->constants[nameIndex].string_value));
+                    stored = slot != NULL;
+                    if (stored) {
+                        runtime_free_value(slot);
+                        *slot = runtime_value_copy(&value);
+                        // Remember the shape, and the transition if the store added the property
+                        if (!object->dictionary) {
+                            vm_property_cache_add(cache, shape, object->shape != shape ? object->shape : NULL,
+                                                  (int)(slot - object->slots));
+                        }
+                    }
+                }
+                runtime_free_value(&target);
+                if (!stored) {
+                    runtime_free_value(&value);
+                    output_sink_error("VM Error: Memory allocation failed for object property.\n");
+                    return VM_RESULT_ERROR;
+                }
+
+                vm_push(vm, value);
+                break;
+            }
+
+            /* -----------------------------
+               Printing, etc.
+               ----------------------------- */
+            case OP_PRINT: {
+                // pop top
+                RuntimeValue v = vm_pop(vm);
+
+                // Same text print() and string concatenation produce
+                char scratch[RUNTIME_VALUE_TEXT_SIZE];
+                size_t length;
+                const char* text = runtime_value_text(&v, scratch, &length);
+                output_sink_write_line(output_sink_current(), text, length);
+                runtime_free_value(&v);
+                break;
+            }
+
+            case OP_TO_STRING: {
+                // If we want to convert the top value to a string in place
+                // For now, just skip or handle as needed
+                break;
+            }
+
+            /* -----------------------------
+               Default (unknown opcode)
+               ----------------------------- */
+            default: {
+                output_sink_error("VM Error: Unknown opcode %d.\n", instruction);
+                return 1;
+            }
+        } // end switch
+#ifdef VM_DISPATCH_PROFILE
+        profile->op_time[instruction] += vm_profile_clock() - started;
+#endif
+    } // end for
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm_profile.h"
+#include "ember_alloc.h"
+
+const char* vm_profile_time_unit(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+VMProfile* vm_profile_create(const BytecodeChunk* chunk) {
+    VMProfile* profile = (VMProfile*)ember_calloc(EMBER_MEM_VM, 1, sizeof(VMProfile));
+    if (!profile) {
+        fprintf(stderr, "Error: Memory allocation failed for profile.\n");
+        return NULL;
+    }
+    int size = chunk ? chunk->code_count : 0;
+    if (size > 0) {
+        profile->offset_hits = (uint64_t*)ember_calloc(EMBER_MEM_VM, (size_t)size, sizeof(uint64_t));
+        if (!profile->offset_hits) {
+            fprintf(stderr, "Error: Memory allocation failed for profile.\n");
+            ember_free(profile);
+            return NULL;
+        }
+    }
+    profile->code_size = size;
+    profile->chunk = chunk;
+    return profile;
+}
+
+void vm_profile_free(VMProfile* profile) {
+    if (!profile) {
+        return;
+    }
+    ember_free(profile->offset_hits);
+    ember_free(profile);
+}
+
+// qsort context is not portable, so the comparators read these
+static const VMProfile* sort_profile = NULL;
+
+static int compare_op_time(const void* a, const void* b) {
+    uint64_t ta = sort_profile->op_time[*(const int*)a];
+    uint64_t tb = sort_profile->op_time[*(const int*)b];
+    return ta < tb ? 1 : ta > tb ? -1 : 0;
+}
+
+static int compare_offset_hits(const void* a, const void* b) {
+    uint64_t ha = sort_profile->offset_hits[*(const int*)a];
+    uint64_t hb = sort_profile->offset_hits[*(const int*)b];
+    if (ha != hb) {
+        return ha < hb ? 1 : -1;
+    }
+    return *(const int*)a - *(const int*)b;
+}
+
+// Opcodes that ran, hottest first. Returns how many were written to `ops`.
+static int sorted_opcodes(const VMProfile* profile, int ops[256]) {
+    int count = 0;
+    for (int op = 0; op < 256; op++) {
+        if (profile->op_counts[op]) {
+            ops[count++] = op;
+        }
+    }
+    sort_profile = profile;
+    qsort(ops, (size_t)count, sizeof(int), compare_op_time);
+    return count;
+}
+
+void vm_profile_print(const VMProfile* profile, FILE* out, int top_offsets) {
+    if (!profile || !out) {
+        return;
+    }
+    int ops[256];
+    int count = sorted_opcodes(profile, ops);
+
+    uint64_t total_count = 0;
+    uint64_t total_time = 0;
+    for (int i = 0; i < count; i++) {
+        total_count += profile->op_counts[ops[i]];
+        total_time += profile->op_time[ops[i]];
+    }
+
+    const char* unit = vm_profile_time_unit();
+    fprintf(out, "\n=== Opcode profile (%llu instructions, %llu %s) ===\n",
+            (unsigned long long)total_count, (unsigned long long)total_time, unit);
+    fprintf(out, "%-16s %14s %16s %10s %7s\n", "opcode", "count", unit, "avg", "time%");
+    for (int i = 0; i < count; i++) {
+        int op = ops[i];
+        uint64_t n = profile->op_counts[op];
+        uint64_t t = profile->op_time[op];
+        fprintf(out, "%-16s %14llu %16llu %10.1f %6.2f%%\n", vm_opcode_name(op),
+                (unsigned long long)n, (unsigned long long)t, (double)t / (double)n,
+                total_time ? 100.0 * (double)t / (double)total_time : 0.0);
+    }
+
+    if (top_offsets <= 0 || profile->code_size == 0) {
+        return;
+    }
+    int* offsets = (int*)ember_malloc(EMBER_MEM_VM, sizeof(int) * (size_t)profile->code_size);
+    if (!offsets) {
+        return;
+    }
+    int hit = 0;
+    for (int i = 0; i < profile->code_size; i++) {
+        if (profile->offset_hits[i]) {
+            offsets[hit++] = i;
+        }
+    }
+    qsort(offsets, (size_t)hit, sizeof(int), compare_offset_hits);
+    if (hit > top_offsets) {
+        hit = top_offsets;
+    }
+    fprintf(out, "\n=== Hottest bytecode offsets ===\n");
+    fprintf(out, "%8s %6s %14s %-16s\n", "offset", "line", "hits", "opcode");
+    for (int i = 0; i < hit; i++) {
+        int offset = offsets[i];
+        int line = vm_chunk_line_at(profile->chunk, offset);
+        char line_text[12] = "-";
+        if (line > 0) {
+            snprintf(line_text, sizeof(line_text), "%d", line);
+        }
+        fprintf(out, "%8d %6s %14llu %-16s\n", offset, line_text,
+                (unsigned long long)profile->offset_hits[offset],
+                profile->chunk ? vm_opcode_name(profile->chunk->code[offset]) : "");
+    }
+    ember_free(offsets);
+}
+
+bool vm_profile_write_json(const VMProfile* profile, const char* path) {
+    if (!profile || !path) {
+        return false;
+    }
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Could not open profile output file '%s'\n", path);
+        return false;
+    }
+
+    int ops[256];
+    int count = sorted_opcodes(profile, ops);
+    fprintf(out, "{\n  \"time_unit\": \"%s\",\n  \"opcodes\": [", vm_profile_time_unit());
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%s\n    {\"op\": \"%s\", \"count\": %llu, \"time\": %llu}",
+                i ? "," : "", vm_opcode_name(ops[i]),
+                (unsigned long long)profile->op_counts[ops[i]],
+                (unsigned long long)profile->op_time[ops[i]]);
+    }
+    fprintf(out, "\n  ],\n  \"offsets\": [");
+    bool first = true;
+    for (int i = 0; i < profile->code_size; i++) {
+        if (!profile->offset_hits[i]) {
+            continue;
+        }
+        fprintf(out, "%s\n    {\"offset\": %d, \"line\": %d, \"hits\": %llu}", first ? "" : ",", i,
+                vm_chunk_line_at(profile->chunk, i), (unsigned long long)profile->offset_hits[i]);
+        first = false;
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    bool ok = !ferror(out);
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,274 @@
+// setitimer() and sigaction() are POSIX, not C11
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+
+#include "vm_sampler.h"
+#include "ember_alloc.h"
+
+typedef struct {
+    int depth;                 // Entries used in `functions`
+    bool in_coroutine;         // Stack belongs to a coroutine, not the main script
+    bool truncated;            // Outer frames were cut off
+    const BytecodeFunction* functions[VM_SAMPLER_MAX_DEPTH]; // Outermost first
+    int offsets[VM_SAMPLER_MAX_DEPTH + 1]; // Code offset each level was at; [0] is the root
+} Sample;
+
+struct VMSampler {
+    int hz;
+    int capacity;
+    Sample* samples;
+    volatile sig_atomic_t count;
+    volatile sig_atomic_t dropped;
+    VM* vm;
+    const BytecodeChunk* chunk; // Of the last VM sampled; resolves offsets to lines
+    bool running;
+    struct sigaction previous_action;
+};
+
+// The process-wide timer can only drive one sampler
+static atomic_flag sampler_active = ATOMIC_FLAG_INIT;
+static VMSampler* volatile running_sampler = NULL;
+
+// Which sampler the running thread feeds; a SIGPROF delivered to any other
+// thread sees NULL here
+static _Thread_local VMSampler* volatile thread_sampler = NULL;
+
+// Runs inside the signal handler: only plain loads and stores, no locks or allocation
+static void sampler_record(VMSampler* s) {
+    VM* vm = s->vm;
+    if (s->count >= s->capacity || vm->frames_changing) {
+        s->dropped++;
+        return;
+    }
+    Sample* sample = &s->samples[s->count];
+    const CallFrame* frames = vm->frames;
+    int frame_count = vm->frame_count;
+
+    int first = 0;
+    sample->truncated = false;
+    if (frame_count > VM_SAMPLER_MAX_DEPTH) {
+        first = frame_count - VM_SAMPLER_MAX_DEPTH;
+        sample->truncated = true;
+    }
+    const uint8_t* code = vm->chunk->code;
+    for (int i = first; i < frame_count; i++) {
+        sample->functions[i - first] = frames[i].function;
+        // A frame's caller is paused just after its call instruction
+        const uint8_t* resume = frames[i].return_ip;
+        sample->offsets[i - first] = resume ? (int)(resume - code) - 1 : -1;
+    }
+    sample->offsets[frame_count - first] = (int)(vm->ip - code) - 1;
+    sample->depth = frame_count - first;
+    sample->in_coroutine = vm->current != &vm->root;
+    s->count++;
+}
+
+static void sampler_signal_handler(int signo) {
+    (void)signo;
+    VMSampler* s = thread_sampler;
+    // Also check it is still running, in case it was stopped from another thread
+    if (s && s == running_sampler) {
+        sampler_record(s);
+    }
+}
+
+VMSampler* vm_sampler_create(int hz, int capacity) {
+    VMSampler* s = (VMSampler*)ember_calloc(EMBER_MEM_VM, 1, sizeof(VMSampler));
+    if (!s) {
+        fprintf(stderr, "Error: Memory allocation failed for sampler.\n");
+        return NULL;
+    }
+    s->hz = hz > 0 ? hz : VM_SAMPLER_DEFAULT_HZ;
+    s->capacity = capacity > 0 ? capacity : VM_SAMPLER_DEFAULT_CAPACITY;
+    s->samples = (Sample*)ember_malloc(EMBER_MEM_VM, sizeof(Sample) * (size_t)s->capacity);
+    if (!s->samples) {
+        fprintf(stderr, "Error: Memory allocation failed for sampler buffer.\n");
+        ember_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void vm_sampler_free(VMSampler* sampler) {
+    if (!sampler) {
+        return;
+    }
+    vm_sampler_stop(sampler);
+    ember_free(sampler->samples);
+    ember_free(sampler);
+}
+
+bool vm_sampler_start(VMSampler* sampler, VM* vm) {
+    if (!sampler || !vm || sampler->running) {
+        return false;
+    }
+    if (atomic_flag_test_and_set(&sampler_active)) {
+        fprintf(stderr, "Error: Another sampling profiler is already running.\n");
+        return false;
+    }
+    sampler->vm = vm;
+    sampler->chunk = vm->chunk;
+    thread_sampler = sampler;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sampler_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(SIGPROF, &action, &sampler->previous_action) != 0) {
+        fprintf(stderr, "Error: Could not install the SIGPROF handler.\n");
+        thread_sampler = NULL;
+        atomic_flag_clear(&sampler_active);
+        return false;
+    }
+
+    struct itimerval timer;
+    long usec = 1000000L / sampler->hz;
+    timer.it_interval.tv_sec = usec / 1000000L;
+    timer.it_interval.tv_usec = usec % 1000000L;
+    if (timer.it_interval.tv_sec == 0 && timer.it_interval.tv_usec == 0) {
+        timer.it_interval.tv_usec = 1;
+    }
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        fprintf(stderr, "Error: Could not start the profiling timer.\n");
+        sigaction(SIGPROF, &sampler->previous_action, NULL);
+        thread_sampler = NULL;
+        atomic_flag_clear(&sampler_active);
+        return false;
+    }
+    sampler->running = true;
+    running_sampler = sampler;
+    return true;
+}
+
+void vm_sampler_stop(VMSampler* sampler) {
+    if (!sampler || !sampler->running) {
+        return;
+    }
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    running_sampler = NULL;
+
+    // A tick may already be pending; under the default action it would
+    // terminate the process, so ignore SIGPROF rather than restore that
+    if (sampler->previous_action.sa_handler == SIG_DFL &&
+        !(sampler->previous_action.sa_flags & SA_SIGINFO)) {
+        struct sigaction ignore;
+        memset(&ignore, 0, sizeof(ignore));
+        ignore.sa_handler = SIG_IGN;
+        sigemptyset(&ignore.sa_mask);
+        sigaction(SIGPROF, &ignore, NULL);
+    } else {
+        sigaction(SIGPROF, &sampler->previous_action, NULL);
+    }
+    thread_sampler = NULL;
+    sampler->running = false;
+    atomic_flag_clear(&sampler_active);
+}
+
+int vm_sampler_sample_count(const VMSampler* sampler) {
+    return sampler ? (int)sampler->count : 0;
+}
+
+int vm_sampler_dropped_count(const VMSampler* sampler) {
+    return sampler ? (int)sampler->dropped : 0;
+}
+
+/* -------------------------------------------------------
+   Folded output
+   ------------------------------------------------------- */
+
+// Render one sample as "root:3;f:7;g:9", growing `*buffer` as needed. Each
+// frame is labelled with the line it is executing, when the chunk has lines.
+static bool format_stack(const Sample* sample, const BytecodeChunk* chunk,
+                         char** buffer, size_t* capacity) {
+    size_t length = 0;
+    const char* root = sample->truncated ? "[truncated]" : sample->in_coroutine ? "[coroutine]" : "main";
+    for (int i = -1; i < sample->depth; i++) {
+        const char* name = root;
+        if (i >= 0) {
+            const BytecodeFunction* fn = sample->functions[i];
+            name = fn && fn->name && fn->name[0] ? fn->name : "[anonymous]";
+        }
+        char line_suffix[16] = "";
+        int offset = sample->offsets[i + 1];
+        int line = offset >= 0 ? vm_chunk_line_at(chunk, offset) : 0;
+        if (line > 0) {
+            snprintf(line_suffix, sizeof(line_suffix), ":%d", line);
+        }
+        size_t needed = length + strlen(name) + strlen(line_suffix) + 2;
+        if (needed > *capacity) {
+            size_t grown = *capacity ? *capacity * 2 : 128;
+            while (grown < needed) {
+                grown *= 2;
+            }
+            char* bigger = (char*)ember_realloc(EMBER_MEM_VM, *buffer, grown);
+            if (!bigger) {
+                return false;
+            }
+            *buffer = bigger;
+            *capacity = grown;
+        }
+        if (i >= 0) {
+            (*buffer)[length++] = ';';
+        }
+        strcpy(*buffer + length, name);
+        length += strlen(name);
+        strcpy(*buffer + length, line_suffix);
+        length += strlen(line_suffix);
+    }
+    return true;
+}
+
+static int compare_stacks(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+bool vm_sampler_write_folded(const VMSampler* sampler, FILE* out) {
+    if (!sampler || !out) {
+        return false;
+    }
+    int count = (int)sampler->count;
+    if (count == 0) {
+        return true;
+    }
+    char** stacks = (char**)ember_calloc(EMBER_MEM_VM, (size_t)count, sizeof(char*));
+    if (!stacks) {
+        fprintf(stderr, "Error: Memory allocation failed for folded stacks.\n");
+        return false;
+    }
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        size_t capacity = 0;
+        ok = format_stack(&sampler->samples[i], sampler->chunk, &stacks[i], &capacity);
+    }
+    if (ok) {
+        // Identical stacks end up adjacent and are written once with their count
+        qsort(stacks, (size_t)count, sizeof(char*), compare_stacks);
+        int run = 1;
+        for (int i = 1; i <= count; i++) {
+            if (i < count && strcmp(stacks[i], stacks[i - 1]) == 0) {
+                run++;
+                continue;
+            }
+            fprintf(out, "%s %d\n", stacks[i - 1], run);
+            run = 1;
+        }
+        ok = !ferror(out);
+    } else {
+        fprintf(stderr, "Error: Memory allocation failed for folded stacks.\n");
+    }
+    for (int i = 0; i < count; i++) {
+        ember_free(stacks[i]);
+    }
+    ember_free(stacks);
+    return ok;
+}
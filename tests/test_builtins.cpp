@@ -0,0 +1,377 @@
+#include "builtins.h"
+#include "array.h"
+#include "object.h"
+#include "script_string.h"
+#include "output_sink.h"
+#include "test_helpers.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+
+static std::string numberArrayLiteral(int count) {
+    std::string out = "[";
+    for (int i = 0; i < count; i++) {
+        if (i > 0) out += ",";
+        out += std::to_string(i);
+    }
+    return out + "]";
+}
+
+TEST(BuiltinsTest, ParallelMapFilterReduceKeepOrder) {
+    std::string source =
+        "function square(x) { return x * x; }"
+        "function is_even(x) { return x % 2 == 0; }"
+        "function add(a, b) { return a + b; }"
+        "var xs = " + numberArrayLiteral(1000) + ";"
+        "var squares = parallel_map(xs, square);"
+        "var evens = parallel_filter(xs, is_even);"
+        "var total = parallel_reduce(xs, add, 0);";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    RuntimeValue* squares = runtime_get_variable(env, "squares");
+    ASSERT_NE(squares, nullptr);
+    ASSERT_EQ(squares->type, RUNTIME_VALUE_ARRAY);
+    ASSERT_EQ(array_count(squares->array_value), 1000);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_DOUBLE_EQ(array_get(squares->array_value, i).number_value, (double)i * i);
+    }
+
+    RuntimeValue* evens = runtime_get_variable(env, "evens");
+    ASSERT_NE(evens, nullptr);
+    ASSERT_EQ(evens->type, RUNTIME_VALUE_ARRAY);
+    ASSERT_EQ(array_count(evens->array_value), 500);
+    for (int i = 0; i < 500; i++) {
+        EXPECT_DOUBLE_EQ(array_get(evens->array_value, i).number_value, 2.0 * i);
+    }
+
+    RuntimeValue* total = runtime_get_variable(env, "total");
+    ASSERT_NE(total, nullptr);
+    ASSERT_EQ(total->type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(total->number_value, 499500.0);
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+TEST(BuiltinsTest, ParallelCallbacksCannotWriteCallerScope) {
+    std::string source =
+        "var hits = 0;"
+        "function touch(x) { hits = hits + 1; return x; }"
+        "var same = parallel_map(" + numberArrayLiteral(300) + ", touch);";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    RuntimeValue* hits = runtime_get_variable(env, "hits");
+    ASSERT_NE(hits, nullptr);
+    EXPECT_DOUBLE_EQ(hits->number_value, 0.0);
+    RuntimeValue* same = runtime_get_variable(env, "same");
+    ASSERT_NE(same, nullptr);
+    EXPECT_EQ(array_count(same->array_value), 300);
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Callbacks see their own copy of captured arrays, so pushing from workers
+// neither races nor reaches the caller's array
+TEST(BuiltinsTest, ParallelCallbacksCannotMutateCallerArrays) {
+    std::string source =
+        "var log = [];"
+        "var nested = [[1], [2]];"
+        "function touch(x) { push(log, x); push(nested[0], x); return x; }"
+        "var same = parallel_map(" + numberArrayLiteral(20000) + ", touch);";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    RuntimeValue* log = runtime_get_variable(env, "log");
+    ASSERT_NE(log, nullptr);
+    ASSERT_EQ(log->type, RUNTIME_VALUE_ARRAY);
+    EXPECT_EQ(array_count(log->array_value), 0);
+    RuntimeValue* nested = runtime_get_variable(env, "nested");
+    ASSERT_NE(nested, nullptr);
+    EXPECT_EQ(array_count(array_get(nested->array_value, 0).array_value), 1);
+    RuntimeValue* same = runtime_get_variable(env, "same");
+    ASSERT_NE(same, nullptr);
+    EXPECT_EQ(array_count(same->array_value), 20000);
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Captured objects, arrays inside them and cycles through them are cloned
+// the same way, so callbacks cannot reach the caller's objects either
+TEST(BuiltinsTest, ParallelCallbacksCannotMutateCallerObjects) {
+    std::string source =
+        "var o = { n = 0, items = [] };"
+        "o.self = o;"
+        "function touch(x) { o.n = o.n + 1; o.self.m = x; push(o.items, x); return x; }"
+        "var same = parallel_map(" + numberArrayLiteral(20000) + ", touch);";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    RuntimeValue* o = runtime_get_variable(env, "o");
+    ASSERT_NE(o, nullptr);
+    ASSERT_EQ(o->type, RUNTIME_VALUE_OBJECT);
+    EXPECT_DOUBLE_EQ(object_get(o->object_value, "n")->number_value, 0.0);
+    EXPECT_EQ(object_get(o->object_value, "m"), nullptr);
+    EXPECT_EQ(array_count(object_get(o->object_value, "items")->array_value), 0);
+    EXPECT_EQ(object_get(o->object_value, "self")->object_value, o->object_value);
+    EXPECT_EQ(array_count(runtime_get_variable(env, "same")->array_value), 20000);
+
+    // Break the cycle so the object can be freed
+    RuntimeValue null_value;
+    null_value.type = RUNTIME_VALUE_NULL;
+    object_set(o->object_value, "self", null_value);
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Chunks share one read-only snapshot; each task's writes stay in its own
+// scope, so a captured counter restarts at every chunk and never leaks out
+TEST(BuiltinsTest, ParallelTasksKeepWritesToThemselves) {
+    std::string source =
+        "var seen = 0;"
+        "function count(x) { seen = seen + 1; return seen; }"
+        "var counts = parallel_map(" + numberArrayLiteral(2000) + ", count);";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "seen")->number_value, 0.0);
+    RuntimeValue* counts = runtime_get_variable(env, "counts");
+    ASSERT_NE(counts, nullptr);
+    ASSERT_EQ(array_count(counts->array_value), 2000);
+    EXPECT_DOUBLE_EQ(array_get(counts->array_value, 0).number_value, 1.0);
+    for (int i = 1; i < 2000; i++) {
+        double previous = array_get(counts->array_value, i - 1).number_value;
+        double current = array_get(counts->array_value, i).number_value;
+        EXPECT_TRUE(current == previous + 1 || current == 1.0) << "at " << i;
+    }
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Arrays of numbers stay unboxed through push and slice; the first other
+// value boxes them, and len/slice/indexing work the same on both kinds
+TEST(BuiltinsTest, ArraysSwitchKindOnFirstNonNumber) {
+    std::string source =
+        "var xs = [1, 2, 3];"
+        "push(xs, 4.5);"
+        "var head = slice(xs, 0, 2);"
+        "var mixed = slice(xs, 1);"
+        "mixed[0] = \"two\";"
+        "push(mixed, true);"
+        "var tail = slice(mixed, 0 - 2);"
+        "var sizes = len(xs) * 100 + len(mixed) * 10 + len(tail);"
+        "var last = xs[3] + head[1];";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    RuntimeValue* xs = runtime_get_variable(env, "xs");
+    RuntimeValue* head = runtime_get_variable(env, "head");
+    RuntimeValue* mixed = runtime_get_variable(env, "mixed");
+    RuntimeValue* tail = runtime_get_variable(env, "tail");
+    ASSERT_NE(xs, nullptr);
+    ASSERT_EQ(xs->type, RUNTIME_VALUE_ARRAY);
+    EXPECT_EQ(array_kind(xs->array_value), ARRAY_KIND_DOUBLE);
+    ASSERT_NE(array_numbers(xs->array_value), nullptr);
+    EXPECT_DOUBLE_EQ(array_numbers(xs->array_value)[3], 4.5);
+    EXPECT_EQ(array_kind(head->array_value), ARRAY_KIND_DOUBLE);
+    EXPECT_EQ(array_kind(mixed->array_value), ARRAY_KIND_GENERIC);
+    EXPECT_EQ(array_numbers(mixed->array_value), nullptr);
+    EXPECT_STREQ(string_cstr(array_get(mixed->array_value, 0).string_value), "two");
+    EXPECT_DOUBLE_EQ(array_get(mixed->array_value, 1).number_value, 3.0);
+    EXPECT_EQ(array_kind(tail->array_value), ARRAY_KIND_GENERIC);
+    EXPECT_TRUE(array_get(tail->array_value, 1).boolean_value);
+
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "sizes")->number_value, 4 * 100 + 4 * 10 + 2);
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "last")->number_value, 6.5);
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// The numeric builtins give the same answers on packed and boxed arrays
+// and reject arrays holding anything but numbers
+TEST(BuiltinsTest, NumericArrayBuiltins) {
+    std::string source =
+        "var xs = " + numberArrayLiteral(101) + ";"
+        "var boxed = " + numberArrayLiteral(101) + ";"
+        "boxed[0] = \"tmp\"; boxed[0] = 0;"
+        "var ones = scale(add_arrays(xs, xs), 0);"
+        "var total = sum(xs) + sum(boxed);"
+        "var lo = min(xs) + min(boxed) + max(xs) + max(boxed);"
+        "var product = dot(xs, boxed);"
+        "var clamped = clamp_all(boxed, 10, 20);"
+        "var halves = scale(boxed, 0.5);"
+        "var bad = sum([1, \"two\"]);"
+        "var empty = max([]);";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "total")->number_value, 2 * 5050.0);
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "lo")->number_value, 200.0);
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "product")->number_value, 338350.0);
+
+    RuntimeValue* clamped = runtime_get_variable(env, "clamped");
+    ASSERT_EQ(clamped->type, RUNTIME_VALUE_ARRAY);
+    ASSERT_EQ(array_count(clamped->array_value), 101);
+    EXPECT_EQ(array_kind(clamped->array_value), ARRAY_KIND_DOUBLE);
+    EXPECT_DOUBLE_EQ(array_get(clamped->array_value, 3).number_value, 10.0);
+    EXPECT_DOUBLE_EQ(array_get(clamped->array_value, 15).number_value, 15.0);
+    EXPECT_DOUBLE_EQ(array_get(clamped->array_value, 99).number_value, 20.0);
+    RuntimeValue* halves = runtime_get_variable(env, "halves");
+    EXPECT_DOUBLE_EQ(array_get(halves->array_value, 7).number_value, 3.5);
+    RuntimeValue* ones = runtime_get_variable(env, "ones");
+    EXPECT_EQ(array_count(ones->array_value), 101);
+
+    EXPECT_EQ(runtime_get_variable(env, "bad")->type, RUNTIME_VALUE_NULL);
+    EXPECT_EQ(runtime_get_variable(env, "empty")->type, RUNTIME_VALUE_NULL);
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+TEST(BuiltinsTest, StringSearchReplaceAndCase) {
+    std::string source =
+        "var line = \"the cat sat on the mat with the hat\";"
+        "var first = index_of(line, \"the\");"
+        "var hat = index_of(line, \"hat\");"
+        "var none = index_of(line, \"dog\");"
+        "var every = replace(line, \"the\", \"a\");"
+        "var grown = replace(\"aaa\", \"a\", \"<a>\");"
+        "var same = replace(line, \"\", \"x\");"
+        "var upper = to_upper(\"Straße über ÀÉ 42\");"
+        "var lower = to_lower(\"ÀÉÎ Ωμέγα ПРИВЕТ Mixed\");";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "first")->number_value, 0.0);
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "hat")->number_value, 32.0);
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "none")->number_value, -1.0);
+    EXPECT_STREQ(string_cstr(runtime_get_variable(env, "every")->string_value),
+                 "a cat sat on a mat with a hat");
+    EXPECT_STREQ(string_cstr(runtime_get_variable(env, "grown")->string_value), "<a><a><a>");
+    EXPECT_STREQ(string_cstr(runtime_get_variable(env, "same")->string_value),
+                 "the cat sat on the mat with the hat");
+    EXPECT_STREQ(string_cstr(runtime_get_variable(env, "upper")->string_value), "STRAßE ÜBER ÀÉ 42");
+    EXPECT_STREQ(string_cstr(runtime_get_variable(env, "lower")->string_value), "àéî ωμέγα привет mixed");
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Walking a string with substring() shares its buffer instead of copying
+// the remainder at every step
+TEST(BuiltinsTest, SubstringWalkSharesTheSource) {
+    std::string source =
+        "var text = \"\";"
+        "for (var i = 0; i < 200; i = i + 1) { text = text + \"word \"; }"
+        "var rest = text;"
+        "var words = 0;"
+        "while (len(rest) > 0) {"
+        "  if (substring(rest, 0, 5) == \"word \") { words = words + 1; }"
+        "  rest = substring(rest, 5, len(rest) - 5);"
+        "}"
+        "var tail = substring(text, 10, 100);"
+        "var head = substring(text, 0, 4);";
+    ASTNode* root = nullptr;
+    Environment* env = runScript(source, &root);
+
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "words")->number_value, 200.0);
+    const ScriptString* tail = runtime_get_variable(env, "tail")->string_value;
+    EXPECT_EQ(string_kind(tail), STRING_KIND_SLICE);
+    EXPECT_EQ(string_length(tail), 100u);
+    EXPECT_EQ(string_data(tail),
+              string_data(runtime_get_variable(env, "text")->string_value) + 10);
+    EXPECT_STREQ(string_cstr(runtime_get_variable(env, "head")->string_value), "word");
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Ranges that are NaN or infinite are rejected rather than cast to size_t
+TEST(BuiltinsTest, SubstringRejectsNonFiniteRange) {
+    const double bad[] = { std::nan(""), INFINITY, -INFINITY };
+    RuntimeValue args[3];
+    args[0].type = RUNTIME_VALUE_STRING;
+    args[0].string_value = string_create("hello", 5);
+    args[1].type = RUNTIME_VALUE_NUMBER;
+    args[2].type = RUNTIME_VALUE_NUMBER;
+    testing::internal::CaptureStderr();
+    for (double value : bad) {
+        args[1].number_value = value;
+        args[2].number_value = 1;
+        EXPECT_EQ(builtin_substring(nullptr, args, 3).type, RUNTIME_VALUE_NULL);
+        args[1].number_value = 1;
+        args[2].number_value = value;
+        EXPECT_EQ(builtin_substring(nullptr, args, 3).type, RUNTIME_VALUE_NULL);
+    }
+    testing::internal::GetCapturedStderr();
+    string_release(args[0].string_value);
+}
+
+// Huge bounds clamp to the array; non-finite ones are rejected
+TEST(BuiltinsTest, SliceRejectsNonFiniteBounds) {
+    ScriptArray* xs = array_create(3);
+    for (int i = 0; i < 3; i++) {
+        RuntimeValue n;
+        n.type = RUNTIME_VALUE_NUMBER;
+        n.number_value = i;
+        ASSERT_TRUE(array_push(xs, n));
+    }
+    RuntimeValue args[3];
+    args[0].type = RUNTIME_VALUE_ARRAY;
+    args[0].array_value = xs;
+    args[1].type = RUNTIME_VALUE_NUMBER;
+    args[2].type = RUNTIME_VALUE_NUMBER;
+
+    args[1].number_value = -1e300;
+    args[2].number_value = 1e300;
+    RuntimeValue all = builtin_slice(nullptr, args, 3);
+    ASSERT_EQ(all.type, RUNTIME_VALUE_ARRAY);
+    EXPECT_EQ(array_count(all.array_value), 3);
+    runtime_free_value(&all);
+
+    const double bad[] = { std::nan(""), INFINITY, -INFINITY };
+    testing::internal::CaptureStderr();
+    for (double value : bad) {
+        args[1].number_value = value;
+        args[2].number_value = 1;
+        EXPECT_EQ(builtin_slice(nullptr, args, 3).type, RUNTIME_VALUE_NULL);
+        EXPECT_EQ(builtin_slice(nullptr, args, 2).type, RUNTIME_VALUE_NULL);
+        args[1].number_value = 0;
+        args[2].number_value = value;
+        EXPECT_EQ(builtin_slice(nullptr, args, 3).type, RUNTIME_VALUE_NULL);
+    }
+    testing::internal::GetCapturedStderr();
+    array_release(xs);
+}
+
+// print(), string concatenation and to_string() format numbers the same way
+TEST(BuiltinsTest, NumbersFormatTheSameEverywhere) {
+    std::string source =
+        "var third = 1 / 3;"
+        "var joined = \"n=\" + 5 + \",\" + (0.1 + 0.2) + \",\" + third;"
+        "var converted = to_string(2.5) + to_string(true) + to_string(null) + to_string(\"!\");"
+        "print(5, 0.1 + 0.2, third, 100000000 * 100000000 * 100000, joined);";
+    ASTNode* root = nullptr;
+    OutputSink* capture = output_sink_create_memory();
+    output_sink_bind(capture);
+    Environment* env = runScript(source, &root);
+    output_sink_bind(nullptr);
+    size_t printed_length = 0;
+    const char* printed_data = output_sink_contents(capture, &printed_length);
+    std::string printed(printed_data, printed_length);
+    output_sink_free(capture);
+
+    EXPECT_STREQ(string_cstr(runtime_get_variable(env, "joined")->string_value),
+                 "n=5,0.30000000000000004,0.3333333333333333");
+    EXPECT_STREQ(string_cstr(runtime_get_variable(env, "converted")->string_value), "2.5truenull!");
+    EXPECT_EQ(printed, "5 0.30000000000000004 0.3333333333333333 1e+21 "
+                       "n=5,0.30000000000000004,0.3333333333333333\n");
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
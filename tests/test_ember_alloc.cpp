@@ -0,0 +1,180 @@
+#include "builtins.h"
+#include "compiler.h"
+#include "ember_alloc.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+
+// Prefixes every block with its size so live bytes can be tracked and a
+// budget enforced, the way an embedder capping script memory would.
+struct CountingHeap {
+    size_t live_bytes = 0;
+    size_t live_blocks = 0;
+    size_t budget = SIZE_MAX;
+};
+
+static const size_t kHeader = 16;
+
+static void* countingAlloc(void* user, size_t size) {
+    CountingHeap* heap = static_cast<CountingHeap*>(user);
+    if (heap->live_bytes + size > heap->budget) return nullptr;
+    char* block = static_cast<char*>(malloc(size + kHeader));
+    if (!block) return nullptr;
+    *reinterpret_cast<size_t*>(block) = size;
+    heap->live_bytes += size;
+    heap->live_blocks++;
+    return block + kHeader;
+}
+
+static void countingFree(void* user, void* ptr) {
+    CountingHeap* heap = static_cast<CountingHeap*>(user);
+    char* block = static_cast<char*>(ptr) - kHeader;
+    heap->live_bytes -= *reinterpret_cast<size_t*>(block);
+    heap->live_blocks--;
+    free(block);
+}
+
+static void* countingRealloc(void* user, void* ptr, size_t size) {
+    if (!ptr) return countingAlloc(user, size);
+    size_t old_size = *reinterpret_cast<size_t*>(static_cast<char*>(ptr) - kHeader);
+    void* grown = countingAlloc(user, size);
+    if (!grown) return nullptr;
+    memcpy(grown, ptr, old_size < size ? old_size : size);
+    countingFree(user, ptr);
+    return grown;
+}
+
+static const char* kScript =
+    "function greet(name) { return \"hi \" + name; }"
+    "var words = [\"a\", \"b\", \"c\"];"
+    "var total = 0;"
+    "var last = \"\";"
+    "for (var i = 0; i < 3; i = i + 1) { last = greet(words[i]); total = total + i; }";
+
+// The allocator is process-wide and other tests leave pool workers running,
+// so each scenario installs it in a forked child and reports through the exit code
+#define EXPECT_IN_CHILD(scenario) \
+    EXPECT_EXIT({ scenario(); exit(::testing::Test::HasFailure() ? 1 : 0); }, \
+                ::testing::ExitedWithCode(0), "")
+
+static void runScriptThroughAllocator() {
+    // Cached environment nodes from before the fork came from malloc
+    runtime_env_pool_trim();
+    CountingHeap heap;
+    EmberAllocator allocator = { countingAlloc, countingRealloc, countingFree, &heap };
+    ember_set_allocator(&allocator);
+    ember_mem_stats_reset();
+
+    Lexer lexer;
+    lexer_init(&lexer, kScript);
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    ASSERT_NE(root, nullptr);
+
+    BytecodeChunk* chunk = vm_create_chunk();
+    SymbolTable* symtab = symbol_table_create();
+    ASSERT_TRUE(compile_ast(root, chunk, symtab));
+    VM* vm = vm_create(chunk);
+    EXPECT_EQ(vm_run(vm), VM_RESULT_OK);
+    vm_free(vm);
+    vm_free_chunk(chunk);
+    symbol_table_free(symtab);
+
+    Environment* env = runtime_create_environment();
+    builtins_register(env);
+    runtime_execute_block(env, root);
+    RuntimeValue* total = runtime_get_variable(env, "total");
+    ASSERT_NE(total, nullptr);
+    EXPECT_DOUBLE_EQ(total->number_value, 3.0);
+    runtime_free_environment(env);
+    runtime_env_pool_trim();
+
+    free_ast(root);
+    ember_free(parser);
+    // Shapes are process-wide and this script creates none, so nothing may survive
+    EXPECT_EQ(heap.live_blocks, 0u);
+
+    for (int s = EMBER_MEM_LEXER; s <= EMBER_MEM_RUNTIME; s++) {
+        EXPECT_GT(ember_mem_stats((EmberMemSubsystem)s).calls, 0u)
+            << ember_mem_subsystem_name((EmberMemSubsystem)s);
+    }
+}
+
+// Blocks carry a header, so any block freed with plain free() instead of
+// through the allocator would abort; every subsystem shows up in the stats
+TEST(EmberAllocTest, AllMemoryGoesThroughTheAllocator) {
+    EXPECT_IN_CHILD(runScriptThroughAllocator);
+}
+
+static const char* kVmScript =
+    "var s = \"a\" + 1;"
+    "s = s + \"b\";"
+    "var xs = [s, [1, 2], \"c\" + 2];"
+    "xs = slice(xs, 1);"
+    "var o = { name = s };"
+    "o.name = \"d\" + 3;"
+    "o[\"extra\"] = xs;"
+    "function gen(x) { var local = [x + \"!\"]; coroutine_yield(local); return x; }"
+    "var co = coroutine_create(gen);"
+    "var first = coroutine_resume(co, \"e\" + 4);";
+
+// Everything a VM holds, including a coroutine suspended with live
+// values on its stack, goes back to the allocator in vm_free()
+static void releaseEverythingOnVmFree() {
+    runtime_env_pool_trim();
+    CountingHeap heap;
+    EmberAllocator allocator = { countingAlloc, countingRealloc, countingFree, &heap };
+    ember_set_allocator(&allocator);
+
+    Lexer lexer;
+    lexer_init(&lexer, kVmScript);
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    ASSERT_NE(root, nullptr);
+    BytecodeChunk* chunk = vm_create_chunk();
+    SymbolTable* symtab = symbol_table_create();
+    ASSERT_TRUE(compile_ast(root, chunk, symtab));
+    symbol_table_free(symtab);
+
+    // Object shapes are shared by every VM and kept; the first run builds them
+    VM* warm = vm_create(chunk);
+    EXPECT_EQ(vm_run(warm), VM_RESULT_OK);
+    vm_free(warm);
+
+    size_t before = heap.live_blocks;
+    VM* vm = vm_create(chunk);
+    EXPECT_EQ(vm_run(vm), VM_RESULT_OK);
+    EXPECT_GT(heap.live_blocks, before);
+    vm_free(vm);
+    EXPECT_EQ(heap.live_blocks, before);
+
+    vm_free_chunk(chunk);
+    free_ast(root);
+    ember_free(parser);
+}
+
+TEST(EmberAllocTest, VmFreeReleasesEverythingItHolds) {
+    EXPECT_IN_CHILD(releaseEverythingOnVmFree);
+}
+
+static void refuseOverBudget() {
+    CountingHeap heap;
+    heap.budget = 64;
+    EmberAllocator allocator = { countingAlloc, countingRealloc, countingFree, &heap };
+    ember_set_allocator(&allocator);
+    ember_mem_stats_reset();
+
+    void* small = ember_malloc(EMBER_MEM_BUILTINS, 32);
+    EXPECT_NE(small, nullptr);
+    EXPECT_EQ(ember_malloc(EMBER_MEM_BUILTINS, 64), nullptr);
+    ember_free(small);
+
+    EmberMemStats stats = ember_mem_stats(EMBER_MEM_BUILTINS);
+    EXPECT_EQ(stats.calls, 2u);
+    EXPECT_EQ(stats.bytes, 96u);
+    EXPECT_EQ(stats.failures, 1u);
+    EXPECT_EQ(heap.live_blocks, 0u);
+}
+
+TEST(EmberAllocTest, RefusedRequestsAreCounted) {
+    EXPECT_IN_CHILD(refuseOverBudget);
+}
@@ -0,0 +1,81 @@
+#include "builtins.h"
+#include "event_bus.h"
+#include "test_helpers.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* kHandlers =
+    "var hits = 0;"
+    "var sum = 0;"
+    "function count(x) { hits = hits + 1; sum = sum + x; }"
+    "function tenfold(x) { hits = hits + 10; }"
+    "on(\"hit\", count);"
+    "on(\"hit\", tenfold);";
+
+TEST(EventBusTest, PostedEventsRunEveryHandlerInBatches) {
+    EventBus* bus = event_bus_create();
+    ASSERT_NE(bus, nullptr);
+    event_bus_bind(bus);
+    ASTNode* root = nullptr;
+    Environment* env = runScript(kHandlers, &root);
+    EXPECT_EQ(event_bus_handler_count(bus, "hit"), 2);
+    EXPECT_EQ(event_bus_handler_count(bus, "miss"), 0);
+
+    const int kProducers = 4;
+    const int kPerProducer = 500;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([bus]() {
+            RuntimeValue one;
+            one.type = RUNTIME_VALUE_NUMBER;
+            one.number_value = 1;
+            for (int i = 0; i < kPerProducer; i++) {
+                event_bus_post(bus, "hit", &one);
+            }
+        });
+    }
+
+    // Drain concurrently with the producers, one bounded batch at a time
+    int handled = 0;
+    while (handled < kProducers * kPerProducer) {
+        int batch = event_bus_dispatch(bus, env, 64);
+        EXPECT_LE(batch, 64);
+        handled += batch;
+        if (batch == 0) std::this_thread::yield();
+    }
+    for (auto& t : producers) t.join();
+    EXPECT_EQ(event_bus_dispatch(bus, env, 0), 0);
+
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "hits")->number_value, 11.0 * handled);
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "sum")->number_value, (double)handled);
+
+    event_bus_bind(nullptr);
+    event_bus_free(bus);
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+TEST(EventBusTest, TriggerEventUsesRegisteredHandlers) {
+    EventBus* bus = event_bus_create();
+    ASSERT_NE(bus, nullptr);
+    event_bus_bind(bus);
+    ASTNode* root = nullptr;
+    Environment* env = runScript(kHandlers, &root);
+
+    RuntimeValue five;
+    five.type = RUNTIME_VALUE_NUMBER;
+    five.number_value = 5;
+    char name[] = "hit";
+    RuntimeEvent event = { name, &five };
+    runtime_trigger_event(env, &event);
+
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "hits")->number_value, 11.0);
+    EXPECT_DOUBLE_EQ(runtime_get_variable(env, "sum")->number_value, 5.0);
+
+    event_bus_free(bus);
+    EXPECT_EQ(event_bus_current(), nullptr);
+    runtime_free_environment(env);
+    free_ast(root);
+}
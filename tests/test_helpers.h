@@ -0,0 +1,56 @@
+// test_helpers.h
+//
+// Script setup shared by the test suites.
+#ifndef EMBER_TEST_HELPERS_H
+#define EMBER_TEST_HELPERS_H
+
+#include "builtins.h"
+#include "compiler.h"
+#include "ember_alloc.h"
+#include <gtest/gtest.h>
+#include <string>
+
+// Runs `source` with the tree-walking runtime in a fresh global environment,
+// on the calling thread. Nothing is bound here: tests that need an event bus
+// or timer wheel bind one to this thread first. The AST is returned through
+// `root` because function values, handlers and callbacks point into it.
+inline Environment* runScript(const std::string& source, ASTNode** root) {
+    Lexer lexer;
+    lexer_init(&lexer, source.c_str());
+    Parser* parser = parser_create(&lexer);
+    *root = parse_script(parser);
+    ember_free(parser);
+    EXPECT_NE(*root, nullptr);
+
+    Environment* env = runtime_create_environment();
+    builtins_register(env);
+    if (*root) {
+        runtime_execute_block(env, *root);
+    }
+    return env;
+}
+
+// Compiles `source` into a fresh chunk. If `var_name` is given, the global
+// slot the compiler assigned it is written to `*var_index`.
+inline BytecodeChunk* compileSource(const char* source, const char* var_name = nullptr,
+                                    int* var_index = nullptr) {
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    EXPECT_NE(root, nullptr);
+
+    SymbolTable* symtab = symbol_table_create();
+    BytecodeChunk* chunk = vm_create_chunk();
+    EXPECT_TRUE(compile_ast(root, chunk, symtab));
+    if (var_name) {
+        *var_index = symbol_table_get_or_add(symtab, var_name, false);
+    }
+
+    symbol_table_free(symtab);
+    free_ast(root);
+    ember_free(parser);
+    return chunk;
+}
+
+#endif // EMBER_TEST_HELPERS_H
@@ -22,6 +22,12 @@ static std::vector<Token> tokenizeSource(const char* source) {
     EXPECT_EQ((tok).type, expected_type);                \
     if (expected_value) EXPECT_STREQ((tok).value, expected_value);
 
+// Number tokens carry their parsed value instead of text
+#define EXPECT_NUMBER_TOKEN(tok, expected_number)       \
+    EXPECT_EQ((tok).type, TOKEN_NUMBER);                \
+    EXPECT_EQ((tok).value, nullptr);                    \
+    EXPECT_EQ((tok).number, (double)(expected_number));
+
 // Test basic tokenization of a simple statement
 TEST(LexerTest, BasicTokenization) {
     const char* source = "var x = 42;";
@@ -31,7 +37,7 @@ TEST(LexerTest, BasicTokenization) {
     EXPECT_TOKEN(tokens[0], TOKEN_KEYWORD, "var");
     EXPECT_TOKEN(tokens[1], TOKEN_IDENTIFIER, "x");
     EXPECT_TOKEN(tokens[2], TOKEN_OPERATOR, "=");
-    EXPECT_TOKEN(tokens[3], TOKEN_NUMBER, "42");
+    EXPECT_NUMBER_TOKEN(tokens[3], 42);
     EXPECT_TOKEN(tokens[4], TOKEN_PUNCTUATION, ";");
     EXPECT_EQ(tokens[5].type, TOKEN_EOF);
 
@@ -135,7 +141,7 @@ TEST(LexerTest, WhitespaceAndComments) {
     EXPECT_TOKEN(tokens[0], TOKEN_KEYWORD, "var");
     EXPECT_TOKEN(tokens[1], TOKEN_IDENTIFIER, "x");
     EXPECT_TOKEN(tokens[2], TOKEN_OPERATOR, "=");
-    EXPECT_TOKEN(tokens[3], TOKEN_NUMBER, "10");
+    EXPECT_NUMBER_TOKEN(tokens[3], 10);
     EXPECT_TOKEN(tokens[4], TOKEN_PUNCTUATION, ";");
 
     // After comments, next line:
@@ -144,7 +150,7 @@ TEST(LexerTest, WhitespaceAndComments) {
     EXPECT_TOKEN(tokens[6], TOKEN_OPERATOR, "=");
     EXPECT_TOKEN(tokens[7], TOKEN_IDENTIFIER, "x");
     EXPECT_TOKEN(tokens[8], TOKEN_OPERATOR, "+");
-    EXPECT_TOKEN(tokens[9], TOKEN_NUMBER, "5");
+    EXPECT_NUMBER_TOKEN(tokens[9], 5);
     EXPECT_TOKEN(tokens[10], TOKEN_PUNCTUATION, ";");
     EXPECT_EQ(tokens[11].type, TOKEN_EOF);
 
@@ -160,15 +166,15 @@ TEST(LexerTest, Operators) {
     EXPECT_TOKEN(tokens[1], TOKEN_PUNCTUATION, "(");
     EXPECT_TOKEN(tokens[2], TOKEN_IDENTIFIER, "x");
     EXPECT_TOKEN(tokens[3], TOKEN_OPERATOR, ">=");
-    EXPECT_TOKEN(tokens[4], TOKEN_NUMBER, "10");
+    EXPECT_NUMBER_TOKEN(tokens[4], 10);
     EXPECT_TOKEN(tokens[5], TOKEN_OPERATOR, "&&");
     EXPECT_TOKEN(tokens[6], TOKEN_IDENTIFIER, "y");
     EXPECT_TOKEN(tokens[7], TOKEN_OPERATOR, "<=");
-    EXPECT_TOKEN(tokens[8], TOKEN_NUMBER, "5");
+    EXPECT_NUMBER_TOKEN(tokens[8], 5);
     EXPECT_TOKEN(tokens[9], TOKEN_OPERATOR, "||");
     EXPECT_TOKEN(tokens[10], TOKEN_IDENTIFIER, "z");
     EXPECT_TOKEN(tokens[11], TOKEN_OPERATOR, "!=");
-    EXPECT_TOKEN(tokens[12], TOKEN_NUMBER, "3");
+    EXPECT_NUMBER_TOKEN(tokens[12], 3);
     EXPECT_TOKEN(tokens[13], TOKEN_PUNCTUATION, ")");
     EXPECT_TOKEN(tokens[14], TOKEN_PUNCTUATION, "{");
     EXPECT_TOKEN(tokens[15], TOKEN_IDENTIFIER, "z");
@@ -228,14 +234,14 @@ TEST(LexerTest, FromAdventureGameSnippet) {
     EXPECT_TOKEN(tokens[5], TOKEN_KEYWORD, "var");
     EXPECT_TOKEN(tokens[6], TOKEN_IDENTIFIER, "health");
     EXPECT_TOKEN(tokens[7], TOKEN_OPERATOR, "=");
-    EXPECT_TOKEN(tokens[8], TOKEN_NUMBER, "50");
+    EXPECT_NUMBER_TOKEN(tokens[8], 50);
     EXPECT_TOKEN(tokens[9], TOKEN_PUNCTUATION, ";");
 
     // var gold = 0;
     EXPECT_TOKEN(tokens[10], TOKEN_KEYWORD, "var");
     EXPECT_TOKEN(tokens[11], TOKEN_IDENTIFIER, "gold");
     EXPECT_TOKEN(tokens[12], TOKEN_OPERATOR, "=");
-    EXPECT_TOKEN(tokens[13], TOKEN_NUMBER, "0");
+    EXPECT_NUMBER_TOKEN(tokens[13], 0);
     EXPECT_TOKEN(tokens[14], TOKEN_PUNCTUATION, ";");
 
     // var inventory = "Sword";
@@ -288,3 +294,56 @@ TEST(LexerTest, FromAdventureGameSnippet) {
 
     for (auto &t : tokens) free_token(&t);
 }
+
+// Literals are parsed once, exactly: the fast path and the strtod fallback
+// agree with strtod on every form the lexer accepts
+TEST(LexerTest, NumberLiteralsParseExactly) {
+    const char* literals[] = {
+        "0", "7", "42", "007", "3.14", "0.1", "0.30000000000000004", "9007199254740993",
+        "123456789012345678901234567890", "100000000000000000000000000",
+        "1e3", "2.5E-3", "1e+21", "1e22", "1e23", "4.9e-324", "1.7976931348623157e308",
+        "1e400", "0.000000000000000000000000000001",
+        "3.0000000000000000000000000000000000001", "2.2250738585072011e-308",
+    };
+    for (const char* literal : literals) {
+        auto tokens = tokenizeSource(literal);
+        SCOPED_TRACE(literal);
+        ASSERT_EQ(tokens.size(), 2u);
+        EXPECT_NUMBER_TOKEN(tokens[0], strtod(literal, nullptr));
+        for (auto &t : tokens) free_token(&t);
+    }
+}
+
+// A dot or an `e` only belongs to the number when a digit follows it
+TEST(LexerTest, NumberLiteralBoundaries) {
+    auto tokens = tokenizeSource("1.2.3 7.x 2else 5e 6e-");
+    ASSERT_GE(tokens.size(), 14u);
+    EXPECT_NUMBER_TOKEN(tokens[0], 1.2);
+    EXPECT_TOKEN(tokens[1], TOKEN_PUNCTUATION, ".");
+    EXPECT_NUMBER_TOKEN(tokens[2], 3);
+    EXPECT_NUMBER_TOKEN(tokens[3], 7);
+    EXPECT_TOKEN(tokens[4], TOKEN_PUNCTUATION, ".");
+    EXPECT_TOKEN(tokens[5], TOKEN_IDENTIFIER, "x");
+    EXPECT_NUMBER_TOKEN(tokens[6], 2);
+    EXPECT_TOKEN(tokens[7], TOKEN_KEYWORD, "else");
+    EXPECT_NUMBER_TOKEN(tokens[8], 5);
+    EXPECT_TOKEN(tokens[9], TOKEN_IDENTIFIER, "e");
+    EXPECT_NUMBER_TOKEN(tokens[10], 6);
+    EXPECT_TOKEN(tokens[11], TOKEN_IDENTIFIER, "e");
+    EXPECT_TOKEN(tokens[12], TOKEN_OPERATOR, "-");
+    EXPECT_EQ(tokens[13].type, TOKEN_EOF);
+    for (auto &t : tokens) free_token(&t);
+}
+
+// Number tokens have no text, so print_token shows their value
+TEST(LexerTest, PrintTokenShowsNumbers) {
+    auto tokens = tokenizeSource("x 0.1");
+    ASSERT_EQ(tokens.size(), 3u);
+    testing::internal::CaptureStdout();
+    print_token(&tokens[0]);
+    print_token(&tokens[1]);
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_NE(out.find("Value=x\n"), std::string::npos);
+    EXPECT_NE(out.find("Value=0.10000000000000001\n"), std::string::npos);
+    for (auto &t : tokens) free_token(&t);
+}
@@ -0,0 +1,91 @@
+#include "number_format.h"
+#include <gtest/gtest.h>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+static std::string format(double value) {
+    char buffer[NUMBER_FORMAT_BUFFER_SIZE];
+    size_t length = number_format(value, buffer);
+    EXPECT_EQ(length, strlen(buffer));
+    return std::string(buffer, length);
+}
+
+TEST(NumberFormatTest, KnownValues) {
+    EXPECT_EQ(format(0.0), "0");
+    EXPECT_EQ(format(-0.0), "0");
+    EXPECT_EQ(format(5.0), "5");
+    EXPECT_EQ(format(-42.0), "-42");
+    EXPECT_EQ(format(9007199254740992.0), "9007199254740992");
+    EXPECT_EQ(format(1e20), "100000000000000000000");
+    EXPECT_EQ(format(1e21), "1e+21");
+    EXPECT_EQ(format(0.1), "0.1");
+    EXPECT_EQ(format(0.1 + 0.2), "0.30000000000000004");
+    EXPECT_EQ(format(1.0 / 3.0), "0.3333333333333333");
+    EXPECT_EQ(format(123.456), "123.456");
+    EXPECT_EQ(format(-0.5), "-0.5");
+    EXPECT_EQ(format(0.000001), "0.000001");
+    EXPECT_EQ(format(1e-7), "1e-7");
+    EXPECT_EQ(format(2.5e-7), "2.5e-7");
+    EXPECT_EQ(format(1.5e300), "1.5e+300");
+    EXPECT_EQ(format(DBL_MAX), "1.7976931348623157e+308");
+    EXPECT_EQ(format(5e-324), "5e-324");
+    EXPECT_EQ(format(NAN), "nan");
+    EXPECT_EQ(format(INFINITY), "inf");
+    EXPECT_EQ(format(-INFINITY), "-inf");
+}
+
+// Every finite double reads back unchanged. Grisu2 works inside a slightly
+// narrowed interval, so a value whose shortest form sits right at the edge
+// gets more digits; that is rare, and never more than 17
+TEST(NumberFormatTest, RoundTripsRandomBitPatterns) {
+    std::mt19937_64 rng(20261016);
+    int samples = 0;
+    int longer = 0;
+    for (int i = 0; i < 100000; i++) {
+        uint64_t bits = rng();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (!std::isfinite(value)) {
+            continue;
+        }
+        std::string text = format(value);
+        ASSERT_LT(text.size(), (size_t)NUMBER_FORMAT_BUFFER_SIZE);
+        double parsed = strtod(text.c_str(), nullptr);
+        ASSERT_EQ(parsed, value) << text;
+
+        int shortest = 1;
+        char reference[40];
+        for (; shortest < 17; shortest++) {
+            snprintf(reference, sizeof(reference), "%.*g", shortest, value);
+            if (strtod(reference, nullptr) == value) {
+                break;
+            }
+        }
+        // Significant digits: drop the sign, point and leading/trailing zeros
+        std::string mantissa;
+        for (char c : text.substr(0, text.find('e'))) {
+            if (c >= '0' && c <= '9') mantissa += c;
+        }
+        mantissa.erase(0, mantissa.find_first_not_of('0'));
+        mantissa.erase(mantissa.find_last_not_of('0') + 1);
+        size_t digits = mantissa.size();
+        EXPECT_LE(digits, 17u) << text;
+        samples++;
+        longer += digits > (size_t)shortest;
+    }
+    EXPECT_LT(longer, samples / 1000);
+}
+
+TEST(NumberFormatTest, IntegersUseNoFraction) {
+    for (double value = 1; value < 1e16; value = value * 3 + 1) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%.0f", value);
+        EXPECT_EQ(format(value), expected);
+        EXPECT_EQ(format(-value), std::string("-") + expected);
+    }
+}
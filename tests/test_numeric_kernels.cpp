@@ -0,0 +1,97 @@
+#include "numeric_kernels.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+// Lengths around every vector width and unroll factor, so each kernel's
+// main loop and scalar tail are both exercised
+static const size_t kLengths[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 100, 1001 };
+
+static std::vector<double> sampleValues(size_t count, double seed) {
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; i++) {
+        values[i] = std::sin(seed + (double)i * 0.37) * 100.0;
+    }
+    return values;
+}
+
+TEST(NumericKernelsTest, DispatchPicksAnAvailableIsa) {
+    const NumericKernels* chosen = numeric_kernels();
+    ASSERT_NE(chosen, nullptr);
+    EXPECT_EQ(numeric_kernels_for(chosen->isa), chosen);
+    // Nothing better than the chosen set is available
+    for (int isa = chosen->isa + 1; isa < NUMERIC_ISA_COUNT; isa++) {
+        EXPECT_EQ(numeric_kernels_for((NumericIsa)isa), nullptr);
+    }
+    EXPECT_NE(numeric_kernels_for(NUMERIC_ISA_SCALAR), nullptr);
+}
+
+TEST(NumericKernelsTest, EveryIsaMatchesScalar) {
+    const NumericKernels* scalar = numeric_kernels_for(NUMERIC_ISA_SCALAR);
+    for (int isa = 0; isa < NUMERIC_ISA_COUNT; isa++) {
+        const NumericKernels* kernels = numeric_kernels_for((NumericIsa)isa);
+        if (!kernels) continue;
+        SCOPED_TRACE(kernels->name);
+        for (size_t count : kLengths) {
+            SCOPED_TRACE(count);
+            std::vector<double> a = sampleValues(count, 1.0);
+            std::vector<double> b = sampleValues(count, 2.5);
+            // Reductions are reassociated, so allow rounding differences
+            EXPECT_NEAR(kernels->sum(a.data(), count), scalar->sum(a.data(), count), 1e-9);
+            EXPECT_NEAR(kernels->dot(a.data(), b.data(), count), scalar->dot(a.data(), b.data(), count), 1e-6);
+            EXPECT_EQ(kernels->min(a.data(), count), scalar->min(a.data(), count));
+            EXPECT_EQ(kernels->max(a.data(), count), scalar->max(a.data(), count));
+
+            std::vector<double> expected(count), actual(count);
+            scalar->scale(expected.data(), a.data(), count, -1.5);
+            kernels->scale(actual.data(), a.data(), count, -1.5);
+            EXPECT_EQ(actual, expected);
+            scalar->add(expected.data(), a.data(), b.data(), count);
+            kernels->add(actual.data(), a.data(), b.data(), count);
+            EXPECT_EQ(actual, expected);
+            scalar->clamp(expected.data(), a.data(), count, -20.0, 35.0);
+            kernels->clamp(actual.data(), a.data(), count, -20.0, 35.0);
+            EXPECT_EQ(actual, expected);
+        }
+    }
+}
+
+// `out` may alias the input
+TEST(NumericKernelsTest, InPlaceUpdates) {
+    std::vector<double> values = sampleValues(19, 0.0);
+    std::vector<double> doubled = values;
+    for (double& v : doubled) v *= 2.0;
+    const NumericKernels* kernels = numeric_kernels();
+    kernels->scale(values.data(), values.data(), values.size(), 2.0);
+    EXPECT_EQ(values, doubled);
+}
+
+// NaN elements are skipped by min/max and pulled to `lo` by clamp, the same
+// way on every instruction set, wherever the NaN falls in the vector loop
+TEST(NumericKernelsTest, NaNHandlingMatchesScalar) {
+    const NumericKernels* scalar = numeric_kernels_for(NUMERIC_ISA_SCALAR);
+    const double nan = std::nan("");
+    std::vector<double> fixed = { 5, 5, 1, 5, 5, 5, nan, 5 };
+    EXPECT_EQ(scalar->min(fixed.data(), fixed.size()), 1.0);
+    for (int isa = 0; isa < NUMERIC_ISA_COUNT; isa++) {
+        const NumericKernels* kernels = numeric_kernels_for((NumericIsa)isa);
+        if (!kernels) continue;
+        SCOPED_TRACE(kernels->name);
+        EXPECT_EQ(kernels->min(fixed.data(), fixed.size()), 1.0);
+        for (size_t count : kLengths) {
+            for (size_t at = 0; at < count && at < 9; at++) {
+                SCOPED_TRACE(count);
+                SCOPED_TRACE(at);
+                std::vector<double> a = sampleValues(count, 0.5);
+                a[at] = nan;
+                EXPECT_EQ(kernels->min(a.data(), count), scalar->min(a.data(), count));
+                EXPECT_EQ(kernels->max(a.data(), count), scalar->max(a.data(), count));
+
+                std::vector<double> expected(count), actual(count);
+                scalar->clamp(expected.data(), a.data(), count, -20.0, 35.0);
+                kernels->clamp(actual.data(), a.data(), count, -20.0, 35.0);
+                EXPECT_EQ(actual, expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,208 @@
+#include "output_sink.h"
+#include "compiler.h"
+#include "builtins.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+static std::string contents(const OutputSink* sink) {
+    size_t length = 0;
+    const char* data = output_sink_contents(sink, &length);
+    return std::string(data, length);
+}
+
+static long fileSize(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// Nothing reaches the file until the buffer fills or the sink is flushed;
+// writes bigger than the buffer go straight through
+TEST(OutputSinkTest, FileSinkWritesWhenFullOrFlushed) {
+    std::string path = testing::TempDir() + "ember_output_sink.txt";
+    OutputSink* sink = output_sink_create_file(path.c_str(), false, 16);
+    ASSERT_NE(sink, nullptr);
+    EXPECT_EQ(output_sink_kind(sink), OUTPUT_SINK_FILE);
+    EXPECT_EQ(output_sink_contents(sink, nullptr), nullptr);
+
+    EXPECT_TRUE(output_sink_write(sink, "0123456789", 10));
+    EXPECT_EQ(fileSize(path), 0);
+    EXPECT_TRUE(output_sink_write(sink, "abcdefghij", 10));
+    EXPECT_EQ(fileSize(path), 10);
+    EXPECT_TRUE(output_sink_flush(sink));
+    EXPECT_EQ(fileSize(path), 20);
+    std::string big(40, 'x');
+    EXPECT_TRUE(output_sink_write(sink, "tail", 4));
+    EXPECT_TRUE(output_sink_write(sink, big.data(), big.size()));
+    EXPECT_EQ(fileSize(path), 64);
+    EXPECT_TRUE(output_sink_write(sink, "!", 1));
+    output_sink_free(sink);
+    EXPECT_EQ(fileSize(path), 65);
+
+    sink = output_sink_create_file(path.c_str(), true, 0);
+    ASSERT_NE(sink, nullptr);
+    EXPECT_TRUE(output_sink_write(sink, "more", 4));
+    output_sink_free(sink);
+    EXPECT_EQ(fileSize(path), 69);
+    remove(path.c_str());
+}
+
+// A sink bound to a thread wins over the installed one, which wins over the
+// built-in stdout sink
+TEST(OutputSinkTest, BoundSinkOverridesInstalledSink) {
+    OutputSink* installed = output_sink_create_memory();
+    OutputSink* bound = output_sink_create_memory();
+    EXPECT_EQ(output_sink_kind(output_sink_current()), OUTPUT_SINK_STDOUT);
+
+    EXPECT_EQ(output_sink_install(installed), nullptr);
+    output_sink_bind(bound);
+    EXPECT_EQ(output_sink_current(), bound);
+    OutputSink* seen_elsewhere = nullptr;
+    std::thread([&]() { seen_elsewhere = output_sink_current(); }).join();
+    EXPECT_EQ(seen_elsewhere, installed);
+
+    output_sink_bind(nullptr);
+    EXPECT_EQ(output_sink_current(), installed);
+    EXPECT_EQ(output_sink_install(nullptr), installed);
+    EXPECT_EQ(output_sink_kind(output_sink_current()), OUTPUT_SINK_STDOUT);
+
+    output_sink_free(installed);
+    output_sink_free(bound);
+}
+
+// Scripts running on several threads print whole values into one installed
+// capture sink
+TEST(OutputSinkTest, InstalledSinkCapturesConcurrentScripts) {
+    Lexer lexer;
+    lexer_init(&lexer, "for (var i = 0; i < 500; i = i + 1) { print(\"line\"); }");
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    ASSERT_NE(root, nullptr);
+    SymbolTable* symtab = symbol_table_create();
+    BytecodeChunk* chunk = vm_create_chunk();
+    ASSERT_TRUE(compile_ast(root, chunk, symtab));
+
+    OutputSink* capture = output_sink_create_memory();
+    output_sink_install(capture);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([chunk]() {
+            VM* vm = vm_create(chunk);
+            EXPECT_EQ(vm_run(vm), VM_RESULT_OK);
+            vm_free(vm);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    output_sink_install(nullptr);
+
+    std::string printed = contents(capture);
+    EXPECT_EQ(printed.size(), 4u * 500u * 5u);
+    // Each printed line lands whole, newline included
+    int lines = 0;
+    for (size_t pos = 0; pos < printed.size(); pos += 5) {
+        ASSERT_EQ(printed.compare(pos, 5, "line\n"), 0) << "at offset " << pos;
+        lines++;
+    }
+    EXPECT_EQ(lines, 4 * 500);
+    output_sink_reset(capture);
+    EXPECT_EQ(contents(capture), "");
+    output_sink_free(capture);
+
+    symbol_table_free(symtab);
+    vm_free_chunk(chunk);
+    free_ast(root);
+    free(parser);
+}
+
+// print() with several arguments joins them into one line before writing
+TEST(OutputSinkTest, PrintWritesEachLineWhole) {
+    OutputSink* capture = output_sink_create_memory();
+    output_sink_install(capture);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([]() {
+            RuntimeValue args[3];
+            args[0].type = RUNTIME_VALUE_NUMBER;
+            args[0].number_value = 1.5;
+            args[1].type = RUNTIME_VALUE_BOOLEAN;
+            args[1].boolean_value = true;
+            args[2].type = RUNTIME_VALUE_NULL;
+            for (int i = 0; i < 500; i++) {
+                builtin_print(nullptr, args, 3);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    output_sink_install(nullptr);
+
+    std::istringstream printed(contents(capture));
+    std::string line;
+    int lines = 0;
+    while (std::getline(printed, line)) {
+        ASSERT_EQ(line, "1.5 true null");
+        lines++;
+    }
+    EXPECT_EQ(lines, 4 * 500);
+    output_sink_free(capture);
+}
+
+// With stdout and stderr on one pipe or file, a VM error comes out after
+// the output printed before it, even though stdout is buffered
+TEST(OutputSinkTest, ErrorsFollowBufferedOutput) {
+    Lexer lexer;
+    lexer_init(&lexer, "print(\"before\");\nvar zero = 0;\nvar x = 1 / zero;\n");
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    ASSERT_NE(root, nullptr);
+    SymbolTable* symtab = symbol_table_create();
+    BytecodeChunk* chunk = vm_create_chunk();
+    ASSERT_TRUE(compile_ast(root, chunk, symtab));
+
+    std::string path = testing::TempDir() + "ember_output_order.txt";
+    FILE* combined = fopen(path.c_str(), "w");
+    ASSERT_NE(combined, nullptr);
+    fflush(stdout);
+    fflush(stderr);
+    int saved_out = dup(fileno(stdout));
+    int saved_err = dup(fileno(stderr));
+    dup2(fileno(combined), fileno(stdout));
+    dup2(fileno(combined), fileno(stderr));
+
+    OutputSink* buffered = output_sink_create_stdout(0);
+    output_sink_install(buffered);
+    VM* vm = vm_create(chunk);
+    int status = vm_run(vm);
+    vm_free(vm);
+    output_sink_install(nullptr);
+    output_sink_free(buffered);
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_out, fileno(stdout));
+    dup2(saved_err, fileno(stderr));
+    close(saved_out);
+    close(saved_err);
+    fclose(combined);
+
+    std::ifstream in(path);
+    std::stringstream written;
+    written << in.rdbuf();
+    remove(path.c_str());
+    EXPECT_NE(status, VM_RESULT_OK);
+    EXPECT_EQ(written.str().rfind("before\n", 0), 0u) << written.str();
+    EXPECT_NE(written.str().find("VM Error"), std::string::npos) << written.str();
+
+    symbol_table_free(symtab);
+    vm_free_chunk(chunk);
+    free_ast(root);
+    free(parser);
+}
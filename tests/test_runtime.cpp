@@ -0,0 +1,113 @@
+#include "builtins.h"
+#include "object.h"
+#include <gtest/gtest.h>
+#include <string>
+
+// Parameters live in the callee's frame; a recursive call must not
+// overwrite the caller's `n` before the caller has finished with it.
+TEST(RuntimeTest, ParametersShadowCallerVariables) {
+    const char* source =
+        "function fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }"
+        "var n = 7;"
+        "var result = fib(10);";
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    free(parser);
+    ASSERT_NE(root, nullptr);
+
+    Environment* env = runtime_create_environment();
+    builtins_register(env);
+    runtime_execute_block(env, root);
+
+    RuntimeValue* result = runtime_get_variable(env, "result");
+    ASSERT_NE(result, nullptr);
+    ASSERT_EQ(result->type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(result->number_value, 55.0);
+    RuntimeValue* n = runtime_get_variable(env, "n");
+    ASSERT_NE(n, nullptr);
+    EXPECT_DOUBLE_EQ(n->number_value, 7.0);
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Objects are references: a copy sees the same properties. Literals that
+// add the same keys in the same order share one shape.
+TEST(RuntimeTest, ObjectsShareShapesAndProperties) {
+    const char* source =
+        "var a = { x = 1, y = 2 };"
+        "var b = a;"
+        "b.x = 5;"
+        "var c = { x = 3, y = 4 };"
+        "var d = { y = 4, x = 3 };"
+        "var result = a.x + c.y;";
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    free(parser);
+    ASSERT_NE(root, nullptr);
+
+    Environment* env = runtime_create_environment();
+    builtins_register(env);
+    runtime_execute_block(env, root);
+
+    RuntimeValue* result = runtime_get_variable(env, "result");
+    ASSERT_NE(result, nullptr);
+    EXPECT_DOUBLE_EQ(result->number_value, 9.0);
+
+    RuntimeValue* a = runtime_get_variable(env, "a");
+    RuntimeValue* c = runtime_get_variable(env, "c");
+    RuntimeValue* d = runtime_get_variable(env, "d");
+    ASSERT_EQ(a->type, RUNTIME_VALUE_OBJECT);
+    EXPECT_EQ(object_shape(a->object_value), object_shape(c->object_value));
+    EXPECT_NE(object_shape(a->object_value), object_shape(d->object_value));
+    EXPECT_EQ(shape_lookup(object_shape(d->object_value), "x"), 1);
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Objects leave the shape tree past OBJECT_DICTIONARY_THRESHOLD properties
+// or on their first non-identifier key, keeping every property readable
+TEST(RuntimeTest, LargeObjectsSwitchToDictionaryMode) {
+    std::string source = "var wide = {";
+    for (int i = 0; i <= OBJECT_DICTIONARY_THRESHOLD; i++) {
+        source += " p" + std::to_string(i) + " = " + std::to_string(i) + ",";
+    }
+    source += " };"
+              "var narrow = { x = 1 };"
+              "var ids = { x = 1 };"
+              "ids[\"user-42\"] = 5;"
+              "wide.p3 = 100;"
+              "var result = wide.p3 + wide[\"p" + std::to_string(OBJECT_DICTIONARY_THRESHOLD) + "\"]"
+              "             + ids.x + ids[\"user-42\"];";
+    Lexer lexer;
+    lexer_init(&lexer, source.c_str());
+    Parser* parser = parser_create(&lexer);
+    ASTNode* root = parse_script(parser);
+    free(parser);
+    ASSERT_NE(root, nullptr);
+
+    Environment* env = runtime_create_environment();
+    builtins_register(env);
+    runtime_execute_block(env, root);
+
+    RuntimeValue* result = runtime_get_variable(env, "result");
+    ASSERT_NE(result, nullptr);
+    EXPECT_DOUBLE_EQ(result->number_value, 100.0 + OBJECT_DICTIONARY_THRESHOLD + 1.0 + 5.0);
+
+    RuntimeValue* wide = runtime_get_variable(env, "wide");
+    RuntimeValue* narrow = runtime_get_variable(env, "narrow");
+    RuntimeValue* ids = runtime_get_variable(env, "ids");
+    EXPECT_TRUE(object_is_dictionary(wide->object_value));
+    EXPECT_EQ(object_property_count(wide->object_value), OBJECT_DICTIONARY_THRESHOLD + 1);
+    EXPECT_FALSE(object_is_dictionary(narrow->object_value));
+    EXPECT_TRUE(object_is_dictionary(ids->object_value));
+    EXPECT_EQ(object_property_count(ids->object_value), 2);
+
+    runtime_free_environment(env);
+    free_ast(root);
+}
@@ -0,0 +1,104 @@
+#include "compiler.h"
+#include "scheduler.h"
+#include "test_helpers.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST(SchedulerTest, RunsManyVMsToCompletion) {
+    int total_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var total = 0;"
+        "for (var i = 0; i < 1000; i = i + 1) { total = total + i; }",
+        "total", &total_index);
+
+    // A small slice forces every VM through many preemptions
+    Scheduler* sched = scheduler_create(4, 50);
+    ASSERT_NE(sched, nullptr);
+
+    const int kFibers = 200;
+    std::vector<VM*> vms;
+    std::vector<Fiber*> fibers;
+    for (int i = 0; i < kFibers; i++) {
+        vms.push_back(vm_create(chunk));
+        fibers.push_back(scheduler_spawn(sched, vms.back()));
+        ASSERT_NE(fibers.back(), nullptr);
+    }
+    scheduler_wait_idle(sched);
+
+    for (int i = 0; i < kFibers; i++) {
+        EXPECT_EQ(scheduler_fiber_state(fibers[i]), FIBER_DONE);
+        EXPECT_EQ(scheduler_fiber_result(fibers[i]), VM_RESULT_OK);
+        EXPECT_DOUBLE_EQ(vm_get_global(vms[i], total_index).number_value, 499500.0);
+    }
+
+    scheduler_destroy(sched);
+    for (VM* vm : vms) vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// One worker: a script that never ends must not starve the others
+TEST(SchedulerTest, RunawayScriptIsPreempted) {
+    int unused = -1;
+    BytecodeChunk* spin = compileSource("while (true) { }", "x", &unused);
+    int total_index = -1;
+    BytecodeChunk* sum = compileSource(
+        "var total = 0;"
+        "for (var i = 0; i < 100; i = i + 1) { total = total + i; }",
+        "total", &total_index);
+
+    Scheduler* sched = scheduler_create(1, 100);
+    ASSERT_NE(sched, nullptr);
+    VM* spinner = vm_create(spin);
+    VM* summer = vm_create(sum);
+    Fiber* spin_fiber = scheduler_spawn(sched, spinner);
+    Fiber* sum_fiber = scheduler_spawn(sched, summer);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (scheduler_fiber_state(sum_fiber) != FIBER_DONE &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(scheduler_fiber_state(sum_fiber), FIBER_DONE);
+    EXPECT_DOUBLE_EQ(vm_get_global(summer, total_index).number_value, 4950.0);
+    EXPECT_NE(scheduler_fiber_state(spin_fiber), FIBER_DONE);
+
+    scheduler_destroy(sched);
+    vm_free(spinner);
+    vm_free(summer);
+    vm_free_chunk(spin);
+    vm_free_chunk(sum);
+}
+
+TEST(SchedulerTest, SleepAndWaitForEvent) {
+    int stage_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var stage = 1;"
+        "sleep(5);"
+        "stage = 2;"
+        "wait_event(\"go\");"
+        "stage = 3;",
+        "stage", &stage_index);
+
+    Scheduler* sched = scheduler_create(2, 0);
+    ASSERT_NE(sched, nullptr);
+    VM* vm = vm_create(chunk);
+    Fiber* fiber = scheduler_spawn(sched, vm);
+
+    // Idle means done or blocked on an event; a sleeper keeps it busy
+    scheduler_wait_idle(sched);
+    EXPECT_EQ(scheduler_fiber_state(fiber), FIBER_WAITING);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, stage_index).number_value, 2.0);
+
+    EXPECT_EQ(scheduler_signal(sched, "other"), 0);
+    EXPECT_EQ(scheduler_signal(sched, "go"), 1);
+    scheduler_wait_idle(sched);
+    EXPECT_EQ(scheduler_fiber_state(fiber), FIBER_DONE);
+    EXPECT_EQ(scheduler_fiber_result(fiber), VM_RESULT_OK);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, stage_index).number_value, 3.0);
+
+    scheduler_destroy(sched);
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
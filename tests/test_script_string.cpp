@@ -0,0 +1,94 @@
+#include "script_string.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string text(const ScriptString* s) {
+    return std::string(string_data(s), string_length(s));
+}
+
+TEST(ScriptStringTest, LongSubstringsShareTheRootBuffer) {
+    std::string source;
+    for (int i = 0; i < 100; i++) source += "token" + std::to_string(i) + " ";
+    ScriptString* root = string_create(source.data(), source.size());
+
+    ScriptString* rest = string_substring(root, 6, source.size() - 6);
+    ASSERT_EQ(string_kind(rest), STRING_KIND_SLICE);
+    EXPECT_EQ(string_data(rest), string_data(root) + 6);
+
+    // A slice of a slice points at the root too, and outlives both parents
+    ScriptString* inner = string_substring(rest, 10, 200);
+    ASSERT_EQ(string_kind(inner), STRING_KIND_SLICE);
+    EXPECT_EQ(string_data(inner), string_data(root) + 16);
+    string_release(rest);
+    string_release(root);
+    EXPECT_EQ(text(inner), source.substr(16, 200));
+
+    // The terminated copy is made once and kept
+    const char* c = string_cstr(inner);
+    EXPECT_EQ(std::string(c), source.substr(16, 200));
+    EXPECT_EQ(string_cstr(inner), c);
+    string_release(inner);
+}
+
+TEST(ScriptStringTest, ShortOrPinningSubstringsAreCopied) {
+    std::string big(64 * 1024, 'x');
+    ScriptString* root = string_create(big.data(), big.size());
+
+    ScriptString* tiny = string_substring(root, 100, 8);
+    EXPECT_EQ(string_kind(tiny), STRING_KIND_FLAT);
+    EXPECT_EQ(std::string(string_cstr(tiny)), "xxxxxxxx");
+
+    // 1 KiB would keep 64 KiB alive, so it gets its own buffer
+    ScriptString* small = string_substring(root, 0, 1024);
+    EXPECT_EQ(string_kind(small), STRING_KIND_FLAT);
+
+    ScriptString* whole = string_substring(root, 0, big.size());
+    EXPECT_EQ(whole, root);
+
+    string_release(tiny);
+    string_release(small);
+    string_release(whole);
+    string_release(root);
+}
+
+TEST(ScriptStringTest, EqualityAndConcatIgnoreKind) {
+    std::string source(200, 'a');
+    source += "needle";
+    ScriptString* root = string_from_cstr(source.c_str());
+    ScriptString* slice = string_substring(root, 100, 106);
+    ScriptString* flat = string_create(source.data() + 100, 106);
+    ASSERT_EQ(string_kind(slice), STRING_KIND_SLICE);
+    EXPECT_TRUE(string_equals(slice, flat));
+    EXPECT_FALSE(string_equals(slice, root));
+
+    ScriptString* joined = string_concat(string_data(slice), string_length(slice), "!", 1);
+    EXPECT_EQ(std::string(string_cstr(joined)), source.substr(100) + "!");
+
+    string_release(joined);
+    string_release(flat);
+    string_release(slice);
+    string_release(root);
+}
+
+// Threads sharing a slice agree on one terminated copy
+TEST(ScriptStringTest, ConcurrentCstrOnSharedSlice) {
+    std::string source(4000, 'q');
+    ScriptString* root = string_create(source.data(), source.size());
+    ScriptString* slice = string_substring(root, 1, 3000);
+    string_release(root);
+
+    const int kThreads = 8;
+    std::vector<const char*> seen(kThreads, nullptr);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t]() { seen[t] = string_cstr(slice); });
+    }
+    for (auto& th : threads) th.join();
+    for (int t = 1; t < kThreads; t++) {
+        EXPECT_EQ(seen[t], seen[0]);
+    }
+    EXPECT_EQ(std::string(seen[0]).size(), 3000u);
+    string_release(slice);
+}
@@ -0,0 +1,92 @@
+#include "string_kernels.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+static size_t naiveFind(const std::string& haystack, const std::string& needle) {
+    size_t at = haystack.find(needle);
+    return at == std::string::npos ? STRING_NOT_FOUND : at;
+}
+
+TEST(StringKernelsTest, FindMatchesNaiveSearchAtEveryOffset) {
+    // Place the needle at every offset of haystacks around the block size,
+    // behind near misses that share its first or last byte
+    const std::string needles[] = { "x", "xy", "xoy", "needle", "abcdefghijklmnopqrstu" };
+    for (const std::string& needle : needles) {
+        for (size_t length = 0; length < 70; length++) {
+            std::string base;
+            for (size_t i = 0; i < length; i++) {
+                base += (i % 3 == 0) ? needle[0] : (i % 3 == 1 ? needle.back() : '.');
+            }
+            SCOPED_TRACE(needle + " in " + std::to_string(length));
+            EXPECT_EQ(string_find(base.data(), base.size(), needle.data(), needle.size()),
+                      naiveFind(base, needle));
+            for (size_t at = 0; at + needle.size() <= length; at++) {
+                std::string haystack = base;
+                haystack.replace(at, needle.size(), needle);
+                EXPECT_EQ(string_find(haystack.data(), haystack.size(), needle.data(), needle.size()),
+                          naiveFind(haystack, needle));
+            }
+        }
+    }
+    EXPECT_EQ(string_find("abc", 3, "", 0), 0u);
+    EXPECT_EQ(string_find("ab", 2, "abc", 3), STRING_NOT_FOUND);
+}
+
+TEST(StringKernelsTest, CountIsNonOverlapping) {
+    EXPECT_EQ(string_count("aaaa", 4, "aa", 2), 2u);
+    EXPECT_EQ(string_count("abcabcab", 8, "abc", 3), 2u);
+    EXPECT_EQ(string_count("abc", 3, "", 0), 0u);
+    std::string long_text(1000, '-');
+    for (size_t i = 0; i < long_text.size(); i += 37) long_text[i] = '#';
+    EXPECT_EQ(string_count(long_text.data(), long_text.size(), "#", 1), 28u);
+}
+
+TEST(StringKernelsTest, CaseMappingCoversAsciiAndTwoByteLetters) {
+    // Long enough that the vector loop, the non-ASCII fallback and the
+    // scalar tail all run
+    std::string mixed;
+    for (int i = 0; i < 5; i++) {
+        mixed += "Hello, World! [az@AZ`{] ";
+        mixed += "Ωmega ÿ ж Ж Ѐѐ ç Ç ÷× 東京 ";
+    }
+    std::string upper(mixed.size(), '\0');
+    std::string lower(mixed.size(), '\0');
+    string_to_upper(&upper[0], mixed.data(), mixed.size());
+    string_to_lower(&lower[0], mixed.data(), mixed.size());
+
+    std::string expected_upper, expected_lower;
+    for (int i = 0; i < 5; i++) {
+        expected_upper += "HELLO, WORLD! [AZ@AZ`{] ";
+        expected_upper += "ΩMEGA Ÿ Ж Ж ЀЀ Ç Ç ÷× 東京 ";
+        expected_lower += "hello, world! [az@az`{] ";
+        expected_lower += "ωmega ÿ ж ж ѐѐ ç ç ÷× 東京 ";
+    }
+    EXPECT_EQ(upper, expected_upper);
+    EXPECT_EQ(lower, expected_lower);
+}
+
+// Latin Extended-A alternates case by code point parity, with the parity
+// flipping at U+0139 and U+0179
+TEST(StringKernelsTest, CaseMappingCoversLatinExtendedA) {
+    std::string text = "Łódź Żółć ąĄ ĹĺŇň ŹźŽž ĲĳŸ İıĸŉſ";
+    std::string upper(text.size(), '\0');
+    std::string lower(text.size(), '\0');
+    string_to_upper(&upper[0], text.data(), text.size());
+    string_to_lower(&lower[0], text.data(), text.size());
+    EXPECT_EQ(upper, "ŁÓDŹ ŻÓŁĆ ĄĄ ĹĹŇŇ ŹŹŽŽ ĲĲŸ İıĸŉſ");
+    EXPECT_EQ(lower, "łódź żółć ąą ĺĺňň źźžž ĳĳÿ İıĸŉſ");
+}
+
+TEST(StringKernelsTest, CaseMappingLeavesMalformedUtf8Alone) {
+    const char bad[] = "ab\xC3" "c\x80\xFF\xE6\x9D" "d\xC3";
+    size_t length = sizeof(bad) - 1;
+    char out[sizeof(bad)];
+    string_to_upper(out, bad, length);
+    EXPECT_EQ(std::memcmp(out, "AB\xC3" "C\x80\xFF\xE6\x9D" "D\xC3", length), 0);
+
+    // In place
+    std::string text = "MiXeD CaSe TeXt ThAt Is LoNgEr ThAn OnE BlOcK";
+    string_to_lower(&text[0], text.data(), text.size());
+    EXPECT_EQ(text, "mixed case text that is longer than one block");
+}
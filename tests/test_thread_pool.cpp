@@ -0,0 +1,89 @@
+#include "runtime.h"
+#include "thread_pool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+
+static std::atomic<int> g_counter(0);
+
+static void incrementTask(void* arg) {
+    (void)arg;
+    g_counter.fetch_add(1);
+}
+
+// Spawns children from inside a worker and joins them there
+static void fanOutTask(void* arg) {
+    ThreadPool* pool = (ThreadPool*)arg;
+    std::vector<ThreadPoolTask*> children;
+    for (int i = 0; i < 16; i++) {
+        children.push_back(thread_pool_submit(pool, incrementTask, NULL));
+    }
+    for (ThreadPoolTask* child : children) {
+        thread_pool_join(child);
+    }
+}
+
+TEST(ThreadPoolTest, RunsEveryTaskOnce) {
+    ThreadPool* pool = thread_pool_create(4);
+    ASSERT_NE(pool, nullptr);
+    EXPECT_EQ(thread_pool_worker_count(pool), 4);
+
+    g_counter = 0;
+    std::vector<ThreadPoolTask*> tasks;
+    for (int i = 0; i < 1000; i++) {
+        tasks.push_back(thread_pool_submit(pool, incrementTask, NULL));
+    }
+    for (ThreadPoolTask* t : tasks) {
+        thread_pool_join(t);
+    }
+    EXPECT_EQ(g_counter.load(), 1000);
+
+    thread_pool_destroy(pool);
+}
+
+TEST(ThreadPoolTest, NestedJoinsFromWorkersComplete) {
+    // A single worker must help run its children instead of blocking on them
+    ThreadPool* pool = thread_pool_create(1);
+    ASSERT_NE(pool, nullptr);
+
+    g_counter = 0;
+    std::vector<ThreadPoolTask*> parents;
+    for (int i = 0; i < 8; i++) {
+        parents.push_back(thread_pool_submit(pool, fanOutTask, pool));
+    }
+    for (ThreadPoolTask* t : parents) {
+        thread_pool_join(t);
+    }
+    EXPECT_EQ(g_counter.load(), 8 * 16);
+
+    thread_pool_destroy(pool);
+}
+
+TEST(ThreadPoolTest, ExecuteInThreadUsesSnapshot) {
+    const char* source = "{ x = x + 41; var y = x; }";
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    Parser* parser = parser_create(&lexer);
+    ASTNode* block = parse_block(parser);
+    ASSERT_NE(block, nullptr);
+
+    Environment* env = runtime_create_environment();
+    RuntimeValue one;
+    one.type = RUNTIME_VALUE_NUMBER;
+    one.number_value = 1;
+    runtime_set_variable(env, "x", one);
+
+    ThreadPoolTask* task = runtime_execute_in_thread(env, block);
+    ASSERT_NE(task, nullptr);
+    thread_pool_join(task);
+
+    // The block only saw a copy of the caller's bindings
+    RuntimeValue* x = runtime_get_variable(env, "x");
+    ASSERT_NE(x, nullptr);
+    EXPECT_DOUBLE_EQ(x->number_value, 1.0);
+    EXPECT_EQ(runtime_get_variable(env, "y"), nullptr);
+
+    runtime_free_environment(env);
+    free_ast(block);
+    free(parser);
+}
@@ -0,0 +1,144 @@
+#include "builtins.h"
+#include "timer_wheel.h"
+#include "test_helpers.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include <vector>
+
+static double number(Environment* env, const char* name) {
+    RuntimeValue* value = runtime_get_variable(env, name);
+    return value && value->type == RUNTIME_VALUE_NUMBER ? value->number_value : -1;
+}
+
+TEST(TimerWheelTest, TimeoutsAndIntervalsFireOnTick) {
+    TimerWheel* wheel = timer_wheel_create();
+    ASSERT_NE(wheel, nullptr);
+    timer_wheel_bind(wheel);
+    ASTNode* root = nullptr;
+    Environment* env = runScript(
+        "var once = 0;"
+        "var every = 0;"
+        "function a() { once = once + 1; }"
+        "function b() { every = every + 1; }"
+        "set_timeout(a, 500);"
+        "var iv = set_interval(b, 200);",
+        &root);
+    EXPECT_EQ(timer_wheel_pending(wheel), 2);
+
+    EXPECT_EQ(timer_wheel_tick(wheel, env, 199), 0);
+    EXPECT_EQ(timer_wheel_tick(wheel, env, 1), 1);
+    EXPECT_DOUBLE_EQ(number(env, "every"), 1.0);
+
+    EXPECT_EQ(timer_wheel_tick(wheel, env, 300), 2);
+    EXPECT_DOUBLE_EQ(number(env, "once"), 1.0);
+    EXPECT_DOUBLE_EQ(number(env, "every"), 2.0);
+    EXPECT_EQ(timer_wheel_pending(wheel), 1);
+
+    EXPECT_TRUE(timer_wheel_cancel(wheel, number(env, "iv")));
+    EXPECT_FALSE(timer_wheel_cancel(wheel, number(env, "iv")));
+    EXPECT_EQ(timer_wheel_tick(wheel, env, 1000), 0);
+    EXPECT_EQ(timer_wheel_pending(wheel), 0);
+
+    timer_wheel_free(wheel);
+    EXPECT_EQ(timer_wheel_current(), nullptr);
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+TEST(TimerWheelTest, IntervalCanCancelItself) {
+    TimerWheel* wheel = timer_wheel_create();
+    ASSERT_NE(wheel, nullptr);
+    timer_wheel_bind(wheel);
+    ASTNode* root = nullptr;
+    Environment* env = runScript(
+        "var n = 0;"
+        "var id = 0;"
+        "function f() { n = n + 1; if (n == 3) { cancel(id); } }"
+        "id = set_interval(f, 10);",
+        &root);
+
+    EXPECT_EQ(timer_wheel_tick(wheel, env, 100), 3);
+    EXPECT_DOUBLE_EQ(number(env, "n"), 3.0);
+    EXPECT_EQ(timer_wheel_pending(wheel), 0);
+
+    timer_wheel_free(wheel);
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Long delays start on the upper levels and must cascade down on time
+TEST(TimerWheelTest, ManyTimersAcrossLevels) {
+    TimerWheel* wheel = timer_wheel_create();
+    ASSERT_NE(wheel, nullptr);
+    timer_wheel_bind(wheel);
+    ASTNode* root = nullptr;
+    Environment* env = runScript("var fired = 0; function hit() { fired = fired + 1; }", &root);
+    RuntimeValue* hit = runtime_get_variable(env, "hit");
+    ASSERT_NE(hit, nullptr);
+
+    const int kTimers = 100000;
+    std::vector<double> ids;
+    ids.reserve(kTimers);
+    for (int i = 0; i < kTimers; i++) {
+        // Spread over ~11 minutes so every level is used
+        ids.push_back(timer_wheel_schedule(wheel, hit, 1 + (double)i * 7, 0));
+    }
+    for (int i = 0; i < kTimers; i += 2) {
+        EXPECT_TRUE(timer_wheel_cancel(wheel, ids[i]));
+    }
+    EXPECT_EQ(timer_wheel_pending(wheel), kTimers / 2);
+
+    // The last timer is due at 1 + 7 * 99999 ms; one tick short of it
+    const uint64_t last = 1 + 7ull * (kTimers - 1);
+    int fired = 0;
+    for (uint64_t t = 0; t + 16 <= last - 1; t += 16) {
+        fired += timer_wheel_tick(wheel, env, 16);
+    }
+    fired += timer_wheel_tick(wheel, env, (last - 1) % 16);
+    EXPECT_EQ(fired, kTimers / 2 - 1);
+    EXPECT_EQ(timer_wheel_tick(wheel, env, 1), 1);
+    EXPECT_DOUBLE_EQ(number(env, "fired"), kTimers / 2);
+    EXPECT_EQ(timer_wheel_pending(wheel), 0);
+
+    timer_wheel_free(wheel);
+    runtime_free_environment(env);
+    free_ast(root);
+}
+
+// Non-finite delays and ids are rejected before any cast; huge delays are
+// capped instead of overflowing the wheel's clock
+TEST(TimerWheelTest, OutOfRangeArgumentsAreRejected) {
+    TimerWheel* wheel = timer_wheel_create();
+    ASSERT_NE(wheel, nullptr);
+    timer_wheel_bind(wheel);
+    ASTNode* root = nullptr;
+    testing::internal::CaptureStderr();
+    Environment* env = runScript(
+        "var inf = 1e300 * 1e300;"
+        "var nan = inf - inf;"
+        "function f() { }"
+        "var never = set_timeout(f, inf);"
+        "var also_never = set_interval(f, nan);"
+        "var late = set_timeout(f, 1e300);"
+        "var by_nan = cancel(nan);"
+        "var by_huge = cancel(1e30);",
+        &root);
+    testing::internal::GetCapturedStderr();
+
+    EXPECT_EQ(runtime_get_variable(env, "never")->type, RUNTIME_VALUE_NULL);
+    EXPECT_EQ(runtime_get_variable(env, "also_never")->type, RUNTIME_VALUE_NULL);
+    EXPECT_GE(number(env, "late"), 0.0);
+    EXPECT_FALSE(runtime_get_variable(env, "by_nan")->boolean_value);
+    EXPECT_FALSE(runtime_get_variable(env, "by_huge")->boolean_value);
+    EXPECT_FALSE(timer_wheel_cancel(wheel, std::nan("")));
+    EXPECT_FALSE(timer_wheel_cancel(wheel, -1));
+
+    EXPECT_EQ(timer_wheel_pending(wheel), 1);
+    EXPECT_EQ(timer_wheel_tick(wheel, env, 1000), 0);
+    EXPECT_TRUE(timer_wheel_cancel(wheel, number(env, "late")));
+
+    timer_wheel_free(wheel);
+    runtime_free_environment(env);
+    free_ast(root);
+}
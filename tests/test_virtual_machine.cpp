@@ -0,0 +1,545 @@
+#include "compiler.h"
+#include "vm_profile.h"
+#include "array.h"
+#include "script_string.h"
+#include "output_sink.h"
+#include "test_helpers.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <string>
+#include <vector>
+
+static const char* kSumLoop =
+    "var total = 0;"
+    "for (var i = 0; i < 1000; i = i + 1) { total = total + i; }";
+
+// Globals belong to the VM, not the process
+TEST(VirtualMachineTest, GlobalsAreIsolatedPerVM) {
+    int total_index = -1;
+    BytecodeChunk* chunk = compileSource(kSumLoop, "total", &total_index);
+
+    VM* first = vm_create(chunk);
+    VM* second = vm_create(chunk);
+    ASSERT_EQ(vm_run(first), VM_RESULT_OK);
+
+    RuntimeValue done = vm_get_global(first, total_index);
+    ASSERT_EQ(done.type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(done.number_value, 499500.0);
+    EXPECT_EQ(vm_get_global(second, total_index).type, RUNTIME_VALUE_NULL);
+
+    vm_free(first);
+    vm_free(second);
+    vm_free_chunk(chunk);
+}
+
+// One compiled chunk shared by many VMs running on their own threads
+TEST(VirtualMachineTest, ConcurrentVMsShareOneChunk) {
+    int total_index = -1;
+    BytecodeChunk* chunk = compileSource(kSumLoop, "total", &total_index);
+
+    const int kThreads = 8;
+    std::vector<double> results(kThreads, -1.0);
+    std::vector<int> statuses(kThreads, -1);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t]() {
+            for (int round = 0; round < 20; round++) {
+                VM* vm = vm_create(chunk);
+                statuses[t] = vm_run(vm);
+                RuntimeValue total = vm_get_global(vm, total_index);
+                results[t] = total.type == RUNTIME_VALUE_NUMBER ? total.number_value : -1.0;
+                vm_free(vm);
+                if (statuses[t] != VM_RESULT_OK || results[t] != 499500.0) break;
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    for (int t = 0; t < kThreads; t++) {
+        EXPECT_EQ(statuses[t], VM_RESULT_OK);
+        EXPECT_DOUBLE_EQ(results[t], 499500.0);
+    }
+    vm_free_chunk(chunk);
+}
+
+TEST(VirtualMachineTest, CallsCompiledFunctions) {
+    int result_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "function fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }"
+        "var result = fib(20);",
+        "result", &result_index);
+
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    RuntimeValue result = vm_get_global(vm, result_index);
+    ASSERT_EQ(result.type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(result.number_value, 6765.0);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Building an array literal leaves exactly one value on the stack, so it
+// can sit inside a loop body
+TEST(VirtualMachineTest, ArrayLiteralInsideLoop) {
+    int total_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var total = 0;"
+        "for (var i = 0; i < 10; i = i + 1) { var items = [1, 2, 3]; total = total + items[i % 3]; }",
+        "total", &total_index);
+
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    RuntimeValue total = vm_get_global(vm, total_index);
+    ASSERT_EQ(total.type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(total.number_value, 19.0);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Reads and writes through nested objects; the single shape each site sees
+// keeps its cache monomorphic
+TEST(VirtualMachineTest, NestedPropertiesReadAndWrite) {
+    int strength_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "function train(p) { p.stats.strength = p.stats.strength + 1; }"
+        "var player = { health = 10, stats = { strength = 12, agility = 8 } };"
+        "for (var i = 0; i < 5; i = i + 1) { train(player); }"
+        "player.mana = player.health - 4;"
+        "var strength = player.stats.strength + player.mana;",
+        "strength", &strength_index);
+    ASSERT_GT(chunk->property_cache_count, 0);
+
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    RuntimeValue strength = vm_get_global(vm, strength_index);
+    ASSERT_EQ(strength.type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(strength.number_value, 23.0);
+
+    // train()'s first site is `p.stats` on the left-hand side
+    EXPECT_EQ(vm->property_caches[0].count, 1);
+    EXPECT_FALSE(vm->property_caches[0].megamorphic);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// One read site fed objects of more shapes than the cache has ways still
+// finds the property, through the uncached lookup
+TEST(VirtualMachineTest, PolymorphicPropertySites) {
+    int total_index = -1;
+    const char* source =
+        "function hp(o) { return o.health; }"
+        "var mobs = [{ health = 1 }, { armor = 0, health = 2 }, { speed = 0, health = 3 },"
+        "            { name = 0, health = 4 }, { level = 0, health = 5 }];"
+        "var total = 0;"
+        "for (var i = 0; i < 20; i = i + 1) { total = total + hp(mobs[i %% %d]); }";
+    char two_shapes[512];
+    char five_shapes[512];
+    snprintf(two_shapes, sizeof(two_shapes), source, 2);
+    snprintf(five_shapes, sizeof(five_shapes), source, 5);
+
+    BytecodeChunk* chunk = compileSource(two_shapes, "total", &total_index);
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, total_index).number_value, 30.0);
+    EXPECT_EQ(vm->property_caches[0].count, 2);
+    vm_free(vm);
+    vm_free_chunk(chunk);
+
+    chunk = compileSource(five_shapes, "total", &total_index);
+    vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, total_index).number_value, 60.0);
+    EXPECT_TRUE(vm->property_caches[0].megamorphic);
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Computed keys that are not identifiers put the object in dictionary mode;
+// reads and overwrites still find every key
+TEST(VirtualMachineTest, DictionaryObjectsIndexByString) {
+    int hit_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var catalog = {};"
+        "for (var i = 0; i < 1000; i = i + 1) { catalog[\"item-\" + i] = i * 2; }"
+        "catalog[\"item-\" + 7] = catalog[\"item-\" + 7] + 1;"
+        "var hit = catalog[\"item-\" + 500] + catalog[\"item-\" + 999] + catalog[\"item-\" + 7];"
+        "if (catalog[\"missing\"] != null) { hit = -1; }",
+        "hit", &hit_index);
+
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, hit_index).number_value, 1000.0 + 1998.0 + 15.0);
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// push/len/slice/indexing run inline on packed arrays; boxing a slice
+// leaves the array it came from unboxed
+TEST(VirtualMachineTest, PackedArraysStayUnboxed) {
+    int xs_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var xs = [];"
+        "for (var i = 0; i < 1000; i = i + 1) { push(xs, i * 0.5); }"
+        "var head = slice(xs, 0, 3);"
+        "head[1] = \"b\";"
+        "xs[0] = len(head) + len(slice(xs, 990));",
+        "xs", &xs_index);
+
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    RuntimeValue xs = vm_get_global(vm, xs_index);
+    ASSERT_EQ(xs.type, RUNTIME_VALUE_ARRAY);
+    ASSERT_EQ(array_count(xs.array_value), 1000);
+    EXPECT_EQ(array_kind(xs.array_value), ARRAY_KIND_DOUBLE);
+    const double* numbers = array_numbers(xs.array_value);
+    ASSERT_NE(numbers, nullptr);
+    EXPECT_DOUBLE_EQ(numbers[0], 13.0);
+    EXPECT_DOUBLE_EQ(numbers[999], 499.5);
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Host numeric builtins are called directly, unless the script defines a
+// function of the same name, even after the call site
+TEST(VirtualMachineTest, NativeBuiltinsYieldToScriptFunctions) {
+    int result_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "function run() { return scale(2, 5) + sum(clamp_all([1, 50, 7], 0, 10)) + dot([1, 2], [3, 4]); }"
+        "function scale(x, k) { return x * k * 100; }"
+        "var result = run();",
+        "result", &result_index);
+
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, result_index).number_value, 1000.0 + 18.0 + 11.0);
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// The string natives are callable from compiled code, and a script function
+// of the same name still wins
+TEST(VirtualMachineTest, StringNativesYieldToScriptFunctions) {
+    int result_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "function run() { return index_of(to_upper(replace(\"a-b-c\", \"-\", \"+\")), \"B+C\")"
+        "  + index_of(to_lower(\"ABC\"), \"shadowed\"); }"
+        "function to_lower(s) { return \"x shadowed\"; }"
+        "var result = run();",
+        "result", &result_index);
+
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, result_index).number_value, 2.0 + 2.0);
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// OP_PRINT, OP_ADD on strings and the to_string native share one formatter
+TEST(VirtualMachineTest, NumbersPrintAsTheyConcatenate) {
+    int label_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var label = \"x=\" + 0.5 + \"/\" + to_string(12) + \"/\" + 1 / 4;"
+        "print(0.1 + 0.2);"
+        "print(label);",
+        "label", &label_index);
+
+    VM* vm = vm_create(chunk);
+    OutputSink* capture = output_sink_create_memory();
+    output_sink_bind(capture);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    output_sink_bind(nullptr);
+    size_t length = 0;
+    const char* printed = output_sink_contents(capture, &length);
+    EXPECT_EQ(std::string(printed, length), "0.30000000000000004\nx=0.5/12/0.25\n");
+    output_sink_free(capture);
+    RuntimeValue label = vm_get_global(vm, label_index);
+    ASSERT_EQ(label.type, RUNTIME_VALUE_STRING);
+    EXPECT_STREQ(string_cstr(label.string_value), "x=0.5/12/0.25");
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Each resume passes a value in and gets the next yielded value back
+TEST(VirtualMachineTest, CoroutinesYieldAndResume) {
+    int sum_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "function counter(start) {"
+        "  var i = start;"
+        "  while (true) { var step = coroutine_yield(i); i = i + step; }"
+        "}"
+        "var co = coroutine_create(counter);"
+        "var a = coroutine_resume(co, 10);"
+        "var b = coroutine_resume(co, 5);"
+        "var c = coroutine_resume(co, 100);"
+        "var sum = a * 10000 + b * 100 + c;",
+        "sum", &sum_index);
+
+    VM* vm = vm_create(chunk);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    RuntimeValue sum = vm_get_global(vm, sum_index);
+    ASSERT_EQ(sum.type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(sum.number_value, 10 * 10000 + 15 * 100 + 115);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+TEST(VirtualMachineTest, ResumingFinishedCoroutineFails) {
+    int first_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "function twice(x) { return x * 2; }"
+        "var co = coroutine_create(twice);"
+        "var first = coroutine_resume(co, 21);"
+        "coroutine_resume(co);",
+        "first", &first_index);
+
+    VM* vm = vm_create(chunk);
+    EXPECT_EQ(vm_run(vm), VM_RESULT_ERROR);
+    RuntimeValue first = vm_get_global(vm, first_index);
+    ASSERT_EQ(first.type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(first.number_value, 42.0);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Infinity would overflow the sleep deadline; it is rejected up front
+TEST(VirtualMachineTest, SleepRejectsNonFiniteDelay) {
+    int big_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var big = 1;"
+        "for (var i = 0; i < 400; i = i + 1) { big = big * 10; }"
+        "sleep(big);",
+        "big", &big_index);
+
+    VM* vm = vm_create(chunk);
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(vm_run(vm), VM_RESULT_ERROR);
+    std::string err = testing::internal::GetCapturedStderr();
+    EXPECT_NE(err.find("finite"), std::string::npos);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Compiled slice() clamps huge bounds and rejects infinite ones
+TEST(VirtualMachineTest, SliceRejectsNonFiniteBounds) {
+    int count_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var big = 1;"
+        "for (var i = 0; i < 300; i = i + 1) { big = big * 10; }"
+        "var xs = [1, 2, 3];"
+        "var count = len(slice(xs, 0 - big, big));"
+        "slice(xs, 0, big * big);",
+        "count", &count_index);
+
+    VM* vm = vm_create(chunk);
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(vm_run(vm), VM_RESULT_ERROR);
+    std::string err = testing::internal::GetCapturedStderr();
+    EXPECT_NE(err.find("finite"), std::string::npos);
+    RuntimeValue count = vm_get_global(vm, count_index);
+    ASSERT_EQ(count.type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(count.number_value, 3.0);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Script functions named like an intrinsic are called, not inlined
+TEST(VirtualMachineTest, ScriptFunctionsShadowIntrinsics) {
+    int total_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "function len(x) { return 1; }"
+        "function sleep(ms) { return 10; }"
+        "function coroutine_create(f) { return 100; }"
+        "var total = len([1, 2, 3]) + sleep(5) + coroutine_create(len);",
+        "total", &total_index);
+
+    VM* vm = vm_create(chunk);
+    EXPECT_EQ(vm_run(vm), VM_RESULT_OK);
+    RuntimeValue total = vm_get_global(vm, total_index);
+    ASSERT_EQ(total.type, RUNTIME_VALUE_NUMBER);
+    EXPECT_DOUBLE_EQ(total.number_value, 111.0);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+// Slices pick up exactly where the previous one stopped
+TEST(VirtualMachineTest, SlicesResumeWhereTheyStopped) {
+    int total_index = -1;
+    BytecodeChunk* chunk = compileSource(kSumLoop, "total", &total_index);
+
+    VM* vm = vm_create(chunk);
+    int slices = 1;
+    int status;
+    while ((status = vm_run_slice(vm, 10)) == VM_RESULT_YIELDED) {
+        slices++;
+    }
+    EXPECT_EQ(status, VM_RESULT_OK);
+    // One unit of fuel per loop iteration: 1000 iterations in slices of 10
+    EXPECT_GE(slices, 100);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, total_index).number_value, 499500.0);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+TEST(VirtualMachineTest, FuelStopsRunawayLoop) {
+    int unused = -1;
+    BytecodeChunk* chunk = compileSource("var n = 0; while (true) { n = n + 1; }", "n", &unused);
+
+    VM* vm = vm_create(chunk);
+    vm_set_fuel(vm, 1000);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_YIELDED);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, unused).number_value, 1000.0);
+    // Each run refills the tank and picks up at the loop head
+    ASSERT_EQ(vm_run(vm), VM_RESULT_YIELDED);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, unused).number_value, 2000.0);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+TEST(VirtualMachineTest, ProfileCountsEveryInstruction) {
+    int i_index = -1;
+    BytecodeChunk* chunk = compileSource("var i = 0; while (i < 50) { i = i + 1; }", "i", &i_index);
+
+    VMProfile* profile = vm_profile_create(chunk);
+    ASSERT_NE(profile, nullptr);
+    VM* vm = vm_create(chunk);
+    vm_set_profile(vm, profile);
+    ASSERT_EQ(vm_run(vm), VM_RESULT_OK);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, i_index).number_value, 50.0);
+
+    EXPECT_EQ(profile->op_counts[OP_LOOP], 50u);
+    EXPECT_EQ(profile->op_counts[OP_EOF], 1u);
+    uint64_t by_opcode = 0;
+    uint64_t by_offset = 0;
+    for (int op = 0; op < 256; op++) {
+        by_opcode += profile->op_counts[op];
+    }
+    for (int i = 0; i < profile->code_size; i++) {
+        by_offset += profile->offset_hits[i];
+    }
+    EXPECT_EQ(by_opcode, by_offset);
+    EXPECT_STREQ(vm_opcode_name(OP_LOOP), "LOOP");
+    EXPECT_STREQ(vm_opcode_name(OP_WAIT_EVENT), "WAIT_EVENT");
+
+    vm_free(vm);
+    vm_profile_free(profile);
+    vm_free_chunk(chunk);
+}
+
+TEST(VirtualMachineTest, LineTableMapsOffsetsToLines) {
+    BytecodeChunk* chunk = vm_create_chunk();
+    vm_chunk_mark_line(chunk, 1);
+    vm_chunk_write_byte(chunk, OP_NOOP);
+    vm_chunk_write_byte(chunk, OP_NOOP);
+    vm_chunk_write_byte(chunk, OP_NOOP);
+    vm_chunk_mark_line(chunk, 1);  // Same line: no new run
+    vm_chunk_mark_line(chunk, 2);
+    vm_chunk_mark_line(chunk, 3);  // Nothing emitted for line 2
+    vm_chunk_write_byte(chunk, OP_NOOP);
+    vm_chunk_write_byte(chunk, OP_NOOP);
+    vm_chunk_mark_line(chunk, 5);
+    vm_chunk_write_byte(chunk, OP_EOF);
+
+    EXPECT_EQ(chunk->line_count, 3);
+    EXPECT_EQ(vm_chunk_line_at(chunk, 0), 1);
+    EXPECT_EQ(vm_chunk_line_at(chunk, 2), 1);
+    EXPECT_EQ(vm_chunk_line_at(chunk, 3), 3);
+    EXPECT_EQ(vm_chunk_line_at(chunk, 4), 3);
+    EXPECT_EQ(vm_chunk_line_at(chunk, 5), 5);
+    EXPECT_EQ(vm_chunk_line_at(chunk, 100), 5);
+    vm_free_chunk(chunk);
+}
+
+TEST(VirtualMachineTest, CompilerRecordsStatementLines) {
+    int b_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var a = 1;\n"
+        "var b = 2;\n"
+        "\n"
+        "while (b < 4) {\n"
+        "  b = b + 1;\n"
+        "}\n",
+        "b", &b_index);
+
+    ASSERT_GT(chunk->line_count, 0);
+    EXPECT_EQ(vm_chunk_line_at(chunk, 0), 1);
+    bool seen[7] = {};
+    for (int i = 0; i < chunk->line_count; i++) {
+        if (i > 0) {
+            EXPECT_GT(chunk->lines[i].offset, chunk->lines[i - 1].offset);
+        }
+        ASSERT_GE(chunk->lines[i].line, 1);
+        ASSERT_LE(chunk->lines[i].line, 6);
+        seen[chunk->lines[i].line] = true;
+    }
+    EXPECT_TRUE(seen[1] && seen[2] && seen[4] && seen[5]);
+    EXPECT_FALSE(seen[3]);
+    vm_free_chunk(chunk);
+}
+
+// Code merged in by an import is attributed to the import statement
+TEST(VirtualMachineTest, ErrorsInImportedCodeReportImportLine) {
+    FILE* imported = fopen("line_table_import.ember", "w");
+    ASSERT_NE(imported, nullptr);
+    fputs("var first = 1;\nvar second = first / 0;\n", imported);
+    fclose(imported);
+
+    int unused = -1;
+    BytecodeChunk* chunk = compileSource(
+        "var a = 1;\n"
+        "var b = 2;\n"
+        "\n"
+        "import line_table_import.ember;\n"
+        "var c = 3;\n",
+        "c", &unused);
+    remove("line_table_import.ember");
+
+    // Only the importing script's own statement lines appear in the table
+    for (int i = 0; i < chunk->line_count; i++) {
+        int line = chunk->lines[i].line;
+        EXPECT_TRUE(line == 1 || line == 2 || line == 4 || line == 5) << line;
+    }
+    VM* vm = vm_create(chunk);
+    testing::internal::CaptureStderr();
+    EXPECT_NE(vm_run(vm), VM_RESULT_OK);
+    std::string errors = testing::internal::GetCapturedStderr();
+    EXPECT_NE(errors.find("[line 4]"), std::string::npos) << errors;
+    EXPECT_EQ(errors.find("[line 1]"), std::string::npos) << errors;
+    EXPECT_EQ(errors.find("[line 2]"), std::string::npos) << errors;
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
+
+TEST(VirtualMachineTest, FuelMetersRecursion) {
+    int result_index = -1;
+    BytecodeChunk* chunk = compileSource(
+        "function fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }"
+        "var result = fib(15);",
+        "result", &result_index);
+
+    VM* vm = vm_create(chunk);
+    vm_set_fuel(vm, 100);
+    int runs = 1;
+    int status;
+    while ((status = vm_run(vm)) == VM_RESULT_YIELDED) {
+        runs++;
+    }
+    EXPECT_EQ(status, VM_RESULT_OK);
+    // fib(15) makes 1973 calls
+    EXPECT_GE(runs, 19);
+    EXPECT_DOUBLE_EQ(vm_get_global(vm, result_index).number_value, 610.0);
+
+    vm_free(vm);
+    vm_free_chunk(chunk);
+}
@@ -0,0 +1,56 @@
+#include "compiler.h"
+#include "vm_sampler.h"
+#include "test_helpers.h"
+#include <gtest/gtest.h>
+#include <string>
+
+// ThreadSanitizer defers async signals to the next libc call, so samples
+// only land once the script has finished
+#if defined(__SANITIZE_THREAD__)
+#define SAMPLES_ARE_DEFERRED 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define SAMPLES_ARE_DEFERRED 1
+#endif
+#endif
+
+TEST(VMSamplerTest, FoldsSampledCallStacks) {
+    BytecodeChunk* chunk = compileSource(
+        "function fib(n) {\n"
+        "  if (n < 2) { return n; }\n"
+        "  return fib(n - 1) + fib(n - 2);\n"
+        "}\n"
+        "function work() {\n"
+        "  return fib(25);\n"
+        "}\n"
+        "var result = work();\n");
+
+    VMSampler* sampler = vm_sampler_create(1000, 0);
+    ASSERT_NE(sampler, nullptr);
+
+    // ITIMER_PROF counts CPU time, so the run has to last a few ticks
+    VM* vm = vm_create(chunk);
+    ASSERT_TRUE(vm_sampler_start(sampler, vm));
+    EXPECT_EQ(vm_run(vm), VM_RESULT_OK);
+    vm_sampler_stop(sampler);
+    vm_free(vm);
+    ASSERT_GT(vm_sampler_sample_count(sampler), 0);
+
+    char* text = nullptr;
+    size_t size = 0;
+    FILE* out = open_memstream(&text, &size);
+    ASSERT_TRUE(vm_sampler_write_folded(sampler, out));
+    fclose(out);
+
+    std::string folded(text, size);
+    free(text);
+#ifndef SAMPLES_ARE_DEFERRED
+    // Callers are labelled with the line of their pending call
+    EXPECT_NE(folded.find("main:8;work:6;fib:3"), std::string::npos) << folded;
+#endif
+    // Every line ends in " <count>"
+    EXPECT_EQ(folded.back(), '\n');
+
+    vm_sampler_free(sampler);
+    vm_free_chunk(chunk);
+}